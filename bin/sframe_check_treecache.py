@@ -0,0 +1,234 @@
+#!/usr/bin/env python
+# $Id$
+#***************************************************************************
+#* @Project: SFrame - ROOT-based analysis framework for ATLAS
+#* @Package: Core
+#*
+#* @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+#* @author David Berge      <David.Berge@cern.ch>          - CERN
+#* @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+#* @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - CERN/Debrecen
+#*
+#***************************************************************************
+#
+# This script checks that a job gives the same results with and without
+# using TTreeCache. It runs the job described by the given configuration
+# twice, once with UseTreeCache="True" and once with UseTreeCache="False"
+# for all of its cycles, writing the outputs into two separate directories.
+# Then it compares the contents of all the trees and histograms in the
+# output files, and the number of processed and skipped events stored in
+# the files.
+#
+# It should preferably be run on a small configuration, as all the trees
+# are compared entry by entry. Cycles reading the output of earlier cycles
+# of the job read the same files in both runs, as their input is given
+# explicitly in the configuration. A small reference job is provided in
+# user/config/TreeCacheCheck_config.xml, which "make test" checks.
+#
+
+# Import base module(s):
+import sys
+import os
+import re
+import subprocess
+import tempfile
+import shutil
+
+##
+# Creates a copy of the job configuration with the tree cache turned on or off
+#
+# @param config The text of the original configuration
+# @param useCache <code>True</code> if the cache should be used
+# @param outdir The directory the cycles should write their output to
+# @returns The text of the modified configuration
+def modifyConfig( config, useCache, outdir ):
+
+    def modifyCycle( match ):
+        attributes = re.sub( r'\s(UseTreeCache|OutputDirectory)\s*=\s*'
+                             r'("[^"]*"|\'[^\']*\')', '', match.group( 1 ) )
+        return '<Cycle UseTreeCache="%s" OutputDirectory="%s/"%s>' % \
+               ( "True" if useCache else "False", outdir, attributes )
+
+    return re.sub( r'<Cycle\b([^>]*)>', modifyCycle, config )
+
+##
+# Collects the comparable objects from a directory of an output file
+#
+# @param directory The directory to look at
+# @param path The path of the directory inside the file
+# @param result Dictionary filled with the objects, keyed by their path
+def collectObjects( directory, path, result ):
+
+    import ROOT
+    for key in directory.GetListOfKeys():
+        name = path + key.GetName()
+        # Only look at the last cycle of every object:
+        if name in result:
+            continue
+        obj = key.ReadObj()
+        if obj.InheritsFrom( "TDirectory" ):
+            collectObjects( obj, name + "/", result )
+        elif obj.InheritsFrom( "TTree" ) or obj.InheritsFrom( "TH1" ) or \
+             obj.InheritsFrom( "SCycleStatistics" ):
+            result[ name ] = obj
+        continue
+    return
+
+##
+# Compares two trees entry by entry
+#
+# @returns A description of the first difference, or <code>None</code>
+def compareTrees( tree1, tree2 ):
+
+    if tree1.GetEntries() != tree2.GetEntries():
+        return "%i != %i entries" % ( tree1.GetEntries(), tree2.GetEntries() )
+    leaves1 = [ l for l in tree1.GetListOfLeaves() ]
+    leaves2 = [ l for l in tree2.GetListOfLeaves() ]
+    if [ l.GetName() for l in leaves1 ] != [ l.GetName() for l in leaves2 ]:
+        return "different branches"
+    for entry in range( tree1.GetEntries() ):
+        tree1.GetEntry( entry )
+        tree2.GetEntry( entry )
+        for leaf1, leaf2 in zip( leaves1, leaves2 ):
+            if leaf1.GetLen() != leaf2.GetLen():
+                return "leaf %s differs in entry %i" % ( leaf1.GetName(),
+                                                         entry )
+            for i in range( leaf1.GetLen() ):
+                if leaf1.GetValue( i ) != leaf2.GetValue( i ):
+                    return "leaf %s differs in entry %i" % ( leaf1.GetName(),
+                                                             entry )
+    return None
+
+##
+# Compares two histograms bin by bin
+#
+# @returns A description of the first difference, or <code>None</code>
+def compareHists( hist1, hist2 ):
+
+    if hist1.GetNcells() != hist2.GetNcells():
+        return "different binning"
+    if hist1.GetEntries() != hist2.GetEntries():
+        return "%g != %g entries" % ( hist1.GetEntries(), hist2.GetEntries() )
+    for i in range( hist1.GetNcells() ):
+        if ( hist1.GetBinContent( i ) != hist2.GetBinContent( i ) ) or \
+           ( hist1.GetBinError( i ) != hist2.GetBinError( i ) ):
+            return "bin %i differs" % i
+    return None
+
+##
+# Compares the output files written with and without the tree cache
+#
+# @returns The number of differences found
+def compareOutputs( dir1, dir2 ):
+
+    import ROOT
+    differences = 0
+    files = sorted( f for f in os.listdir( dir1 ) if f.endswith( ".root" ) )
+    if not files:
+        print( "ERROR: The job didn't produce any output file" )
+        return 1
+    for fileName in files:
+        file1 = ROOT.TFile.Open( os.path.join( dir1, fileName ), "READ" )
+        file2 = ROOT.TFile.Open( os.path.join( dir2, fileName ), "READ" )
+        if ( not file2 ) or file2.IsZombie():
+            print( "ERROR: %s was only written with the cache" % fileName )
+            differences += 1
+            continue
+        objects1 = {}
+        objects2 = {}
+        collectObjects( file1, "", objects1 )
+        collectObjects( file2, "", objects2 )
+        for name in sorted( set( objects1.keys() ) | set( objects2.keys() ) ):
+            if ( name not in objects1 ) or ( name not in objects2 ):
+                problem = "only written by one of the jobs"
+            elif objects1[ name ].InheritsFrom( "TTree" ):
+                problem = compareTrees( objects1[ name ], objects2[ name ] )
+            elif objects1[ name ].InheritsFrom( "TH1" ):
+                problem = compareHists( objects1[ name ], objects2[ name ] )
+            else:
+                stat1 = objects1[ name ]
+                stat2 = objects2[ name ]
+                problem = None
+                if ( stat1.GetProcessedEvents() !=
+                     stat2.GetProcessedEvents() ) or \
+                   ( stat1.GetSkippedEvents() != stat2.GetSkippedEvents() ):
+                    problem = "%i/%i != %i/%i processed/skipped events" % \
+                              ( stat1.GetProcessedEvents(),
+                                stat1.GetSkippedEvents(),
+                                stat2.GetProcessedEvents(),
+                                stat2.GetSkippedEvents() )
+            if problem:
+                print( "ERROR: %s:%s - %s" % ( fileName, name, problem ) )
+                differences += 1
+            else:
+                print( "  OK: %s:%s" % ( fileName, name ) )
+        file1.Close()
+        file2.Close()
+    return differences
+
+##
+# The C(++) style main function
+#
+# @returns <code>0</code> if the results agree, something else otherwise
+def main():
+
+    # Access the command line argument(s):
+    if len( sys.argv ) != 2:
+        print( "Usage: %s <job configuration XML>" %
+               os.path.basename( sys.argv[ 0 ] ) )
+        return 255
+    configName = sys.argv[ 1 ]
+    with open( configName ) as configFile:
+        config = configFile.read()
+
+    # The modified configurations are put next to the original one, so that
+    # the DTD and any external entities would be found:
+    configDir = os.path.dirname( os.path.abspath( configName ) )
+    workDir = tempfile.mkdtemp( prefix = "sframe_check_treecache_" )
+    try:
+        outdirs = []
+        for useCache in [ True, False ]:
+            outdir = os.path.join( workDir,
+                                   "cache" if useCache else "nocache" )
+            os.mkdir( outdir )
+            outdirs.append( outdir )
+            handle, runConfig = tempfile.mkstemp( suffix = ".xml",
+                                                  dir = configDir )
+            try:
+                with os.fdopen( handle, "w" ) as runFile:
+                    runFile.write( modifyConfig( config, useCache, outdir ) )
+                print( "Running the job with UseTreeCache=\"%s\"" %
+                       ( "True" if useCache else "False" ) )
+                with open( os.path.join( workDir, "log" ), "a" ) as log:
+                    if subprocess.call( [ "sframe_main", runConfig ],
+                                        stdout = log,
+                                        stderr = subprocess.STDOUT ):
+                        print( "ERROR: The job failed, see: %s" %
+                               os.path.join( workDir, "log" ) )
+                        workDir = None
+                        return 1
+            finally:
+                os.remove( runConfig )
+
+        # Compare the results:
+        import ROOT
+        ROOT.gErrorIgnoreLevel = ROOT.kError
+        ROOT.gSystem.Load( "libSFrameCore" )
+        differences = compareOutputs( outdirs[ 0 ], outdirs[ 1 ] )
+        if differences:
+            print( "ERROR: Found %i difference(s) between the results with "
+                   "and without TTreeCache" % differences )
+            print( "ERROR: The outputs are kept in: %s" % workDir )
+            workDir = None
+            return 1
+        print( "The results with and without TTreeCache are identical" )
+    finally:
+        if workDir:
+            shutil.rmtree( workDir )
+
+    # Return gracefully:
+    return 0
+
+# Execute the main function:
+if __name__ == "__main__":
+    sys.exit( main() )
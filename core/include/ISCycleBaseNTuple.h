@@ -68,14 +68,30 @@ protected:
                       std::vector< TTree* >& outTrees ) = 0;
    /// Save all the created output trees in the output
    virtual void SaveOutputTrees() = 0;
+   /// Optimise the output baskets once the configured entries are written
+   virtual void OptimizeOutputBaskets() = 0;
+   /// Copy the written event for a pipelined downstream cycle
+   virtual void FillPipelineTrees() = 0;
+   /// Hand the collected events over to a pipelined downstream cycle
+   virtual void SendPipelineChunk() = 0;
    /// Load the input trees
    virtual void LoadInputTrees( const SInputData& id, TTree* main_tree,
                                 TDirectory*& inputFile ) = 0;
+   /// Configure the TTreeCache of the input trees
+   virtual void ConfigureTreeCache() = 0;
    /// Read in the event from the "normal" trees
    virtual void GetEvent( Long64_t entry ) = 0;
+   /// Read the input branches copied into the output trees
+   virtual void ReadPassThroughBranches() = 0;
+   /// Get the number of uncompressed bytes read from the input branches
+   virtual Long64_t GetInputBytesRead() const = 0;
    /// Calculate the weight of the current event
    virtual Double_t CalculateWeight( const SInputData& inputData,
                                      Long64_t entry ) const = 0;
+   /// Calculate the weights of a block of events
+   virtual void CalculateWeights( const SInputData& inputData,
+                                  Long64_t firstEntry, Long64_t nEntries,
+                                  Double_t* weights ) = 0;
    /// Forget about the internally cached TTree pointers
    virtual void ClearCachedTrees() = 0;
 
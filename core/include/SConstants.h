@@ -37,6 +37,12 @@ namespace SFrame {
    static const char* ProofOutputDirName   = "jobTempOutput_XXXXXX";
    /// Name of the temporary local file created in LOCAL mode for output ntuples
    static const char* ProofOutputFileName  = "SFramePROOFTempOutput.root";
+   /// Name of the SInputShare object given to the cycles in fused execution
+   static const char* InputShareName       = "InputShare";
+   /// Name of the SPipelineQueue object given to an upstream pipelined cycle
+   static const char* PipelineQueueName    = "PipelineQueue";
+   /// Name of the SProgressMonitor object shared by the worker cycles
+   static const char* ProgressMonitorName  = "ProgressMonitor";
 
 } // namespace SFrame
 
@@ -23,6 +23,7 @@
 #include <TString.h>
 
 // Local include(s):
+#include "SCycleStatistics.h"
 #include "ISCycleBaseConfig.h"
 #include "ISCycleBaseHist.h"
 #include "ISCycleBaseNTuple.h"
@@ -32,6 +33,7 @@
 class TTree;
 class SInputData;
 class TList;
+class SProgressMonitor;
 
 /**
  *   @short The SCycleBase constituent responsible for running the cycle
@@ -53,6 +55,8 @@ class SCycleBaseExec : public TSelector,
 public:
    /// Default constructor
    SCycleBaseExec();
+   /// Destructor
+   virtual ~SCycleBaseExec();
 
    ///////////////////////////////////////////////////////////////////////////
    //                                                                       //
@@ -80,6 +84,13 @@ public:
    virtual Int_t  Version() const { return 2; }
    //@}
 
+   /// Read an entry from the input before it would be processed
+   void PreloadEvent( Long64_t entry );
+   /// Process a block of entries with a single call to the user code
+   Bool_t ProcessBatch( Long64_t firstEntry, Long64_t nEntries );
+   /// Clean up instead of SlaveTerminate() when the processing failed
+   void AbortInputData();
+
    ///////////////////////////////////////////////////////////////////////////
    //                                                                       //
    //   The following are the functions to be implemented in the derived    //
@@ -144,9 +155,62 @@ public:
     * can do here yet...
     */
    virtual void EndMasterInputData( const SInputData& ) {}
+   /// Function called for a block of events, instead of ExecuteEvent(...)
+   /**
+    * Light-weight cycles can implement this function to process all the
+    * entries of an input cluster with a single call. The framework doesn't
+    * read the entries in this case. The function has to call GetEvent(...)
+    * itself for the entries that it needs, and WriteEvent() for the events
+    * that should be written to the output tree(s). SetEventRejected() should
+    * be called once for each event of the block that is rejected. Throwing
+    * an exception with SkipEvent severity stops the processing of the block,
+    * and counts all of its events not written out so far as skipped.
+    * The input is most efficiently accessed through columns, connected with
+    * ConnectColumn(...).
+    *
+    * The function is only called if ProcessesEventBatches() returns
+    * <code>kTRUE</code>. It is used in LOCAL, THREADS and PROCESSES mode,
+    * unless the cycle is fused with other cycles. Otherwise
+    * ExecuteEvent(...) is called for every event.
+    */
+   virtual void ExecuteEventBatch( const SInputData& id, Long64_t firstEntry,
+                                   Long64_t nEntries,
+                                   const Double_t* weights );
+   /// Function declaring whether the cycle implements ExecuteEventBatch(...)
+   /**
+    * Cycles implementing ExecuteEventBatch(...) have to override this
+    * function to return <code>kTRUE</code>.
+    */
+   virtual Bool_t ProcessesEventBatches() const { return kFALSE; }
    //@}
 
+protected:
+   /// Write the current event into the output tree(s)
+   void WriteEvent();
+   /// Reject the current event without throwing an exception
+   void SetEventRejected();
+
 private:
+   /// Point in time used for measuring the processing stages
+   struct StageClock {
+      /// Wall clock time
+      std::chrono::steady_clock::time_point real;
+      /// CPU time used by the current thread, in seconds
+      Double_t cpu;
+   }; // struct StageClock
+
+   /// Read the clocks used for measuring the processing stages
+   static void ReadStageClock( StageClock& clock );
+   /// Account the time since the last clock reading to a processing stage
+   void StageDone( SCycleStatistics::Stage stage, StageClock& clock );
+   /// Start monitoring the progress of the event processing
+   void StartProgressMonitor();
+   /// Stop monitoring the progress of the event processing
+   void StopProgressMonitor();
+   /// Start compressing the output baskets on multiple threads
+   void StartImplicitMT();
+   /// Stop using implicit multi-threading for the output, if it was used
+   void StopImplicitMT();
    /// Function for reading the cycle configuration on the worker nodes
    void ReadConfig();
    /// Dummy override for the function defined in TObject
@@ -159,17 +223,42 @@ private:
 
    /// Flag specifying if this is the first initialization of input variables
    Bool_t m_firstInit;
+   /// Entry already read by PreloadEvent(...), or -1
+   Long64_t m_preloadedEntry;
+   /// Flag showing that the preloaded entry has to be skipped
+   Bool_t m_preloadSkipped;
+   /// Flag showing that the user code rejected the current event
+   Bool_t m_eventRejected;
+   /// Flag showing that a block of events is being processed
+   Bool_t m_inBatch;
+   /// The number of events rejected in the current block
+   Long64_t m_batchRejected;
+   /// The number of events written out from the current block
+   Long64_t m_batchWritten;
+   /// Weights of the events in the current block
+   std::vector< Double_t > m_batchWeights;
+   /// Flag showing whether the processing stages should be timed
+   Bool_t m_profile;
+   /// The time spent in the processing stages
+   SCycleStatistics m_stageTimes;
+   /// The time when the processing of the input data started
+   StageClock m_workerStart;
+   /// The number of bytes read by ROOT when the processing started
+   Long64_t m_fileBytesStart;
+   /// The number of input files opened so far
+   Long64_t m_fileOpens;
+   /// Object reporting the progress of the event processing
+   SProgressMonitor* m_monitor;
+   /// Flag showing that the progress monitor belongs to this cycle
+   Bool_t m_ownMonitor;
+   /// Flag showing that the cycle asked for implicit multi-threading
+   Bool_t m_implicitMT;
 
    TTree*                m_inputTree; ///< TTree used to load all input trees
    SInputData*           m_inputData; ///< Pointer to the currently active ID
    /// List of all the event-level output TTree-s
    std::vector< TTree* > m_outputTrees;
 
-   /// For timing events
-   typedef std::chrono::high_resolution_clock clock_;
-   typedef std::chrono::duration<double, std::ratio<1> > second_;
-   std::chrono::time_point<clock_> m_timeStart;
-
 #ifndef DOXYGEN_IGNORE
    ClassDef( SCycleBaseExec, 0 )
 #endif // DOXYGEN_IGNORE
@@ -24,13 +24,19 @@
 #include "ISCycleBaseConfig.h"
 #include "ISCycleBaseNTuple.h"
 #include "SCycleBaseBase.h"
+#include "SInputShare.h"
+#include "SInputVariable.h"
+#include "SInputColumn.h"
 #include "SError.h"
+#include "SInputData.h"
 
 // Forward declaration(s):
 class TTree;
 class TFile;
 class TBranch;
-class SInputData;
+class TTreeFormula;
+class TClass;
+class SPipelineQueue;
 
 /**
  *   @short NTuple handling part of SCycleBase
@@ -75,6 +81,14 @@ public:
    template< typename T >
    bool ConnectVariable( const char* treeName, const char* branchName,
                          T*& variable );
+   /// Specialisation for variables read on demand
+   template< typename T >
+   bool ConnectVariable( const char* treeName, const char* branchName,
+                         SInputVariable< T >& variable );
+   /// Connect a column of values to a primitive input branch
+   template< typename T >
+   bool ConnectColumn( const char* treeName, const char* branchName,
+                       SInputColumn< T >& column );
 
    /// Declare an output variable
    template< class T >
@@ -110,14 +124,29 @@ protected:
                            std::vector< TTree* >& outTrees );
    /// Save all the created output trees in the output
    void SaveOutputTrees();
+   /// Optimise the output baskets once the configured entries are written
+   void OptimizeOutputBaskets();
+   /// Copy the written event for a pipelined downstream cycle
+   void FillPipelineTrees();
+   /// Hand the collected events over to a pipelined downstream cycle
+   void SendPipelineChunk();
    /// Load the input trees
    void LoadInputTrees( const SInputData& id, TTree* main_tree,
                         TDirectory*& inputFile );
+   /// Configure the TTreeCache of the input trees
+   void ConfigureTreeCache();
    /// Read in the event from the "normal" trees
    void GetEvent( Long64_t entry );
+   /// Read the input branches copied into the output trees
+   void ReadPassThroughBranches();
+   /// Get the number of uncompressed bytes read from the input branches
+   Long64_t GetInputBytesRead() const;
    /// Calculate the weight of the current event
    Double_t CalculateWeight( const SInputData& inputData,
                              Long64_t entry ) const;
+   /// Calculate the weights of a block of events
+   void CalculateWeights( const SInputData& inputData, Long64_t firstEntry,
+                          Long64_t nEntries, Double_t* weights );
    /// Forget about the internally cached TTree pointers
    void ClearCachedTrees();
 
@@ -128,8 +157,32 @@ private:
    static const char* TypeidType( const char* root_type );
    /// Function registering an input branch for use during the event loop
    void RegisterInputBranch( TBranch* br );
+   /// Function taking an input variable from another cycle if possible
+   Bool_t ShareInputVariable( TBranch* br, void* variable,
+                              const std::type_info& type, size_t size,
+                              Bool_t isArray );
+   /// Function taking an input object from another cycle if possible
+   Bool_t ShareInputObject( TBranch* br, void* variable,
+                            const std::type_info& type,
+                            SInputCopy::copy_function copy );
    /// Function deleting the object created on the heap by ROOT
    void DeleteInputVariables();
+   /// Function preparing the event weight calculation for a new input file
+   void PrepareWeights( const SInputData& id );
+   /// Function deleting the cached generator cut formulas
+   void DeleteWeightFormulas();
+   /// Function connecting the pass-through branches to a new input file
+   void ConnectPassThroughBranches();
+   /// Function deleting the objects of the pass-through branches
+   void DeletePassThroughBranches();
+   /// Function deleting the events not yet sent to a pipelined cycle
+   void DeletePipelineChunk();
+   /// Function deleting the output trees that only fed a pipelined cycle
+   void DeletePipelineOutputTrees();
+   /// Function returning the basket size to create an output branch with
+   Int_t GetOutputBasketSize( const TTree* tree ) const;
+   /// Function applying the output settings to a newly created branch
+   void ConfigureOutputBranch( TTree* tree, TBranch* branch ) const;
    /// Function creating a sub-directory inside an existing directory
    TDirectory* MakeSubDirectory( const TString& path,
                                  TDirectory* dir ) const;
@@ -143,11 +196,74 @@ private:
    std::vector< TBranch* > m_inputBranches;
    /// Pointers storing the input objects created by ConnectVariable(...)
    std::list< TObject* >   m_inputVarPointers;
+   /// Registry of the branches read by fused cycles (if any)
+   SInputShare*            m_inputShare;
+   /// Input variables copied from other fused cycles after reading an event
+   std::vector< SInputCopy > m_inputCopies;
+   /// The entry currently loaded by GetEvent(...)
+   Long64_t m_currentEntry;
+   /// Uncompressed bytes read from the input branches
+   Long64_t m_inputBytesRead;
+   /// Flag showing that the branch being connected is read on demand
+   Bool_t   m_lazyConnection;
+   /// The last branch connected to a variable read on demand
+   TBranch* m_lazyBranch;
+
+   /// Input data block contributing to the event weights
+   struct WeightTerm {
+      Double_t lumi; ///< Scaled luminosity of the input data block
+      /// Compiled generator cuts of the block for the current input file
+      std::vector< TTreeFormula* > cuts;
+   }; // struct WeightTerm
+   /// The input data blocks contributing to the current event weights
+   std::vector< WeightTerm > m_weightTerms;
+   /// Type of the input data that the weights were prepared for
+   TString  m_weightType;
+   /// Version of the input data that the weights were prepared for
+   TString  m_weightVersion;
+   /// Flag showing if any of the weight terms has generator cuts
+   Bool_t   m_weightHasCuts;
+   /// Event weight if there are no generator cuts
+   Double_t m_constantWeight;
 
    TFile* m_outputFile; ///< Pointer to the active temporary output file
 
+   /// Queue leading to a pipelined downstream cycle (if any)
+   SPipelineQueue*       m_pipeline;
+   /// In-memory file collecting the events for the downstream cycle
+   TFile*                m_pipelineFile;
+   /// In-memory copies of the output trees
+   std::vector< TTree* > m_pipelineTrees;
+   /// Number of events in the current in-memory file
+   Long64_t              m_pipelineEntries;
+   /// The output trees only feed the pipeline, and are owned by the object
+   Bool_t                m_pipelineOnly;
+
    /// Vector to hold the output trees
    std::vector< TTree* > m_outputTrees;
+   /// Output settings of the trees in m_outputTrees
+   std::vector< STree >  m_outputTreeSettings;
+   /// Number of output trees still waiting for their basket optimisation
+   Int_t m_pendingBasketOptimizations;
+
+   /// Input branch written into the output tree(s) without the user code
+   struct PassThroughBranch {
+      TString  name; ///< Name of the branch
+      TBranch* input; ///< The branch in the current input file
+      TClass*  objClass; ///< Class of an object branch, null for leaf lists
+      void*    object; ///< The object or buffer shared by the branches
+      Long64_t size; ///< Size of the buffer of a leaf list branch
+      /// The output branches filled from the input branch
+      std::vector< TBranch* > outputs;
+   }; // struct PassThroughBranch
+   /// The branches copied from the input into the output trees
+   /**
+    * The input branches are given the address of the object pointers stored
+    * here, so the elements must not move in memory.
+    */
+   std::list< PassThroughBranch > m_passThrough;
+   /// Flag showing that the pass-through branches were set up already
+   Bool_t m_passThroughCreated;
    /// Vector to hold the metadata input trees
    std::vector< TTree* > m_metaInputTrees;
    /// Vector to hold the metadata output trees
@@ -53,12 +53,14 @@ public:
    /// Run mode enumeration
    /**
     * This enumeration defines how the analysis cycle can be run. At the
-    * moment local running and running the cycle on a PROOF cluster are
-    * possible.
+    * moment local running, local running on multiple threads or processes
+    * and running the cycle on a PROOF cluster are possible.
     */
    enum RunMode {
-      LOCAL, ///< Run the analysis cycle locally
-      PROOF  ///< Run the analysis cycle on a PROOF cluster
+      LOCAL,    ///< Run the analysis cycle locally
+      PROOF,    ///< Run the analysis cycle on a PROOF cluster
+      THREADS,  ///< Run the analysis cycle locally on multiple threads
+      PROCESSES ///< Run the analysis cycle locally on forked processes
    };
    /// Definition of the type of the properties
    typedef std::vector< std::pair< std::string, std::string > > property_type;
@@ -80,6 +82,21 @@ public:
    /// Set the number of parallel nodes
    void SetProofNodes( Int_t nodes );
 
+   /// Get the number of worker threads
+   Int_t GetNThreads() const;
+   /// Set the number of worker threads
+   void SetNThreads( Int_t threads );
+
+   /// Get the number of worker processes
+   Int_t GetNProcesses() const;
+   /// Set the number of worker processes
+   void SetNProcesses( Int_t processes );
+
+   /// Get the number of InputData groups processed concurrently
+   Int_t GetNConcurrentInputData() const;
+   /// Set the number of InputData groups processed concurrently
+   void SetNConcurrentInputData( Int_t value );
+
    /// Get the path to the PROOF working directory
    const TString& GetProofWorkDir() const;
    /// Set the path to the PROOF working directory
@@ -147,12 +164,57 @@ public:
    /// Get whether the PROOF nodes are allowed to read each other's files
    Bool_t GetProcessOnlyLocal() const;
 
+   /// Set whether the next input file should be opened in the background
+   void SetPrefetchInputFiles( Bool_t flag );
+   /// Get whether the next input file should be opened in the background
+   Bool_t GetPrefetchInputFiles() const;
+
+   /// Set whether the stages of the event loop should be timed
+   void SetProfileEventLoop( Bool_t flag );
+   /// Get whether the stages of the event loop should be timed
+   Bool_t GetProfileEventLoop() const;
+
+   /// Set the time between two progress reports in seconds
+   void SetProgressInterval( Double_t interval );
+   /// Get the time between two progress reports in seconds
+   Double_t GetProgressInterval() const;
+
+   /// Set the file to write the progress reports to
+   void SetProgressFile( const TString& fileName );
+   /// Get the file to write the progress reports to
+   const TString& GetProgressFile() const;
+
+   /// Set the compression settings of the output file
+   void SetOutputCompression( Int_t settings );
+   /// Get the compression settings of the output file
+   Int_t GetOutputCompression() const;
+
+   /// Set the default basket size of the output branches
+   void SetOutputBasketSize( Int_t size );
+   /// Get the default basket size of the output branches
+   Int_t GetOutputBasketSize() const;
+
+   /// Set the default AutoFlush setting of the output trees
+   void SetOutputAutoFlush( Long64_t autoFlush );
+   /// Get the default AutoFlush setting of the output trees
+   Long64_t GetOutputAutoFlush() const;
+
+   /// Set after how many entries the output baskets should be optimised
+   void SetOptimizeBasketsAfter( Long64_t entries );
+   /// Get after how many entries the output baskets should be optimised
+   Long64_t GetOptimizeBasketsAfter() const;
+
+   /// Set the number of threads compressing the output baskets
+   void SetOutputCompressionThreads( Int_t threads );
+   /// Get the number of threads compressing the output baskets
+   Int_t GetOutputCompressionThreads() const;
+
    /// Print the configuration to the screen
    void PrintConfig() const;
    /// Re-arrange the input data objects
    void ArrangeInputData();
    /// Fill the input data objects with information from the files
-   void ValidateInput();
+   void ValidateInput( const SCycleConfig* validated = 0 );
 
    /// Get the cycle configuration as a TString object
    TString GetStringConfig( const SInputData* id = 0 ) const;
@@ -168,6 +230,12 @@ private:
    TString       m_workdir;
    /// Number of nodes to use on the specified PROOF farm
    Int_t         m_nodes;
+   /// Number of worker threads to use in THREADS mode
+   Int_t         m_nThreads;
+   /// Number of worker processes to use in PROCESSES mode
+   Int_t         m_nProcesses;
+   /// Number of InputData groups to process concurrently
+   Int_t         m_nConcurrentInputData;
    property_type m_properties; ///< All the properties defined for the cycle
    id_type       m_inputData; ///< All SInputData objects defined for the cycle
    Double_t      m_targetLumi; ///< Luminosity to scale all MC samples to
@@ -182,9 +250,27 @@ private:
    Int_t         m_cacheLearnEntries;
    /// Flag for only processing local files on the PROOF workers
    Bool_t        m_processOnlyLocal;
+   /// Switch for opening the next input file in the background
+   Bool_t        m_prefetchInputFiles;
+   /// Switch for timing the stages of the event loop
+   Bool_t        m_profileEventLoop;
+   /// Time between two progress reports in seconds
+   Double_t      m_progressInterval;
+   /// File to write the progress reports to in JSON format
+   TString       m_progressFile;
+   /// Compression settings of the output file (ROOT convention, or -1)
+   Int_t         m_outputCompression;
+   /// Default basket size of the output branches (0 for ROOT's default)
+   Int_t         m_outputBasketSize;
+   /// Default AutoFlush setting of the output trees
+   Long64_t      m_outputAutoFlush;
+   /// Number of entries after which the output baskets are optimised
+   Long64_t      m_optimizeBasketsAfter;
+   /// Threads compressing the output baskets (0: off, negative: all cores)
+   Int_t         m_outputCompressionThreads;
 
 #ifndef DOXYGEN_IGNORE
-   ClassDef( SCycleConfig, 1 )
+   ClassDef( SCycleConfig, 9 )
 #endif // DOXYGEN_IGNORE
 
 }; // class SCycleConfig
@@ -15,6 +15,7 @@
 #define SFRAME_CORE_SCycleController_H
 
 // STL include(s):
+#include <map>
 #include <vector>
 
 // ROOT include(s):
@@ -26,7 +27,15 @@
 
 // Forward declaration(s):
 class TProof;
+class TList;
+class TStopwatch;
 class ISCycleBase;
+class SInputData;
+class SCycleConfig;
+class SCycleStatistics;
+class SInputShare;
+class SPipelineQueue;
+class SProgressMonitor;
 
 /**
  *   @short Class controlling SFrame analyses
@@ -73,16 +82,86 @@ public:
    UInt_t GetCurCycle() { return m_curCycle; }
 
 private:
+   /// Type for a group of input data blocks writing the same output file
+   typedef std::vector< const SInputData* > id_group_type;
+
+   /// Function preparing the configuration of a cycle for its execution
+   void PrepareConfig( ISCycleBase* cycle, SCycleConfig& config,
+                       Bool_t validate = kTRUE,
+                       const SCycleConfig* validated = 0 ) const;
+   /// Function printing the final statistics of a cycle
+   void PrintCycleStatistics( const SCycleStatistics& stats,
+                              TStopwatch& timer ) const;
+   /// Function counting how many cycles can be executed together
+   UInt_t CountFusableCycles() const;
+   /// Function executing multiple cycles in a single event loop
+   void ExecuteFusedCycles( UInt_t nCycles );
+   /// Function executing the fused cycles on one input data block
+   Bool_t ExecuteFusedInputData( const std::vector< ISCycleBase* >& cycles,
+                                 std::vector< SCycleConfig >& configs,
+                                 size_t index, Bool_t updateOutput,
+                                 std::vector< SCycleStatistics >& stats );
+   /// Function checking if the next cycle can read the output of this one
+   Bool_t GetPipelineInputs( std::vector< std::vector< size_t > >&
+                             inputs ) const;
+   /// Function executing two cycles as a pipeline
+   void ExecutePipelinedCycles( const std::vector< std::vector< size_t > >&
+                                inputs );
+   /// Function executing the downstream cycle of a pipeline
+   void ConsumePipeline( ISCycleBase* cycle, SCycleConfig& config,
+                         const std::vector< std::vector< size_t > >& inputs,
+                         const std::vector< size_t >& groupSizes,
+                         SPipelineQueue& queue,
+                         std::vector< TList* >& outputs );
+
+   /// Function executing the cycle on a group of input data blocks
+   Bool_t ExecuteInputDataGroup( ISCycleBase* cycle, SCycleConfig& config,
+                                 const id_group_type& group,
+                                 SCycleStatistics& stats );
+   /// Function executing the cycle on multiple groups concurrently
+   void ExecuteConcurrently( ISCycleBase* cycle, SCycleConfig& config,
+                             const std::vector< id_group_type >& groups,
+                             Int_t nConcurrent, SCycleStatistics& stats );
+   /// Function creating the progress monitor of a concurrent child process
+   SProgressMonitor* CreateChildMonitor( ISCycleBase* cycle,
+                                         const SCycleConfig& config,
+                                         const SInputData* id ) const;
+   /// Function executing the cycle on one input data block
+   Bool_t ExecuteInputData( ISCycleBase* cycle, SCycleConfig& config,
+                            const SInputData* id, Bool_t updateOutput,
+                            SCycleStatistics& stats,
+                            SPipelineQueue* pipeline = 0 );
+   /// Function writing the output of processing one input data block
+   void FinishInputData( ISCycleBase* cycle, const SCycleConfig& config,
+                         const SInputData& inputData, TList* outputs,
+                         Bool_t updateOutput,
+                         SCycleStatistics& stats ) const;
    /// Delete all analysis cycle objects from memory
    void DeleteAllAnalysisCycles();
    /// "Historic" function initializing the PROOF connection
    void InitProof( const TString& server, Int_t nodes);
    /// "Historic" function, closing the current PROOF connection
    void ShutDownProof();
-   /// Function creating/updating the output file of the last cycle
-   void WriteCycleOutput( TList* olist, const TString& filename,
+   /// Function creating/updating the output file of a cycle
+   void WriteCycleOutput( const char* cycleName, TList* olist,
+                          const TString& filename,
                           const TString& config,
                           Bool_t update ) const;
+   /// Function processing one input data block on multiple threads
+   TList* ProcessThreads( ISCycleBase* cycle, TList& input,
+                          const SInputData& id, const char* treeName,
+                          Long64_t evmax );
+   /// Function processing one input data block on multiple processes
+   TList* ProcessForked( ISCycleBase* cycle, TList& input,
+                         const SInputData& id, const char* treeName,
+                         Long64_t evmax );
+   /// Function processing one input data block with multiple cycles
+   void ProcessFused( const std::vector< ISCycleBase* >& cycles,
+                      const std::vector< TList* >& inputs,
+                      const SInputData& id, const char* treeName,
+                      Long64_t evmax, SInputShare& share );
+   /// Function merging the objects of one output list into another one
+   void MergeOutputs( TList* target, TList* source ) const;
 
    /// vector holding all analysis cycles to be executed
    std::vector< ISCycleBase* > m_analysisCycles;
@@ -92,7 +171,25 @@ private:
    UInt_t  m_curCycle; ///< Index of the current cycle in the list
    /// Status flag showing if the object is initialized
    Bool_t  m_isInitialized;
+   /// Flag showing if compatible cycles should be executed together
+   Bool_t  m_fuseCycles;
+   /// Flag showing if chained cycles should be executed as a pipeline
+   Bool_t  m_pipelineCycles;
+   /// Maximal number of event chunks waiting between pipelined cycles
+   UInt_t  m_pipelineDepth;
+   /// Number of events handed over at a time between pipelined cycles
+   Long64_t m_pipelineChunkSize;
+   /// Flag showing if the upstream cycle of a pipeline writes its ntuples
+   Bool_t  m_pipelineWriteIntermediate;
+   /// File to write the Prometheus metrics of the job to
+   TString m_metricsFile;
+   /// Time between two updates of the metrics file in seconds
+   Double_t m_metricsInterval;
+   /// Number of threads used for merging the output files (<=0: all cores)
+   Int_t   m_mergeThreads;
    TString m_xmlConfigFile; ///< Name of the configuration file read
+   /// Monitors of the parent process counting the events of a child process
+   std::map< const SInputData*, SProgressMonitor* > m_parentMonitors;
 
    TProof* m_proof; ///< Pointer to the currently used PROOF object
 
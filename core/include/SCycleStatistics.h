@@ -32,13 +32,32 @@ class TCollection;
  *          info however.) So I decided to collect this information by hand.
  *
  *          This class is used by the framework internally to send statistics
- *          information from the workers to the master node.
+ *          information from the workers to the master node. Besides the
+ *          event counts it collects the resources used by the workers, and
+ *          it is saved as metadata into the output file of each input data
+ *          block.
+ *
+ *          The number of bytes read is taken from the process-wide counter
+ *          of ROOT. So it includes everything read while the input data
+ *          block was processed, like the file headers read by the input
+ *          file prefetcher (PrefetchInputFiles), not just the reads of the
+ *          event loop.
  *
  * @version $Revision$
  */
 class SCycleStatistics : public TNamed {
 
 public:
+   /// Stages of the event processing that are timed separately
+   enum Stage {
+      ReadStage     = 0, ///< Reading the events from the input trees
+      WeightStage   = 1, ///< Calculating the event weights
+      ExecuteStage  = 2, ///< Running the user's event processing code
+      WriteStage    = 3, ///< Filling the output trees
+      FileInitStage = 4, ///< Initialising the processing of the input files
+      NStages       = 5  ///< The number of timed stages
+   };
+
    /// Constructor with all current parameters
    SCycleStatistics( const char* name = "", Long64_t procEvents = 0,
                      Long64_t skipEvents = 0 );
@@ -53,6 +72,53 @@ public:
    /// Set the number of skipped events
    void SetSkippedEvents( Long64_t events );
 
+   /// Get the number of bytes read from the input files
+   Long64_t GetBytesRead() const;
+   /// Set the number of bytes read from the input files
+   void SetBytesRead( Long64_t bytes );
+
+   /// Get the number of uncompressed bytes read from the input branches
+   Long64_t GetUncompressedBytesRead() const;
+   /// Set the number of uncompressed bytes read from the input branches
+   void SetUncompressedBytesRead( Long64_t bytes );
+
+   /// Get the number of opened input files
+   Long64_t GetFileOpens() const;
+   /// Set the number of opened input files
+   void SetFileOpens( Long64_t files );
+
+   /// Get the peak resident memory of the workers (in kilobytes)
+   Long64_t GetPeakResidentMemory() const;
+   /// Set the peak resident memory of the workers (in kilobytes)
+   void SetPeakResidentMemory( Long64_t memory );
+
+   /// Get the CPU time used by the workers
+   Double_t GetCpuTime() const;
+   /// Set the CPU time used by the workers
+   void SetCpuTime( Double_t time );
+
+   /// Get the wall clock time spent by the workers
+   Double_t GetRealTime() const;
+   /// Set the wall clock time spent by the workers
+   void SetRealTime( Double_t time );
+
+   /// Get the number of processed events per second of a worker
+   Double_t GetEventRate() const;
+
+   /// Get the (wall clock) time spent in a processing stage
+   Double_t GetStageRealTime( Stage stage ) const;
+   /// Get the CPU time spent in a processing stage
+   Double_t GetStageCpuTime( Stage stage ) const;
+   /// Add some time spent in a processing stage
+   void AddStageTime( Stage stage, Double_t realTime, Double_t cpuTime );
+   /// Get the printable name of a processing stage
+   static const char* GetStageName( Stage stage );
+
+   /// Add the statistics collected by another object to this one
+   void Add( const SCycleStatistics& other );
+   /// Reset all the collected statistics
+   virtual void Clear( Option_t* option = "" );
+
    /// Function merging the information from the worker nodes
    Int_t Merge( TCollection* coll );
    /// Write the object in the current output directory (const version)
@@ -65,12 +131,22 @@ public:
 private:
    Long64_t m_processedEvents; ///< The number of processed events
    Long64_t m_skippedEvents;   ///< The number of skipped events
+   Long64_t m_bytesRead;       ///< Bytes read from the input files
+   Long64_t m_bytesUnzipped;   ///< Uncompressed bytes read from the branches
+   Long64_t m_fileOpens;       ///< The number of opened input files
+   Long64_t m_peakMemory;      ///< Peak resident memory of the workers [kB]
+   Double_t m_cpuTime;         ///< CPU time used by the workers [s]
+   Double_t m_realTime;        ///< Wall clock time of the workers [s]
+   /// The wall clock time spent in the processing stages
+   Double_t m_stageRealTime[ NStages ];
+   /// The CPU time spent in the processing stages
+   Double_t m_stageCpuTime[ NStages ];
 
    /// Message logger object
    mutable SLogger m_logger; //!
 
 #ifndef DOXYGEN_IGNORE
-   ClassDef( SCycleStatistics, 1 )
+   ClassDef( SCycleStatistics, 3 )
 #endif // DOXYGEN_IGNORE
 
 }; // class SCycleStatistics
@@ -0,0 +1,95 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SCycleWorker_H
+#define SFRAME_CORE_SCycleWorker_H
+
+// ROOT include(s):
+#include <Rtypes.h>
+
+// Local include(s):
+#include "SError.h"
+#include "SLogger.h"
+
+// Forward declaration(s):
+class TTree;
+class TChain;
+class TList;
+class ISCycleBase;
+class SFilePrefetcher;
+class SWorkQueue;
+
+/**
+ *   @short Class executing the worker side of a cycle in the local process
+ *
+ *          When running on PROOF, the worker side functions of the cycles
+ *          are called by PROOF's own machinery. When a cycle is executed
+ *          on multiple threads of the local machine, this class takes over
+ *          that role.
+ *
+ *          It drives one cycle instance through SlaveBegin(...), Init(...),
+ *          Notify(), Process(...) and SlaveTerminate() in the same way as
+ *          TTreePlayer does. But it never calls the client side Begin(...)
+ *          and Terminate() functions. Those are only called once, on the
+ *          original cycle object, by SCycleController.
+ *
+ * @version $Revision$
+ */
+class SCycleWorker {
+
+public:
+   /// Constructor with the cycle to drive, and its input objects
+   SCycleWorker( ISCycleBase* cycle, TList* input );
+   /// Destructor
+   ~SCycleWorker();
+
+   /// Set the queue that the processed entry ranges are taken from
+   void SetWorkQueue( SWorkQueue* queue, UInt_t worker );
+   /// Initialise the cycle for processing entries of the specified tree
+   void Begin( TTree* tree, Bool_t connectNotify = kTRUE );
+   /// Process the entries [first, last) of the tree
+   Long64_t ProcessRange( Long64_t first, Long64_t last );
+   /// Process all the entries of a stand-alone tree
+   Long64_t ProcessTree( TTree* tree );
+   /// Finalise the processing on the worker
+   void Terminate();
+   /// Clean up after the processing failed on the worker
+   void Abort();
+
+   /// Get the cycle instance driven by this object
+   ISCycleBase* GetCycle() const;
+   /// Get the list of objects produced by the cycle
+   TList* GetOutputList() const;
+
+private:
+   /// Copying the object is not allowed
+   SCycleWorker( const SCycleWorker& );
+   /// Assigning the object is not allowed
+   SCycleWorker& operator=( const SCycleWorker& );
+
+   ISCycleBase* m_cycle; ///< The cycle instance driven by this object
+   TTree*       m_tree; ///< The (chain) tree that entries are read from
+   /// The input chain, if its files should be prefetched
+   TChain*      m_chain;
+   /// Object opening the next input file in the background (if requested)
+   SFilePrefetcher* m_prefetcher;
+   /// The queue that the entry ranges are taken from (if any)
+   SWorkQueue*  m_queue;
+   /// Index of this worker in the work queue
+   UInt_t       m_queueWorker;
+
+   mutable SLogger m_logger; ///< Message logger object
+
+}; // class SCycleWorker
+
+#endif // SFRAME_CORE_SCycleWorker_H
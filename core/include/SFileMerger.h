@@ -17,15 +17,19 @@
 // STL include(s):
 #include <vector>
 
+// ROOT include(s):
+#include <TString.h>
+
 // Local include(s):
 #include "SError.h"
 #include "SLogger.h"
 
 // Forward declaration(s):
 class TFile;
-class TString;
 class TObject;
 class TDirectory;
+class TTree;
+class TList;
 
 /**
  *   @short Helper class for merging the TTree contents of ROOT files
@@ -34,8 +38,16 @@ class TDirectory;
  *          for PROOF. Unfortunately TFileMerger has some weird behaviour,
  *          otherwise I would've just used that class.
  *
- *          The class loops over all input files specified with AddInput(),
- *          and copies the TTree-s from them into the output file.
+ *          The class merges the TTree-s and mergeable objects of all the
+ *          input files specified with AddFile() into the output file in a
+ *          single pass. Each tree is copied from all the input files at
+ *          once, and is only written to the output once.
+ *
+ *          When the compression settings of the input files match the ones
+ *          of the output file, the baskets of the trees are copied without
+ *          being decompressed. Trees that need to be re-compressed are
+ *          merged on multiple threads into temporary files first. Remote
+ *          input files are copied locally on multiple threads as well.
  *
  *          Note that the output can be an existing file. In this case the
  *          TTrees from the input files are merged into the TTrees already
@@ -56,20 +68,44 @@ public:
    /// Specify the output of the merging
    Bool_t OutputFile( const TString& fileName,
                       const TString& mode = "UPDATE" );
+   /// Set the number of threads to use (0 means one per core)
+   void SetThreads( Int_t threads );
 
    /// Execute the merging itself
    Bool_t Merge();
 
 private:
+   /// Description of a tree that is re-compressed on a separate thread
+   struct TreeJob {
+      TString path; ///< Full path of the tree inside the files
+      Int_t   compression; ///< Compression setting of the merged tree
+      TString tempName; ///< Temporary file receiving the merged tree
+      TString error; ///< Description of the failure, if there was one
+   }; // struct TreeJob
+
+   /// Copy the remote input files locally, and open all of them
+   void OpenInputFiles();
    /// Close all open files
    void CloseFiles();
-   /// Merge the contents of one directory
-   void MergeDirectory( TDirectory* input, TDirectory* output );
-   /// Merge two objects together
-   void MergeObjects( TObject* in, TObject* out );
+   /// Merge the contents of one directory from all the input files
+   void MergeDirectory( const std::vector< TDirectory* >& inputs,
+                        TDirectory* output, const TString& path,
+                        std::vector< TreeJob >& jobs );
+   /// Merge the same tree from all the input files
+   void MergeTrees( TList& trees, TDirectory* output, const char* name,
+                    Int_t compression, Bool_t fast );
+   /// Re-compress trees on multiple threads, and merge them into the output
+   void RunTreeJobs( std::vector< TreeJob >& jobs );
+   /// Merge objects into another object
+   void MergeObjects( TList& in, TObject* out );
+   /// Get the number of threads to use for a number of tasks
+   Int_t GetThreads( size_t tasks ) const;
 
-   std::vector< TFile* > m_inputFiles; ///< List of all specified input files
-   TFile*                m_outputFile; ///< The output file
+   std::vector< TString > m_inputNames; ///< Names of the specified input files
+   std::vector< TString > m_localNames; ///< Names of the files to read
+   std::vector< TFile* >  m_inputFiles; ///< List of all opened input files
+   TFile*                 m_outputFile; ///< The output file
+   Int_t                  m_nThreads; ///< Number of threads to use
 
    mutable SLogger m_logger; ///< Object for logging some messages
 
@@ -0,0 +1,124 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SFileMetadataCache_H
+#define SFRAME_CORE_SFileMetadataCache_H
+
+// STL include(s):
+#include <utility>
+#include <vector>
+
+// ROOT include(s):
+#include <Rtypes.h>
+#include <TString.h>
+
+// Local include(s):
+#include "SLogger.h"
+
+// Forward declaration(s):
+class TTree;
+
+/**
+ *   @short Metadata cache of input files shared between jobs
+ *
+ *          Singleton class giving access to a cache file that describes the
+ *          input files validated by any number of jobs. (See the
+ *          MetadataCache option of the job configuration.) The files are
+ *          identified by their path, size and modification time, so a file
+ *          that changed is never described by outdated information.
+ *
+ *          The cache file is a table of records, with an index of the
+ *          record positions sorted by the hash of the file paths. The file
+ *          is memory mapped, so a lookup only touches the few pages holding
+ *          the index entries and the record that it needs.
+ *
+ *          Jobs that validated new files merge their records into the cache
+ *          while holding a lock on a separate lock file, and replace the
+ *          cache file atomically with a new version. Jobs reading the cache
+ *          never have to wait for the lock.
+ *
+ * @version $Revision$
+ */
+class SFileMetadataCache {
+
+public:
+   /// Cluster sizes, as (cluster size, number of clusters) pairs
+   typedef std::vector< std::pair< Long64_t, Long64_t > > Clusters_t;
+
+   /// Description of one tree in an input file
+   struct TreeInfo {
+      TString    name; ///< Name of the tree
+      Long64_t   entries; ///< Number of entries in the tree
+      Clusters_t clusters; ///< Cluster sizes of the tree, if known
+   }; // struct TreeInfo
+
+   /// Description of one input file
+   struct FileInfo {
+      TString                 path; ///< Full path name of the file
+      Long64_t                size; ///< Size of the file in bytes
+      Long64_t                mtime; ///< Modification time of the file
+      std::vector< TreeInfo > trees; ///< The trees in the file
+   }; // struct FileInfo
+
+   /// Function for accessing the single object
+   static SFileMetadataCache* Instance();
+   /// Destructor
+   ~SFileMetadataCache();
+
+   /// Set the name of the cache file (an empty name disables the cache)
+   void SetFileName( const TString& fileName );
+   /// Get the name of the cache file
+   const TString& GetFileName() const;
+   /// Check whether a cache file is in use
+   Bool_t IsEnabled() const;
+
+   /// Look up the description of a file with a given size and modification
+   Bool_t Lookup( const TString& path, Long64_t size, Long64_t mtime,
+                  FileInfo& info ) const;
+   /// Add the descriptions of some files to the cache file
+   Bool_t Store( const std::vector< FileInfo >& files );
+
+   /// Get the cluster boundaries of a tree, if the cache knows them
+   Bool_t GetClusterBoundaries( const TString& path, const TString& treeName,
+                                std::vector< Long64_t >& boundaries ) const;
+
+   /// Get the size and modification time of a file
+   static Bool_t GetFileStat( const TString& path, Long64_t& size,
+                              Long64_t& mtime );
+   /// Describe a tree, optionally with its cluster sizes
+   static void DescribeTree( TTree* tree, Bool_t withClusters,
+                             TreeInfo& info );
+
+protected:
+   /// Protected default constructor
+   SFileMetadataCache();
+
+private:
+   /// Forward declaration of the private implementation type
+   struct Impl;
+
+   /// Copying the object is not allowed
+   SFileMetadataCache( const SFileMetadataCache& );
+   /// Assigning the object is not allowed
+   SFileMetadataCache& operator=( const SFileMetadataCache& );
+
+   /// Single instance, used in the singleton implementation
+   static SFileMetadataCache* m_instance;
+
+   TString m_fileName; ///< Name of the cache file
+   Impl*   m_impl; ///< The private implementation of the cache
+   mutable SLogger m_logger; ///< Message logger object
+
+}; // class SFileMetadataCache
+
+#endif // SFRAME_CORE_SFileMetadataCache_H
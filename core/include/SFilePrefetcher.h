@@ -0,0 +1,80 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SFilePrefetcher_H
+#define SFRAME_CORE_SFilePrefetcher_H
+
+// ROOT include(s):
+#include <Rtypes.h>
+
+// Forward declaration(s):
+class TChain;
+
+/**
+ *   @short Opens the next input file of a chain in the background
+ *
+ *          Opening an input file on a shared or remote filesystem can take
+ *          a considerable amount of time, during which the event loop is
+ *          just waiting. When the PrefetchInputFiles option of the cycle is
+ *          turned on, the framework uses this class to open the next file
+ *          of the input chain on a background thread, while the current
+ *          file is processed. The background thread also reads the first
+ *          cluster of the main input tree of the file. So by the time the
+ *          chain opens the file itself, its metadata and first baskets are
+ *          already cached by the filesystem/network layer.
+ *
+ *          In the parallel run modes the workers don't process the files
+ *          of the chain in order, so there the framework tells the class
+ *          which file the worker will process next.
+ *
+ *          The class holds on to a prefetched file until the chain opened
+ *          the file itself, or until the file is superseded by a newer
+ *          request. It never waits for a background thread during the
+ *          event loop, only when the object is deleted.
+ *
+ * @version $Revision$
+ */
+class SFilePrefetcher {
+
+public:
+   /// Constructor with the cache size used for the first cluster
+   SFilePrefetcher( Long64_t cacheSize );
+   /// Destructor
+   ~SFilePrefetcher();
+
+   /// Start prefetching the file after the current file of a chain
+   void Update( const TChain& chain );
+   /// Start prefetching the file of a chain that is processed next
+   void Update( const TChain& chain, Int_t nextTree );
+   /// Start prefetching a given file
+   void Prefetch( const char* fileName, const char* treeName );
+
+private:
+   /// Forward declaration of the private implementation type
+   struct Impl;
+
+   /// Start opening a file on a background thread
+   void Start( const char* fileName, const char* treeName, Int_t tree );
+   /// Close the prefetched files that are not needed anymore
+   void Release( Int_t currentTree );
+
+   /// Copying the object is not allowed
+   SFilePrefetcher( const SFilePrefetcher& );
+   /// Assigning the object is not allowed
+   SFilePrefetcher& operator=( const SFilePrefetcher& );
+
+   Impl* m_impl; ///< The private implementation of the prefetcher
+
+}; // class SFilePrefetcher
+
+#endif // SFRAME_CORE_SFilePrefetcher_H
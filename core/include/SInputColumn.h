@@ -0,0 +1,107 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SInputColumn_H
+#define SFRAME_CORE_SInputColumn_H
+
+// STL include(s):
+#include <vector>
+
+// ROOT include(s):
+#include <Rtypes.h>
+
+// Forward declaration(s):
+class TBranch;
+class TLeaf;
+class TBufferFile;
+
+/**
+ *   @short Contiguous block of values read from a primitive input branch
+ *
+ *          Objects of this type can be connected to simple input branches,
+ *          holding a single primitive value per entry, using
+ *          SCycleBaseNTuple::ConnectColumn(...). Instead of reading the
+ *          branch entry by entry into a variable, the object reads complete
+ *          baskets of the branch at a time, and gives access to the values
+ *          of a range of entries as a plain array. With ROOT versions
+ *          providing bulk I/O (6.18 and later) the baskets are deserialised
+ *          in one go.
+ *
+ *          It is best used together with
+ *          SCycleBaseExec::ExecuteEventBatch(...). Like:
+ *
+ *   In the header:
+ *   <code>
+ *      SInputColumn< Float_t > m_el_pt;
+ *   </code>
+ *
+ *   In the source file:
+ *   <code>
+ *      ConnectColumn( "MyTree", "el_pt", m_el_pt );<br/>
+ *      ...<br/>
+ *      const Float_t* pt = m_el_pt.Get( firstEntry, nEntries );<br/>
+ *      for( Long64_t i = 0; i < nEntries; ++i ) {
+ *   </code>
+ *
+ *          The entry numbers are the ones that the framework gives to the
+ *          cycle, i.e. they count the entries of the current input file.
+ *          Bool_t columns are not supported.
+ *
+ * @version $Revision$
+ */
+template< typename T >
+class SInputColumn {
+
+public:
+   /// Default constructor
+   SInputColumn();
+   /// Copy constructor
+   SInputColumn( const SInputColumn& parent );
+   /// Destructor
+   ~SInputColumn();
+
+   /// Assignment operator
+   SInputColumn& operator=( const SInputColumn& rh );
+
+   /// Access the values of a range of entries
+   const T* Get( Long64_t firstEntry, Long64_t nEntries );
+   /// Access the value of a single entry
+   const T& At( Long64_t entry );
+
+   /// Connect the column to a branch (done by SCycleBaseNTuple normally)
+   void Connect( TBranch* branch, TLeaf* leaf );
+
+private:
+   /// Read the values of (at least) a range of entries
+   void Read( Long64_t firstEntry, Long64_t nEntries );
+
+   /// The values read from the branch
+   std::vector< T > m_values;
+   /// The entry of the first value in the buffer
+   Long64_t m_first;
+   /// The branch that the values are read from
+   TBranch* m_branch;
+   /// The only leaf of the branch
+   TLeaf* m_leaf;
+   /// Flag showing whether the branch can be read in bulk
+   Bool_t m_bulk;
+   /// Buffer receiving the serialised baskets
+   TBufferFile* m_buffer;
+
+}; // class SInputColumn
+
+#ifndef __CINT__
+#include "SInputColumn.icc"
+#endif
+
+#endif // SFRAME_CORE_SInputColumn_H
@@ -142,9 +142,13 @@ public:
  *   @short Class describing a "simple" input tree in the input file(s).
  *
  *          This class describes an input or output TTree that is used
- *          by the analysis to the framework. The TTree only has one
- *          property actually, its name. The name of the tree is taken
- *          from the configuration XML file.
+ *          by the analysis to the framework. The main property of the
+ *          TTree is its name, which is taken from the configuration XML
+ *          file. Event-level output trees also remember how they should
+ *          be written: the compression settings, basket size and
+ *          AutoFlush setting of the tree, after how many entries the
+ *          basket sizes should be optimised, and which input branches
+ *          should be copied into the tree without the cycle's help.
  *
  * @version $Revision$
  */
@@ -153,7 +157,9 @@ class STree : public TObject {
 public:
    /// Constructor with a tree name
    STree( const TString& name = "", Int_t typ = 0 )
-      : treeName( name ), type( typ ) {}
+      : treeName( name ), type( typ ), compression( -1 ), basketSize( 0 ),
+        autoFlush( DEFAULT_AUTOFLUSH ), optimizeBasketsAfter( 0 ),
+        passThrough( "" ) {}
 
    /// Assignment operator
    STree& operator=  ( const STree& parent );
@@ -183,8 +189,42 @@ public:
     */
    Int_t type;
 
+   /// The default AutoFlush setting of ROOT (flush after every 30 MB)
+   static const Long64_t DEFAULT_AUTOFLUSH;
+
+   /// Compression settings of the output tree
+   /**
+    * The value is given in ROOT's convention: 100 * algorithm + level. A
+    * negative value means that the branches should just use the
+    * compression settings of the output file.
+    */
+   Int_t compression;
+   /// Basket size of the branches of the output tree (0: ROOT default)
+   Int_t basketSize;
+   /// AutoFlush setting of the output tree
+   /**
+    * Positive values give the number of entries, negative values the
+    * number of bytes after which the baskets are flushed, like for
+    * TTree::SetAutoFlush(...). Zero turns off the flushing.
+    */
+   Long64_t autoFlush;
+   /// Number of entries after which the basket sizes are optimised
+   Long64_t optimizeBasketsAfter;
+   /// Input branches copied into the output tree
+   /**
+    * Comma separated list of the names of input branches, which may contain
+    * wildcards, that are written into the output tree for every selected
+    * event, without the cycle having to connect and declare them.
+    */
+   TString passThrough;
+
+   /// Decode a compression setting given in the configuration
+   static Bool_t ParseCompression( const TString& value, Int_t& settings );
+   /// Describe a compression setting in the format of the configuration
+   static TString CompressionName( Int_t settings );
+
 #ifndef DOXYGEN_IGNORE
-   ClassDef( STree, 1 )
+   ClassDef( STree, 3 )
 #endif // DOXYGEN_IGNORE
 
 }; // class STree
@@ -233,6 +273,11 @@ public:
    /// Get whether the file lookup during dataset validation can be skipped
    Bool_t GetSkipLookup() const                    { return m_skipLookup; }
 
+   /// Set the number of threads used for validating the input files
+   void SetValidationThreads( Int_t threads )      { m_validThreads = threads; }
+   /// Get the number of threads used for validating the input files
+   Int_t GetValidationThreads() const              { return m_validThreads; }
+
    /// Set the current entry which is being read from the input
    void SetEventTreeEntry( Long64_t entry )        { m_entry = entry; }
    /// Get the current entry which is being read from the input
@@ -254,6 +299,8 @@ public:
 
    /// Collect information about the input files (needed before running)
    void ValidateInput( const char* pserver = 0 );
+   /// Take over the validation results of an identical input data
+   Bool_t TakeValidation( const SInputData& validated );
 
    /// Get the name of the input data type
    const TString& GetType() const { return m_type; }
@@ -336,6 +383,8 @@ private:
    Bool_t m_skipValid; ///< Flag showing whether to skip the ID validation
    /// Flag showing whether to skip the file lookup during dataset validation
    Bool_t m_skipLookup;
+   /// Number of threads validating the input files (0: automatic)
+   Int_t m_validThreads;
    Long64_t m_entry; ///< Current entry read from the input
 
    TDSet* m_dset; //! Transient dataset representation of input files
@@ -343,7 +392,7 @@ private:
    mutable SLogger m_logger; //! Transient logger object
 
 #ifndef DOXYGEN_IGNORE
-   ClassDef( SInputData, 1 )
+   ClassDef( SInputData, 2 )
 #endif // DOXYGEN_IGNORE
 
 }; // class SInputData
@@ -0,0 +1,158 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SInputShare_H
+#define SFRAME_CORE_SInputShare_H
+
+// STL include(s):
+#include <map>
+#include <utility>
+#include <typeinfo>
+#include <type_traits>
+#include <cstddef>
+
+// ROOT include(s):
+#include <TNamed.h>
+
+// Forward declaration(s):
+class TBranch;
+class TLeaf;
+
+/**
+ *   @short Registry of the input branches read by fused cycles
+ *
+ *          When multiple cycles are executed in a single event loop (see
+ *          the FuseCycles option of the job configuration), they all read
+ *          their input from the same TTree objects. Since a branch can only
+ *          be read into a single variable, the first cycle connecting to a
+ *          branch becomes its "reader". All the other cycles connecting to
+ *          the same branch get a copy of the variable of the reader cycle
+ *          after each event is read.
+ *
+ *          The registry is given to the cycles through their input object
+ *          list. It has to be cleared whenever a new input file is opened.
+ *
+ * @version $Revision$
+ */
+class SInputShare : public TNamed {
+
+public:
+   /// Default constructor
+   SInputShare();
+
+   /// Forget about all the registered branches
+   virtual void Clear( Option_t* option = "" );
+
+   /// Register the variable that a branch is read into
+   void Register( const TBranch* br, void* address,
+                  const std::type_info& type );
+   /// Find the variable that a branch is read into
+   void* Find( const TBranch* br, const std::type_info& type ) const;
+
+private:
+   /// Type of the variables registered for the branches
+   typedef std::pair< void*, const std::type_info* > variable_type;
+
+   /// The variables that the branches are read into
+   std::map< const TBranch*, variable_type > m_variables;
+
+}; // class SInputShare
+
+/**
+ *   @short Copy of an input variable read by another cycle
+ *
+ *          Objects of this type are used by SCycleBaseNTuple in fused
+ *          execution to copy the contents of an input variable, read by
+ *          another cycle, into a variable of the current cycle. For object
+ *          branches each cycle has its own object, and the contents of the
+ *          object of the reader cycle are assigned to it. So a cycle
+ *          modifying its input objects doesn't affect the other cycles.
+ *
+ * @version $Revision$
+ */
+class SInputCopy {
+
+public:
+   /// Type of the functions copying the objects of object branches
+   typedef void ( *copy_function )( void* target, const void* source );
+
+   /// Constructor with the source and target variables
+   SInputCopy( void* target, const void* source, size_t size,
+               TLeaf* leaf = 0 );
+   /// Constructor with the source and target object pointers
+   SInputCopy( void* target, const void* source, copy_function copy );
+
+   /// Copy the current contents of the source into the target
+   void Copy() const;
+
+   /// Get the function copying objects of a given type, if there is one
+   template< typename T >
+   static copy_function GetObjectCopy();
+
+private:
+   /// Copy the object of one object pointer into the object of another
+   template< typename T >
+   static void CopyObject( void* target, const void* source );
+   /// Get the copy function of a type that can be assigned
+   template< typename T >
+   static copy_function GetObjectCopy( std::true_type );
+   /// Get the copy function of a type that can't be assigned
+   template< typename T >
+   static copy_function GetObjectCopy( std::false_type );
+
+   void*         m_target; ///< The variable of the current cycle
+   const void*   m_source; ///< The variable of the reader cycle
+   size_t        m_size; ///< Maximal number of bytes to copy
+   TLeaf*        m_leaf; ///< Leaf describing the current size of arrays
+   copy_function m_copy; ///< Function copying objects, if not null
+
+}; // class SInputCopy
+
+/**
+ * @returns The function assigning the contents of one object of the type to
+ *          another, or a null pointer if the type can't be assigned
+ */
+template< typename T >
+SInputCopy::copy_function SInputCopy::GetObjectCopy() {
+
+   return GetObjectCopy< T >( std::is_copy_assignable< T >() );
+}
+
+/**
+ * @param target Pointer to the object pointer of the current cycle
+ * @param source Pointer to the object pointer of the reader cycle
+ */
+template< typename T >
+void SInputCopy::CopyObject( void* target, const void* source ) {
+
+   const T* sobj = *static_cast< T* const* >( source );
+   T* tobj = *static_cast< T** >( target );
+   if( sobj && tobj ) {
+      *tobj = *sobj;
+   }
+   return;
+}
+
+template< typename T >
+SInputCopy::copy_function SInputCopy::GetObjectCopy( std::true_type ) {
+
+   return &CopyObject< T >;
+}
+
+template< typename T >
+SInputCopy::copy_function SInputCopy::GetObjectCopy( std::false_type ) {
+
+   return 0;
+}
+
+#endif // SFRAME_CORE_SInputShare_H
@@ -0,0 +1,99 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SInputVariable_H
+#define SFRAME_CORE_SInputVariable_H
+
+// ROOT include(s):
+#include <Rtypes.h>
+
+// Forward declaration(s):
+class TBranch;
+class SCycleBaseNTuple;
+
+/**
+ *   @short Input variable read from its branch only when it's accessed
+ *
+ *          Variables of this type can be connected to input branches just
+ *          like the usual input variables, using
+ *          SCycleBaseNTuple::ConnectVariable(...). But unlike the usual
+ *          variables, the framework doesn't read the branch for every
+ *          event. The branch is only read the first time the variable is
+ *          accessed during an event. So cycles rejecting most of the events
+ *          after looking at a few variables only decompress the data that
+ *          they actually use.
+ *
+ *          The template argument is the type that one would use for a
+ *          regular input variable. Like:
+ *
+ *   In the header:
+ *   <code>
+ *      SInputVariable< Int_t > m_el_n;<br/>
+ *      SInputVariable< std::vector< float >* > m_el_pt;
+ *   </code>
+ *
+ *   In the source file:
+ *   <code>
+ *      ConnectVariable( "MyTree", "el_n", m_el_n );<br/>
+ *      ...<br/>
+ *      if( m_el_n() < 2 ) throw SError( SError::SkipEvent );<br/>
+ *      for( size_t i = 0; i < m_el_pt()->size(); ++i ) {
+ *   </code>
+ *
+ *          When cycles are executed in a single event loop (see the
+ *          FuseCycles option of the job configuration), the variables are
+ *          read for every event, as the branches may be shared between the
+ *          cycles.
+ *
+ * @version $Revision$
+ */
+template< typename T >
+class SInputVariable {
+
+   /// The connection is made by SCycleBaseNTuple
+   friend class SCycleBaseNTuple;
+
+public:
+   /// Default constructor
+   SInputVariable();
+
+   /// Make sure that the variable holds the current event
+   void Load() const;
+   /// Access the value of the variable for the current event
+   const T& Get() const;
+   /// Access the value of the variable for the current event
+   const T& operator()() const { return Get(); }
+
+private:
+   /// Connect the variable to a branch
+   void Connect( TBranch* branch, const Long64_t* entry,
+                 Long64_t* bytesRead );
+
+   /// The variable that the branch is read into
+   T m_value;
+   /// The branch to read on demand (null if it's read by the framework)
+   TBranch* m_branch;
+   /// The entry currently processed by the cycle
+   const Long64_t* m_entry;
+   /// Counter of the bytes read by the cycle
+   Long64_t* m_bytesRead;
+   /// The entry that was last read into the variable
+   mutable Long64_t m_loadedEntry;
+
+}; // class SInputVariable
+
+#ifndef __CINT__
+#include "SInputVariable.icc"
+#endif
+
+#endif // SFRAME_CORE_SInputVariable_H
@@ -31,6 +31,15 @@
  *          one possibility would be to write messages to a file
  *          for batch running later on. (Just an idea...)
  *
+ *          By default every line is written (and flushed) by the thread
+ *          sending the message. In asynchronous mode (see the
+ *          AsyncLogBuffer option of the job configuration) the lines are
+ *          put into a fixed size, lock-free ring buffer instead, and are
+ *          written in batches by a background thread. When the buffer is
+ *          full, new lines are either dropped or the sender waits for
+ *          free space, depending on the selected policy. FATAL messages
+ *          are always flushed to the output before Write returns.
+ *
  *     @see SLogger
  * @version $Revision$
  */
@@ -50,14 +59,36 @@ public:
    /// Get the message type above which messages are printed
    SMsgType GetMinType() const;
 
+   /// Switch between synchronous and asynchronous writing
+   void SetAsync( unsigned int bufferSize, bool dropWhenFull = false );
+   /// Check whether the messages are written asynchronously
+   bool IsAsync() const;
+   /// Wait until all the messages sent so far are written to the output
+   void Flush() const;
+
 protected:
    /// Protected default constructor
    SLogWriter();
 
 private:
+   /// Forward declaration of the asynchronous writer type
+   struct AsyncImpl;
+
+   /// Copying the object is not allowed
+   SLogWriter( const SLogWriter& );
+   /// Assigning the object is not allowed
+   SLogWriter& operator=( const SLogWriter& );
+
+   /// Format a line the way it's printed on the output
+   void Format( std::string& output, SMsgType type, const std::string& line,
+                bool colour ) const;
+
    /// Single instance, used in the singleton implementation
    static SLogWriter* m_instance;
 
+   /// The asynchronous writer, if one is used
+   AsyncImpl* m_async;
+
    /// Message type -> type name association
    std::map< SMsgType, std::string > m_typeMap;
    /// Message type -> message color association
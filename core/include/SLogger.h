@@ -95,6 +95,11 @@ public:
    /// Old style message sender function
    void Send( SMsgType type, const std::string& message ) const;
 
+   /// Check whether messages of a given type would be printed
+   bool IsActive( SMsgType type ) const {
+      return ( type >= m_logWriter->GetMinType() );
+   }
+
 private:
    /// Internal function for sending the message to the console
    void Send();
@@ -163,6 +168,51 @@ inline SLogger& SLogger::operator<< ( SMsgType type ) {
    return *this;
 }
 
+/// Minimal message type that is compiled into the code
+/**
+ * Messages with a lower type than this are removed from the code by the
+ * compiler when they are printed with the SLOGGER_* or REPORT_* macros.
+ * By default all messages are kept. Release builds can remove the VERBOSE
+ * and DEBUG messages by compiling with
+ * <code>-DSLOGGER_MIN_TYPE=INFO</code>. (See the SFRAME_MIN_LOG_TYPE
+ * variable of Makefile.common.)
+ */
+#ifndef SLOGGER_MIN_TYPE
+#   define SLOGGER_MIN_TYPE VERBOSE
+#endif // SLOGGER_MIN_TYPE
+
+/// Check if messages of a given type are printed by a logger
+/**
+ * The first part of the condition is a compile time constant, so the
+ * compiler removes the code guarded by this check completely for the message
+ * types below SLOGGER_MIN_TYPE.
+ */
+#define SLOGGER_ACTIVE( LOGGER, TYPE )                  \
+   ( ( static_cast< int >( ::TYPE ) >=                 \
+       static_cast< int >( ::SLOGGER_MIN_TYPE ) ) &&    \
+     ( LOGGER ).IsActive( ::TYPE ) )
+
+/// Print a message with a given logger, if its type is printed
+/**
+ * Unlike the <code>logger << TYPE << ... << SLogger::endmsg</code> form, the
+ * macro doesn't evaluate any part of the message if it would not be printed.
+ * So it should be used for VERBOSE and DEBUG messages in code that is
+ * executed often. It can be used like:
+ *
+ * <code>
+ *   SLOGGER_MSG( m_logger, DEBUG, "Connected branch: " << name );
+ * </code>
+ */
+#define SLOGGER_MSG( LOGGER, TYPE, MESSAGE )                          \
+   do {                                                                \
+      if( SLOGGER_ACTIVE( LOGGER, TYPE ) ) {                           \
+         ( LOGGER ) << ::TYPE << MESSAGE << SLogger::endmsg;           \
+      }                                                                \
+   } while( false )
+
+/// Convenience macro for printing DEBUG messages with the m_logger member
+#define SLOGGER_DEBUG( MESSAGE ) SLOGGER_MSG( m_logger, DEBUG, MESSAGE )
+
 // This is a GCC extension for getting the name of the current function.
 #if defined( __GNUC__ )
 #   define SLOGGER_FNAME __PRETTY_FUNCTION__
@@ -194,10 +244,11 @@ inline SLogger& SLogger::operator<< ( SMsgType type ) {
  * <code>
  *   REPORT_VERBOSE( "This is a verbose message with a number: " << number );
  * </code>
+ *
+ * The message is not evaluated at all if VERBOSE messages are not printed.
  */
-#define REPORT_VERBOSE( MESSAGE )                             \
-   m_logger << ::VERBOSE << SLOGGER_REPORT_PREFIX << MESSAGE; \
-   m_logger << SLogger::endmsg
+#define REPORT_VERBOSE( MESSAGE )                                     \
+   SLOGGER_MSG( m_logger, VERBOSE, SLOGGER_REPORT_PREFIX << MESSAGE )
 
 /// Convenience macro for reporting ERROR messages in the code
 /**
@@ -210,9 +261,8 @@ inline SLogger& SLogger::operator<< ( SMsgType type ) {
  *   REPORT_ERROR( "A serious error message" );
  * </code>
  */
-#define REPORT_ERROR( MESSAGE )                             \
-   m_logger << ::ERROR << SLOGGER_REPORT_PREFIX << MESSAGE; \
-   m_logger << SLogger::endmsg
+#define REPORT_ERROR( MESSAGE )                                       \
+   SLOGGER_MSG( m_logger, ERROR, SLOGGER_REPORT_PREFIX << MESSAGE )
 
 /// Convenience macro for reporting FATAL messages in the code
 /**
@@ -225,8 +275,7 @@ inline SLogger& SLogger::operator<< ( SMsgType type ) {
  *   REPORT_FATAL( "A very serious error message" );
  * </code>
  */
-#define REPORT_FATAL( MESSAGE )                             \
-   m_logger << ::FATAL << SLOGGER_REPORT_PREFIX << MESSAGE; \
-   m_logger << SLogger::endmsg
+#define REPORT_FATAL( MESSAGE )                                       \
+   SLOGGER_MSG( m_logger, FATAL, SLOGGER_REPORT_PREFIX << MESSAGE )
 
 #endif // SFRAME_CORE_SLogger_H
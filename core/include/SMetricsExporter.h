@@ -0,0 +1,84 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SMetricsExporter_H
+#define SFRAME_CORE_SMetricsExporter_H
+
+// ROOT include(s):
+#include <Rtypes.h>
+#include <TString.h>
+
+// Forward declaration(s):
+class SProgressMonitor;
+
+/**
+ *   @short Writes the state of the job into a Prometheus metrics file
+ *
+ *          Singleton class that periodically writes the metrics of the
+ *          current process into a file, in the Prometheus text exposition
+ *          format. (See the MetricsFile option of the job configuration.)
+ *          The file is meant to be picked up by the textfile collector of
+ *          the node exporter, so it is always replaced atomically.
+ *
+ *          The event counters of the cycles are taken from the
+ *          SProgressMonitor objects of the cycles running in the current
+ *          process, which register themselves with this class. The counters
+ *          of the monitors that finished already are kept, so the file
+ *          describes all the input data blocks processed so far.
+ *
+ *          The events processed, and the bytes read, in the processes
+ *          forked by the framework are counted in memory shared with this
+ *          process, so they are included in the metrics. The metrics of
+ *          cycles running on PROOF workers are not visible to this class.
+ *
+ * @version $Revision$
+ */
+class SMetricsExporter {
+
+public:
+   /// Function for accessing the single object
+   static SMetricsExporter* Instance();
+   /// Destructor
+   ~SMetricsExporter();
+
+   /// Start writing the metrics file periodically
+   void Start( const TString& fileName, Double_t interval );
+   /// Write the metrics file one last time, and stop the writer thread
+   void Stop();
+
+   /// Register a monitor whose counters should be exported
+   void Register( const SProgressMonitor* monitor );
+   /// Remove a monitor, keeping its last counter values
+   void Unregister( const SProgressMonitor* monitor );
+
+protected:
+   /// Protected default constructor
+   SMetricsExporter();
+
+private:
+   /// Forward declaration of the private implementation type
+   struct Impl;
+
+   /// Copying the object is not allowed
+   SMetricsExporter( const SMetricsExporter& );
+   /// Assigning the object is not allowed
+   SMetricsExporter& operator=( const SMetricsExporter& );
+
+   /// Single instance, used in the singleton implementation
+   static SMetricsExporter* m_instance;
+
+   Impl* m_impl; ///< The private implementation of the exporter
+
+}; // class SMetricsExporter
+
+#endif // SFRAME_CORE_SMetricsExporter_H
@@ -0,0 +1,86 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SPipelineQueue_H
+#define SFRAME_CORE_SPipelineQueue_H
+
+// ROOT include(s):
+#include <TNamed.h>
+
+// Forward declaration(s):
+class TFile;
+
+/**
+ *   @short Bounded queue of event chunks between two pipelined cycles
+ *
+ *          When two cycles are executed as a pipeline (see the
+ *          PipelineCycles option of the job configuration), the upstream
+ *          cycle writes every event of its output trees into small
+ *          in-memory files. (Writing the events into the usual output
+ *          file as well is optional.) Each of these TMemFile-s
+ *          holds a chunk of a fixed number of events (PipelineChunkSize),
+ *          and is handed over to the downstream cycle through this queue
+ *          as soon as it's full. A null pointer in the queue marks the end
+ *          of an input data block of the upstream cycle.
+ *
+ *          The queue only holds a limited number of chunks. The producer is
+ *          blocked while the queue is full, so the memory used by the
+ *          intermediate events stays bounded even if the downstream cycle
+ *          is slower than the upstream one.
+ *
+ *          The queue takes ownership of the files pushed into it, and gives
+ *          the ownership to whoever pops them. It is given to the upstream
+ *          cycle through its input object list.
+ *
+ * @version $Revision$
+ */
+class SPipelineQueue : public TNamed {
+
+public:
+   /// Constructor with the maximal number of chunks, and the chunk size
+   SPipelineQueue( UInt_t capacity, Long64_t chunkSize,
+                   Bool_t writeIntermediate = kFALSE );
+   /// Destructor
+   ~SPipelineQueue();
+
+   /// Get the number of events to put into one chunk
+   Long64_t GetChunkSize() const;
+   /// Check if the upstream cycle should write its output trees as well
+   Bool_t GetWriteIntermediate() const;
+
+   /// Add a chunk (or an end-of-block marker) to the end of the queue
+   Bool_t Push( TFile* file );
+   /// Take the chunk from the front of the queue
+   Bool_t Pop( TFile*& file );
+
+   /// Signal that no more chunks will be added to the queue
+   void Close();
+   /// Stop both the producer and the consumer as soon as possible
+   void Abort();
+
+private:
+   /// Forward declaration of the private implementation type
+   struct Impl;
+
+   /// Copying the object is not allowed
+   SPipelineQueue( const SPipelineQueue& );
+   /// Assigning the object is not allowed
+   SPipelineQueue& operator=( const SPipelineQueue& );
+
+   Impl*    m_impl; ///< The private implementation of the queue
+   Long64_t m_chunkSize; ///< Number of events in one chunk
+   Bool_t   m_writeIntermediate; ///< Write the output trees to disk too
+
+}; // class SPipelineQueue
+
+#endif // SFRAME_CORE_SPipelineQueue_H
@@ -0,0 +1,112 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SProgressMonitor_H
+#define SFRAME_CORE_SProgressMonitor_H
+
+// ROOT include(s):
+#include <TNamed.h>
+
+// Local include(s):
+#include "SMsgType.h"
+
+// Forward declaration(s):
+class SInputData;
+
+/**
+ *   @short Reports the progress of the event loop from a background thread
+ *
+ *          The event loop only increments an atomic counter for each
+ *          processed event. A background thread samples this counter at a
+ *          fixed wall clock interval (see the ProgressInterval option of
+ *          the cycle), and prints the instantaneous and average event rates,
+ *          together with an estimate of the remaining processing time.
+ *
+ *          If a file name is given (see the ProgressFile option of the
+ *          cycle), each report is also appended to the file as a single
+ *          line of JSON. Multiple workers can write to the same file, as
+ *          each line is written with a single append operation. The last
+ *          line written by each monitor has its "finished" field set.
+ *
+ *          The monitor also keeps track of the skipped events, of the
+ *          input file being processed, and of the bytes read by the event
+ *          loop from the input files. These counters are exported by
+ *          SMetricsExporter, with which every monitor registers itself.
+ *          When the reporting interval is not positive, no reports are made
+ *          by the monitor, but its counters are still exported.
+ *
+ *          When an input data block is processed on multiple threads or
+ *          processes, the framework creates a single monitor for all the
+ *          workers, and gives it to their cycles through the input object
+ *          list. For forked workers the counters are put in shared memory,
+ *          so that the monitor in the parent process would see them. A
+ *          monitor in a forked process can also count its events in the
+ *          shared counters of a monitor in the parent process.
+ *
+ * @version $Revision$
+ */
+class SProgressMonitor : public TNamed {
+
+public:
+   /// Constructor starting the monitoring thread
+   SProgressMonitor( const char* name, const SInputData& id,
+                     Long64_t totalEvents, Double_t interval, SMsgType type,
+                     const char* fileName = "", Bool_t shared = kFALSE,
+                     const SProgressMonitor* parent = 0 );
+   /// Destructor stopping the monitoring thread
+   ~SProgressMonitor();
+
+   /// Count some newly processed events
+   void AddEvents( Long64_t events );
+   /// Count some newly skipped events
+   void AddSkippedEvents( Long64_t events );
+   /// Set the index of the input file being processed (starting from 1)
+   void SetFileIndex( Long64_t index );
+   /// Count the bytes read by the process since the last call
+   void UpdateBytesRead();
+   /// Start counting the bytes read from the current state of the process
+   void ResetBytesRead();
+
+   /// Get the name of the monitored cycle
+   const char* GetCycleName() const;
+   /// Get the type of the processed input data
+   const char* GetInputType() const;
+   /// Get the version of the processed input data
+   const char* GetInputVersion() const;
+   /// Get the number of processed events
+   Long64_t GetProcessedEvents() const;
+   /// Get the number of skipped events
+   Long64_t GetSkippedEvents() const;
+   /// Get the number of bytes read from the input files
+   Long64_t GetBytesRead() const;
+   /// Get the index of the input file being processed
+   Long64_t GetFileIndex() const;
+   /// Get the number of input files of the input data
+   Long64_t GetFileCount() const;
+
+private:
+   /// Forward declaration of the type holding the counters
+   struct Counters;
+   /// Forward declaration of the private implementation type
+   struct Impl;
+
+   /// Copying the object is not allowed
+   SProgressMonitor( const SProgressMonitor& );
+   /// Assigning the object is not allowed
+   SProgressMonitor& operator=( const SProgressMonitor& );
+
+   Impl* m_impl; ///< The private implementation of the monitor
+
+}; // class SProgressMonitor
+
+#endif // SFRAME_CORE_SProgressMonitor_H
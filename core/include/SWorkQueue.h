@@ -0,0 +1,102 @@
+// Dear emacs, this is -*- c++ -*-
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+#ifndef SFRAME_CORE_SWorkQueue_H
+#define SFRAME_CORE_SWorkQueue_H
+
+// STL include(s):
+#include <vector>
+#include <atomic>
+
+// ROOT include(s):
+#include <Rtypes.h>
+
+/**
+ *   @short Range of entries to be processed by one of the workers
+ *
+ *          The entry numbers are given in the "global" entry space of the
+ *          TChain holding all the input files of an input data block.
+ *
+ * @version $Revision$
+ */
+struct SEntryRange {
+   /// Constructor with the boundaries of the range
+   SEntryRange( Long64_t f = 0, Long64_t l = 0, Int_t t = -1 )
+      : first( f ), last( l ), tree( t ) {}
+   Long64_t first; ///< First entry of the range
+   Long64_t last; ///< One past the last entry of the range
+   Int_t    tree; ///< Index of the chain file holding the range (-1: unknown)
+}; // struct SEntryRange
+
+/**
+ *   @short Work-stealing queue of entry ranges for the parallel run modes
+ *
+ *          The entry ranges (usually corresponding to the TTree clusters of
+ *          the input files) are initially distributed between the workers
+ *          in contiguous blocks of roughly the same number of entries. Each
+ *          worker takes ranges from the front of its own block. When a
+ *          worker runs out of work, it steals ranges from the back of the
+ *          block of the worker with the most ranges left. This way the
+ *          workers stay busy until the very end of the job, even when the
+ *          input files have very different sizes.
+ *
+ *          When one of the workers fails, the queue can be stopped, so that
+ *          the other workers wouldn't process any more ranges either.
+ *
+ *          The queue can be created in shared memory. In this case it can be
+ *          used by child processes forked after its creation.
+ *
+ * @version $Revision$
+ */
+class SWorkQueue {
+
+public:
+   /// Constructor with all the ranges, and the number of workers
+   SWorkQueue( const std::vector< SEntryRange >& ranges, UInt_t nWorkers,
+               Bool_t shared = kFALSE );
+   /// Destructor
+   ~SWorkQueue();
+
+   /// Get the next range to be processed by a given worker
+   Bool_t Next( UInt_t worker, SEntryRange& range );
+   /// Look at the range that a given worker would get next from its own deque
+   Bool_t Peek( UInt_t worker, SEntryRange& range );
+   /// Stop handing out ranges to all the workers
+   void Stop();
+
+private:
+   /// Forward declaration of the private deque type
+   struct Deque;
+
+   /// Take a range from the front of a given deque
+   Bool_t Pop( UInt_t worker, SEntryRange& range );
+   /// Take a range from the back of the fullest deque
+   Bool_t Steal( UInt_t worker, SEntryRange& range );
+
+   /// Copying the object is not allowed
+   SWorkQueue( const SWorkQueue& );
+   /// Assigning the object is not allowed
+   SWorkQueue& operator=( const SWorkQueue& );
+
+   UInt_t       m_nWorkers; ///< Number of workers using the queue
+   SEntryRange* m_ranges; ///< All the ranges, in order
+   Deque*       m_deques; ///< The deques of the workers
+   /// Flag showing that no more ranges should be handed out
+   std::atomic< bool >* m_stopped;
+   char*        m_memory; ///< Memory block holding the ranges and deques
+   size_t       m_memorySize; ///< Size of the memory block
+   Bool_t       m_shared; ///< Flag showing if shared memory is used
+
+}; // class SWorkQueue
+
+#endif // SFRAME_CORE_SWorkQueue_H
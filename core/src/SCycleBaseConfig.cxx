@@ -125,6 +125,10 @@ void SCycleBaseConfig::Initialize( TXMLNode* node ) {
             mode = SCycleConfig::LOCAL;
          else if( curAttr->GetValue() == TString( "PROOF" ) )
             mode = SCycleConfig::PROOF;
+         else if( curAttr->GetValue() == TString( "THREADS" ) )
+            mode = SCycleConfig::THREADS;
+         else if( curAttr->GetValue() == TString( "PROCESSES" ) )
+            mode = SCycleConfig::PROCESSES;
          else {
             m_logger << ::WARNING << "Running mode (\"" << curAttr->GetValue()
                      << "\") not recognised. Running locally!"
@@ -137,6 +141,12 @@ void SCycleBaseConfig::Initialize( TXMLNode* node ) {
          m_config.SetProofWorkDir( curAttr->GetValue() );
       } else if( curAttr->GetName() == TString( "ProofNodes" ) ) {
          m_config.SetProofNodes( atoi(curAttr->GetValue()) );
+      } else if( curAttr->GetName() == TString( "NThreads" ) ) {
+         m_config.SetNThreads( atoi( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "NProcesses" ) ) {
+         m_config.SetNProcesses( atoi( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "NConcurrentInputData" ) ) {
+         m_config.SetNConcurrentInputData( atoi( curAttr->GetValue() ) );
       } else if( curAttr->GetName() == TString( "OutputDirectory" ) ) {
          m_config.SetOutputDirectory( curAttr->GetValue() );
       } else if( curAttr->GetName() == TString( "PostFix" ) ) {
@@ -149,6 +159,33 @@ void SCycleBaseConfig::Initialize( TXMLNode* node ) {
          m_config.SetCacheLearnEntries( atoi( curAttr->GetValue() ) );
       } else if( curAttr->GetName() == TString( "ProcessOnlyLocal" ) ) {
          m_config.SetProcessOnlyLocal( ToBool( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "PrefetchInputFiles" ) ) {
+         m_config.SetPrefetchInputFiles( ToBool( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "ProfileEventLoop" ) ) {
+         m_config.SetProfileEventLoop( ToBool( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "ProgressInterval" ) ) {
+         m_config.SetProgressInterval( atof( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "ProgressFile" ) ) {
+         m_config.SetProgressFile( curAttr->GetValue() );
+      } else if( curAttr->GetName() == TString( "OutputCompression" ) ) {
+         Int_t settings = -1;
+         if( STree::ParseCompression( curAttr->GetValue(), settings ) ) {
+            m_config.SetOutputCompression( settings );
+         } else {
+            m_logger << ::WARNING << "Output compression (\""
+                     << curAttr->GetValue() << "\") not recognised or not "
+                     << "supported by this ROOT version. Using the default."
+                     << SLogger::endmsg;
+         }
+      } else if( curAttr->GetName() == TString( "OutputBasketSize" ) ) {
+         m_config.SetOutputBasketSize( atoi( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "OutputAutoFlush" ) ) {
+         m_config.SetOutputAutoFlush( atoll( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "OptimizeBasketsAfter" ) ) {
+         m_config.SetOptimizeBasketsAfter( atoll( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() ==
+                 TString( "OutputCompressionThreads" ) ) {
+         m_config.SetOutputCompressionThreads( atoi( curAttr->GetValue() ) );
       }
    }
 
@@ -450,6 +487,8 @@ SCycleBaseConfig::InitializeInputData( TXMLNode* node ) {
          inputData.SetSkipValid( ToBool( curAttr->GetValue() ) );
       } else if( curAttr->GetName() == TString( "SkipLookup" ) ) {
          inputData.SetSkipLookup( ToBool( curAttr->GetValue() ) );
+      } else if( curAttr->GetName() == TString( "ValidationThreads" ) ) {
+         inputData.SetValidationThreads( atoi( curAttr->GetValue() ) );
       }
    }
 
@@ -548,18 +587,51 @@ SCycleBaseConfig::InitializeInputData( TXMLNode* node ) {
       // get an output tree
       else if( child->GetNodeName() == TString( "OutputTree" ) ) {
 
-         TString treeName = "";
+         // The tree inherits the output settings of the cycle, unless it
+         // overrides them:
+         STree tree( "", ( STree::OUTPUT_TREE | STree::EVENT_TREE ) );
+         tree.compression = m_config.GetOutputCompression();
+         tree.basketSize = m_config.GetOutputBasketSize();
+         tree.autoFlush = m_config.GetOutputAutoFlush();
+         tree.optimizeBasketsAfter = m_config.GetOptimizeBasketsAfter();
+
          attribute = 0;
          while( ( attribute =
                   dynamic_cast< TXMLAttr* >( attributes() ) ) != 0 ) {
-            if( attribute->GetName() == TString( "Name" ) )
-               treeName = attribute->GetValue();
+            if( attribute->GetName() == TString( "Name" ) ) {
+               tree.treeName = attribute->GetValue();
+            } else if( attribute->GetName() == TString( "Compression" ) ) {
+               if( ! STree::ParseCompression( attribute->GetValue(),
+                                              tree.compression ) ) {
+                  m_logger << ::WARNING << "Compression (\""
+                           << attribute->GetValue() << "\") not recognised "
+                           << "or not supported by this ROOT version. Using "
+                           << "the cycle's setting." << SLogger::endmsg;
+               }
+            } else if( attribute->GetName() == TString( "BasketSize" ) ) {
+               tree.basketSize = atoi( attribute->GetValue() );
+            } else if( attribute->GetName() == TString( "AutoFlush" ) ) {
+               tree.autoFlush = atoll( attribute->GetValue() );
+            } else if( attribute->GetName() ==
+                       TString( "OptimizeBasketsAfter" ) ) {
+               tree.optimizeBasketsAfter = atoll( attribute->GetValue() );
+            } else if( attribute->GetName() == TString( "PassThrough" ) ) {
+               tree.passThrough = attribute->GetValue();
+            }
          }
 
-         REPORT_VERBOSE( "Found regular output tree with name: " << treeName );
-         inputData.AddTree( decoder->GetXMLCode( "OutputTree" ),
-                            STree( treeName, ( STree::OUTPUT_TREE |
-                                               STree::EVENT_TREE ) ) );
+         // ROOT resizes the baskets when a tree is flushed for the first
+         // time, so a fixed basket size is only kept without AutoFlush:
+         if( ( tree.basketSize > 0 ) && ( tree.autoFlush != 0 ) ) {
+            m_logger << ::WARNING << "The basket size of output tree \""
+                     << tree.treeName << "\" is only used until its first "
+                     << "flush. Set AutoFlush=\"0\" to keep it."
+                     << SLogger::endmsg;
+         }
+
+         REPORT_VERBOSE( "Found regular output tree with name: "
+                         << tree.treeName );
+         inputData.AddTree( decoder->GetXMLCode( "OutputTree" ), tree );
 
       }
       // get an input metadata tree
@@ -10,7 +10,16 @@
  *
  ***************************************************************************/
 
+// System include(s):
+#include <time.h>
+#include <sys/resource.h>
+
+// STL include(s):
+#include <algorithm>
+#include <mutex>
+
 // ROOT include(s):
+#include <TROOT.h>
 #include <TTree.h>
 #include <TSystem.h>
 #include <TString.h>
@@ -24,6 +33,33 @@
 #include "../include/SLogWriter.h"
 #include "../include/STreeType.h"
 #include "../include/SConstants.h"
+#include "../include/SProgressMonitor.h"
+
+namespace {
+
+   /// Get the peak resident memory of the current process in kilobytes
+   Long64_t PeakResidentMemory() {
+
+      struct rusage usage;
+      if( getrusage( RUSAGE_SELF, &usage ) ) {
+         return 0;
+      }
+#ifdef __APPLE__
+      // MacOS reports the value in bytes:
+      return usage.ru_maxrss / 1024;
+#else
+      return usage.ru_maxrss;
+#endif // __APPLE__
+   }
+
+   /// Mutex protecting the implicit multi-threading state of ROOT
+   std::mutex s_implicitMTMutex;
+   /// The number of cycles currently using implicit multi-threading
+   Int_t s_implicitMTUsers = 0;
+   /// Flag showing that SFrame turned implicit multi-threading on
+   Bool_t s_implicitMTOwned = kFALSE;
+
+} // private namespace
 
 #ifndef DOXYGEN_IGNORE
 ClassImp( SCycleBaseExec )
@@ -33,12 +69,29 @@ ClassImp( SCycleBaseExec )
  * The constructor just initialises some member variable(s).
  */
 SCycleBaseExec::SCycleBaseExec()
-   : m_nProcessedEvents( 0 ), m_nSkippedEvents( 0 ) {
+   : m_nProcessedEvents( 0 ), m_nSkippedEvents( 0 ), m_preloadedEntry( -1 ),
+     m_preloadSkipped( kFALSE ), m_eventRejected( kFALSE ),
+     m_inBatch( kFALSE ), m_batchRejected( 0 ), m_batchWritten( 0 ),
+     m_batchWeights(),
+     m_profile( kFALSE ),
+     m_stageTimes( SFrame::RunStatisticsName ), m_workerStart(),
+     m_fileBytesStart( 0 ), m_fileOpens( 0 ), m_monitor( 0 ),
+     m_ownMonitor( kFALSE ), m_implicitMT( kFALSE ) {
 
    SetLogName( this->GetName() );
    REPORT_VERBOSE( "SCycleBaseExec constructed" );
 }
 
+/**
+ * The destructor stops the progress reporting, if the processing was not
+ * finished normally.
+ */
+SCycleBaseExec::~SCycleBaseExec() {
+
+   StopProgressMonitor();
+   StopImplicitMT();
+}
+
 /**
  * This function is called by ROOT/PROOF when the processing of a job (input
  * data) starts on the PROOF master. In LOCAL mode it is just called before
@@ -64,7 +117,6 @@ void SCycleBaseExec::Begin( TTree* ) {
       // Let the user initialize his/her code:
       this->BeginMasterInputData( *m_inputData );
 
-      m_timeStart = clock_::now();
    } catch( const SError& error ) {
       REPORT_FATAL( "Exception caught with message: " << error.what() );
       throw;
@@ -87,6 +139,11 @@ void SCycleBaseExec::SlaveBegin( TTree* ) {
       // Read the cycle/input data configuration:
       this->ReadConfig();
 
+      // A tree only checks whether implicit multi-threading is enabled when
+      // it's constructed, so it has to be turned on before the output trees
+      // are created:
+      StartImplicitMT();
+
       //
       // Configure the base classes:
       //
@@ -110,6 +167,7 @@ void SCycleBaseExec::SlaveBegin( TTree* ) {
 
    } catch( const SError& error ) {
       REPORT_FATAL( "Exception caught with message: " << error.what() );
+      StopImplicitMT();
       throw;
    }
 
@@ -117,7 +175,12 @@ void SCycleBaseExec::SlaveBegin( TTree* ) {
    m_nProcessedEvents = 0;
    m_nSkippedEvents = 0;
    m_firstInit = kTRUE;
-   m_timeStart = clock_::now();
+   m_profile = GetConfig().GetProfileEventLoop();
+   m_stageTimes.Clear();
+   ReadStageClock( m_workerStart );
+   m_fileBytesStart = TFile::GetFileBytesRead();
+   m_fileOpens = 0;
+   StartProgressMonitor();
 
    // Print what just happened:
    m_logger << ::INFO << "Initialised InputData \"" << m_inputData->GetType()
@@ -159,13 +222,16 @@ Bool_t SCycleBaseExec::Notify() {
 
    // Should not run the initialization when it's first called in LOCAL mode.
    // ROOT always calls Notify() twice in this mode. Note that this behavior
-   // might change in future ROOT versions...
-   if( ( GetConfig().GetRunMode() == SCycleConfig::LOCAL ) && m_firstInit ) {
+   // might change in future ROOT versions... SCycleWorker mimics this
+   // behaviour in THREADS and PROCESSES mode.
+   if( ( GetConfig().GetRunMode() != SCycleConfig::PROOF ) && m_firstInit ) {
       m_firstInit = kFALSE;
       return kTRUE;
    }
 
    // Connect to all objects of the input file:
+   StageClock clock;
+   if( m_profile ) ReadStageClock( clock );
    TDirectory* inputFile = 0;
    try {
 
@@ -174,36 +240,19 @@ Bool_t SCycleBaseExec::Notify() {
       this->BeginInputFile( *m_inputData );
       m_logger << ::INFO << "Opening " << inputFile->GetFile()->GetName()
                << SLogger::endmsg;
+      ++m_fileOpens;
+      if( m_monitor ) {
+         m_monitor->SetFileIndex( m_fileOpens );
+         m_monitor->UpdateBytesRead();
+      }
    } catch( const SError& error ) {
       REPORT_FATAL( "Exception caught with message: " << error.what() );
       throw;
    }
 
-#if ROOT_VERSION_CODE >= ROOT_VERSION( 5, 26, 0 )
-   // Tell the cache to learn the access pattern for the configured number
-   // of entries:
-   if( GetConfig().GetCacheLearnEntries() > 0 ) {
-      m_inputTree->SetCacheLearnEntries( GetConfig().GetCacheLearnEntries() );
-   } else {
-      // If it's set to a negative number, add all the branches to the cache.
-      // Otherwise (it's 0) trust that the user already added all the necessary
-      // branches inside BeginInputFile(...).
-      if( GetConfig().GetCacheLearnEntries() < 0 ) {
-         m_inputTree->AddBranchToCache( "*", kTRUE );
-      }
-      m_inputTree->StopCacheLearningPhase();
-   }
-
-   // According to user reports, trying to turn on TTreeCache in LOCAL mode
-   // leads to hard-to-detect, but serious problems. (The results don't match
-   // up with the ones acquired without using a cache.) So, for now the code
-   // doesn't try to use a cache in this case.
-   if( GetConfig().GetUseTreeCache() &&
-       ( GetConfig().GetRunMode() == SCycleConfig::LOCAL ) ) {
-      m_logger << ::WARNING << "Can't use a TTreeCache in LOCAL mode, sorry..."
-               << SLogger::endmsg;
-   }
-#endif // ROOT_VERSION...
+   // Configure the TTreeCache-s of the input trees:
+   this->ConfigureTreeCache();
+   if( m_profile ) StageDone( SCycleStatistics::FileInitStage, clock );
 
    // Return gracefully:
    return kTRUE;
@@ -220,83 +269,420 @@ Bool_t SCycleBaseExec::Notify() {
  */
 Bool_t SCycleBaseExec::Process( Long64_t entry ) {
 
+   // Check if the entry has already been read:
+   const Bool_t preloaded = ( entry == m_preloadedEntry );
+   m_preloadedEntry = -1;
+
+   // Execute the analysis code, looking out for any thrown exceptions. (An
+   // event that couldn't be read by PreloadEvent(...) is skipped right away.)
+   Bool_t skipEvent = ( preloaded && m_preloadSkipped );
+   m_eventRejected = kFALSE;
+   StageClock clock;
+   if( m_profile ) ReadStageClock( clock );
+   if( ! skipEvent ) {
+      try {
+
+         if( ! preloaded ) {
+            this->GetEvent( entry );
+            if( m_profile ) StageDone( SCycleStatistics::ReadStage, clock );
+         }
+         m_inputData->SetEventTreeEntry( entry );
+         const Double_t weight = this->CalculateWeight( *m_inputData, entry );
+         if( m_profile ) StageDone( SCycleStatistics::WeightStage, clock );
+         this->ExecuteEvent( *m_inputData, weight );
+
+      } catch( const SError& error ) {
+         if( error.request() <= SError::SkipEvent ) {
+            REPORT_VERBOSE( "Exeption caught while processing event" );
+            REPORT_VERBOSE( " Message: " << error.what() );
+            REPORT_VERBOSE( " --> Skipping event!" );
+            skipEvent = kTRUE;
+         } else {
+            REPORT_FATAL( "Exception caught while processing event" );
+            REPORT_FATAL( "Message: " << error.what() );
+            throw;
+         }
+      }
+   }
+
+   // Write a new event to the output TTree(s) if the event doesn't have to be
+   // skipped:
+   // (Any time spent since the last measurement is accounted to the user
+   // code, also when it threw an exception.)
+   if( m_profile ) StageDone( SCycleStatistics::ExecuteStage, clock );
+   if( ( ! skipEvent ) && ( ! m_eventRejected ) ) {
+      this->WriteEvent();
+      if( m_profile ) StageDone( SCycleStatistics::WriteStage, clock );
+   } else {
+      ++m_nSkippedEvents;
+      if( m_monitor ) m_monitor->AddSkippedEvents( 1 );
+   }
+
+   ++m_nProcessedEvents;
+   if( m_monitor ) {
+      m_monitor->AddEvents( 1 );
+      m_monitor->UpdateBytesRead();
+   }
+
+   // Return gracefully:
+   return kTRUE;
+}
+
+/**
+ * This function is called by the framework with blocks of entries (usually
+ * TTree clusters) when it drives the event loop itself. If the cycle
+ * declares with ProcessesEventBatches() that it implements
+ * ExecuteEventBatch(...), the whole block is given to it in a single call.
+ * Otherwise the function returns right away, and the caller has to process
+ * the entries one by one with Process(...).
+ *
+ * @param firstEntry The first entry of the block in the current input tree
+ * @param nEntries The number of entries in the block
+ * @returns <code>kTRUE</code> if the block was processed,
+ *          <code>kFALSE</code> if the cycle doesn't process blocks
+ */
+Bool_t SCycleBaseExec::ProcessBatch( Long64_t firstEntry, Long64_t nEntries ) {
+
+   // Check if the cycle processes blocks at all:
+   if( ! this->ProcessesEventBatches() ) {
+      return kFALSE;
+   }
+   if( nEntries <= 0 ) {
+      return kTRUE;
+   }
+
    // Execute the analysis code, looking out for any thrown exceptions:
-   Bool_t skipEvent = kFALSE;
+   Bool_t skipBatch = kFALSE;
+   m_inBatch = kTRUE;
+   m_batchRejected = 0;
+   m_batchWritten = 0;
+   StageClock clock;
+   if( m_profile ) ReadStageClock( clock );
    try {
 
-      this->GetEvent( entry );
-      m_inputData->SetEventTreeEntry( entry );
-      this->ExecuteEvent( *m_inputData, this->CalculateWeight( *m_inputData,
-                                                               entry ) );
+      m_batchWeights.resize( nEntries );
+      this->CalculateWeights( *m_inputData, firstEntry, nEntries,
+                              &m_batchWeights.front() );
+      if( m_profile ) StageDone( SCycleStatistics::WeightStage, clock );
+      m_inputData->SetEventTreeEntry( firstEntry );
+      this->ExecuteEventBatch( *m_inputData, firstEntry, nEntries,
+                               &m_batchWeights.front() );
 
    } catch( const SError& error ) {
       if( error.request() <= SError::SkipEvent ) {
-         REPORT_VERBOSE( "Exeption caught while processing event" );
+         REPORT_VERBOSE( "Exeption caught while processing event block" );
          REPORT_VERBOSE( " Message: " << error.what() );
-         REPORT_VERBOSE( " --> Skipping event!" );
-         skipEvent = kTRUE;
+         REPORT_VERBOSE( " --> Skipping event block!" );
+         skipBatch = kTRUE;
       } else {
-         REPORT_FATAL( "Exception caught while processing event" );
+         REPORT_FATAL( "Exception caught while processing event block" );
          REPORT_FATAL( "Message: " << error.what() );
+         m_inBatch = kFALSE;
          throw;
       }
    }
+   m_inBatch = kFALSE;
+   // The reading and writing of the events is done by the user code in this
+   // case, so all of it is accounted to the user code:
+   if( m_profile ) StageDone( SCycleStatistics::ExecuteStage, clock );
+
+   // Update the statistics. When the block was abandoned, the events that
+   // were already written out still count as processed normally.
+   const Long64_t skipped =
+      ( skipBatch ? std::max( nEntries - m_batchWritten, Long64_t( 0 ) ) :
+        std::min( m_batchRejected, nEntries ) );
+   m_nSkippedEvents += skipped;
+   m_nProcessedEvents += nEntries;
+   if( m_monitor ) {
+      m_monitor->AddEvents( nEntries );
+      m_monitor->AddSkippedEvents( skipped );
+      m_monitor->UpdateBytesRead();
+   }
 
-   // Write a new event to the output TTree(s) if the event doesn't have to be
-   // skipped:
-   if( ! skipEvent ) {
-      int nbytes = 0;
-      std::vector< TTree* >::iterator tree_itr = m_outputTrees.begin();
-      std::vector< TTree* >::iterator tree_end = m_outputTrees.end();
-      for( ; tree_itr != tree_end; ++tree_itr ) {
-         nbytes = ( *tree_itr )->Fill();
-         if( nbytes < 0 ) {
-            REPORT_ERROR( "Write error occured in tree \""
-                          << ( *tree_itr )->GetName() << "\"" );
-            // Stop the execution, as this is a serious problem:
-            throw SError( "TTree write error occured",
-                          SError::StopExecution );
-         } else if( nbytes == 0 ) {
-            m_logger << ::WARNING << "No data written to tree \""
-                     << ( *tree_itr )->GetName() << "\"" << SLogger::endmsg;
-         }
+   return kTRUE;
+}
+
+/**
+ * The wall clock time is taken from a monotonic clock, while the CPU time
+ * is the one used by the current thread. So the measurement is correct in
+ * THREADS mode as well.
+ *
+ * @param clock The object to fill with the current time
+ */
+void SCycleBaseExec::ReadStageClock( StageClock& clock ) {
+
+   clock.real = std::chrono::steady_clock::now();
+   timespec ts;
+   clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+   clock.cpu = ts.tv_sec + 1e-9 * ts.tv_nsec;
+
+   return;
+}
+
+/**
+ * @param stage The processing stage that just finished
+ * @param clock The clock reading at the beginning of the stage. It is
+ *              updated to the current time.
+ */
+void SCycleBaseExec::StageDone( SCycleStatistics::Stage stage,
+                                StageClock& clock ) {
+
+   StageClock now;
+   ReadStageClock( now );
+   m_stageTimes.AddStageTime(
+      stage,
+      std::chrono::duration< Double_t >( now.real - clock.real ).count(),
+      now.cpu - clock.cpu );
+   clock = now;
+
+   return;
+}
+
+/**
+ * When the OutputCompressionThreads option of the cycle is set, ROOT's
+ * implicit multi-threading is turned on while the cycle is processing events.
+ * TTree::Fill(...) then compresses the baskets of the output branches on a
+ * pool of threads when the output trees are flushed, instead of compressing
+ * them one by one on the event loop's thread. Reading the input is not
+ * affected, as SFrame reads the input branches one by one.
+ *
+ * Implicit multi-threading is a global setting of ROOT, so it is only turned
+ * off again once all the cycles using it are finished. It's never turned off
+ * if it was turned on by somebody else. It's not left on between the event
+ * loops, so that no thread pool would be running when SFrame forks its
+ * worker processes.
+ */
+void SCycleBaseExec::StartImplicitMT() {
+
+   const Int_t threads = GetConfig().GetOutputCompressionThreads();
+   if( m_implicitMT || ( threads == 0 ) ) {
+      return;
+   }
+
+#if defined( R__USE_IMT ) && \
+   ( ROOT_VERSION_CODE >= ROOT_VERSION( 6, 10, 0 ) )
+   std::lock_guard< std::mutex > lock( s_implicitMTMutex );
+   if( ( s_implicitMTUsers++ == 0 ) && ( ! ROOT::IsImplicitMTEnabled() ) ) {
+      // Make sure that ROOT protects its global state:
+      ROOT::EnableThreadSafety();
+      // A negative value means that all the cores should be used:
+      ROOT::EnableImplicitMT( threads > 0 ? threads : 0 );
+      s_implicitMTOwned = kTRUE;
+      m_logger << ::INFO << "Compressing the output on "
+               << ROOT::GetImplicitMTPoolSize() << " threads"
+               << SLogger::endmsg;
+   }
+   m_implicitMT = kTRUE;
+#else
+   m_logger << ::WARNING << "ROOT was built without implicit "
+            << "multi-threading. The output is compressed on a single "
+            << "thread." << SLogger::endmsg;
+#endif // R__USE_IMT
+
+   return;
+}
+
+/**
+ * Releases the implicit multi-threading requested by StartImplicitMT(). It's
+ * only turned off in ROOT when no other cycle uses it anymore, and only if
+ * SFrame turned it on. The function is called at the end of every input data
+ * block (and by the destructor), so it does nothing when the cycle doesn't
+ * use implicit multi-threading at the moment.
+ */
+void SCycleBaseExec::StopImplicitMT() {
+
+   if( ! m_implicitMT ) {
+      return;
+   }
+
+#if defined( R__USE_IMT ) && \
+   ( ROOT_VERSION_CODE >= ROOT_VERSION( 6, 10, 0 ) )
+   std::lock_guard< std::mutex > lock( s_implicitMTMutex );
+   if( ( --s_implicitMTUsers == 0 ) && s_implicitMTOwned ) {
+      ROOT::DisableImplicitMT();
+      s_implicitMTOwned = kFALSE;
+   }
+#endif // R__USE_IMT
+   m_implicitMT = kFALSE;
+
+   return;
+}
+
+/**
+ * The framework calls this function for every event that was processed
+ * without an exception in ExecuteEvent(...). Cycles implementing
+ * ExecuteEventBatch(...) have to call it themselves for each event that
+ * should be written out, after loading the event with GetEvent(...). (The
+ * branches passed through to the output are read for the entry last loaded
+ * by GetEvent(...).)
+ */
+void SCycleBaseExec::WriteEvent() {
+
+   // Read the input branches that are copied into the output:
+   this->ReadPassThroughBranches();
+
+   int nbytes = 0;
+   std::vector< TTree* >::iterator tree_itr = m_outputTrees.begin();
+   std::vector< TTree* >::iterator tree_end = m_outputTrees.end();
+   for( ; tree_itr != tree_end; ++tree_itr ) {
+      nbytes = ( *tree_itr )->Fill();
+      if( nbytes < 0 ) {
+         REPORT_ERROR( "Write error occured in tree \""
+                       << ( *tree_itr )->GetName() << "\"" );
+         // Stop the execution, as this is a serious problem:
+         throw SError( "TTree write error occured",
+                       SError::StopExecution );
+      } else if( nbytes == 0 ) {
+         m_logger << ::WARNING << "No data written to tree \""
+                  << ( *tree_itr )->GetName() << "\"" << SLogger::endmsg;
       }
+   }
+
+   // Copy the event for a pipelined downstream cycle:
+   this->FillPipelineTrees();
+
+   // Keep track of the events written out from a block:
+   if( m_inBatch ) ++m_batchWritten;
+
+   // Resize the output baskets if the trees have enough entries for it:
+   this->OptimizeOutputBaskets();
+
+   return;
+}
+
+/**
+ * Rejecting events by throwing an SError with SkipEvent severity is
+ * expensive when most of the events are rejected. Calling this function
+ * instead, and returning from ExecuteEvent(...) normally, has the same
+ * effect: the event is not written to the output tree(s), and it's counted
+ * as a skipped event.
+ *
+ * In ExecuteEventBatch(...) the function has to be called once for each
+ * rejected event of the block. Those events should of course not be
+ * written out with WriteEvent().
+ */
+void SCycleBaseExec::SetEventRejected() {
+
+   if( m_inBatch ) {
+      ++m_batchRejected;
    } else {
-      ++m_nSkippedEvents;
+      m_eventRejected = kTRUE;
    }
 
-   ++m_nProcessedEvents;
-   if( ! ( m_nProcessedEvents % 1000 ) ) {
-      double time_elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                             clock_::now() - m_timeStart).count();
-      int total_events = ( m_inputData->GetNEventsMax() < 0 ?
-                           m_inputData->GetEventsTotal() :
-                           m_inputData->GetNEventsMax() );
-      int remaining_events = total_events - m_nProcessedEvents;
-      double time_remaining = remaining_events * (time_elapsed/m_nProcessedEvents);
-      std::string time_unit = "seconds";
-      if (time_remaining > 3600) {
-         time_remaining /= 3600;
-         time_unit = "hours";
-      } else if (time_remaining > 60) {
-         time_remaining /= 60;
-         time_unit = "minutes";
+   return;
+}
+
+/**
+ * The default implementation is only called if the cycle claims to process
+ * blocks of events with ProcessesEventBatches(), but doesn't actually
+ * implement this function.
+ */
+void SCycleBaseExec::ExecuteEventBatch( const SInputData&, Long64_t,
+                                        Long64_t, const Double_t* ) {
+
+   throw SError( "The cycle doesn't implement ExecuteEventBatch(...)",
+                 SError::StopExecution );
+   return;
+}
+
+/**
+ * The progress of the event loop is reported by a background thread, so that
+ * the event loop itself only has to increment a counter. In LOCAL mode the
+ * reports are printed at INFO level, while on PROOF they're only needed for
+ * debugging.
+ *
+ * In THREADS and PROCESSES mode the framework gives a single monitor to all
+ * the workers in the input object list, which knows about the number of
+ * events processed by all of them. The cycle then just updates that one.
+ *
+ * The monitor is created even if the progress reports are turned off, as
+ * its counters are also used by SMetricsExporter.
+ */
+void SCycleBaseExec::StartProgressMonitor() {
+
+   StopProgressMonitor();
+
+   // Use the monitor shared by all the workers, if there is one:
+   SProgressMonitor* shared = ( fInput ?
+                                dynamic_cast< SProgressMonitor* >(
+                                   fInput->FindObject(
+                                      SFrame::ProgressMonitorName ) ) : 0 );
+   if( shared ) {
+      m_monitor = shared;
+      m_ownMonitor = kFALSE;
+      return;
+   }
+
+   Long64_t totalEvents = m_inputData->GetEventsTotal();
+   if( ( m_inputData->GetNEventsMax() >= 0 ) &&
+       ( ( totalEvents < 0 ) ||
+         ( m_inputData->GetNEventsMax() < totalEvents ) ) ) {
+      totalEvents = m_inputData->GetNEventsMax();
+   }
+   m_monitor =
+      new SProgressMonitor( GetName(), *m_inputData, totalEvents,
+                            GetConfig().GetProgressInterval(),
+                            ( GetConfig().GetRunMode() == SCycleConfig::LOCAL ?
+                              ::INFO : ::DEBUG ),
+                            GetConfig().GetProgressFile() );
+   m_ownMonitor = kTRUE;
+
+   return;
+}
+
+/**
+ * The monitor is only deleted if it was created by the cycle itself. A
+ * monitor shared by multiple workers is deleted by the framework.
+ */
+void SCycleBaseExec::StopProgressMonitor() {
+
+   // Count the bytes read at the very end of the event loop as well:
+   if( m_monitor ) {
+      m_monitor->UpdateBytesRead();
+   }
+   if( m_ownMonitor ) {
+      delete m_monitor;
+   }
+   m_monitor = 0;
+   m_ownMonitor = kFALSE;
+
+   return;
+}
+
+/**
+ * When multiple cycles are executed in a single event loop, the cycles may
+ * share some of their input variables. So the framework first reads the
+ * current entry for all the cycles, and only then lets them process it. This
+ * way none of the cycles can see the modifications made by another cycle to
+ * the shared variables.
+ *
+ * @param entry The entry that should be read from the input TTree(s)
+ */
+void SCycleBaseExec::PreloadEvent( Long64_t entry ) {
+
+   StageClock clock;
+   if( m_profile ) ReadStageClock( clock );
+   m_preloadSkipped = kFALSE;
+   try {
+      this->GetEvent( entry );
+      if( m_profile ) StageDone( SCycleStatistics::ReadStage, clock );
+   } catch( const SError& error ) {
+      if( error.request() <= SError::SkipEvent ) {
+         // Let Process(...) skip just this event, like it would do when
+         // reading the event itself:
+         REPORT_VERBOSE( "Exeption caught while reading event" );
+         REPORT_VERBOSE( " Message: " << error.what() );
+         REPORT_VERBOSE( " --> Skipping event!" );
+         m_preloadSkipped = kTRUE;
+      } else {
+         REPORT_FATAL( "Exception caught while reading event" );
+         REPORT_FATAL( "Message: " << error.what() );
+         throw;
       }
-      // Only print these messages in local mode in INFO level. In PROOF mode
-      // they're only needed for debugging.
-      m_logger << ( GetConfig().GetRunMode() == SCycleConfig::LOCAL ? ::INFO :
-                    ::DEBUG )
-               << "Processing entry: " << entry << " ("
-               << ( m_nProcessedEvents - 1 ) << " / "
-               << total_events
-               << " events processed so far, ~ "
-               << TString::Format("%.2g" , time_remaining)
-               << " " << time_unit << " left)"
-               << SLogger::endmsg;
    }
+   m_preloadedEntry = entry;
 
-   // Return gracefully:
-   return kTRUE;
+   return;
 }
 
 /**
@@ -309,6 +695,9 @@ void SCycleBaseExec::SlaveTerminate() {
 
    REPORT_VERBOSE( "Running finalization on slave" );
 
+   // Stop reporting the progress of the event loop:
+   StopProgressMonitor();
+
    //
    // Tell the user cycle that the InputData has ended:
    //
@@ -319,6 +708,9 @@ void SCycleBaseExec::SlaveTerminate() {
       throw;
    }
 
+   // Hand the last events over to a pipelined downstream cycle:
+   this->SendPipelineChunk();
+
    //
    // Write the objects that are meant to be merged in-file, into
    // the output file:
@@ -331,11 +723,24 @@ void SCycleBaseExec::SlaveTerminate() {
    SCycleStatistics* stat = new SCycleStatistics( SFrame::RunStatisticsName,
                                                   m_nProcessedEvents,
                                                   m_nSkippedEvents );
+   stat->Add( m_stageTimes );
+   StageClock now;
+   ReadStageClock( now );
+   stat->SetRealTime( std::chrono::duration< Double_t >(
+                         now.real - m_workerStart.real ).count() );
+   stat->SetCpuTime( now.cpu - m_workerStart.cpu );
+   stat->SetBytesRead( TFile::GetFileBytesRead() - m_fileBytesStart );
+   stat->SetUncompressedBytesRead( this->GetInputBytesRead() );
+   stat->SetFileOpens( m_fileOpens );
+   stat->SetPeakResidentMemory( PeakResidentMemory() );
    fOutput->Add( stat );
 
    // Close the output file:
    this->CloseOutputFile();
 
+   // The last baskets have been compressed by now:
+   StopImplicitMT();
+
    // Reset the ntuple handling component:
    this->ClearCachedTrees();
 
@@ -347,6 +752,29 @@ void SCycleBaseExec::SlaveTerminate() {
    return;
 }
 
+/**
+ * When the processing of an input data block failed on a worker, the
+ * framework calls this function instead of SlaveTerminate(). The user code
+ * is not called anymore, and no statistics are written. Only the output
+ * file is closed, so that the framework could remove it.
+ */
+void SCycleBaseExec::AbortInputData() {
+
+   // Stop reporting the progress of the event loop:
+   StopProgressMonitor();
+
+   // Close the output file:
+   this->CloseOutputFile();
+
+   // Stop using the threads for the output:
+   StopImplicitMT();
+
+   // Reset the ntuple handling component:
+   this->ClearCachedTrees();
+
+   return;
+}
+
 /**
  * This function is called by ROOT/PROOF on the master node after all events
  * have been processed. The code just calls the user's
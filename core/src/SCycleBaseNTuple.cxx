@@ -19,9 +19,16 @@
 
 // ROOT include(s):
 #include <TFile.h>
+#include <TMemFile.h>
 #include <TTree.h>
 #include <TChain.h>
 #include <TBranch.h>
+#include <TBranchElement.h>
+#include <TLeaf.h>
+#include <TLeafC.h>
+#include <TClass.h>
+#include <TRegexp.h>
+#include <TObjString.h>
 #include <TROOT.h>
 #include <TList.h>
 #include <TSelectorList.h>
@@ -39,19 +46,62 @@
 #include "../include/STreeType.h"
 #include "../include/SConstants.h"
 #include "../include/SOutputFile.h"
+#include "../include/SPipelineQueue.h"
 
 #ifndef DOXYGEN_IGNORE
 ClassImp( SCycleBaseNTuple )
 #endif // DOXYGEN_IGNORE
 
+namespace {
+
+   /**
+    * Only branches made from a leaf list are handled this way. The buffer
+    * has to be large enough for the longest variable sized array in the
+    * input file. Variable sized arrays and strings are only supported in
+    * branches that have a single leaf.
+    *
+    * @param branch The input branch
+    * @returns The size of the buffer needed by the branch in bytes, or -1
+    *          if the branch is not supported
+    */
+   Long64_t LeafListSize( TBranch* branch ) {
+
+      TObjArray* leaves = branch->GetListOfLeaves();
+      const Int_t nLeaves = leaves->GetEntriesFast();
+      Long64_t size = 0;
+      for( Int_t i = 0; i < nLeaves; ++i ) {
+         TLeaf* leaf = static_cast< TLeaf* >( leaves->At( i ) );
+         Long64_t length = leaf->GetLenStatic();
+         if( leaf->GetLeafCount() ) {
+            if( nLeaves > 1 ) return -1;
+            length *= std::max( leaf->GetLeafCount()->GetMaximum(), 1 );
+         } else if( dynamic_cast< TLeafC* >( leaf ) ) {
+            if( nLeaves > 1 ) return -1;
+            length = leaf->GetMaximum() + 1;
+         }
+         size += leaf->GetLenType() * length;
+      }
+
+      return size;
+   }
+
+} // private namespace
+
 /**
  * The constructor is only initialising the base class.
  */
 SCycleBaseNTuple::SCycleBaseNTuple()
    : SCycleBaseBase(), m_inputTrees(), m_inputBranches(), m_inputVarPointers(),
-     m_outputFile( 0 ),
-     m_outputTrees(), m_metaInputTrees(), m_outputVarPointers(),
-     m_input( 0 ), m_output( 0 ) {
+     m_inputShare( 0 ), m_inputCopies(), m_currentEntry( -1 ),
+     m_inputBytesRead( 0 ), m_lazyConnection( kFALSE ), m_lazyBranch( 0 ),
+     m_weightTerms(), m_weightType(), m_weightVersion(),
+     m_weightHasCuts( kFALSE ), m_constantWeight( 0.0 ),
+     m_outputFile( 0 ), m_pipeline( 0 ), m_pipelineFile( 0 ),
+     m_pipelineTrees(), m_pipelineEntries( 0 ), m_pipelineOnly( kFALSE ),
+     m_outputTrees(), m_outputTreeSettings(),
+     m_pendingBasketOptimizations( 0 ), m_passThrough(),
+     m_passThroughCreated( kFALSE ), m_metaInputTrees(),
+     m_outputVarPointers(), m_input( 0 ), m_output( 0 ) {
 
    REPORT_VERBOSE( "SCycleBaseNTuple constructed" );
 }
@@ -63,6 +113,10 @@ SCycleBaseNTuple::SCycleBaseNTuple()
 SCycleBaseNTuple::~SCycleBaseNTuple() {
 
    DeleteInputVariables();
+   DeletePipelineOutputTrees();
+   DeletePassThroughBranches();
+   DeletePipelineChunk();
+   DeleteWeightFormulas();
    REPORT_VERBOSE( "SCycleBaseNTuple destructed" );
 }
 
@@ -418,6 +472,16 @@ TDirectory* SCycleBaseNTuple::GetOutputFile() {
    // Free up the possibly allocated memory:
    if( tempDirName ) delete[] tempDirName;
 
+   // Set the compression of the output file. This is used by all the
+   // branches that don't ask for something else.
+   const Int_t compression = GetConfig().GetOutputCompression();
+   if( m_outputFile && ( compression >= 0 ) ) {
+      m_outputFile->SetCompressionSettings( compression );
+      m_logger << ::DEBUG << "Output file compression set to: "
+               << STree::CompressionName( compression )
+               << SLogger::endmsg;
+   }
+
    // Return the directory of the output file:
    return m_outputFile;
 }
@@ -428,6 +492,9 @@ TDirectory* SCycleBaseNTuple::GetOutputFile() {
  */
 void SCycleBaseNTuple::CloseOutputFile() {
 
+   // The output trees that only fed a pipeline are not saved anywhere:
+   DeletePipelineOutputTrees();
+
    // We only need to do anything if the output file has been made:
    if( m_outputFile ) {
 
@@ -437,6 +504,9 @@ void SCycleBaseNTuple::CloseOutputFile() {
       // Save all the output trees into the output file. Memory-kept TTrees
       // don't need this.
       this->SaveOutputTrees();
+      DeletePassThroughBranches();
+      // A chunk that wasn't sent to the pipeline by now, will never be:
+      DeletePipelineChunk();
 
       // Close the output file and reset the variables:
       m_outputFile->SaveSelf( kTRUE );
@@ -444,6 +514,8 @@ void SCycleBaseNTuple::CloseOutputFile() {
       delete m_outputFile;
       m_outputFile = 0;
       m_outputTrees.clear();
+      m_outputTreeSettings.clear();
+      m_pendingBasketOptimizations = 0;
       m_metaOutputTrees.clear();
    }
 
@@ -472,11 +544,23 @@ CreateOutputTrees( const SInputData& iD,
    }
 
    // Clear the vector of output trees:
+   DeletePipelineOutputTrees();
    m_outputTrees.clear();
+   m_outputTreeSettings.clear();
+   m_pendingBasketOptimizations = 0;
    m_metaOutputTrees.clear();
 
    // Clear the vector of output variable pointers:
    m_outputVarPointers.clear();
+   DeletePassThroughBranches();
+
+   // Check whether the written events should be handed over to a pipelined
+   // cycle, and whether they should be written to disk as well:
+   DeletePipelineChunk();
+   m_pipeline = ( m_input ?
+                  dynamic_cast< SPipelineQueue* >(
+                     m_input->FindObject( SFrame::PipelineQueueName ) ) : 0 );
+   m_pipelineOnly = ( m_pipeline && ( ! m_pipeline->GetWriteIntermediate() ) );
 
    // Access all the regular output trees:
    const std::vector< STree >* sOutTree =
@@ -528,10 +612,27 @@ CreateOutputTrees( const SInputData& iD,
                                   TString( "Format: User" ) +
                                   ", data type: " + iD.GetType() );
          tree->SetAutoSave( autoSave );
+         tree->SetAutoFlush( st->autoFlush );
+
+         // Trees only feeding a pipeline are not filled by the caller, and
+         // are not written anywhere. Only the in-memory copies made by
+         // FillPipelineTrees() are filled.
+         if( m_pipelineOnly ) {
+            tree->SetDirectory( 0 );
+            m_outputTrees.push_back( tree );
+            m_outputTreeSettings.push_back( *st );
+            REPORT_VERBOSE( "TTree \"" << tname
+                            << "\" only feeds the pipeline" );
+            continue;
+         }
 
          // Store the pointer:
          outTrees.push_back( tree );
          m_outputTrees.push_back( tree );
+         m_outputTreeSettings.push_back( *st );
+         if( st->optimizeBasketsAfter > 0 ) {
+            ++m_pendingBasketOptimizations;
+         }
 
          // Make sure that an output file is available:
          GetOutputFile();
@@ -593,6 +694,7 @@ CreateOutputTrees( const SInputData& iD,
          TTree* tree = new TTree( tname, TString( "Format: User" ) +
                                   ", data type: " + iD.GetType() );
          tree->SetAutoSave( autoSave );
+         tree->SetAutoFlush( GetConfig().GetOutputAutoFlush() );
 
          // Remember its pointer:
          m_metaOutputTrees.push_back( tree );
@@ -673,6 +775,238 @@ void SCycleBaseNTuple::SaveOutputTrees() {
    return;
 }
 
+/**
+ * When the cycle is the upstream cycle of a pipeline, every event written
+ * by the cycle is written into empty copies of the output trees that live in
+ * an in-memory file. (The output trees themselves are only filled if the
+ * intermediate output is written to disk as well.) Once the in-memory file
+ * holds a full chunk of events, it is handed over to the downstream cycle.
+ *
+ * The copies are only made when the first event is written, since the user
+ * code declares the output variables after the output trees are created.
+ *
+ * <strong>The function is used internally by the framework!</strong>
+ */
+void SCycleBaseNTuple::FillPipelineTrees() {
+
+   // Return right away in the most common case:
+   if( ( ! m_pipeline ) || m_outputTrees.empty() ) return;
+
+   //
+   // Start a new chunk if needed:
+   //
+   if( ! m_pipelineFile ) {
+      TDirectory* savedir = gDirectory;
+      m_pipelineFile = new TMemFile( "SFramePipelineChunk.root", "RECREATE" );
+      for( std::vector< TTree* >::const_iterator tree = m_outputTrees.begin();
+           tree != m_outputTrees.end(); ++tree ) {
+         // The copy shares the variables of the output tree:
+         TTree* copy = ( *tree )->CloneTree( 0 );
+         if( ! copy ) {
+            throw SError( TString( "Couldn't copy output tree \"" ) +
+                          ( *tree )->GetName() + "\" for the pipeline",
+                          SError::StopExecution );
+         }
+         copy->SetDirectory( m_pipelineFile );
+         m_pipelineTrees.push_back( copy );
+      }
+      if( savedir ) savedir->cd();
+   }
+
+   //
+   // Write the event into the chunk:
+   //
+   for( std::vector< TTree* >::const_iterator tree = m_pipelineTrees.begin();
+        tree != m_pipelineTrees.end(); ++tree ) {
+      if( ( *tree )->Fill() < 0 ) {
+         REPORT_ERROR( "Write error occured in pipelined tree \""
+                       << ( *tree )->GetName() << "\"" );
+         throw SError( "TTree write error occured", SError::StopExecution );
+      }
+   }
+
+   // Send the chunk if it's full:
+   if( ++m_pipelineEntries >= m_pipeline->GetChunkSize() ) {
+      SendPipelineChunk();
+   }
+
+   return;
+}
+
+/**
+ * The in-memory copies of the output trees are written into their file, and
+ * the file is pushed into the queue leading to the downstream cycle. The
+ * function blocks while the queue is full.
+ *
+ * <strong>The function is used internally by the framework!</strong>
+ */
+void SCycleBaseNTuple::SendPipelineChunk() {
+
+   // Check if there's anything to send:
+   if( ! m_pipelineFile ) return;
+
+   //
+   // Finalise the trees. Deleting them also disconnects them from the output
+   // trees.
+   //
+   TDirectory* savedir = gDirectory;
+   m_pipelineFile->cd();
+   for( std::vector< TTree* >::const_iterator tree = m_pipelineTrees.begin();
+        tree != m_pipelineTrees.end(); ++tree ) {
+      ( *tree )->Write();
+      delete *tree;
+   }
+   m_pipelineTrees.clear();
+   if( savedir ) savedir->cd();
+
+   //
+   // Hand the file over to the downstream cycle:
+   //
+   TFile* file = m_pipelineFile;
+   m_pipelineFile = 0;
+   m_pipelineEntries = 0;
+   if( ! m_pipeline->Push( file ) ) {
+      delete file;
+      throw SError( "The downstream cycle of the pipeline stopped",
+                    SError::StopExecution );
+   }
+
+   return;
+}
+
+/**
+ * Deletes the chunk of events that is being collected for a pipelined cycle,
+ * without sending it. Used when the processing of an input data block is
+ * finished or abandoned.
+ */
+void SCycleBaseNTuple::DeletePipelineChunk() {
+
+   for( std::vector< TTree* >::const_iterator tree = m_pipelineTrees.begin();
+        tree != m_pipelineTrees.end(); ++tree ) {
+      delete *tree;
+   }
+   m_pipelineTrees.clear();
+   delete m_pipelineFile;
+   m_pipelineFile = 0;
+   m_pipelineEntries = 0;
+
+   return;
+}
+
+/**
+ * When the upstream cycle of a pipeline doesn't write its output trees to
+ * disk, the trees are not attached to any file or output list. So they have
+ * to be deleted explicitly, after the in-memory copies connected to them.
+ */
+void SCycleBaseNTuple::DeletePipelineOutputTrees() {
+
+   // Check if there's anything to delete:
+   if( ! m_pipelineOnly ) return;
+
+   DeletePipelineChunk();
+   for( std::vector< TTree* >::const_iterator tree = m_outputTrees.begin();
+        tree != m_outputTrees.end(); ++tree ) {
+      delete *tree;
+   }
+   m_outputTrees.clear();
+   m_outputTreeSettings.clear();
+   m_pendingBasketOptimizations = 0;
+   m_pipelineOnly = kFALSE;
+
+   return;
+}
+
+/**
+ * ROOT only optimises the basket sizes of a tree by itself when the tree is
+ * flushed for the first time. Output trees with the OptimizeBasketsAfter
+ * option set get their baskets resized once they have the configured number
+ * of entries instead, based on the size of their branches up to that point.
+ * The baskets are not flushed here, the new sizes take effect when they are
+ * written out at the next regular flush of the tree. This way the cluster
+ * boundaries of the tree are not affected.
+ *
+ * <strong>The function is used internally by the framework!</strong>
+ */
+void SCycleBaseNTuple::OptimizeOutputBaskets() {
+
+   // Return right away in the most common case:
+   if( ! m_pendingBasketOptimizations ) return;
+
+   for( size_t i = 0; i < m_outputTrees.size(); ++i ) {
+
+      // Check if this tree needs to be optimised now:
+      Long64_t& after = m_outputTreeSettings[ i ].optimizeBasketsAfter;
+      TTree* tree = m_outputTrees[ i ];
+      if( ( after <= 0 ) || ( tree->GetEntries() < after ) ) continue;
+
+      m_logger << ::DEBUG << "Optimising the baskets of tree \""
+               << tree->GetName() << "\" after " << tree->GetEntries()
+               << " entries" << SLogger::endmsg;
+      tree->OptimizeBaskets();
+
+      // Only do it once:
+      after = 0;
+      --m_pendingBasketOptimizations;
+   }
+
+   return;
+}
+
+/**
+ * The basket size can only be set reliably when a branch is created, as the
+ * first basket of the branch is allocated right away. The settings of the
+ * tree from the configuration are used. (The settings of the cycle for the
+ * metadata trees.)
+ *
+ * Note that ROOT resizes the baskets of a tree when it's flushed for the
+ * first time, and so does OptimizeOutputBaskets(). The configured size only
+ * sticks for trees with AutoFlush turned off.
+ *
+ * @param tree The output tree that the branch is created in
+ * @returns The basket size to give to TTree::Branch(...)
+ */
+Int_t SCycleBaseNTuple::GetOutputBasketSize( const TTree* tree ) const {
+
+   Int_t basketSize = GetConfig().GetOutputBasketSize();
+   for( size_t i = 0; i < m_outputTrees.size(); ++i ) {
+      if( m_outputTrees[ i ] == tree ) {
+         basketSize = m_outputTreeSettings[ i ].basketSize;
+         break;
+      }
+   }
+
+   // Use ROOT's default if nothing was configured:
+   return ( basketSize > 0 ? basketSize : 32000 );
+}
+
+/**
+ * The branches of an output tree inherit the compression settings of the
+ * output file. This function applies the settings of the tree from the
+ * configuration instead. (The settings of the cycle are used for the
+ * metadata trees.)
+ *
+ * @param tree The output tree that the branch was created in
+ * @param branch The branch that was just created
+ */
+void SCycleBaseNTuple::ConfigureOutputBranch( TTree* tree,
+                                              TBranch* branch ) const {
+
+   Int_t compression = GetConfig().GetOutputCompression();
+   for( size_t i = 0; i < m_outputTrees.size(); ++i ) {
+      if( m_outputTrees[ i ] == tree ) {
+         compression = m_outputTreeSettings[ i ].compression;
+         break;
+      }
+   }
+
+   // This call takes care of the sub-branches of split objects as well:
+   if( compression >= 0 ) {
+      branch->SetCompressionSettings( compression );
+   }
+
+   return;
+}
+
 /**
  * Function called first for each new input file. It opens the file, and
  * accesses the trees defined in the cycle configuration. It also starts the
@@ -702,20 +1036,31 @@ LoadInputTrees( const SInputData& iD,
    Long64_t nEvents = 0;
    m_inputTrees.clear();
    m_inputBranches.clear();
+   m_inputCopies.clear();
+   m_currentEntry = -1;
    DeleteInputVariables();
    m_metaInputTrees.clear();
 
+   // Check whether the input variables should be shared with other cycles:
+   m_inputShare = ( m_input ?
+                    dynamic_cast< SInputShare* >(
+                       m_input->FindObject( SFrame::InputShareName ) ) : 0 );
+
    //
    // Access the physical file that is currently being opened:
    //
    inputFile = 0;
-   if( GetConfig().GetRunMode() == SCycleConfig::LOCAL ) {
+   if( ( GetConfig().GetRunMode() == SCycleConfig::LOCAL ) ||
+       ( GetConfig().GetRunMode() == SCycleConfig::THREADS ) ||
+       ( GetConfig().GetRunMode() == SCycleConfig::PROCESSES ) ) {
+      // Pipelined cycles receive their input in stand-alone trees instead of
+      // a chain:
       TChain* chain = dynamic_cast< TChain* >( main_tree );
-      if( ! chain ) {
-         throw SError( "In LOCAL running the input TTree is not a TChain!",
-                       SError::StopExecution );
+      if( chain ) {
+         inputFile = chain->GetFile();
+      } else {
+         inputFile = main_tree->GetCurrentFile();
       }
-      inputFile = chain->GetFile();
    } else if( GetConfig().GetRunMode() == SCycleConfig::PROOF ) {
       inputFile = main_tree->GetCurrentFile();
    } else {
@@ -775,6 +1120,14 @@ LoadInputTrees( const SInputData& iD,
             }
          }
 
+         // When the framework processes the input itself, every input tree
+         // gets its own cache. (Under PROOF the main tree's cache is set up
+         // by PROOF.)
+         if( GetConfig().GetUseTreeCache() &&
+             ( GetConfig().GetRunMode() != SCycleConfig::PROOF ) ) {
+            tree->SetCacheSize( GetConfig().GetCacheSize() );
+         }
+
          m_inputTrees.push_back( tree );
          if( firstPassed && tree->GetEntries() != nEvents ) {
             SError error( SError::SkipFile );
@@ -808,12 +1161,51 @@ LoadInputTrees( const SInputData& iD,
       }
    }
 
+   // Connect the branches copied into the output trees:
+   ConnectPassThroughBranches();
+
+   // Set up the event weight calculation for the new file:
+   PrepareWeights( iD );
+
+   return;
+}
+
+/**
+ * This function is called after the user code connected to the input
+ * variables of a new input file. It tells the TTreeCache-s of all the input
+ * trees which branches they should read. When a positive number of learning
+ * entries is configured, the caches find this out themselves. Otherwise
+ * they either read all the branches, or only the ones added by the user
+ * code in BeginInputFile(...).
+ *
+ * <strong>The function is used internally by the framework!</strong>
+ */
+void SCycleBaseNTuple::ConfigureTreeCache() {
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 5, 26, 0 )
+   const Int_t learnEntries = GetConfig().GetCacheLearnEntries();
+   for( std::vector< TTree* >::const_iterator it = m_inputTrees.begin();
+        it != m_inputTrees.end(); ++it ) {
+      // Don't create caches for the trees that were not given one:
+      if( ( *it )->GetCacheSize() <= 0 ) continue;
+      if( learnEntries > 0 ) {
+         ( *it )->SetCacheLearnEntries( learnEntries );
+      } else {
+         if( learnEntries < 0 ) {
+            ( *it )->AddBranchToCache( "*", kTRUE );
+         }
+         ( *it )->StopCacheLearningPhase();
+      }
+   }
+#endif // ROOT_VERSION...
+
    return;
 }
 
 /**
  * Function reading in the same entry for each of the connected branches.
- * It is called first for each new event.
+ * It is called first for each new event. The branches connected to
+ * SInputVariable objects are only read when the cycle accesses them.
  *
  * <strong>The function is used internally by the framework!</strong>
  *
@@ -826,90 +1218,275 @@ void SCycleBaseNTuple::GetEvent( Long64_t entry ) {
         it != m_inputTrees.end(); ++it ) {
       ( *it )->LoadTree( entry );
    }
+   m_currentEntry = entry;
 
    // Load the current entry for all the regular input variables:
    for( std::vector< TBranch* >::const_iterator it = m_inputBranches.begin();
         it != m_inputBranches.end(); ++it ) {
-      ( *it )->GetEntry( entry );
+      const Int_t nbytes = ( *it )->GetEntry( entry );
+      if( nbytes > 0 ) m_inputBytesRead += nbytes;
+   }
+
+   // Take the variables read by other fused cycles:
+   for( std::vector< SInputCopy >::const_iterator it = m_inputCopies.begin();
+        it != m_inputCopies.end(); ++it ) {
+      it->Copy();
+   }
+
+   return;
+}
+
+/**
+ * The branches passed through to the output trees are only read for the
+ * events that are written out, right before the output trees are filled. So
+ * the events rejected by the cycle don't need to decode them. The entry last
+ * loaded by GetEvent(...) is read.
+ *
+ * <strong>The function is used internally by the framework!</strong>
+ */
+void SCycleBaseNTuple::ReadPassThroughBranches() {
+
+   if( m_currentEntry < 0 ) return;
+
+   for( std::list< PassThroughBranch >::const_iterator it =
+           m_passThrough.begin(); it != m_passThrough.end(); ++it ) {
+
+      // Make sure that the cycle didn't connect to the branch itself:
+      const void* address = ( it->objClass ?
+                              static_cast< const void* >( &it->object ) :
+                              it->object );
+      if( it->input->GetAddress() != address ) {
+         SError error( SError::StopExecution );
+         error << "Branch \"" << it->name << "\" is both connected by the "
+               << "cycle and passed through to the output. Remove it from "
+               << "the PassThrough setting, and declare it as an output "
+               << "variable instead.";
+         throw error;
+      }
+
+      const Int_t nbytes = it->input->GetEntry( m_currentEntry );
+      if( nbytes < 0 ) {
+         SError error( SError::StopExecution );
+         error << "Failed to read pass-through branch: " << it->name;
+         throw error;
+      }
+      m_inputBytesRead += nbytes;
    }
 
    return;
 }
 
+/**
+ * The counter includes the branches read on demand through SInputVariable
+ * objects, and is reset by ClearCachedTrees().
+ *
+ * <strong>The function is used internally by the framework!</strong>
+ *
+ * @returns The number of uncompressed bytes read from the input branches
+ *          since the processing of the input data started
+ */
+Long64_t SCycleBaseNTuple::GetInputBytesRead() const {
+
+   return m_inputBytesRead;
+}
+
 /**
  * Function calculating the event weight for the MC event for each event.
+ * The luminosity table and the generator cut formulas are prepared by
+ * PrepareWeights(...) when a new input file is opened. The generator cuts
+ * are evaluated for the entry currently loaded into the input trees.
  *
  * <strong>The function is used internally by the framework!</strong>
  *
  * @param inputData The input data that we're processing at the moment
- * @param entry     The event number
  */
 Double_t SCycleBaseNTuple::CalculateWeight( const SInputData& inputData,
-                                            Long64_t entry ) const {
-
-   // the type of this input data
-   const TString& type    = inputData.GetType();
-   const TString& version = inputData.GetVersion();
-
-   Double_t weight = 0.;
-   Double_t totlum = 0.;
+                                            Long64_t /*entry*/ ) const {
 
    // Data events always have a weight of 1.0:
    if( inputData.GetType() == "data" ) {
       return 1.0;
    }
 
-   // Iterate over vector of input data and addup the weight for the type of
-   // this input data:
+   // Make sure that the weights were prepared for this input data:
+   if( ( inputData.GetType() != m_weightType ) ||
+       ( inputData.GetVersion() != m_weightVersion ) ) {
+      SError error( SError::SkipInputData );
+      error << "Event weights were not prepared for input data type \""
+            << inputData.GetType() << "\" version \""
+            << inputData.GetVersion() << "\"";
+      throw error;
+   }
+
+   // Without generator cuts the weight is always the same:
+   if( ! m_weightHasCuts ) {
+      return m_constantWeight;
+   }
+
+   // Add up the luminosity of the input data blocks that the event belongs
+   // to:
+   Double_t totlum = 0.;
+   std::vector< WeightTerm >::const_iterator term_itr = m_weightTerms.begin();
+   std::vector< WeightTerm >::const_iterator term_end = m_weightTerms.end();
+   for( ; term_itr != term_end; ++term_itr ) {
+      Bool_t inside = kTRUE;
+      std::vector< TTreeFormula* >::const_iterator f_itr =
+         term_itr->cuts.begin();
+      std::vector< TTreeFormula* >::const_iterator f_end =
+         term_itr->cuts.end();
+      for( ; f_itr != f_end; ++f_itr ) {
+         // GetNdata() makes the formula load its leaves for the current
+         // entry:
+         ( *f_itr )->GetNdata();
+         if( ! ( *f_itr )->EvalInstance( 0 ) ) {
+            inside = kFALSE;
+            break;
+         }
+      }
+      if( inside ) totlum += term_itr->lumi;
+   }
+
+   // Check that the total luminosity is not zero:
+   if( totlum > 1e-15 ) {
+      return ( GetConfig().GetTargetLumi() / totlum );
+   }
+
+   return 0.;
+}
+
+/**
+ * Function calculating the event weights for a block of events in one go.
+ * Without generator cuts the weight doesn't depend on the event, so it only
+ * has to be calculated once. Otherwise the input trees are positioned on
+ * each entry in turn, so that the generator cuts could be evaluated. (But
+ * none of the connected input variables are read.)
+ *
+ * <strong>The function is used internally by the framework!</strong>
+ *
+ * @param inputData The input data that we're processing at the moment
+ * @param firstEntry The first entry of the block
+ * @param nEntries The number of entries in the block
+ * @param weights Array receiving the weights of the entries (output)
+ */
+void SCycleBaseNTuple::CalculateWeights( const SInputData& inputData,
+                                         Long64_t firstEntry,
+                                         Long64_t nEntries,
+                                         Double_t* weights ) {
+
+   // The simple case:
+   if( ( inputData.GetType() == "data" ) || ( ! m_weightHasCuts ) ) {
+      const Double_t weight = CalculateWeight( inputData, firstEntry );
+      std::fill( weights, weights + nEntries, weight );
+      return;
+   }
+
+   // Evaluate the generator cuts for each entry:
+   for( Long64_t i = 0; i < nEntries; ++i ) {
+      for( std::vector< TTree* >::const_iterator it = m_inputTrees.begin();
+           it != m_inputTrees.end(); ++it ) {
+         ( *it )->LoadTree( firstEntry + i );
+      }
+      weights[ i ] = CalculateWeight( inputData, firstEntry + i );
+   }
+
+   return;
+}
+
+/**
+ * The event weights depend on the luminosities of all the input data blocks
+ * with the same type and version as the one being processed, and on the
+ * generator cuts defined for these blocks. The luminosities are collected
+ * only once per input data, while the generator cuts are compiled for the
+ * trees of every new input file.
+ *
+ * @param id The input data that we're processing at the moment
+ */
+void SCycleBaseNTuple::PrepareWeights( const SInputData& id ) {
+
+   DeleteWeightFormulas();
+
+   // Collect the luminosities if the input data changed:
+   if( ( id.GetType() != m_weightType ) ||
+       ( id.GetVersion() != m_weightVersion ) ) {
+
+      m_weightTerms.clear();
+      m_weightHasCuts = kFALSE;
+      Double_t totlum = 0.;
+      std::vector< SInputData >::const_iterator id_itr =
+         GetConfig().GetInputData().begin();
+      std::vector< SInputData >::const_iterator id_end =
+         GetConfig().GetInputData().end();
+      for( ; id_itr != id_end; ++id_itr ) {
+         if( ( id_itr->GetType() == id.GetType() ) &&
+             ( id_itr->GetVersion() == id.GetVersion() ) ) {
+            WeightTerm term;
+            term.lumi = id_itr->GetScaledLumi();
+            m_weightTerms.push_back( term );
+            totlum += term.lumi;
+            if( id_itr->GetSGeneratorCuts().size() ) {
+               m_weightHasCuts = kTRUE;
+            }
+         }
+      }
+      m_constantWeight = ( totlum > 1e-15 ?
+                           ( GetConfig().GetTargetLumi() / totlum ) : 0. );
+      m_weightType = id.GetType();
+      m_weightVersion = id.GetVersion();
+   }
+   if( ! m_weightHasCuts ) {
+      return;
+   }
+
+   // Compile the generator cuts for the trees of the current input file:
+   size_t index = 0;
    std::vector< SInputData >::const_iterator id_itr =
       GetConfig().GetInputData().begin();
    std::vector< SInputData >::const_iterator id_end =
       GetConfig().GetInputData().end();
    for( ; id_itr != id_end; ++id_itr ) {
-
-      if( ( id_itr->GetType() == type ) &&
-          ( id_itr->GetVersion() == version ) ) {
-
-         const std::vector< SGeneratorCut >& sgencuts =
-            id_itr->GetSGeneratorCuts();
-         Bool_t inside = kTRUE;
-
-         std::vector< SGeneratorCut >::const_iterator gc_itr = sgencuts.begin();
-         std::vector< SGeneratorCut >::const_iterator gc_end = sgencuts.end();
-         for( ; gc_itr != gc_end; ++gc_itr ) {
-
-            // loop over the trees
-            std::vector< TTree* >::const_iterator tree_itr =
-               m_inputTrees.begin();
-            std::vector< TTree* >::const_iterator tree_end =
-               m_inputTrees.end();
-            for( ; tree_itr != tree_end; ++tree_itr ) {
-
-               // consider the one with the correct name
-               if( ( *tree_itr )->GetName() == gc_itr->GetTreeName() ) {
-                  // check for this entry, if Formula is true
-                  TTreeFormula f( "testFormula", gc_itr->GetFormula().Data(),
-                                  *tree_itr );
-                  // if true for all cuts, then add the Lumi of this input data
-                  // to totlum
-                  if( ! f.EvalInstance( static_cast< Int_t >( entry ) ) ) {
-                     inside = kFALSE;
-                  }
-                  break;
-               }
-
+      if( ( id_itr->GetType() != id.GetType() ) ||
+          ( id_itr->GetVersion() != id.GetVersion() ) ) {
+         continue;
+      }
+      WeightTerm& term = m_weightTerms[ index++ ];
+      const std::vector< SGeneratorCut >& sgencuts =
+         id_itr->GetSGeneratorCuts();
+      std::vector< SGeneratorCut >::const_iterator gc_itr = sgencuts.begin();
+      std::vector< SGeneratorCut >::const_iterator gc_end = sgencuts.end();
+      for( ; gc_itr != gc_end; ++gc_itr ) {
+         std::vector< TTree* >::const_iterator tree_itr =
+            m_inputTrees.begin();
+         std::vector< TTree* >::const_iterator tree_end =
+            m_inputTrees.end();
+         for( ; tree_itr != tree_end; ++tree_itr ) {
+            if( ( *tree_itr )->GetName() == gc_itr->GetTreeName() ) {
+               term.cuts.push_back(
+                  new TTreeFormula( "GeneratorCut",
+                                    gc_itr->GetFormula().Data(),
+                                    *tree_itr ) );
+               break;
             }
          }
-         if( inside ) totlum += id_itr->GetScaledLumi();
       }
    }
 
-   // Check that the total luminosity is not zero:
-   if( totlum > 1e-15 ) {
-      weight = ( GetConfig().GetTargetLumi() / totlum );
+   return;
+}
+
+void SCycleBaseNTuple::DeleteWeightFormulas() {
+
+   std::vector< WeightTerm >::iterator term_itr = m_weightTerms.begin();
+   std::vector< WeightTerm >::iterator term_end = m_weightTerms.end();
+   for( ; term_itr != term_end; ++term_itr ) {
+      std::vector< TTreeFormula* >::iterator f_itr = term_itr->cuts.begin();
+      std::vector< TTreeFormula* >::iterator f_end = term_itr->cuts.end();
+      for( ; f_itr != f_end; ++f_itr ) {
+         delete *f_itr;
+      }
+      term_itr->cuts.clear();
    }
 
-   return weight;
+   return;
 }
 
 /**
@@ -921,11 +1498,29 @@ void SCycleBaseNTuple::ClearCachedTrees() {
 
    m_inputTrees.clear();
    m_inputBranches.clear();
+   m_inputCopies.clear();
+   m_inputShare = 0;
+   m_currentEntry = -1;
+   m_inputBytesRead = 0;
+   m_lazyBranch = 0;
+   DeletePipelineOutputTrees();
+   DeletePipelineChunk();
+   m_pipeline = 0;
    m_outputTrees.clear();
+   m_outputTreeSettings.clear();
+   m_pendingBasketOptimizations = 0;
    m_metaInputTrees.clear();
    m_metaOutputTrees.clear();
 
    DeleteInputVariables();
+   DeletePassThroughBranches();
+
+   // The configuration may change before the next time the weights are
+   // needed:
+   DeleteWeightFormulas();
+   m_weightTerms.clear();
+   m_weightType = "";
+   m_weightVersion = "";
 
    return;
 }
@@ -1056,6 +1651,12 @@ SCycleBaseNTuple::TypeidType( const char* root_type ) {
  */
 void SCycleBaseNTuple::RegisterInputBranch( TBranch* br ) {
 
+   // Branches read on demand are handed over to their SInputVariable:
+   if( m_lazyConnection ) {
+      m_lazyBranch = br;
+      return;
+   }
+
    // This is a bit slow, but still not the worst part of the code...
    if( std::find( m_inputBranches.begin(), m_inputBranches.end(), br ) !=
        m_inputBranches.end() ) {
@@ -1069,6 +1670,91 @@ void SCycleBaseNTuple::RegisterInputBranch( TBranch* br ) {
    return;
 }
 
+/**
+ * When multiple cycles are executed in a single event loop, only the first
+ * cycle connecting to a given branch reads it. The other cycles get a copy
+ * of the variable of that cycle after each event is read. Object branches
+ * are handled by ShareInputObject(...).
+ *
+ * @param br The branch that the variable should be connected to
+ * @param variable The address of the variable
+ * @param type The type of the variable (of its elements for arrays)
+ * @param size The size of the variable in bytes
+ * @param isArray Flag showing whether the variable is a primitive array
+ * @returns <code>kTRUE</code> if the variable will be copied from another
+ *          cycle, <code>kFALSE</code> if this cycle has to read the branch
+ */
+Bool_t SCycleBaseNTuple::ShareInputVariable( TBranch* br, void* variable,
+                                             const std::type_info& type,
+                                             size_t size, Bool_t isArray ) {
+
+   // In normal running every cycle reads its own branches:
+   if( ! m_inputShare ) return kFALSE;
+
+   // If no cycle reads this branch yet, this one will:
+   void* source = m_inputShare->Find( br, type );
+   if( ( ! source ) || ( source == variable ) ) {
+      m_inputShare->Register( br, variable, type );
+      return kFALSE;
+   }
+
+   // The current length of variable sized arrays is given by their leaf:
+   TLeaf* leaf = 0;
+   if( isArray ) {
+      leaf = dynamic_cast< TLeaf* >( br->GetListOfLeaves()->At( 0 ) );
+   }
+   m_inputCopies.push_back( SInputCopy( variable, source, size, leaf ) );
+
+   m_logger << ::DEBUG << "Branch \"" << br->GetName() << "\" is read by "
+            << "another cycle, sharing its contents" << SLogger::endmsg;
+
+   return kTRUE;
+}
+
+/**
+ * Object branches are shared between fused cycles similarly to the simple
+ * variables. But every cycle has its own object, into which the object of
+ * the reader cycle is assigned after each event is read. So the cycles can
+ * modify their input objects without affecting each other, just like in
+ * unfused execution. Types that can't be assigned can't be shared, so
+ * cycles using them can't be fused with a cycle reading the same branch.
+ *
+ * @param br The branch that the object pointer should be connected to
+ * @param variable The address of the object pointer
+ * @param type The type of the object
+ * @param copy The function assigning the objects, or a null pointer if the
+ *             type can't be assigned
+ * @returns <code>kTRUE</code> if the object will be copied from another
+ *          cycle, <code>kFALSE</code> if this cycle has to read the branch
+ */
+Bool_t SCycleBaseNTuple::ShareInputObject( TBranch* br, void* variable,
+                                           const std::type_info& type,
+                                           SInputCopy::copy_function copy ) {
+
+   // In normal running every cycle reads its own branches:
+   if( ! m_inputShare ) return kFALSE;
+
+   // If no cycle reads this branch yet, this one will:
+   void* source = m_inputShare->Find( br, type );
+   if( ( ! source ) || ( source == variable ) ) {
+      m_inputShare->Register( br, variable, type );
+      return kFALSE;
+   }
+
+   if( ! copy ) {
+      SError error( SError::SkipCycle );
+      error << "Branch \"" << br->GetName() << "\" holds objects that can't "
+            << "be copied between the fused cycles";
+      throw error;
+   }
+   m_inputCopies.push_back( SInputCopy( variable, source, copy ) );
+
+   m_logger << ::DEBUG << "Branch \"" << br->GetName() << "\" is read by "
+            << "another cycle, copying its objects" << SLogger::endmsg;
+
+   return kTRUE;
+}
+
 /**
  * This function deletes the contents of the input variable list. Since the
  * SPointer objects in the list know exactly what kind of object they point to
@@ -1086,6 +1772,228 @@ void SCycleBaseNTuple::DeleteInputVariables() {
    return;
 }
 
+/**
+ * The PassThrough setting of an output tree lists input branches (possibly
+ * with wildcards) that should be copied into the output tree for every
+ * written event. The output branches are created when the first input file
+ * is opened, by looking at the top-level branches of the event-level input
+ * trees. For later input files the existing output branches are just
+ * connected to the branches of the new file.
+ *
+ * Object branches (including STL containers) and leaf list branches are
+ * supported. The buffers of the latter are resized when a new input file
+ * has longer variable sized arrays than the previous ones.
+ */
+void SCycleBaseNTuple::ConnectPassThroughBranches() {
+
+   //
+   // Connect the already existing pass-through branches to the new file:
+   //
+   for( std::list< PassThroughBranch >::iterator it = m_passThrough.begin();
+        it != m_passThrough.end(); ++it ) {
+
+      // Find the branch in the new file:
+      TBranch* branch = 0;
+      for( std::vector< TTree* >::const_iterator tree = m_inputTrees.begin();
+           ( tree != m_inputTrees.end() ) && ( ! branch ); ++tree ) {
+         branch = ( *tree )->GetBranch( it->name );
+      }
+      if( ! branch ) {
+         SError error( SError::SkipFile );
+         error << "Pass-through branch \"" << it->name << "\" doesn't exist "
+               << "in the current input file";
+         throw error;
+      }
+
+      if( it->objClass ) {
+         branch->SetAddress( &it->object );
+      } else {
+         // Make sure that the buffer is large enough for this file:
+         const Long64_t size = LeafListSize( branch );
+         if( size < 0 ) {
+            SError error( SError::SkipFile );
+            error << "Pass-through branch \"" << it->name << "\" has an "
+                  << "unexpected layout in the current input file";
+            throw error;
+         }
+         if( size > it->size ) {
+            char* buffer = new char[ size ];
+            memset( buffer, 0, size );
+            delete[] static_cast< char* >( it->object );
+            it->object = buffer;
+            it->size = size;
+            for( std::vector< TBranch* >::const_iterator out =
+                    it->outputs.begin(); out != it->outputs.end(); ++out ) {
+               ( *out )->SetAddress( it->object );
+            }
+         }
+         branch->SetAddress( it->object );
+      }
+      it->input = branch;
+   }
+
+   // The output branches are only created once:
+   if( m_passThroughCreated ) return;
+   m_passThroughCreated = kTRUE;
+
+   //
+   // Create the output branches:
+   //
+   for( size_t i = 0; i < m_outputTrees.size(); ++i ) {
+
+      // Check if this tree needs any pass-through branches:
+      const TString& setting = m_outputTreeSettings[ i ].passThrough;
+      if( ! setting.Length() ) continue;
+      TTree* outTree = m_outputTrees[ i ];
+
+      // Collect the name patterns:
+      std::vector< TRegexp > patterns;
+      TObjArray* array = setting.Tokenize( ", " );
+      for( Int_t j = 0; j < array->GetEntriesFast(); ++j ) {
+         TObjString* pattern = dynamic_cast< TObjString* >( array->At( j ) );
+         if( ! pattern ) continue;
+         patterns.push_back( TRegexp( pattern->GetString(), kTRUE ) );
+      }
+      delete array;
+
+      Int_t nBranches = 0;
+      for( std::vector< TTree* >::const_iterator tree = m_inputTrees.begin();
+           tree != m_inputTrees.end(); ++tree ) {
+         TObjArray* branches = ( *tree )->GetListOfBranches();
+         for( Int_t j = 0; j < branches->GetEntriesFast(); ++j ) {
+
+            TBranch* branch = static_cast< TBranch* >( branches->At( j ) );
+            const TString name = branch->GetName();
+
+            // Check if the name matches any of the patterns:
+            Bool_t match = kFALSE;
+            for( size_t k = 0; ( k < patterns.size() ) && ( ! match ); ++k ) {
+               Ssiz_t length = 0;
+               match = ( ( patterns[ k ].Index( name, &length ) == 0 ) &&
+                         ( length == name.Length() ) );
+            }
+            if( ! match ) continue;
+
+            // Don't override the branches declared by the cycle:
+            if( outTree->GetBranch( name ) ) {
+               m_logger << ::WARNING << "Branch \"" << name << "\" already "
+                        << "exists in output tree \"" << outTree->GetName()
+                        << "\". Not passing it through." << SLogger::endmsg;
+               continue;
+            }
+
+            // Check if the branch is already passed through to another
+            // output tree:
+            PassThroughBranch* pass = 0;
+            for( std::list< PassThroughBranch >::iterator it =
+                    m_passThrough.begin(); it != m_passThrough.end(); ++it ) {
+               if( it->name == name ) {
+                  pass = &*it;
+                  break;
+               }
+            }
+
+            // If not, set up reading it:
+            if( ! pass ) {
+               PassThroughBranch newPass;
+               newPass.name = name;
+               newPass.input = branch;
+               newPass.objClass = 0;
+               newPass.object = 0;
+               newPass.size = 0;
+               TBranchElement* element =
+                  dynamic_cast< TBranchElement* >( branch );
+               if( element ) {
+                  newPass.objClass =
+                     TClass::GetClass( element->GetClassName() );
+                  if( newPass.objClass ) {
+                     newPass.object = newPass.objClass->New();
+                  }
+               } else if( branch->IsA() == TBranch::Class() ) {
+                  newPass.size = LeafListSize( branch );
+                  if( newPass.size > 0 ) {
+                     newPass.object = new char[ newPass.size ];
+                     memset( newPass.object, 0, newPass.size );
+                  }
+               }
+               if( ! newPass.object ) {
+                  m_logger << ::WARNING << "The type of branch \"" << name
+                           << "\" is not supported. Not passing it through."
+                           << SLogger::endmsg;
+                  continue;
+               }
+               m_passThrough.push_back( newPass );
+               pass = &m_passThrough.back();
+               if( pass->objClass ) {
+                  branch->SetAddress( &pass->object );
+               } else {
+                  branch->SetAddress( pass->object );
+               }
+            }
+
+            // Create the output branch:
+            TBranch* output = 0;
+            if( pass->objClass ) {
+               TBranchElement* element =
+                  static_cast< TBranchElement* >( branch );
+               output = outTree->Bronch( name, pass->objClass->GetName(),
+                                         &pass->object,
+                                         GetOutputBasketSize( outTree ),
+                                         element->GetSplitLevel() );
+            } else {
+               // A variable sized array needs its counter in the output tree:
+               TLeaf* leaf =
+                  static_cast< TLeaf* >( branch->GetListOfLeaves()->At( 0 ) );
+               if( leaf && leaf->GetLeafCount() &&
+                   ( ! outTree->GetLeaf( leaf->GetLeafCount()->GetName() ) ) ) {
+                  m_logger << ::WARNING << "The size of branch \"" << name
+                           << "\" is not passed through. Not passing the "
+                           << "branch through either." << SLogger::endmsg;
+                  continue;
+               }
+               output = outTree->Branch( name, pass->object,
+                                         branch->GetTitle(),
+                                         GetOutputBasketSize( outTree ) );
+            }
+            if( ! output ) {
+               SError error( SError::SkipInputData );
+               error << "Couldn't create pass-through branch: " << name;
+               throw error;
+            }
+            ConfigureOutputBranch( outTree, output );
+            pass->outputs.push_back( output );
+            ++nBranches;
+         }
+      }
+
+      m_logger << ::INFO << "Passing " << nBranches << " input branch(es) "
+               << "through to output tree \"" << outTree->GetName() << "\""
+               << SLogger::endmsg;
+   }
+
+   return;
+}
+
+/**
+ * The objects are only deleted after the output trees are written. The input
+ * branches are not touched, as their file may already be closed.
+ */
+void SCycleBaseNTuple::DeletePassThroughBranches() {
+
+   for( std::list< PassThroughBranch >::iterator it = m_passThrough.begin();
+        it != m_passThrough.end(); ++it ) {
+      if( it->objClass ) {
+         it->objClass->Destructor( it->object );
+      } else {
+         delete[] static_cast< char* >( it->object );
+      }
+   }
+   m_passThrough.clear();
+   m_passThroughCreated = kFALSE;
+
+   return;
+}
+
 /**
  * This function can create a sub-directory inside an existing directory (a file
  * for instance). It's used to make directories for output trees.
@@ -34,11 +34,16 @@ ClassImp( SCycleConfig )
 SCycleConfig::SCycleConfig( const char* name )
    : TNamed( name, "SFrame cycle configuration" ),
      m_cycleName( "Unknown" ), m_mode( LOCAL ),
-     m_server( "" ), m_workdir( "" ), m_nodes( -1 ), m_properties(),
+     m_server( "" ), m_workdir( "" ), m_nodes( -1 ), m_nThreads( -1 ),
+     m_nProcesses( -1 ), m_nConcurrentInputData( 1 ), m_properties(),
      m_inputData(), m_targetLumi( 1. ), m_outputDirectory( "" ),
      m_postFix( "" ), m_msgLevel( INFO ), m_useTreeCache( kFALSE ),
      m_cacheSize( 30000000 ), m_cacheLearnEntries( 100 ),
-     m_processOnlyLocal( kFALSE ) {
+     m_processOnlyLocal( kFALSE ), m_prefetchInputFiles( kFALSE ),
+     m_profileEventLoop( kFALSE ), m_progressInterval( 10. ),
+     m_progressFile( "" ), m_outputCompression( -1 ),
+     m_outputBasketSize( 0 ), m_outputAutoFlush( STree::DEFAULT_AUTOFLUSH ),
+     m_optimizeBasketsAfter( 0 ), m_outputCompressionThreads( 0 ) {
 
 }
 
@@ -110,6 +115,61 @@ void SCycleConfig::SetProofNodes( Int_t nodes ) {
    return;
 }
 
+/**
+ * @returns The number of worker threads to use in THREADS mode
+ */
+Int_t SCycleConfig::GetNThreads() const {
+
+   return m_nThreads;
+}
+
+/**
+ * @param threads The number of worker threads to use in THREADS mode. A
+ *                non-positive value means using all available cores.
+ */
+void SCycleConfig::SetNThreads( Int_t threads ) {
+
+   m_nThreads = threads;
+   return;
+}
+
+/**
+ * @returns The number of worker processes to use in PROCESSES mode
+ */
+Int_t SCycleConfig::GetNProcesses() const {
+
+   return m_nProcesses;
+}
+
+/**
+ * @param processes The number of worker processes to use in PROCESSES mode.
+ *                  A non-positive value means using all available cores.
+ */
+void SCycleConfig::SetNProcesses( Int_t processes ) {
+
+   m_nProcesses = processes;
+   return;
+}
+
+/**
+ * @returns The maximum number of InputData groups (blocks with the same type
+ *          and version) that are processed at the same time
+ */
+Int_t SCycleConfig::GetNConcurrentInputData() const {
+
+   return m_nConcurrentInputData;
+}
+
+/**
+ * @param value The maximum number of InputData groups (blocks with the same
+ *              type and version) that are processed at the same time
+ */
+void SCycleConfig::SetNConcurrentInputData( Int_t value ) {
+
+   m_nConcurrentInputData = value;
+   return;
+}
+
 /**
  * @returns The directory to use for storing merged ntuples from PROOF
  */
@@ -286,6 +346,189 @@ Bool_t SCycleConfig::GetProcessOnlyLocal() const {
    return m_processOnlyLocal;
 }
 
+/**
+ * @param flag <code>kTRUE</code> if the next input file should be opened in
+ *             the background while the current one is processed,
+ *             <code>kFALSE</code> if not
+ */
+void SCycleConfig::SetPrefetchInputFiles( Bool_t flag ) {
+
+   m_prefetchInputFiles = flag;
+   return;
+}
+
+/**
+ * @returns <code>kTRUE</code> if the next input file should be opened in the
+ *          background while the current one is processed,
+ *          <code>kFALSE</code> if not
+ */
+Bool_t SCycleConfig::GetPrefetchInputFiles() const {
+
+   return m_prefetchInputFiles;
+}
+
+/**
+ * @param flag <code>kTRUE</code> if the time spent in the different stages
+ *             of the event loop should be measured, <code>kFALSE</code> if
+ *             not
+ */
+void SCycleConfig::SetProfileEventLoop( Bool_t flag ) {
+
+   m_profileEventLoop = flag;
+   return;
+}
+
+/**
+ * @returns <code>kTRUE</code> if the time spent in the different stages of
+ *          the event loop should be measured, <code>kFALSE</code> if not
+ */
+Bool_t SCycleConfig::GetProfileEventLoop() const {
+
+   return m_profileEventLoop;
+}
+
+/**
+ * @param interval The time between two progress reports in seconds. Zero
+ *                 or a negative value turns off the progress reports.
+ */
+void SCycleConfig::SetProgressInterval( Double_t interval ) {
+
+   m_progressInterval = interval;
+   return;
+}
+
+/**
+ * @returns The time between two progress reports in seconds
+ */
+Double_t SCycleConfig::GetProgressInterval() const {
+
+   return m_progressInterval;
+}
+
+/**
+ * @param fileName The file to append the progress reports to in JSON
+ *                 format, or an empty string
+ */
+void SCycleConfig::SetProgressFile( const TString& fileName ) {
+
+   m_progressFile = fileName;
+   return;
+}
+
+/**
+ * @returns The file to append the progress reports to in JSON format, or
+ *          an empty string
+ */
+const TString& SCycleConfig::GetProgressFile() const {
+
+   return m_progressFile;
+}
+
+/**
+ * The setting applies to the output file of the cycle, so to all the output
+ * trees that don't specify their own compression settings.
+ *
+ * @param settings The compression settings in ROOT's convention
+ *                 (100 * algorithm + level), or -1 for ROOT's default
+ */
+void SCycleConfig::SetOutputCompression( Int_t settings ) {
+
+   m_outputCompression = settings;
+   return;
+}
+
+/**
+ * @returns The compression settings of the output file in ROOT's convention,
+ *          or -1 if ROOT's default should be used
+ */
+Int_t SCycleConfig::GetOutputCompression() const {
+
+   return m_outputCompression;
+}
+
+/**
+ * The size is given to the output branches when they're created. ROOT still
+ * resizes the baskets when a tree is flushed for the first time, so the size
+ * is only kept for the whole tree when AutoFlush is turned off.
+ *
+ * @param size The basket size of the output branches in bytes, or 0 for
+ *             ROOT's default
+ */
+void SCycleConfig::SetOutputBasketSize( Int_t size ) {
+
+   m_outputBasketSize = size;
+   return;
+}
+
+/**
+ * @returns The basket size of the output branches in bytes, or 0 if ROOT's
+ *          default should be used
+ */
+Int_t SCycleConfig::GetOutputBasketSize() const {
+
+   return m_outputBasketSize;
+}
+
+/**
+ * @param autoFlush Number of entries (positive value) or bytes (negative
+ *                  value) after which the output trees should be flushed.
+ *                  Zero turns off the flushing.
+ */
+void SCycleConfig::SetOutputAutoFlush( Long64_t autoFlush ) {
+
+   m_outputAutoFlush = autoFlush;
+   return;
+}
+
+/**
+ * @returns The AutoFlush setting of the output trees
+ */
+Long64_t SCycleConfig::GetOutputAutoFlush() const {
+
+   return m_outputAutoFlush;
+}
+
+/**
+ * @param entries The number of entries after which the basket sizes of the
+ *                output trees should be optimised, or 0 to leave it to ROOT
+ */
+void SCycleConfig::SetOptimizeBasketsAfter( Long64_t entries ) {
+
+   m_optimizeBasketsAfter = entries;
+   return;
+}
+
+/**
+ * @returns The number of entries after which the basket sizes of the output
+ *          trees should be optimised
+ */
+Long64_t SCycleConfig::GetOptimizeBasketsAfter() const {
+
+   return m_optimizeBasketsAfter;
+}
+
+/**
+ * The threads are provided by ROOT's implicit multi-threading. They compress
+ * the baskets of the output trees in parallel when the trees are flushed.
+ *
+ * @param threads The number of threads to use, 0 for turning the feature
+ *                off, or a negative value for using all the cores
+ */
+void SCycleConfig::SetOutputCompressionThreads( Int_t threads ) {
+
+   m_outputCompressionThreads = threads;
+   return;
+}
+
+/**
+ * @returns The number of threads compressing the output baskets, 0 if the
+ *          feature is off, or a negative value if all the cores are used
+ */
+Int_t SCycleConfig::GetOutputCompressionThreads() const {
+
+   return m_outputCompressionThreads;
+}
+
 /**
  * This function is used at the initialization stage to print the configuration
  * of the cycle in a nice way.
@@ -299,10 +542,19 @@ void SCycleConfig::PrintConfig() const {
    logger << INFO << "                    Cycle configuration"
           << SLogger::endmsg;
    logger << INFO << "  - Running mode: "
-          << ( m_mode == LOCAL ? "LOCAL" : "PROOF" ) << SLogger::endmsg;
+          << ( m_mode == LOCAL ? "LOCAL" :
+               ( m_mode == PROOF ? "PROOF" :
+                 ( m_mode == THREADS ? "THREADS" : "PROCESSES" ) ) )
+          << SLogger::endmsg;
    if( m_mode == PROOF ) {
       logger << INFO << "  - PROOF server: " << m_server << SLogger::endmsg;
       logger << INFO << "  - PROOF nodes: " << m_nodes << SLogger::endmsg;
+   } else if( m_mode == THREADS ) {
+      logger << INFO << "  - Worker threads: " << m_nThreads
+             << SLogger::endmsg;
+   } else if( m_mode == PROCESSES ) {
+      logger << INFO << "  - Worker processes: " << m_nProcesses
+             << SLogger::endmsg;
    }
    logger << INFO << "  - Target luminosity: " << m_targetLumi
           << SLogger::endmsg;
@@ -328,6 +580,51 @@ void SCycleConfig::PrintConfig() const {
       logger << INFO << "  - Workers will only process local files"
              << SLogger::endmsg;
    }
+   if( m_nConcurrentInputData > 1 ) {
+      logger << INFO << "  - Concurrently processed InputData groups: "
+             << m_nConcurrentInputData << SLogger::endmsg;
+   }
+   if( m_prefetchInputFiles ) {
+      logger << INFO << "  - Input files are opened in the background"
+             << SLogger::endmsg;
+   }
+   if( m_profileEventLoop ) {
+      logger << INFO << "  - The stages of the event loop are timed"
+             << SLogger::endmsg;
+   }
+   if( m_progressInterval > 0.0 ) {
+      logger << INFO << "  - Progress reported every " << m_progressInterval
+             << " seconds" << SLogger::endmsg;
+      if( m_progressFile.Length() ) {
+         logger << INFO << "    Progress file: " << m_progressFile
+                << SLogger::endmsg;
+      }
+   }
+
+   if( m_outputCompression >= 0 ) {
+      logger << INFO << "  - Output compression: "
+             << STree::CompressionName( m_outputCompression )
+             << SLogger::endmsg;
+   }
+   if( m_outputBasketSize > 0 ) {
+      logger << INFO << "  - Output basket size: " << m_outputBasketSize
+             << SLogger::endmsg;
+   }
+   if( m_outputAutoFlush != STree::DEFAULT_AUTOFLUSH ) {
+      logger << INFO << "  - Output AutoFlush: " << m_outputAutoFlush
+             << SLogger::endmsg;
+   }
+   if( m_optimizeBasketsAfter > 0 ) {
+      logger << INFO << "  - Output baskets optimised after "
+             << m_optimizeBasketsAfter << " entries" << SLogger::endmsg;
+   }
+   if( m_outputCompressionThreads > 0 ) {
+      logger << INFO << "  - Output compressed on "
+             << m_outputCompressionThreads << " threads" << SLogger::endmsg;
+   } else if( m_outputCompressionThreads < 0 ) {
+      logger << INFO << "  - Output compressed on all cores"
+             << SLogger::endmsg;
+   }
 
    for( id_type::const_iterator id = m_inputData.begin();
         id != m_inputData.end(); ++id ) {
@@ -402,12 +699,18 @@ void SCycleConfig::ArrangeInputData() {
  * input files, and not from the XML configuration. This information is
  * needed for the correct event weight calculation. This function should
  * be called by SCycleController...
+ *
+ * @param validated An already validated configuration reading the same
+ *                  input, whose results should be re-used where possible
  */
-void SCycleConfig::ValidateInput() {
+void SCycleConfig::ValidateInput( const SCycleConfig* validated ) {
 
-   for( id_type::iterator id = m_inputData.begin(); id != m_inputData.end();
-        ++id ) {
-      id->ValidateInput( m_server );
+   for( size_t i = 0; i < m_inputData.size(); ++i ) {
+      if( validated && ( i < validated->m_inputData.size() ) &&
+          m_inputData[ i ].TakeValidation( validated->m_inputData[ i ] ) ) {
+         continue;
+      }
+      m_inputData[ i ].ValidateInput( m_server );
    }
 
    return;
@@ -474,6 +777,10 @@ TString SCycleConfig::GetStringConfig( const SInputData* id ) const {
       result += "LOCAL";
    } else if( m_mode == PROOF ) {
       result += "PROOF";
+   } else if( m_mode == THREADS ) {
+      result += "THREADS";
+   } else if( m_mode == PROCESSES ) {
+      result += "PROCESSES";
    } else {
       result += "UNKNOWN";
    }
@@ -483,13 +790,36 @@ TString SCycleConfig::GetStringConfig( const SInputData* id ) const {
    result += TString::Format( "       ProofNodes=\"%i\"\n", m_nodes );
    result += TString::Format( "       ProofWorkDir=\"%s\"\n",
                               m_workdir.Data() );
+   result += TString::Format( "       NThreads=\"%i\"\n", m_nThreads );
+   result += TString::Format( "       NProcesses=\"%i\"\n", m_nProcesses );
+   result += TString::Format( "       NConcurrentInputData=\"%i\"\n",
+                              m_nConcurrentInputData );
    result += TString::Format( "       UseTreeCache=\"%s\"\n",
                               ( m_useTreeCache ? "True" : "False" ) );
    result += TString::Format( "       TreeCacheSize=\"%lld\"\n", m_cacheSize );
    result += TString::Format( "       TreeCacheLearnEntries=\"%i\"\n",
                               m_cacheLearnEntries );
-   result += TString::Format( "       ProcessOnlyLocal=\"%s\">\n\n",
+   result += TString::Format( "       ProcessOnlyLocal=\"%s\"\n",
                               ( m_processOnlyLocal ? "True" : "False" ) );
+   result += TString::Format( "       PrefetchInputFiles=\"%s\"\n",
+                              ( m_prefetchInputFiles ? "True" : "False" ) );
+   result += TString::Format( "       ProfileEventLoop=\"%s\"\n",
+                              ( m_profileEventLoop ? "True" : "False" ) );
+   result += TString::Format( "       ProgressInterval=\"%g\"\n",
+                              m_progressInterval );
+   result += TString::Format( "       ProgressFile=\"%s\"\n",
+                              m_progressFile.Data() );
+   result += TString::Format( "       OutputCompression=\"%s\"\n",
+                              STree::CompressionName(
+                                 m_outputCompression ).Data() );
+   result += TString::Format( "       OutputBasketSize=\"%i\"\n",
+                              m_outputBasketSize );
+   result += TString::Format( "       OutputAutoFlush=\"%lld\"\n",
+                              m_outputAutoFlush );
+   result += TString::Format( "       OptimizeBasketsAfter=\"%lld\"\n",
+                              m_optimizeBasketsAfter );
+   result += TString::Format( "       OutputCompressionThreads=\"%i\">\n\n",
+                              m_outputCompressionThreads );
 
    // Decide how to add the input data information:
    if( id ) {
@@ -532,6 +862,9 @@ void SCycleConfig::ClearConfig() {
    m_server = "";
    m_workdir = "";
    m_nodes = -1;
+   m_nThreads = -1;
+   m_nProcesses = -1;
+   m_nConcurrentInputData = 1;
    m_properties.clear();
    m_inputData.clear();
    m_targetLumi = 1.0;
@@ -541,6 +874,15 @@ void SCycleConfig::ClearConfig() {
    m_useTreeCache = kFALSE;
    m_cacheSize = 30000000;
    m_cacheLearnEntries = 100;
+   m_prefetchInputFiles = kFALSE;
+   m_profileEventLoop = kFALSE;
+   m_progressInterval = 10.;
+   m_progressFile = "";
+   m_outputCompression = -1;
+   m_outputBasketSize = 0;
+   m_outputAutoFlush = STree::DEFAULT_AUTOFLUSH;
+   m_optimizeBasketsAfter = 0;
+   m_outputCompressionThreads = 0;
 
    return;
 }
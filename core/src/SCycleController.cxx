@@ -10,11 +10,26 @@
  *
  ***************************************************************************/
 
+// System include(s):
+extern "C" {
+#   include <unistd.h>
+#   include <sys/types.h>
+#   include <sys/wait.h>
+}
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+
 // STL include(s):
 #include <iomanip>
+#include <iostream>
 #include <sstream>
 #include <cstdlib>
 #include <limits>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <exception>
 
 // ROOT include(s):
 #include <TDOMParser.h>
@@ -27,6 +42,7 @@
 #include <TROOT.h>
 #include <TPython.h>
 #include <TChain.h>
+#include <TTree.h>
 #include <TList.h>
 #include <TFile.h>
 #include <TProof.h>
@@ -37,6 +53,7 @@
 #include <TFileInfo.h>
 #include <TObjString.h>
 #include <TInterpreter.h>
+#include <TBufferFile.h>
 
 // Local include(s):
 #include "../include/SCycleController.h"
@@ -50,6 +67,337 @@
 #include "../include/SCycleConfig.h"
 #include "../include/SCycleOutput.h"
 #include "../include/SProofManager.h"
+#include "../include/SCycleWorker.h"
+#include "../include/SFilePrefetcher.h"
+#include "../include/SWorkQueue.h"
+#include "../include/SInputShare.h"
+#include "../include/SPipelineQueue.h"
+#include "../include/SMetricsExporter.h"
+#include "../include/SProgressMonitor.h"
+#include "../include/SFileMetadataCache.h"
+
+namespace {
+
+   /**
+    * Adds all the input files of an input data block to a chain. The number
+    * of events in the files is not given to the chain, even if it's known
+    * from the input validation. A validation result taken from a cache may
+    * be out of date, which would make the chain use wrong entry offsets.
+    *
+    * @param chain The chain to add the files to
+    * @param id The input data block whose files should be added
+    */
+   void AddInputFiles( TChain& chain, const SInputData& id ) {
+
+      std::vector< SFile >::const_iterator f_itr = id.GetSFileIn().begin();
+      std::vector< SFile >::const_iterator f_end = id.GetSFileIn().end();
+      for( ; f_itr != f_end; ++f_itr ) {
+         chain.AddFile( f_itr->file );
+      }
+
+      return;
+   }
+
+   /**
+    * Removes the temporary ntuple files (and their directories) of a worker
+    * running outside of PROOF, when its output is not going to be merged.
+    *
+    * @param output The output list of the worker's cycle
+    */
+   void RemoveTemporaryFiles( TList* output ) {
+
+      TIter next( output );
+      TObject* obj = 0;
+      while( ( obj = next() ) ) {
+         SOutputFile* sfile = dynamic_cast< SOutputFile* >( obj );
+         if( ! sfile ) continue;
+         gSystem->Unlink( sfile->GetFileName() );
+         TString dirname = gSystem->DirName( sfile->GetFileName() );
+         if( dirname != "." ) {
+            gSystem->Unlink( dirname );
+         }
+      }
+
+      return;
+   }
+
+   /**
+    * Sets up the TTreeCache of a chain that the framework processes itself
+    * (outside of PROOF), if the cycle asks for it. The chain moves its cache
+    * over to each new input file. The other input trees are taken care of by
+    * SCycleBaseNTuple.
+    *
+    * @param chain The chain to configure
+    * @param config The configuration of the cycle processing the chain
+    */
+   void ConfigureTreeCache( TChain& chain, const SCycleConfig& config ) {
+
+      if( config.GetUseTreeCache() ) {
+         chain.SetCacheSize( config.GetCacheSize() );
+      }
+
+      return;
+   }
+
+   /**
+    * Finds the name of the main event-level input tree of an input data
+    * block. This is the tree that the TChain-s are created for.
+    *
+    * @param id The input data block
+    * @returns The name of the first event-level input tree, or a null
+    *          pointer if the block doesn't have one
+    */
+   const char* GetMainTreeName( const SInputData& id ) {
+
+      for( std::map< Int_t, std::vector< STree > >::const_iterator trees =
+              id.GetTrees().begin(); trees != id.GetTrees().end(); ++trees ) {
+         for( std::vector< STree >::const_iterator st = trees->second.begin();
+              st != trees->second.end(); ++st ) {
+            if( ( st->type & STree::INPUT_TREE ) &&
+                ( st->type & STree::EVENT_TREE ) ) {
+               return st->treeName.Data();
+            }
+         }
+      }
+
+      return 0;
+   }
+
+   /**
+    * Checks whether two cycles can be executed in a single event loop. This
+    * is only possible in LOCAL mode, and only if the cycles process exactly
+    * the same events from the same input files.
+    *
+    * @param c1 The configuration of the first cycle
+    * @param c2 The configuration of the second cycle
+    * @returns <code>kTRUE</code> if the cycles can be fused,
+    *          <code>kFALSE</code> otherwise
+    */
+   Bool_t CanBeFused( const SCycleConfig& c1, const SCycleConfig& c2 ) {
+
+      // Check the running modes:
+      if( ( c1.GetRunMode() != SCycleConfig::LOCAL ) ||
+          ( c2.GetRunMode() != SCycleConfig::LOCAL ) ) {
+         return kFALSE;
+      }
+
+      // Check the input data blocks one by one:
+      const SCycleConfig::id_type& ids1 = c1.GetInputData();
+      const SCycleConfig::id_type& ids2 = c2.GetInputData();
+      if( ids1.size() != ids2.size() ) {
+         return kFALSE;
+      }
+      for( size_t i = 0; i < ids1.size(); ++i ) {
+         const SInputData& id1 = ids1[ i ];
+         const SInputData& id2 = ids2[ i ];
+         if( ( id1.GetType() != id2.GetType() ) ||
+             ( id1.GetVersion() != id2.GetVersion() ) ||
+             ( id1.GetNEventsMax() != id2.GetNEventsMax() ) ||
+             ( id1.GetNEventsSkip() != id2.GetNEventsSkip() ) ||
+             id1.GetDataSets().size() || id2.GetDataSets().size() ||
+             ( id1.GetSFileIn().size() != id2.GetSFileIn().size() ) ) {
+            return kFALSE;
+         }
+         for( size_t j = 0; j < id1.GetSFileIn().size(); ++j ) {
+            if( id1.GetSFileIn()[ j ].file != id2.GetSFileIn()[ j ].file ) {
+               return kFALSE;
+            }
+         }
+         const char* tree1 = GetMainTreeName( id1 );
+         const char* tree2 = GetMainTreeName( id2 );
+         if( ( ! tree1 ) || ( ! tree2 ) || strcmp( tree1, tree2 ) ) {
+            return kFALSE;
+         }
+      }
+
+      return kTRUE;
+   }
+
+   /**
+    * Constructs the name of the output file that a cycle writes for an input
+    * data block. All the blocks with the same type and version write into
+    * the same file.
+    *
+    * @param cycleName The name of the cycle
+    * @param config The configuration of the cycle
+    * @param id The input data block
+    * @returns The name of the output file
+    */
+   TString GetOutputFileName( const TString& cycleName,
+                              const SCycleConfig& config,
+                              const SInputData& id ) {
+
+      TString result = config.GetOutputDirectory() + cycleName + "." +
+         id.GetType() + "." + id.GetVersion() + config.GetPostFix() +
+         ".root";
+      result.ReplaceAll( "::", "." );
+
+      return result;
+   }
+
+   /**
+    * Brings a file name into a form in which it can be compared to other
+    * file names. Only the most common variations are handled, like a leading
+    * "./", or multiple slashes.
+    *
+    * @param fileName The file name to normalise
+    * @returns The normalised file name
+    */
+   TString NormaliseFileName( const TString& fileName ) {
+
+      TString result = fileName;
+      while( result.Contains( "//" ) ) {
+         result.ReplaceAll( "//", "/" );
+      }
+      result.ReplaceAll( "/./", "/" );
+      while( result.BeginsWith( "./" ) ) {
+         result.Remove( 0, 2 );
+      }
+
+      return result;
+   }
+
+   /**
+    * Determines the range of entries that should be processed from an input
+    * data block, taking the number of events to skip and the maximal number
+    * of events to process into account.
+    *
+    * @param chain The chain holding all the files of the input data
+    * @param id The input data block being processed
+    * @param evmax The maximum number of events to process
+    * @param firstEntry The first entry to process (output)
+    * @returns The number of entries to process
+    */
+   Long64_t GetEntryRange( TChain& chain, const SInputData& id,
+                           Long64_t evmax, Long64_t& firstEntry ) {
+
+      firstEntry = id.GetNEventsSkip();
+      const Long64_t totalEntries = chain.GetEntries();
+      Long64_t lastEntry = totalEntries;
+      if( evmax < ( totalEntries - firstEntry ) ) {
+         lastEntry = firstEntry + evmax;
+      }
+
+      return ( lastEntry > firstEntry ? lastEntry - firstEntry : 0 );
+   }
+
+   /**
+    * Splits the entries to be processed into ranges that are aligned with the
+    * cluster boundaries of the input files. This way none of the clusters
+    * have to be read by multiple workers.
+    *
+    * @param chain The chain holding all the files of the input data
+    * @param firstEntry The first entry to process
+    * @param nEntries The number of entries to process
+    * @returns The cluster-aligned entry ranges, in order
+    */
+   std::vector< SEntryRange > GetClusterRanges( TChain& chain,
+                                                Long64_t firstEntry,
+                                                Long64_t nEntries ) {
+
+      std::vector< SEntryRange > result;
+      const Long64_t lastEntry = firstEntry + nEntries;
+      for( Int_t i = 0; i < chain.GetNtrees(); ++i ) {
+
+         // Check if the file has any entries that need to be processed:
+         const Long64_t offset = chain.GetTreeOffset()[ i ];
+         if( offset >= lastEntry ) break;
+         if( ( chain.GetTreeOffset()[ i + 1 ] <= firstEntry ) ||
+             ( chain.GetTreeOffset()[ i + 1 ] == offset ) ) continue;
+
+         // Use the cluster boundaries from the shared metadata cache if
+         // possible, so that the file doesn't need to be opened here:
+         const char* fileName = chain.GetListOfFiles()->At( i )->GetTitle();
+         std::vector< Long64_t > boundaries;
+         if( SFileMetadataCache::Instance()->
+             GetClusterBoundaries( fileName, chain.GetName(), boundaries ) &&
+             ( offset + boundaries.back() ==
+               chain.GetTreeOffset()[ i + 1 ] ) ) {
+            for( size_t j = 0; j + 1 < boundaries.size(); ++j ) {
+               const Long64_t first = std::max( offset + boundaries[ j ],
+                                                firstEntry );
+               const Long64_t last = std::min( offset + boundaries[ j + 1 ],
+                                               lastEntry );
+               if( first < last ) {
+                  result.push_back( SEntryRange( first, last, i ) );
+               }
+            }
+            continue;
+         }
+
+         // Load the tree of the file:
+         if( ( chain.LoadTree( offset ) < 0 ) ||
+             ( chain.GetTreeNumber() != i ) ) {
+            SError error( SError::SkipInputData );
+            error << "Couldn't load the input tree of file: "
+                  << chain.GetListOfFiles()->At( i )->GetTitle();
+            throw error;
+         }
+         TTree* tree = chain.GetTree();
+
+         // Create one range for each cluster:
+         TTree::TClusterIterator clusters = tree->GetClusterIterator( 0 );
+         Long64_t start = 0;
+         while( ( start = clusters() ) < tree->GetEntries() ) {
+            const Long64_t first = std::max( offset + start, firstEntry );
+            const Long64_t last = std::min( offset + clusters.GetNextEntry(),
+                                            lastEntry );
+            if( first < last ) {
+               result.push_back( SEntryRange( first, last, i ) );
+            }
+         }
+      }
+
+      return result;
+   }
+
+   /**
+    * Writes a buffer into a file descriptor, handling partial writes and
+    * interrupted system calls.
+    *
+    * @returns <code>kTRUE</code> if the whole buffer was written,
+    *          <code>kFALSE</code> otherwise
+    */
+   Bool_t WriteAll( int fd, const char* data, size_t size ) {
+
+      while( size ) {
+         const ssize_t n = write( fd, data, size );
+         if( n < 0 ) {
+            if( errno == EINTR ) continue;
+            return kFALSE;
+         }
+         data += n;
+         size -= n;
+      }
+
+      return kTRUE;
+   }
+
+   /**
+    * Reads a given number of bytes from a file descriptor, handling partial
+    * reads and interrupted system calls.
+    *
+    * @returns <code>kTRUE</code> if the requested number of bytes was read,
+    *          <code>kFALSE</code> otherwise
+    */
+   Bool_t ReadAll( int fd, char* data, size_t size ) {
+
+      while( size ) {
+         const ssize_t n = read( fd, data, size );
+         if( n < 0 ) {
+            if( errno == EINTR ) continue;
+            return kFALSE;
+         } else if( n == 0 ) {
+            return kFALSE;
+         }
+         data += n;
+         size -= n;
+      }
+
+      return kTRUE;
+   }
+
+} // private namespace
 
 /**
  * The user has to specify a configuration file already at the construction
@@ -60,8 +408,12 @@
  * @param xmlConfigFile The name of the configuration file
  */
 SCycleController::SCycleController( const TString& xmlConfigFile )
-   : m_curCycle( 0 ), m_isInitialized( kFALSE ),
-     m_xmlConfigFile( xmlConfigFile ),
+   : m_curCycle( 0 ), m_isInitialized( kFALSE ), m_fuseCycles( kFALSE ),
+     m_pipelineCycles( kFALSE ), m_pipelineDepth( 2 ),
+     m_pipelineChunkSize( 1000 ), m_pipelineWriteIntermediate( kFALSE ),
+     m_metricsFile( "" ),
+     m_metricsInterval( 15. ), m_mergeThreads( 1 ),
+     m_xmlConfigFile( xmlConfigFile ), m_parentMonitors(),
      m_proof( 0 ), m_logger( "SCycleController" ) {
 
 }
@@ -74,6 +426,13 @@ SCycleController::SCycleController( const TString& xmlConfigFile )
  */
 SCycleController::~SCycleController() {
 
+   // Make sure that the metrics file is up to date, even if the execution
+   // was stopped by an exception:
+   SMetricsExporter::Instance()->Stop();
+
+   // Make sure that all the messages of the job are printed:
+   SLogWriter::Instance()->Flush();
+
    std::vector< ISCycleBase* >::const_iterator it = m_analysisCycles.begin();
    for( ; it != m_analysisCycles.end(); ++it) {
       delete ( *it );
@@ -101,6 +460,14 @@ void SCycleController::Initialize() {
 
    // first clean up everything in case this is called multiple times
    m_curCycle = 0;
+   m_fuseCycles = kFALSE;
+   m_pipelineCycles = kFALSE;
+   m_pipelineDepth = 2;
+   m_pipelineChunkSize = 1000;
+   m_pipelineWriteIntermediate = kFALSE;
+   m_metricsFile = "";
+   m_metricsInterval = 15.;
+   m_mergeThreads = 1;
    this->DeleteAllAnalysisCycles();
    m_parPackages.clear();
 
@@ -139,6 +506,8 @@ void SCycleController::Initialize() {
    if( rootNode->GetNodeName() == TString( "JobConfiguration" ) ) {
       std::string jobName = "";
       std::string outputLevelString = "";
+      UInt_t logBufferSize = 0;
+      Bool_t dropLogMessages = kFALSE;
       TListIter attribIt( rootNode->GetAttributes() );
       TXMLAttr* curAttr( 0 );
       while ( (curAttr = dynamic_cast< TXMLAttr* >( attribIt() ) ) != 0 ) {
@@ -146,6 +515,80 @@ void SCycleController::Initialize() {
             jobName = curAttr->GetValue();
          else if( curAttr->GetName() == TString( "OutputLevel" ) )
             outputLevelString = curAttr->GetValue();
+         else if( curAttr->GetName() == TString( "FuseCycles" ) ) {
+            const TString value( curAttr->GetValue() );
+            m_fuseCycles = ( value.Contains( "true", TString::kIgnoreCase ) ||
+                             ( value.IsDigit() && value.Atoi() ) );
+         }
+         else if( curAttr->GetName() == TString( "PipelineCycles" ) ) {
+            const TString value( curAttr->GetValue() );
+            m_pipelineCycles =
+               ( value.Contains( "true", TString::kIgnoreCase ) ||
+                 ( value.IsDigit() && value.Atoi() ) );
+         }
+         else if( curAttr->GetName() == TString( "PipelineDepth" ) ) {
+            const TString value( curAttr->GetValue() );
+            if( value.IsDigit() && value.Atoi() ) {
+               m_pipelineDepth = value.Atoi();
+            } else {
+               m_logger << WARNING << "Pipeline depth (" << value
+                        << ") not recognized" << SLogger::endmsg;
+            }
+         }
+         else if( curAttr->GetName() == TString( "PipelineChunkSize" ) ) {
+            const TString value( curAttr->GetValue() );
+            if( value.IsDigit() && value.Atoll() ) {
+               m_pipelineChunkSize = value.Atoll();
+            } else {
+               m_logger << WARNING << "Pipeline chunk size (" << value
+                        << ") not recognized" << SLogger::endmsg;
+            }
+         }
+         else if( curAttr->GetName() ==
+                  TString( "PipelineWriteIntermediate" ) ) {
+            const TString value( curAttr->GetValue() );
+            m_pipelineWriteIntermediate =
+               ( value.Contains( "true", TString::kIgnoreCase ) ||
+                 ( value.IsDigit() && value.Atoi() ) );
+         }
+         else if( curAttr->GetName() == TString( "MetricsFile" ) )
+            m_metricsFile = curAttr->GetValue();
+         else if( curAttr->GetName() == TString( "MetricsInterval" ) )
+            m_metricsInterval = atof( curAttr->GetValue() );
+         else if( curAttr->GetName() == TString( "MergeThreads" ) ) {
+            // A negative value is accepted, meaning all the cores:
+            const TString value( curAttr->GetValue() );
+            const TString digits( value.BeginsWith( "-" ) ?
+                                  TString( value( 1, value.Length() ) ) :
+                                  value );
+            if( digits.Length() && digits.IsDigit() ) {
+               m_mergeThreads = value.Atoi();
+            } else {
+               m_logger << WARNING << "Number of merging threads (" << value
+                        << ") not recognized" << SLogger::endmsg;
+            }
+         }
+         else if( curAttr->GetName() == TString( "MetadataCache" ) )
+            SFileMetadataCache::Instance()->SetFileName(
+               curAttr->GetValue() );
+         else if( curAttr->GetName() == TString( "AsyncLogBuffer" ) ) {
+            const TString value( curAttr->GetValue() );
+            if( value.IsDigit() ) {
+               logBufferSize = value.Atoi();
+            } else {
+               m_logger << WARNING << "Log buffer size (" << value
+                        << ") not recognized" << SLogger::endmsg;
+            }
+         }
+         else if( curAttr->GetName() == TString( "LogOverflowPolicy" ) ) {
+            const TString value( curAttr->GetValue() );
+            if( value.CompareTo( "Drop", TString::kIgnoreCase ) == 0 ) {
+               dropLogMessages = kTRUE;
+            } else if( value.CompareTo( "Block", TString::kIgnoreCase ) ) {
+               m_logger << WARNING << "Log overflow policy (" << value
+                        << ") not recognized" << SLogger::endmsg;
+            }
+         }
       }
       SMsgType type = INFO;
       if     ( outputLevelString == "VERBOSE" ) type = VERBOSE;
@@ -161,6 +604,9 @@ void SCycleController::Initialize() {
                   << SLogger::endmsg;
       }
       SLogWriter::Instance()->SetMinType( type );
+      if( logBufferSize || SLogWriter::Instance()->IsAsync() ) {
+         SLogWriter::Instance()->SetAsync( logBufferSize, dropLogMessages );
+      }
 
       TXMLNode* nodes = rootNode->GetChildren();
 
@@ -362,11 +808,22 @@ void SCycleController::ExecuteAllCycles() {
    // Let the user know what's happening:
    m_logger << INFO << "Entering ExecuteAllCycles()" << SLogger::endmsg;
 
-   // Execute each cycle one by one:
-   for( size_t i = 0; i < m_analysisCycles.size(); ++i ) {
+   // Start writing the metrics file if requested:
+   if( m_metricsFile.Length() ) {
+      m_logger << INFO << "Writing metrics to \"" << m_metricsFile
+               << "\" every " << m_metricsInterval << " seconds"
+               << SLogger::endmsg;
+      SMetricsExporter::Instance()->Start( m_metricsFile, m_metricsInterval );
+   }
+
+   // Execute each cycle one by one. (Fused cycles are executed together.)
+   while( m_curCycle < m_analysisCycles.size() ) {
       this->ExecuteNextCycle();
    }
 
+   // Write the final metrics:
+   SMetricsExporter::Instance()->Stop();
+
    return;
 }
 
@@ -386,6 +843,29 @@ void SCycleController::ExecuteNextCycle() {
                     SError::StopExecution );
    }
 
+   //
+   // Execute the cycle together with the following ones if possible:
+   //
+   if( m_fuseCycles ) {
+      const UInt_t nCycles = this->CountFusableCycles();
+      if( nCycles > 1 ) {
+         this->ExecuteFusedCycles( nCycles );
+         return;
+      }
+   }
+
+   //
+   // Execute the cycle together with the next one if the next one only
+   // reads the output of this one:
+   //
+   if( m_pipelineCycles ) {
+      std::vector< std::vector< size_t > > inputs;
+      if( this->GetPipelineInputs( inputs ) ) {
+         this->ExecutePipelinedCycles( inputs );
+         return;
+      }
+   }
+
    //
    // Measure the total time needed for this cycle:
    //
@@ -403,17 +883,14 @@ void SCycleController::ExecuteNextCycle() {
    // PROOF:
    //
    SCycleConfig config = cycle->GetConfig();
-   config.SetName( SFrame::CycleConfigName );
-   config.ArrangeInputData(); // To handle multiple ID of the same type...
-   config.ValidateInput(); // This is needed for the proper weighting...
-   config.SetMsgLevel( SLogWriter::Instance()->GetMinType() ); // For the correct msg level...
-   config.SetCycleName( cycle->GetName() ); // For technical reasons...
-   cycle->SetConfig( config );
+   this->PrepareConfig( cycle, config );
 
    m_logger << INFO << "Executing Cycle #" << m_curCycle << " ('"
             << cycleName << "') "
             << ( config.GetRunMode() == SCycleConfig::LOCAL ? "locally" :
-                 "on PROOF" )
+                 ( config.GetRunMode() == SCycleConfig::PROOF ? "on PROOF" :
+                   ( config.GetRunMode() == SCycleConfig::THREADS ?
+                     "on multiple threads" : "on multiple processes" ) ) )
             << SLogger::endmsg;
 
    //
@@ -469,10 +946,8 @@ void SCycleController::ExecuteNextCycle() {
 
    }
 
-   // Number of processed events:
-   Long64_t procev = 0;
-   // Number of skipped events:
-   Long64_t skipev = 0;
+   // Statistics of processing all the input data blocks:
+   SCycleStatistics stats;
 
    //
    // The begin cycle function has to be called here by hand:
@@ -480,402 +955,1499 @@ void SCycleController::ExecuteNextCycle() {
    cycle->BeginCycle();
 
    //
-   // Loop over all defined input data types:
+   // Group the input data blocks that write into the same output file. The
+   // InputData objects should be arranged by their type at this point...
    //
+   std::vector< id_group_type > groups;
    SCycleConfig::id_type::const_iterator id = config.GetInputData().begin();
    SCycleConfig::id_type::const_iterator id_end = config.GetInputData().end();
    for( ; id != id_end; ++id ) {
-
-      //
-      // Decide how to write the output file at the end of processing this
-      // InputData. The InputData objects should be arranged by their type at
-      // this point...
-      //
-      Bool_t updateOutput = kFALSE;
-      SCycleConfig::id_type::const_iterator previous_id = id;
-      if( previous_id == config.GetInputData().begin() ) {
-         updateOutput = kFALSE;
-         REPORT_VERBOSE( "New output file will be opened for ID type: "
-                         << id->GetType() );
-      } else {
-         --previous_id;
-         if( ( previous_id->GetType() == id->GetType() ) &&
-             ( previous_id->GetVersion() == id->GetVersion() ) ) {
-            updateOutput = kTRUE;
-            REPORT_VERBOSE( "Output file will be updated for ID type: "
-                            << id->GetType() );
-         } else {
-            updateOutput = kFALSE;
-            REPORT_VERBOSE( "New output file will be opened for ID type: "
-                            << id->GetType() );
-         }
-      }
-
-      //
-      // Each input data has to have at least one input tree:
-      //
-      if( ! id->HasInputTrees() ) {
-         REPORT_ERROR( "No input trees defined in input data "
-                       << id->GetType() );
-         REPORT_ERROR( "Skipping it from processing" );
-         continue;
+      if( groups.empty() ||
+          ( groups.back().back()->GetType() != id->GetType() ) ||
+          ( groups.back().back()->GetVersion() != id->GetVersion() ) ) {
+         groups.push_back( id_group_type() );
       }
+      groups.back().push_back( &( *id ) );
+   }
 
-      // Find the first event-level input tree in the configuration:
-      REPORT_VERBOSE( "Finding the name of the main event-level input "
-                      "TTree..." );
-      const char* treeName = 0;
-      for( std::map< Int_t, std::vector< STree > >::const_iterator trees =
-              id->GetTrees().begin(); trees != id->GetTrees().end(); ++trees ) {
-         for( std::vector< STree >::const_iterator st = trees->second.begin();
-              st != trees->second.end(); ++st ) {
-            if( ( st->type & STree::INPUT_TREE ) &&
-                ( st->type & STree::EVENT_TREE ) ) {
-               treeName = st->treeName.Data();
-               break;
-            }
+   //
+   // Process the input data groups, either one by one, or concurrently:
+   //
+   Int_t nConcurrent = config.GetNConcurrentInputData();
+   if( ( nConcurrent > 1 ) &&
+       ( config.GetRunMode() == SCycleConfig::PROOF ) ) {
+      m_logger << WARNING << "Concurrent processing of InputData-s is not "
+               << "available in PROOF mode" << SLogger::endmsg;
+      nConcurrent = 1;
+   }
+   if( ( nConcurrent > 1 ) && ( groups.size() > 1 ) ) {
+      ExecuteConcurrently( cycle, config, groups, nConcurrent, stats );
+   } else {
+      for( size_t i = 0; i < groups.size(); ++i ) {
+         if( ! ExecuteInputDataGroup( cycle, config, groups[ i ], stats ) ) {
+            break;
          }
       }
-      if( ! treeName ) {
-         REPORT_ERROR( "Can't determine input TTree name for input data "
-                       << id->GetType() );
-         REPORT_ERROR( "Skipping it from processing" );
-         continue;
-      } else {
-         REPORT_VERBOSE( "The name of the main event-level input TTree is: "
-                         << treeName );
-      }
-
-      // Let the user know what's happening:
-      m_logger << INFO << "Processing input data type: " << id->GetType()
-               << " version: " << id->GetVersion() << SLogger::endmsg;
+   }
 
-      //
-      // Create a copy of the input data configuration, so that it can be
-      // given to PROOF:
-      //
-      SInputData inputData = *id;
-      inputData.SetName( SFrame::CurrentInputDataName );
+   //
+   // The end cycle function has to be called here by hand:
+   //
+   cycle->EndCycle();
 
-      //
-      // Retrieve the configuration object list from the cycle:
-      //
-      const TList& configList = cycle->GetConfigurationObjects();
+   // The cycle processing is done at this point:
+   timer.Stop();
 
-      //
-      // Calculate how many events to process:
-      //
-      const Long64_t evmax = ( id->GetNEventsMax() == -1 ?
-                               std::numeric_limits< Long64_t >::max() :
-                               id->GetNEventsMax() );
+   // Print some final statistics about the cycle:
+   this->PrintCycleStatistics( stats, timer );
 
-      // This will point to the created output objects:
-      TList* outputs = 0;
+   ++m_curCycle;
+   return;
+}
 
-      //
-      // The cycle can be run in two modes:
-      //
-      if( config.GetRunMode() == SCycleConfig::LOCAL ) {
+/**
+ * Each cycle is executed with a copy of its own configuration, which is
+ * prepared for the execution by this function. The prepared copy is also
+ * given back to the cycle.
+ *
+ * @param cycle The cycle that is about to be executed
+ * @param config The copy of the cycle's configuration (modified)
+ * @param validate When <code>kFALSE</code>, the input files are not
+ *                 validated. (Because they don't exist yet.)
+ * @param validated Already prepared configuration of another cycle reading
+ *                  the same input, whose validation results are re-used
+ */
+void SCycleController::PrepareConfig( ISCycleBase* cycle,
+                                      SCycleConfig& config,
+                                      Bool_t validate,
+                                      const SCycleConfig* validated ) const {
 
-         if( id->GetDataSets().size() ) {
-            REPORT_ERROR( "Can't use DataSet-s as input in LOCAL mode!" );
-            REPORT_ERROR( "Skipping InputData type: " << id->GetType()
-                          << " version: " << id->GetVersion() );
-            continue;
-         }
+   config.SetName( SFrame::CycleConfigName );
+   config.ArrangeInputData(); // To handle multiple ID of the same type...
+   if( validate ) {
+      // This is needed for the proper weighting...
+      config.ValidateInput( validated );
+   }
+   config.SetMsgLevel( SLogWriter::Instance()->GetMinType() ); // For the correct msg level...
+   config.SetCycleName( cycle->GetName() ); // For technical reasons...
+   cycle->SetConfig( config );
 
-         //
-         // Create a chain with all the specified input files:
-         //
-         REPORT_VERBOSE( "Creating TChain to run the cycle on..." );
-         TChain chain( treeName );
-         std::vector< SFile >::const_iterator f_itr = id->GetSFileIn().begin();
-         std::vector< SFile >::const_iterator f_end = id->GetSFileIn().end();
-         for( ; f_itr != f_end; ++f_itr ) {
-            REPORT_VERBOSE( "Adding file: " << f_itr->file );
-            chain.AddFile( f_itr->file );
-         }
+   return;
+}
 
-         //
-         // Give the configuration to the cycle by hand:
-         //
-         TList list;
-         list.Add( &config );
-         list.Add( &inputData );
-         for( Int_t i = 0; i < configList.GetSize(); ++i ) {
-            list.Add( configList.At( i ) );
-         }
-         cycle->SetInputList( &list );
+/**
+ * Besides the overall event rates, the function prints the resources used
+ * by the workers, and how the time of the event loop was shared between its
+ * stages, if the cycle collected this information. The stage times are
+ * summed over all the workers.
+ *
+ * @param stats The statistics of the processing by the cycle
+ * @param timer The (stopped) timer measuring the execution of the cycle
+ */
+void SCycleController::PrintCycleStatistics( const SCycleStatistics& stats,
+                                             TStopwatch& timer ) const {
 
-         //
-         // Run the cycle:
-         //
-         chain.Process( cycle, "", evmax, id->GetNEventsSkip() );
+   const Long64_t procev = stats.GetProcessedEvents();
 
-         // Get the output objects from the cycle:
-         outputs = cycle->GetOutputList();
+   m_logger << INFO << "Overall cycle statistics:" << SLogger::endmsg;
+   m_logger.setf( std::ios::fixed );
+   m_logger << INFO << std::setw( 10 ) << std::setfill( ' ' )
+            << std::setprecision( 0 ) << procev << " Events - Real time "
+            << std::setw( 6 ) << std::setprecision( 2 ) << timer.RealTime()
+            << " s  - " << std::setw( 5 ) << std::setprecision( 0 )
+            << ( procev / timer.RealTime() ) << " Hz | CPU time "
+            << std::setw( 6 ) << std::setprecision( 2 ) << timer.CpuTime()
+            << " s  - " << std::setw( 5 ) << std::setprecision( 0 )
+            << ( procev / timer.CpuTime() ) << " Hz" << SLogger::endmsg;
+   m_logger << INFO << "Read " << std::setprecision( 1 )
+            << ( stats.GetBytesRead() / 1048576.0 ) << " MB ("
+            << ( stats.GetUncompressedBytesRead() / 1048576.0 )
+            << " MB uncompressed) from " << stats.GetFileOpens()
+            << " file(s) - Worker rate " << std::setprecision( 0 )
+            << stats.GetEventRate() << " Hz - Peak memory "
+            << std::setprecision( 1 )
+            << ( stats.GetPeakResidentMemory() / 1024.0 ) << " MB"
+            << SLogger::endmsg;
 
-      } else if( config.GetRunMode() == SCycleConfig::PROOF ) {
+   // Print the breakdown of the event loop, if it's available:
+   Double_t totalReal = 0.0;
+   for( Int_t i = 0; i < SCycleStatistics::NStages; ++i ) {
+      totalReal += stats.GetStageRealTime(
+         static_cast< SCycleStatistics::Stage >( i ) );
+   }
+   if( totalReal <= 0.0 ) {
+      return;
+   }
+   m_logger << INFO << "Event loop breakdown (summed over the workers):"
+            << SLogger::endmsg;
+   for( Int_t i = 0; i < SCycleStatistics::NStages; ++i ) {
+      const SCycleStatistics::Stage stage =
+         static_cast< SCycleStatistics::Stage >( i );
+      const Double_t real = stats.GetStageRealTime( stage );
+      m_logger << INFO << std::setw( 21 ) << std::setfill( ' ' )
+               << SCycleStatistics::GetStageName( stage ) << ": wall "
+               << std::setw( 8 ) << std::setprecision( 2 ) << real
+               << " s (" << std::setw( 5 ) << std::setprecision( 1 )
+               << ( 100.0 * real / totalReal ) << " %) | cpu "
+               << std::setw( 8 ) << std::setprecision( 2 )
+               << stats.GetStageCpuTime( stage ) << " s" << SLogger::endmsg;
+   }
 
-         //
-         // Check that the PROOF server is available and ready. For instance
-         // it's not a good idea to send a job to a server that crashed on the
-         // previous input data...
-         //
-         if( ! m_proof->IsValid() ) {
-            REPORT_ERROR( "PROOF server doesn't seem to be available: "
-                          << m_proof->GetManager()->GetUrl() );
-            REPORT_ERROR( "Aborting execution of cycle!" );
-            break;
-         }
+   return;
+}
 
-         // This object describes how to create the temporary PROOF output
-         // files in the cycles:
-         TNamed proofOutputFile( TString( SFrame::ProofOutputName ),
-                                 ( config.GetProofWorkDir() == "" ? "./" :
-                                   config.GetProofWorkDir() + "/" ) +
-                                 cycle->GetName() + "-" + inputData.GetType() +
-                                 "-" + inputData.GetVersion() +
-                                 "-TempNTuple.root" );
+/**
+ * Cycles can be executed in a single event loop if they are configured one
+ * after the other in the configuration file, and they all read exactly the
+ * same input in LOCAL mode.
+ *
+ * @returns The number of cycles, starting with the current one, that can be
+ *          executed together
+ */
+UInt_t SCycleController::CountFusableCycles() const {
+
+   const SCycleConfig& first = m_analysisCycles.at( m_curCycle )->GetConfig();
+   UInt_t result = 1;
+   while( ( m_curCycle + result < m_analysisCycles.size() ) &&
+          CanBeFused( first,
+                      m_analysisCycles[ m_curCycle + result ]->GetConfig() ) ) {
+      ++result;
+   }
 
-         //
-         // Clear the query results from memory (Thanks to Gerri!):
-         //
-         if( m_proof->GetQueryResults() ) {
-            m_proof->GetQueryResults()->SetOwner( kTRUE );
-            m_proof->GetQueryResults()->Clear();
-            m_proof->GetQueryResults()->SetOwner( kFALSE );
-         }
+   return result;
+}
 
-         //
-         // Give the configuration to PROOF, and tweak it a little:
-         //
-         m_proof->ClearInput();
-         // Only output a maximum of 10 messages per node about memory usage per
-         // query:
-         const Long64_t eventsPerNode = ( inputData.GetEventsTotal() /
-                                          m_proof->GetParallel() );
-         m_proof->SetParameter( "PROOF_MemLogFreq",
-                                ( Long64_t ) ( eventsPerNode > 10000 ?
-                                               ( eventsPerNode / 10 ) :
-                                               1000 ) );
-         // Make sure that we can use as many workers per node as we want:
-         m_proof->SetParameter( "PROOF_MaxSlavesPerNode", ( Long_t ) 9999999 );
-         // Configure the usage of TTreeCache on the cluster:
-         if( config.GetUseTreeCache() ) {
-            m_proof->SetParameter( "PROOF_UseTreeCache", ( Int_t ) 1 );
-         }
-         m_proof->SetParameter( "PROOF_CacheSize", config.GetCacheSize() );
-         // Configure whether the workers are allowed to read each others'
-         // files:
-         if( config.GetProcessOnlyLocal() ) {
-            m_proof->SetParameter( "PROOF_ForceLocal", ( Int_t ) 1 );
-         }
-         // Turn off file lookup if the configuration asks for this feature:
-         if( inputData.GetSkipLookup() ) {
-            m_proof->SetParameter( "PROOF_LookupOpt", "none" );
-         }
+/**
+ * This function executes multiple cycles in a single event loop. Each event
+ * is read from the input files only once, and is then given to all of the
+ * cycles. The cycles otherwise behave the same as if they were executed one
+ * by one. Each of them writes its own output file, and receives its own
+ * BeginCycle(), BeginInputData(...), etc. calls.
+ *
+ * The order of the calls between the cycles follows the order of the cycles
+ * in the configuration.
+ *
+ * @param nCycles The number of cycles to execute, starting with the current
+ *                one
+ */
+void SCycleController::ExecuteFusedCycles( UInt_t nCycles ) {
 
-         // Add the "input objects" to PROOF:
-         m_proof->AddInput( &config );
-         m_proof->AddInput( &inputData );
-         m_proof->AddInput( &proofOutputFile );
-         for( Int_t i = 0; i < configList.GetSize(); ++i ) {
-            m_proof->AddInput( configList.At( i ) );
-         }
+   //
+   // Measure the total time needed for the cycles:
+   //
+   TStopwatch timer;
+   timer.Start();
 
-         if( id->GetDataSets().size() ) {
-
-            // Merge the dataset names in the way that PROOF expects them. This
-            // is "<dataset 1>|<dataset 2>|...". Note that this only works in
-            // ROOT versions newer than 5.27/02, but SInputData should take care
-            // about removing multiple datasets when using an "old" ROOT
-            // release.
-            TString dsets = "";
-            std::vector< SDataSet >::const_iterator ds_itr =
-               id->GetDataSets().begin();
-            std::vector< SDataSet >::const_iterator ds_end =
-               id->GetDataSets().end();
-            for( ; ds_itr != ds_end; ++ds_itr ) {
-               if( ds_itr != id->GetDataSets().begin() ) {
-                  dsets += "|";
-               }
-               dsets += ds_itr->name + "#" + treeName;
-            }
+   //
+   // Prepare the configuration of all the cycles. The cycles read the same
+   // input, so it's only validated for the first one.
+   //
+   std::vector< ISCycleBase* > cycles;
+   std::vector< SCycleConfig > configs;
+   configs.reserve( nCycles );
+   for( UInt_t i = 0; i < nCycles; ++i ) {
+      ISCycleBase* cycle = m_analysisCycles.at( m_curCycle + i );
+      configs.push_back( cycle->GetConfig() );
+      this->PrepareConfig( cycle, configs.back(), kTRUE,
+                           ( i ? &configs.front() : 0 ) );
+      cycles.push_back( cycle );
+
+      m_logger << INFO << "Executing Cycle #" << ( m_curCycle + i ) << " ('"
+               << cycle->GetName() << "') locally, fused with "
+               << ( nCycles - 1 ) << " other cycle(s)" << SLogger::endmsg;
+   }
 
-            // Process the events:
-            if( m_proof->Process( dsets, cycle->GetName(), "", evmax,
-                                  id->GetNEventsSkip() ) == -1 ) {
-               REPORT_ERROR( "There was an error processing:" );
-               REPORT_ERROR( "  Cycle      = " << cycle->GetName() );
-               REPORT_ERROR( "  ID type    = " << inputData.GetType() );
-               REPORT_ERROR( "  ID version = " << inputData.GetVersion() );
-               REPORT_ERROR( "Stopping the execution of this cycle!" );
-               break;
-            }
+   // Statistics of the processing per cycle:
+   std::vector< SCycleStatistics > stats( nCycles );
 
-         } else if( id->GetSFileIn().size() ) {
+   //
+   // The begin cycle functions have to be called here by hand:
+   //
+   for( UInt_t i = 0; i < nCycles; ++i ) {
+      cycles[ i ]->BeginCycle();
+   }
 
-            //
-            // Check if the validation was skipped. If it was, then the
-            // SInputData objects didn't create a TDSet object of its own. So we
-            // have to create a simple one here. Otherwise just use the TDSet
-            // created by SInputData.
-            //
-            if( id->GetSkipValid() ) {
-
-               // Create the dataset object first:
-               TChain chain( treeName );
-               std::vector< SFile >::const_iterator file_itr =
-                  id->GetSFileIn().begin();
-               std::vector< SFile >::const_iterator file_end =
-                  id->GetSFileIn().end();
-               for( ; file_itr != file_end; ++file_itr ) {
-                  chain.Add( file_itr->file );
-               }
-               TDSet set( chain );
-
-               // Process the events:
-               if( m_proof->Process( &set, cycle->GetName(), "", evmax,
-                                     id->GetNEventsSkip() ) == -1 ) {
-                  REPORT_ERROR( "There was an error processing:" );
-                  REPORT_ERROR( "  Cycle      = " << cycle->GetName() );
-                  REPORT_ERROR( "  ID type    = " << inputData.GetType() );
-                  REPORT_ERROR( "  ID version = " << inputData.GetVersion() );
-                  REPORT_ERROR( "Stopping the execution of this cycle!" );
-                  break;
-               }
+   //
+   // Process the input data blocks. Blocks of the same type and version
+   // write into the same output file.
+   //
+   const SCycleConfig::id_type& ids = configs.front().GetInputData();
+   for( size_t i = 0; i < ids.size(); ++i ) {
+      const Bool_t updateOutput =
+         ( ( i != 0 ) && ( ids[ i ].GetType() == ids[ i - 1 ].GetType() ) &&
+           ( ids[ i ].GetVersion() == ids[ i - 1 ].GetVersion() ) );
+      if( ! ExecuteFusedInputData( cycles, configs, i, updateOutput,
+                                   stats ) ) {
+         break;
+      }
+   }
 
-            } else {
+   //
+   // The end cycle functions have to be called here by hand:
+   //
+   for( UInt_t i = 0; i < nCycles; ++i ) {
+      cycles[ i ]->EndCycle();
+   }
 
-               //
-               // Run the cycle on PROOF. Unfortunately the checking of the
-               // "successfullness" of the PROOF job is not working too well...
-               // Even after a *lot* of error messages the TProof::Process(...)
-               // command can still return a success code, which can lead to
-               // nasty crashes...
-               //
-               if( m_proof->Process( id->GetDSet(), cycle->GetName(), "", evmax,
-                                     id->GetNEventsSkip() ) == -1 ) {
-                  REPORT_ERROR( "There was an error processing:" );
-                  REPORT_ERROR( "  Cycle      = " << cycle->GetName() );
-                  REPORT_ERROR( "  ID type    = " << inputData.GetType() );
-                  REPORT_ERROR( "  ID version = " << inputData.GetVersion() );
-                  REPORT_ERROR( "Stopping the execution of this cycle!" );
-                  break;
+   // The cycle processing is done at this point:
+   timer.Stop();
+
+   // Print some final statistics about the cycles:
+   for( UInt_t i = 0; i < nCycles; ++i ) {
+      m_logger << INFO << "Cycle '" << cycles[ i ]->GetName() << "':"
+               << SLogger::endmsg;
+      this->PrintCycleStatistics( stats[ i ], timer );
+   }
+
+   m_curCycle += nCycles;
+   return;
+}
+
+/**
+ * This function executes the fused cycles on one input data block. Every
+ * cycle gets its own copy of the input data description, and its own input
+ * object list. But all of them receive the same registry of shared input
+ * branches.
+ *
+ * @param cycles The cycles to execute
+ * @param configs The configurations of the cycles
+ * @param index The index of the input data block in the configurations
+ * @param updateOutput Flag deciding if the output files should be updated
+ *                     or overwritten
+ * @param stats The statistics of the processing per cycle (incremented)
+ * @returns <code>kFALSE</code> if the execution of the cycles should be
+ *          stopped, <code>kTRUE</code> otherwise
+ */
+Bool_t SCycleController::
+ExecuteFusedInputData( const std::vector< ISCycleBase* >& cycles,
+                       std::vector< SCycleConfig >& configs,
+                       size_t index, Bool_t updateOutput,
+                       std::vector< SCycleStatistics >& stats ) {
+
+   // The input data block, as seen by the first cycle:
+   const SInputData& id = configs.front().GetInputData()[ index ];
+
+   //
+   // Each input data has to have at least one input tree:
+   //
+   if( ! id.HasInputTrees() ) {
+      REPORT_ERROR( "No input trees defined in input data "
+                    << id.GetType() );
+      REPORT_ERROR( "Skipping it from processing" );
+      return kTRUE;
+   }
+   const char* treeName = GetMainTreeName( id );
+   if( ! treeName ) {
+      REPORT_ERROR( "Can't determine input TTree name for input data "
+                    << id.GetType() );
+      REPORT_ERROR( "Skipping it from processing" );
+      return kTRUE;
+   }
+
+   // Let the user know what's happening:
+   m_logger << INFO << "Processing input data type: " << id.GetType()
+            << " version: " << id.GetVersion() << " with "
+            << cycles.size() << " fused cycles" << SLogger::endmsg;
+
+   //
+   // Create the input data descriptions and the input object lists of the
+   // cycles:
+   //
+   SInputShare share;
+   std::vector< SInputData > inputData;
+   inputData.reserve( cycles.size() );
+   std::vector< TList* > inputs;
+   for( size_t i = 0; i < cycles.size(); ++i ) {
+      inputData.push_back( configs[ i ].GetInputData()[ index ] );
+      inputData.back().SetName( SFrame::CurrentInputDataName );
+
+      TList* list = new TList();
+      list->Add( &configs[ i ] );
+      list->Add( &inputData.back() );
+      list->Add( &share );
+      const TList& configList = cycles[ i ]->GetConfigurationObjects();
+      for( Int_t j = 0; j < configList.GetSize(); ++j ) {
+         list->Add( configList.At( j ) );
+      }
+      inputs.push_back( list );
+   }
+
+   //
+   // Calculate how many events to process:
+   //
+   const Long64_t evmax = ( id.GetNEventsMax() == -1 ?
+                            std::numeric_limits< Long64_t >::max() :
+                            id.GetNEventsMax() );
+
+   //
+   // Run the cycles:
+   //
+   try {
+      ProcessFused( cycles, inputs, id, treeName, evmax, share );
+   } catch( ... ) {
+      for( size_t i = 0; i < inputs.size(); ++i ) {
+         delete inputs[ i ];
+      }
+      throw;
+   }
+
+   //
+   // Write out the objects produced by the cycles:
+   //
+   for( size_t i = 0; i < cycles.size(); ++i ) {
+      FinishInputData( cycles[ i ], configs[ i ], inputData[ i ],
+                       cycles[ i ]->GetOutputList(), updateOutput,
+                       stats[ i ] );
+      delete inputs[ i ];
+   }
+
+   return kTRUE;
+}
+
+/**
+ * Two cycles can be executed as a pipeline if both of them run in LOCAL
+ * mode, and the second cycle reads nothing else, but the output files of
+ * the first cycle. The input data blocks of the second cycle have to read
+ * the output files of the first cycle in the same order in which the first
+ * cycle writes them, they have to process all of their events, and they
+ * can't read metadata trees.
+ *
+ * @param inputs The indices of the output files of the current cycle read by
+ *               each input data block of the next cycle (output)
+ * @returns <code>kTRUE</code> if the current and the next cycle can be
+ *          executed as a pipeline, <code>kFALSE</code> otherwise
+ */
+Bool_t SCycleController::
+GetPipelineInputs( std::vector< std::vector< size_t > >& inputs ) const {
+
+   inputs.clear();
+   if( m_curCycle + 1 >= m_analysisCycles.size() ) {
+      return kFALSE;
+   }
+
+   //
+   // Check the running modes of the cycles:
+   //
+   const ISCycleBase* upstream = m_analysisCycles[ m_curCycle ];
+   SCycleConfig upConfig = upstream->GetConfig();
+   SCycleConfig downConfig = m_analysisCycles[ m_curCycle + 1 ]->GetConfig();
+   if( ( upConfig.GetRunMode() != SCycleConfig::LOCAL ) ||
+       ( downConfig.GetRunMode() != SCycleConfig::LOCAL ) ) {
+      return kFALSE;
+   }
+   upConfig.ArrangeInputData();
+   downConfig.ArrangeInputData();
+
+   //
+   // Collect the names of the output files of the first cycle:
+   //
+   std::vector< TString > outputs;
+   const SCycleConfig::id_type& upIds = upConfig.GetInputData();
+   for( size_t i = 0; i < upIds.size(); ++i ) {
+      if( ( i == 0 ) ||
+          ( upIds[ i ].GetType() != upIds[ i - 1 ].GetType() ) ||
+          ( upIds[ i ].GetVersion() != upIds[ i - 1 ].GetVersion() ) ) {
+         outputs.push_back(
+            NormaliseFileName( GetOutputFileName( upstream->GetName(),
+                                                  upConfig, upIds[ i ] ) ) );
+      }
+   }
+
+   //
+   // Check that the second cycle reads exactly these files, in this order:
+   //
+   size_t nextOutput = 0;
+   const SCycleConfig::id_type& downIds = downConfig.GetInputData();
+   for( size_t i = 0; i < downIds.size(); ++i ) {
+      const SInputData& id = downIds[ i ];
+      if( ( id.GetNEventsMax() != -1 ) || ( id.GetNEventsSkip() != 0 ) ||
+          id.GetDataSets().size() || id.GetSFileIn().empty() ||
+          ( ! GetMainTreeName( id ) ) ) {
+         inputs.clear();
+         return kFALSE;
+      }
+      // Only the event-level trees are handed over through the pipeline:
+      std::map< Int_t, std::vector< STree > >::const_iterator t_itr =
+         id.GetTrees().begin();
+      std::map< Int_t, std::vector< STree > >::const_iterator t_end =
+         id.GetTrees().end();
+      for( ; t_itr != t_end; ++t_itr ) {
+         for( std::vector< STree >::const_iterator st = t_itr->second.begin();
+              st != t_itr->second.end(); ++st ) {
+            if( ( st->type & STree::INPUT_TREE ) &&
+                ( ! ( st->type & STree::EVENT_TREE ) ) ) {
+               inputs.clear();
+               return kFALSE;
+            }
+         }
+      }
+      inputs.push_back( std::vector< size_t >() );
+      std::vector< SFile >::const_iterator f_itr = id.GetSFileIn().begin();
+      std::vector< SFile >::const_iterator f_end = id.GetSFileIn().end();
+      for( ; f_itr != f_end; ++f_itr ) {
+         if( ( nextOutput >= outputs.size() ) ||
+             ( NormaliseFileName( f_itr->file ) != outputs[ nextOutput ] ) ) {
+            inputs.clear();
+            return kFALSE;
+         }
+         inputs.back().push_back( nextOutput );
+         ++nextOutput;
+      }
+   }
+   if( nextOutput != outputs.size() ) {
+      inputs.clear();
+      return kFALSE;
+   }
+
+   return kTRUE;
+}
+
+/**
+ * This function executes the current and the next cycle as a pipeline. The
+ * current (upstream) cycle is executed on the main thread. Every event that
+ * it writes into its output trees is put into an in-memory chunk of
+ * PipelineChunkSize events, which is handed over to the next (downstream)
+ * cycle as soon as it's full. The downstream cycle processes the chunks on
+ * a separate thread, while the upstream cycle is already busy with the next
+ * events.
+ *
+ * The upstream cycle doesn't write its output ntuples to disk, unless
+ * PipelineWriteIntermediate is set in the configuration. Its histograms and
+ * other output objects are still written into its output files.
+ *
+ * The queue between the two cycles only holds a limited number of chunks
+ * (PipelineDepth in the configuration), so the upstream cycle waits for the
+ * downstream one if needed. This way at most PipelineDepth + 2 chunks of
+ * events are kept in memory at any time.
+ *
+ * If either cycle fails, or the upstream cycle stops early, the input data
+ * blocks of the downstream cycle that could not be processed completely
+ * don't write any output.
+ *
+ * @param inputs The indices of the output files of the upstream cycle read
+ *               by each input data block of the downstream cycle
+ */
+void SCycleController::
+ExecutePipelinedCycles( const std::vector< std::vector< size_t > >& inputs ) {
+
+#if ROOT_VERSION_CODE < ROOT_VERSION( 6, 6, 0 )
+   throw SError( "Pipelined cycles are only available with ROOT >= 6.06",
+                 SError::SkipCycle );
+#else
+   //
+   // Measure the total time needed for the cycles:
+   //
+   TStopwatch timer;
+   timer.Start();
+
+   // Make sure that ROOT protects its global state:
+   ROOT::EnableThreadSafety();
+
+   //
+   // Prepare the configuration of the cycles. The input files of the
+   // downstream cycle don't exist, so they can't be validated.
+   //
+   ISCycleBase* upstream = m_analysisCycles.at( m_curCycle );
+   ISCycleBase* downstream = m_analysisCycles.at( m_curCycle + 1 );
+   SCycleConfig upConfig = upstream->GetConfig();
+   this->PrepareConfig( upstream, upConfig );
+   SCycleConfig downConfig = downstream->GetConfig();
+   this->PrepareConfig( downstream, downConfig, kFALSE );
+
+   m_logger << INFO << "Executing Cycle #" << m_curCycle << " ('"
+            << upstream->GetName() << "') and Cycle #" << ( m_curCycle + 1 )
+            << " ('" << downstream->GetName() << "') as a pipeline"
+            << SLogger::endmsg;
+
+   //
+   // Count how many input data blocks of the upstream cycle write each of
+   // its output files:
+   //
+   std::vector< size_t > groupSizes;
+   const SCycleConfig::id_type& ids = upConfig.GetInputData();
+   for( size_t i = 0; i < ids.size(); ++i ) {
+      if( ( i == 0 ) || ( ids[ i ].GetType() != ids[ i - 1 ].GetType() ) ||
+          ( ids[ i ].GetVersion() != ids[ i - 1 ].GetVersion() ) ) {
+         groupSizes.push_back( 0 );
+      }
+      ++groupSizes.back();
+   }
+
+   // Statistics of the processing by the two cycles:
+   SCycleStatistics upStats, downStats;
+
+   // The objects produced by the downstream cycle for its input data blocks:
+   std::vector< TList* > downOutputs( downConfig.GetInputData().size(), 0 );
+
+   //
+   // The begin cycle functions have to be called here by hand:
+   //
+   upstream->BeginCycle();
+   downstream->BeginCycle();
+
+   //
+   // Start the downstream cycle:
+   //
+   SPipelineQueue queue( m_pipelineDepth, m_pipelineChunkSize,
+                         m_pipelineWriteIntermediate );
+   std::exception_ptr failure;
+   std::thread consumer( [ this, downstream, &downConfig, &inputs,
+                           &groupSizes, &queue, &downOutputs, &failure ]() {
+         try {
+            ConsumePipeline( downstream, downConfig, inputs, groupSizes,
+                             queue, downOutputs );
+         } catch( ... ) {
+            failure = std::current_exception();
+            queue.Abort();
+         }
+      } );
+
+   //
+   // Execute the upstream cycle on all of its input data blocks. The end of
+   // every block is marked in the queue, even if the upstream cycle skipped
+   // the block.
+   //
+   try {
+      Bool_t proceed = kTRUE;
+      for( size_t i = 0; ( i < ids.size() ) && proceed; ++i ) {
+
+         const Bool_t updateOutput =
+            ( ( i != 0 ) && ( ids[ i ].GetType() == ids[ i - 1 ].GetType() ) &&
+              ( ids[ i ].GetVersion() == ids[ i - 1 ].GetVersion() ) );
+
+         proceed = ExecuteInputData( upstream, upConfig, &ids[ i ],
+                                     updateOutput, upStats, &queue );
+         if( ! queue.Push( 0 ) ) {
+            break;
+         }
+      }
+   } catch( ... ) {
+      queue.Abort();
+      consumer.join();
+      for( size_t i = 0; i < downOutputs.size(); ++i ) {
+         delete downOutputs[ i ];
+      }
+      // The upstream cycle fails when the downstream one stops, so report
+      // the original problem if there was one:
+      if( failure ) {
+         std::rethrow_exception( failure );
+      }
+      throw;
+   }
+
+   //
+   // Wait for the downstream cycle to finish, and write the output of the
+   // input data blocks that it processed completely:
+   //
+   queue.Close();
+   consumer.join();
+   const SCycleConfig::id_type& downIds = downConfig.GetInputData();
+   for( size_t i = 0; i < downOutputs.size(); ++i ) {
+      if( downOutputs[ i ] ) {
+         const Bool_t updateOutput =
+            ( ( i != 0 ) &&
+              ( downIds[ i ].GetType() == downIds[ i - 1 ].GetType() ) &&
+              ( downIds[ i ].GetVersion() == downIds[ i - 1 ].GetVersion() ) );
+         FinishInputData( downstream, downConfig, downIds[ i ],
+                          downOutputs[ i ], updateOutput, downStats );
+      }
+      delete downOutputs[ i ];
+   }
+   if( failure ) {
+      std::rethrow_exception( failure );
+   }
+
+   //
+   // The end cycle functions have to be called here by hand:
+   //
+   upstream->EndCycle();
+   downstream->EndCycle();
+
+   // The cycle processing is done at this point:
+   timer.Stop();
+
+   // Print some final statistics about the cycles:
+   m_logger << INFO << "Cycle '" << upstream->GetName() << "':"
+            << SLogger::endmsg;
+   this->PrintCycleStatistics( upStats, timer );
+   m_logger << INFO << "Cycle '" << downstream->GetName() << "':"
+            << SLogger::endmsg;
+   this->PrintCycleStatistics( downStats, timer );
+
+   m_curCycle += 2;
+   return;
+#endif // ROOT_VERSION
+}
+
+/**
+ * This function runs on a separate thread, and executes the downstream cycle
+ * of a pipeline on the chunks of events produced by the upstream cycle.
+ * Each input data block of the cycle processes the chunks belonging to the
+ * upstream output files that it was configured to read.
+ *
+ * The output of the cycle is written by the main thread, once the pipeline
+ * finished. This way the function doesn't need to use any of the (not
+ * thread-safe) members of the controller. An input data block only provides
+ * its output if all of its events were received.
+ *
+ * @param cycle The downstream cycle
+ * @param config The configuration of the downstream cycle
+ * @param inputs The indices of the upstream output files read by each input
+ *               data block of the cycle
+ * @param groupSizes The number of upstream input data blocks making up each
+ *                   upstream output file
+ * @param queue The queue delivering the chunks of events
+ * @param outputs The objects produced for each input data block (output)
+ */
+void SCycleController::
+ConsumePipeline( ISCycleBase* cycle, SCycleConfig& config,
+                 const std::vector< std::vector< size_t > >& inputs,
+                 const std::vector< size_t >& groupSizes,
+                 SPipelineQueue& queue, std::vector< TList* >& outputs ) {
+
+   SLogger logger( "SCyclePipeline" );
+
+   const TList& configList = cycle->GetConfigurationObjects();
+   const SCycleConfig::id_type& ids = config.GetInputData();
+   for( size_t i = 0; i < ids.size(); ++i ) {
+
+      // Let the user know what's happening:
+      const char* treeName = GetMainTreeName( ids[ i ] );
+      logger << INFO << "Processing input data type: " << ids[ i ].GetType()
+             << " version: " << ids[ i ].GetVersion()
+             << " from the pipeline" << SLogger::endmsg;
+
+      //
+      // Give the configuration to the cycle by hand:
+      //
+      SInputData inputData = ids[ i ];
+      inputData.SetName( SFrame::CurrentInputDataName );
+      TList list;
+      list.Add( &config );
+      list.Add( &inputData );
+      for( Int_t j = 0; j < configList.GetSize(); ++j ) {
+         list.Add( configList.At( j ) );
+      }
+      cycle->SetInputList( &list );
+      cycle->Begin( 0 );
+
+      //
+      // Process the chunks belonging to this input data block. Each upstream
+      // input data block ends with a null pointer in the queue. A chunk is
+      // only deleted once the cycle moved on to the next one.
+      //
+      SCycleWorker worker( cycle, &list );
+      worker.Begin( 0, kFALSE );
+      TFile* previous = 0;
+      TFile* file = 0;
+      Bool_t warned = kFALSE;
+      try {
+         for( size_t j = 0; j < inputs[ i ].size(); ++j ) {
+            for( size_t k = 0; k < groupSizes[ inputs[ i ][ j ] ]; ++k ) {
+               while( kTRUE ) {
+                  if( ! queue.Pop( file ) ) {
+                     throw SError( "The upstream cycle stopped before "
+                                   "providing all events of input data "
+                                   "type: " + ids[ i ].GetType() +
+                                   " version: " + ids[ i ].GetVersion(),
+                                   SError::SkipCycle );
+                  }
+                  if( ! file ) break;
+                  TTree* tree =
+                     dynamic_cast< TTree* >( file->Get( treeName ) );
+                  if( tree ) {
+                     worker.ProcessTree( tree );
+                     delete previous;
+                     previous = file;
+                  } else {
+                     if( ! warned ) {
+                        logger << WARNING << "Tree \"" << treeName
+                               << "\" not received from the upstream cycle"
+                               << SLogger::endmsg;
+                        warned = kTRUE;
+                     }
+                     delete file;
+                  }
+                  file = 0;
                }
             }
+         }
+         worker.Terminate();
+      } catch( ... ) {
+         delete file;
+         delete previous;
+         throw;
+      }
+      delete previous;
+      cycle->Terminate();
+
+      //
+      // Take the produced objects from the cycle:
+      //
+      outputs[ i ] = new TList();
+      TIter next( cycle->GetOutputList() );
+      TObject* obj = 0;
+      while( ( obj = next() ) ) {
+         outputs[ i ]->Add( obj );
+      }
+      cycle->GetOutputList()->Clear();
+   }
+
+   return;
+}
+
+/**
+ * This function executes the cycle on a group of input data blocks that have
+ * the same type and version. The first block of the group creates a new
+ * output file, while the others update it.
+ *
+ * @param cycle The cycle to execute
+ * @param config The configuration of the cycle
+ * @param group The input data blocks to process
+ * @param stats The statistics of the processing (incremented)
+ * @returns <code>kFALSE</code> if the execution of the cycle should be
+ *          stopped, <code>kTRUE</code> otherwise
+ */
+Bool_t SCycleController::ExecuteInputDataGroup( ISCycleBase* cycle,
+                                                SCycleConfig& config,
+                                                const id_group_type& group,
+                                                SCycleStatistics& stats ) {
+
+   for( size_t i = 0; i < group.size(); ++i ) {
+
+      // Decide how to write the output file at the end of processing this
+      // InputData:
+      const Bool_t updateOutput = ( i != 0 );
+      if( updateOutput ) {
+         REPORT_VERBOSE( "Output file will be updated for ID type: "
+                         << group[ i ]->GetType() );
+      } else {
+         REPORT_VERBOSE( "New output file will be opened for ID type: "
+                         << group[ i ]->GetType() );
+      }
+
+      // Process the input data block:
+      if( ! ExecuteInputData( cycle, config, group[ i ], updateOutput,
+                              stats ) ) {
+         return kFALSE;
+      }
+   }
+
+   return kTRUE;
+}
+
+/**
+ * This function executes the cycle on multiple groups of input data blocks
+ * concurrently. Each group is processed by a child process forked from the
+ * current one, so the groups can't interfere with each other. Since all
+ * groups write their own output file, and the blocks within a group are
+ * still processed one after the other, the output files are the same as the
+ * ones created by processing the groups one by one.
+ *
+ * Note that the cycle object of this process doesn't see any of the changes
+ * happening to the cycle objects of the children during the processing.
+ *
+ * @param cycle The cycle to execute
+ * @param config The configuration of the cycle
+ * @param groups The input data groups to process
+ * @param nConcurrent The maximum number of groups to process at the same time
+ * @param stats The statistics of the processing (incremented)
+ */
+void SCycleController::ExecuteConcurrently( ISCycleBase* cycle,
+                                            SCycleConfig& config,
+                                            const std::vector< id_group_type >&
+                                            groups,
+                                            Int_t nConcurrent,
+                                            SCycleStatistics& stats ) {
+
+   m_logger << INFO << "Processing " << groups.size() << " InputData groups, "
+            << nConcurrent << " at a time" << SLogger::endmsg;
+
+   // Make sure that the children don't print anything still buffered in
+   // this process:
+   std::cout.flush();
+   fflush( stdout );
+   fflush( stderr );
+
+   // The running children, and the pipes to read their results from:
+   std::map< pid_t, int > running;
+   // The monitors counting the events processed by the running children:
+   std::map< pid_t, std::vector< SProgressMonitor* > > monitors;
+   size_t nextGroup = 0;
+   Bool_t stop = kFALSE, failed = kFALSE;
+
+   while( ( ( ! stop ) && ( nextGroup < groups.size() ) ) ||
+          running.size() ) {
+
+      //
+      // Start new children while there are free slots:
+      //
+      while( ( ! stop ) && ( nextGroup < groups.size() ) &&
+             ( running.size() < static_cast< size_t >( nConcurrent ) ) ) {
+
+         // The events processed by the child are counted in shared memory,
+         // so that the metrics exported by this process would include them.
+         // (See CreateChildMonitor(...).)
+         const id_group_type& group = groups[ nextGroup ];
+         std::vector< SProgressMonitor* > groupMonitors;
+         Bool_t ready = kTRUE;
+         try {
+            for( size_t i = 0; i < group.size(); ++i ) {
+               groupMonitors.push_back(
+                  new SProgressMonitor( cycle->GetName(), *group[ i ], -1,
+                                        0.0, INFO, "", kTRUE ) );
+               m_parentMonitors[ group[ i ] ] = groupMonitors.back();
+            }
+         } catch( const SError& error ) {
+            REPORT_ERROR( error.what() );
+            ready = kFALSE;
+         }
+
+         int fd[ 2 ];
+         if( ready && pipe( fd ) ) {
+            REPORT_ERROR( "Couldn't create pipe for child process: "
+                          << strerror( errno ) );
+            ready = kFALSE;
+         }
+         pid_t pid = -1;
+         if( ready ) {
+            pid = fork();
+            if( pid < 0 ) {
+               REPORT_ERROR( "Couldn't fork child process: "
+                             << strerror( errno ) );
+               close( fd[ 0 ] );
+               close( fd[ 1 ] );
+            }
+         }
+         if( pid < 0 ) {
+            for( size_t i = 0; i < groupMonitors.size(); ++i ) {
+               m_parentMonitors.erase( group[ i ] );
+               delete groupMonitors[ i ];
+            }
+            stop = kTRUE;
+            failed = kTRUE;
+            break;
+         }
+
+         if( pid == 0 ) {
+
+            //
+            // This is the child process. Process the group, send the
+            // statistics to the parent, and exit without running any of the
+            // cleanup of the parent process.
+            //
+            close( fd[ 0 ] );
+            for( std::map< pid_t, int >::const_iterator itr = running.begin();
+                 itr != running.end(); ++itr ) {
+               close( itr->second );
+            }
+            SCycleStatistics childStats;
+            Long64_t proceed = 1;
+            int status = 0;
+            try {
+               proceed = ExecuteInputDataGroup( cycle, config,
+                                                groups[ nextGroup ],
+                                                childStats );
+            } catch( const SError& error ) {
+               REPORT_FATAL( "Exception caught in child process with "
+                             "message: " << error.what() );
+               status = 1;
+            } catch( const std::exception& error ) {
+               REPORT_FATAL( "STL exception caught in child process with "
+                             "message: " << error.what() );
+               status = 1;
+            } catch( ... ) {
+               // Nothing may unwind the child into the parent's code path:
+               REPORT_FATAL( "Unknown exception caught in child process" );
+               status = 1;
+            }
+            TBufferFile buffer( TBuffer::kWrite );
+            buffer.WriteObject( &childStats );
+            const Long64_t size = buffer.Length();
+            if( ( ! WriteAll( fd[ 1 ],
+                              reinterpret_cast< const char* >( &proceed ),
+                              sizeof( proceed ) ) ) ||
+                ( ! WriteAll( fd[ 1 ], reinterpret_cast< const char* >( &size ),
+                              sizeof( size ) ) ) ||
+                ( ! WriteAll( fd[ 1 ], buffer.Buffer(), size ) ) ) {
+               status = 1;
+            }
+            close( fd[ 1 ] );
+            std::cout.flush();
+            fflush( stdout );
+            _exit( status );
+         }
+
+         // This is the parent process:
+         close( fd[ 1 ] );
+         running[ pid ] = fd[ 0 ];
+         monitors[ pid ] = groupMonitors;
+         for( size_t i = 0; i < group.size(); ++i ) {
+            m_parentMonitors.erase( group[ i ] );
+         }
+         ++nextGroup;
+      }
+      if( running.empty() ) break;
+
+      //
+      // Wait for one of the children to finish:
+      //
+      int status = 0;
+      const pid_t pid = waitpid( -1, &status, 0 );
+      if( pid < 0 ) {
+         if( errno == EINTR ) continue;
+         REPORT_ERROR( "Failed waiting for the child processes: "
+                       << strerror( errno ) );
+         failed = kTRUE;
+         break;
+      }
+      std::map< pid_t, int >::iterator child = running.find( pid );
+      if( child == running.end() ) continue;
+
+      // Collect its results:
+      Long64_t proceed = 1, size = 0;
+      SCycleStatistics* childStats = 0;
+      if( ReadAll( child->second, reinterpret_cast< char* >( &proceed ),
+                   sizeof( proceed ) ) &&
+          ReadAll( child->second, reinterpret_cast< char* >( &size ),
+                   sizeof( size ) ) && ( size > 0 ) ) {
+         char* data = new char[ size ];
+         if( ReadAll( child->second, data, size ) ) {
+            // The buffer object takes ownership of the data:
+            TBufferFile buffer( TBuffer::kRead, size, data, kTRUE );
+            childStats = dynamic_cast< SCycleStatistics* >(
+               buffer.ReadObject( SCycleStatistics::Class() ) );
+         } else {
+            delete[] data;
+         }
+      }
+      close( child->second );
+      running.erase( child );
+      std::vector< SProgressMonitor* >& childMonitors = monitors[ pid ];
+      for( size_t i = 0; i < childMonitors.size(); ++i ) {
+         delete childMonitors[ i ];
+      }
+      monitors.erase( pid );
+      if( ( ! childStats ) || ( ! WIFEXITED( status ) ) ||
+          WEXITSTATUS( status ) ) {
+         REPORT_ERROR( "Child process " << pid << " failed" );
+         delete childStats;
+         failed = kTRUE;
+         continue;
+      }
+      stats.Add( *childStats );
+      delete childStats;
+      if( ! proceed ) stop = kTRUE;
+   }
+
+   // Delete the monitors of the children that were not waited for:
+   std::map< pid_t, std::vector< SProgressMonitor* > >::iterator itr;
+   for( itr = monitors.begin(); itr != monitors.end(); ++itr ) {
+      for( size_t i = 0; i < itr->second.size(); ++i ) {
+         delete itr->second[ i ];
+      }
+   }
+
+   if( failed ) {
+      throw SError( "Failed to process some of the InputData groups",
+                    SError::SkipCycle );
+   }
+
+   return;
+}
+
+/**
+ * In a child process forked by ExecuteConcurrently(...), the events are
+ * counted in memory shared with the parent process, so that the metrics
+ * exported by the parent would include them. The monitor created here
+ * reports the progress of the child just like the own monitor of the cycle
+ * would, but it counts the events in the counters of the parent's monitor.
+ *
+ * @param cycle The cycle to execute
+ * @param config The configuration of the cycle
+ * @param id The input data block to process
+ * @returns The monitor to give to the cycle, or a null pointer when not
+ *          running in such a child process
+ */
+SProgressMonitor*
+SCycleController::CreateChildMonitor( ISCycleBase* cycle,
+                                      const SCycleConfig& config,
+                                      const SInputData* id ) const {
+
+   std::map< const SInputData*, SProgressMonitor* >::const_iterator parent =
+      m_parentMonitors.find( id );
+   if( parent == m_parentMonitors.end() ) {
+      return 0;
+   }
+
+   Long64_t totalEvents = id->GetEventsTotal();
+   if( ( id->GetNEventsMax() >= 0 ) &&
+       ( ( totalEvents < 0 ) || ( id->GetNEventsMax() < totalEvents ) ) ) {
+      totalEvents = id->GetNEventsMax();
+   }
+   return new SProgressMonitor( cycle->GetName(), *id, totalEvents,
+                                config.GetProgressInterval(), INFO,
+                                config.GetProgressFile(), kFALSE,
+                                parent->second );
+}
+
+/**
+ * This function executes the cycle on one input data block, and writes the
+ * output of the processing into the output file belonging to the block.
+ *
+ * @param cycle The cycle to execute
+ * @param config The configuration of the cycle
+ * @param id The input data block to process
+ * @param updateOutput Flag deciding if the output file should be updated or
+ *                     overwritten
+ * @param stats The statistics of the processing (incremented)
+ * @param pipeline The queue to hand the written events over to a pipelined
+ *                 downstream cycle through (LOCAL mode only)
+ * @returns <code>kFALSE</code> if the execution of the cycle should be
+ *          stopped, <code>kTRUE</code> otherwise
+ */
+Bool_t SCycleController::ExecuteInputData( ISCycleBase* cycle,
+                                           SCycleConfig& config,
+                                           const SInputData* id,
+                                           Bool_t updateOutput,
+                                           SCycleStatistics& stats,
+                                           SPipelineQueue* pipeline ) {
+
+   //
+   // Each input data has to have at least one input tree:
+   //
+   if( ! id->HasInputTrees() ) {
+      REPORT_ERROR( "No input trees defined in input data "
+                    << id->GetType() );
+      REPORT_ERROR( "Skipping it from processing" );
+      return kTRUE;
+   }
+
+   // Find the first event-level input tree in the configuration:
+   REPORT_VERBOSE( "Finding the name of the main event-level input "
+                   "TTree..." );
+   const char* treeName = GetMainTreeName( *id );
+   if( ! treeName ) {
+      REPORT_ERROR( "Can't determine input TTree name for input data "
+                    << id->GetType() );
+      REPORT_ERROR( "Skipping it from processing" );
+      return kTRUE;
+   } else {
+      REPORT_VERBOSE( "The name of the main event-level input TTree is: "
+                      << treeName );
+   }
+
+   // Let the user know what's happening:
+   m_logger << INFO << "Processing input data type: " << id->GetType()
+            << " version: " << id->GetVersion() << SLogger::endmsg;
+
+   //
+   // Create a copy of the input data configuration, so that it can be
+   // given to PROOF:
+   //
+   SInputData inputData = *id;
+   inputData.SetName( SFrame::CurrentInputDataName );
+
+   //
+   // Retrieve the configuration object list from the cycle:
+   //
+   const TList& configList = cycle->GetConfigurationObjects();
+
+   //
+   // Calculate how many events to process:
+   //
+   const Long64_t evmax = ( id->GetNEventsMax() == -1 ?
+                            std::numeric_limits< Long64_t >::max() :
+                            id->GetNEventsMax() );
+
+   // This will point to the created output objects:
+   TList* outputs = 0;
+
+   //
+   // The cycle can be run in two modes:
+   //
+   if( config.GetRunMode() == SCycleConfig::LOCAL ) {
+
+      if( id->GetDataSets().size() ) {
+         REPORT_ERROR( "Can't use DataSet-s as input in LOCAL mode!" );
+         REPORT_ERROR( "Skipping InputData type: " << id->GetType()
+                       << " version: " << id->GetVersion() );
+         return kTRUE;
+      }
+
+      //
+      // Create a chain with all the specified input files:
+      //
+      REPORT_VERBOSE( "Creating TChain to run the cycle on..." );
+      TChain chain( treeName );
+      AddInputFiles( chain, *id );
+      ConfigureTreeCache( chain, config );
+
+      //
+      // Give the configuration to the cycle by hand:
+      //
+      TList list;
+      list.Add( &config );
+      list.Add( &inputData );
+      if( pipeline ) {
+         list.Add( pipeline );
+      }
+      for( Int_t i = 0; i < configList.GetSize(); ++i ) {
+         list.Add( configList.At( i ) );
+      }
+      SProgressMonitor* monitor = CreateChildMonitor( cycle, config, id );
+      if( monitor ) {
+         list.Add( monitor );
+      }
+      cycle->SetInputList( &list );
+
+      //
+      // Run the cycle. When it processes blocks of events, the event loop
+      // is driven by SCycleWorker instead of TTreePlayer, so that the cycle
+      // would receive whole clusters at a time. The same is done when the
+      // input files should be prefetched, so that the prefetcher would see
+      // the chain moving to each new input file.
+      //
+      if( cycle->ProcessesEventBatches() ||
+          config.GetPrefetchInputFiles() ) {
+         Long64_t firstEntry = 0;
+         const Long64_t nEntries = GetEntryRange( chain, *id, evmax,
+                                                  firstEntry );
+         cycle->Begin( &chain );
+         SCycleWorker worker( cycle, &list );
+         worker.Begin( &chain );
+         worker.ProcessRange( firstEntry, firstEntry + nEntries );
+         worker.Terminate();
+         cycle->Terminate();
+      } else {
+         chain.Process( cycle, "", evmax, id->GetNEventsSkip() );
+      }
+      delete monitor;
+
+      // Get the output objects from the cycle:
+      outputs = cycle->GetOutputList();
+
+   } else if( config.GetRunMode() == SCycleConfig::THREADS ) {
+
+      if( id->GetDataSets().size() ) {
+         REPORT_ERROR( "Can't use DataSet-s as input in THREADS mode!" );
+         REPORT_ERROR( "Skipping InputData type: " << id->GetType()
+                       << " version: " << id->GetVersion() );
+         return kTRUE;
+      }
+
+      //
+      // Collect the configuration for the cycle instances:
+      //
+      TList list;
+      list.Add( &config );
+      list.Add( &inputData );
+      for( Int_t i = 0; i < configList.GetSize(); ++i ) {
+         list.Add( configList.At( i ) );
+      }
+
+      SProgressMonitor* monitor = CreateChildMonitor( cycle, config, id );
+      if( monitor ) {
+         list.Add( monitor );
+      }
+
+      //
+      // Run the cycle, and collect the merged output objects:
+      //
+      outputs = ProcessThreads( cycle, list, inputData, treeName, evmax );
+      delete monitor;
+
+   } else if( config.GetRunMode() == SCycleConfig::PROCESSES ) {
+
+      if( id->GetDataSets().size() ) {
+         REPORT_ERROR( "Can't use DataSet-s as input in PROCESSES mode!" );
+         REPORT_ERROR( "Skipping InputData type: " << id->GetType()
+                       << " version: " << id->GetVersion() );
+         return kTRUE;
+      }
+
+      //
+      // Collect the configuration for the cycle:
+      //
+      TList list;
+      list.Add( &config );
+      list.Add( &inputData );
+      for( Int_t i = 0; i < configList.GetSize(); ++i ) {
+         list.Add( configList.At( i ) );
+      }
+
+      SProgressMonitor* monitor = CreateChildMonitor( cycle, config, id );
+      if( monitor ) {
+         list.Add( monitor );
+      }
+
+      //
+      // Run the cycle, and collect the merged output objects:
+      //
+      outputs = ProcessForked( cycle, list, inputData, treeName, evmax );
+      delete monitor;
+
+   } else if( config.GetRunMode() == SCycleConfig::PROOF ) {
+
+      //
+      // Check that the PROOF server is available and ready. For instance
+      // it's not a good idea to send a job to a server that crashed on the
+      // previous input data...
+      //
+      if( ! m_proof->IsValid() ) {
+         REPORT_ERROR( "PROOF server doesn't seem to be available: "
+                       << m_proof->GetManager()->GetUrl() );
+         REPORT_ERROR( "Aborting execution of cycle!" );
+         return kFALSE;
+      }
+
+      // This object describes how to create the temporary PROOF output
+      // files in the cycles:
+      TNamed proofOutputFile( TString( SFrame::ProofOutputName ),
+                              ( config.GetProofWorkDir() == "" ? "./" :
+                                config.GetProofWorkDir() + "/" ) +
+                              cycle->GetName() + "-" + inputData.GetType() +
+                              "-" + inputData.GetVersion() +
+                              "-TempNTuple.root" );
+
+      //
+      // Clear the query results from memory (Thanks to Gerri!):
+      //
+      if( m_proof->GetQueryResults() ) {
+         m_proof->GetQueryResults()->SetOwner( kTRUE );
+         m_proof->GetQueryResults()->Clear();
+         m_proof->GetQueryResults()->SetOwner( kFALSE );
+      }
+
+      //
+      // Give the configuration to PROOF, and tweak it a little:
+      //
+      m_proof->ClearInput();
+      // Only output a maximum of 10 messages per node about memory usage per
+      // query:
+      const Long64_t eventsPerNode = ( inputData.GetEventsTotal() /
+                                       m_proof->GetParallel() );
+      m_proof->SetParameter( "PROOF_MemLogFreq",
+                             ( Long64_t ) ( eventsPerNode > 10000 ?
+                                            ( eventsPerNode / 10 ) :
+                                            1000 ) );
+      // Make sure that we can use as many workers per node as we want:
+      m_proof->SetParameter( "PROOF_MaxSlavesPerNode", ( Long_t ) 9999999 );
+      // Configure the usage of TTreeCache on the cluster:
+      if( config.GetUseTreeCache() ) {
+         m_proof->SetParameter( "PROOF_UseTreeCache", ( Int_t ) 1 );
+      }
+      m_proof->SetParameter( "PROOF_CacheSize", config.GetCacheSize() );
+      // Configure whether the workers are allowed to read each others'
+      // files:
+      if( config.GetProcessOnlyLocal() ) {
+         m_proof->SetParameter( "PROOF_ForceLocal", ( Int_t ) 1 );
+      }
+      // Turn off file lookup if the configuration asks for this feature:
+      if( inputData.GetSkipLookup() ) {
+         m_proof->SetParameter( "PROOF_LookupOpt", "none" );
+      }
+
+      // Add the "input objects" to PROOF:
+      m_proof->AddInput( &config );
+      m_proof->AddInput( &inputData );
+      m_proof->AddInput( &proofOutputFile );
+      for( Int_t i = 0; i < configList.GetSize(); ++i ) {
+         m_proof->AddInput( configList.At( i ) );
+      }
+
+      if( id->GetDataSets().size() ) {
+
+         // Merge the dataset names in the way that PROOF expects them. This
+         // is "<dataset 1>|<dataset 2>|...". Note that this only works in
+         // ROOT versions newer than 5.27/02, but SInputData should take care
+         // about removing multiple datasets when using an "old" ROOT
+         // release.
+         TString dsets = "";
+         std::vector< SDataSet >::const_iterator ds_itr =
+            id->GetDataSets().begin();
+         std::vector< SDataSet >::const_iterator ds_end =
+            id->GetDataSets().end();
+         for( ; ds_itr != ds_end; ++ds_itr ) {
+            if( ds_itr != id->GetDataSets().begin() ) {
+               dsets += "|";
+            }
+            dsets += ds_itr->name + "#" + treeName;
+         }
+
+         // Process the events:
+         if( m_proof->Process( dsets, cycle->GetName(), "", evmax,
+                               id->GetNEventsSkip() ) == -1 ) {
+            REPORT_ERROR( "There was an error processing:" );
+            REPORT_ERROR( "  Cycle      = " << cycle->GetName() );
+            REPORT_ERROR( "  ID type    = " << inputData.GetType() );
+            REPORT_ERROR( "  ID version = " << inputData.GetVersion() );
+            REPORT_ERROR( "Stopping the execution of this cycle!" );
+            return kFALSE;
+         }
+
+      } else if( id->GetSFileIn().size() ) {
+
+         //
+         // Check if the validation was skipped. If it was, then the
+         // SInputData objects didn't create a TDSet object of its own. So we
+         // have to create a simple one here. Otherwise just use the TDSet
+         // created by SInputData.
+         //
+         if( id->GetSkipValid() ) {
+
+            // Create the dataset object first:
+            TChain chain( treeName );
+            std::vector< SFile >::const_iterator file_itr =
+               id->GetSFileIn().begin();
+            std::vector< SFile >::const_iterator file_end =
+               id->GetSFileIn().end();
+            for( ; file_itr != file_end; ++file_itr ) {
+               chain.Add( file_itr->file );
+            }
+            TDSet set( chain );
+
+            // Process the events:
+            if( m_proof->Process( &set, cycle->GetName(), "", evmax,
+                                  id->GetNEventsSkip() ) == -1 ) {
+               REPORT_ERROR( "There was an error processing:" );
+               REPORT_ERROR( "  Cycle      = " << cycle->GetName() );
+               REPORT_ERROR( "  ID type    = " << inputData.GetType() );
+               REPORT_ERROR( "  ID version = " << inputData.GetVersion() );
+               REPORT_ERROR( "Stopping the execution of this cycle!" );
+               return kFALSE;
+            }
 
          } else {
-            REPORT_ERROR( "Nothing was executed using PROOF!" );
+
+            //
+            // Run the cycle on PROOF. Unfortunately the checking of the
+            // "successfullness" of the PROOF job is not working too well...
+            // Even after a *lot* of error messages the TProof::Process(...)
+            // command can still return a success code, which can lead to
+            // nasty crashes...
+            //
+            if( m_proof->Process( id->GetDSet(), cycle->GetName(), "", evmax,
+                                  id->GetNEventsSkip() ) == -1 ) {
+               REPORT_ERROR( "There was an error processing:" );
+               REPORT_ERROR( "  Cycle      = " << cycle->GetName() );
+               REPORT_ERROR( "  ID type    = " << inputData.GetType() );
+               REPORT_ERROR( "  ID version = " << inputData.GetVersion() );
+               REPORT_ERROR( "Stopping the execution of this cycle!" );
+               return kFALSE;
+            }
          }
 
-         // The missing file accounting only started in ROOT 5.28 as far as I
-         // can tell:
+      } else {
+         REPORT_ERROR( "Nothing was executed using PROOF!" );
+      }
+
+      // The missing file accounting only started in ROOT 5.28 as far as I
+      // can tell:
 #if ROOT_VERSION_CODE >= ROOT_VERSION( 5, 28, 00 )
-         // Only do this for non-Lite PROOF:
-         if( ! m_proof->IsLite() ) {
-            // Get the list of missing files:
-            TFileCollection* missing = m_proof->GetMissingFiles();
-            if( missing ) {
-               // Get the list of files:
-               THashList* flist = missing->GetList();
-               if( flist->GetEntries() ) {
-                  m_logger << WARNING
-                           << "The following files were not processed:"
-                           << SLogger::endmsg;
-                  for( Int_t i = 0; i < flist->GetEntries(); ++i ) {
-                     TFileInfo* finfo =
-                        dynamic_cast< TFileInfo* >( flist->At( i ) );
-                     if( ! finfo ) {
-                        REPORT_ERROR( "Missing file list not in the expected "
-                                      "format" );
-                        continue;
-                     }
-                     m_logger << WARNING << "    "
-                              << finfo->GetCurrentUrl()->GetUrl()
-                              << SLogger::endmsg;
+      // Only do this for non-Lite PROOF:
+      if( ! m_proof->IsLite() ) {
+         // Get the list of missing files:
+         TFileCollection* missing = m_proof->GetMissingFiles();
+         if( missing ) {
+            // Get the list of files:
+            THashList* flist = missing->GetList();
+            if( flist->GetEntries() ) {
+               m_logger << WARNING
+                        << "The following files were not processed:"
+                        << SLogger::endmsg;
+               for( Int_t i = 0; i < flist->GetEntries(); ++i ) {
+                  TFileInfo* finfo =
+                     dynamic_cast< TFileInfo* >( flist->At( i ) );
+                  if( ! finfo ) {
+                     REPORT_ERROR( "Missing file list not in the expected "
+                                   "format" );
+                     continue;
                   }
+                  m_logger << WARNING << "    "
+                           << finfo->GetCurrentUrl()->GetUrl()
+                           << SLogger::endmsg;
                }
-               // Remove the object:
-               delete missing;
-               missing = 0;
             }
+            // Remove the object:
+            delete missing;
+            missing = 0;
          }
+      }
 #endif // ROOT_VERSION( 5, 28, 00 )
 
-         // Get the output objects from PROOF:
-         outputs = m_proof->GetOutputList();
-
-      } else {
-         throw SError( "Running mode not recognised!", SError::SkipCycle );
-      }
+      // Get the output objects from PROOF:
+      outputs = m_proof->GetOutputList();
 
-      // Check that the cycle output is available:
-      if( ! outputs ) {
-         REPORT_ERROR( "Cycle output could not be retrieved." );
-         REPORT_ERROR( "NOT writing the output of cycle \""
-                       << cycle->GetName() << "\", ID \"" << inputData.GetType()
-                       << "\", Version \"" << inputData.GetVersion() << "\"" );
-         continue;
-      }
+   } else {
+      throw SError( "Running mode not recognised!", SError::SkipCycle );
+   }
 
-      //
-      // Collect the statistics from this input data:
-      //
-      TObject* tstat = outputs->FindObject( SFrame::RunStatisticsName );
-      SCycleStatistics* stat = dynamic_cast< SCycleStatistics* >( tstat );
-      if( stat ) {
-         procev += stat->GetProcessedEvents();
-         skipev += stat->GetSkippedEvents();
-      } else {
-         m_logger << WARNING << "Cycle statistics not received from: "
-                  << cycle->GetName() << SLogger::endmsg;
-         m_logger << WARNING << "Printed statistics will not be correct!"
-                  << SLogger::endmsg;
-      }
+   // Collect the statistics, and write the output of the cycle:
+   FinishInputData( cycle, config, inputData, outputs, updateOutput, stats );
 
-      //
-      // Write out the objects produced by the cycle:
-      //
-      TString outputFileName = config.GetOutputDirectory() + cycleName + "." +
-         id->GetType() + "." + id->GetVersion() + config.GetPostFix() + ".root";
-      outputFileName.ReplaceAll( "::", "." );
-      WriteCycleOutput( outputs, outputFileName,
-                        config.GetStringConfig( &inputData ),
-                        updateOutput );
-
-      // This cleanup is giving me endless trouble on the NYU Tier3 with
-      // ROOT 5.28c. So, knowing no better solution, I just disabled it
-      // on new ROOT versions for now...
-#if ROOT_VERSION_CODE < ROOT_VERSION( 5, 28, 0 )
-      outputs->SetOwner( kTRUE );
-#endif
-      outputs->Clear();
+   return kTRUE;
+}
 
+/**
+ * This function collects the statistics of processing an input data block,
+ * and writes the objects produced by the cycle into the output file
+ * belonging to the block.
+ *
+ * @param cycle The executed cycle
+ * @param config The configuration of the cycle
+ * @param inputData The processed input data block
+ * @param outputs The objects produced by the cycle
+ * @param updateOutput Flag deciding if the output file should be updated or
+ *                     overwritten
+ * @param stats The statistics of the processing (incremented)
+ */
+void SCycleController::FinishInputData( ISCycleBase* cycle,
+                                        const SCycleConfig& config,
+                                        const SInputData& inputData,
+                                        TList* outputs, Bool_t updateOutput,
+                                        SCycleStatistics& stats ) const {
+
+   // Check that the cycle output is available:
+   if( ! outputs ) {
+      REPORT_ERROR( "Cycle output could not be retrieved." );
+      REPORT_ERROR( "NOT writing the output of cycle \""
+                    << cycle->GetName() << "\", ID \"" << inputData.GetType()
+                    << "\", Version \"" << inputData.GetVersion() << "\"" );
+      return;
    }
 
    //
-   // The end cycle function has to be called here by hand:
+   // Collect the statistics from this input data:
    //
-   cycle->EndCycle();
-
-   // The cycle processing is done at this point:
-   timer.Stop();
+   TObject* tstat = outputs->FindObject( SFrame::RunStatisticsName );
+   SCycleStatistics* stat = dynamic_cast< SCycleStatistics* >( tstat );
+   if( stat ) {
+      stats.Add( *stat );
+   } else {
+      m_logger << WARNING << "Cycle statistics not received from: "
+               << cycle->GetName() << SLogger::endmsg;
+      m_logger << WARNING << "Printed statistics will not be correct!"
+               << SLogger::endmsg;
+   }
 
-   // Print some final statistics about the cycle:
-   m_logger << INFO << "Overall cycle statistics:" << SLogger::endmsg;
-   m_logger.setf( std::ios::fixed );
-   m_logger << INFO << std::setw( 10 ) << std::setfill( ' ' )
-            << std::setprecision( 0 ) << procev << " Events - Real time "
-            << std::setw( 6 ) << std::setprecision( 2 ) << timer.RealTime()
-            << " s  - " << std::setw( 5 ) << std::setprecision( 0 )
-            << ( procev / timer.RealTime() ) << " Hz | CPU time "
-            << std::setw( 6 ) << std::setprecision( 2 ) << timer.CpuTime()
-            << " s  - " << std::setw( 5 ) << std::setprecision( 0 )
-            << ( procev / timer.CpuTime() ) << " Hz" << SLogger::endmsg;
+   //
+   // Write out the objects produced by the cycle:
+   //
+   const TString outputFileName = GetOutputFileName( cycle->GetName(),
+                                                     config, inputData );
+   WriteCycleOutput( cycle->GetName(), outputs, outputFileName,
+                     config.GetStringConfig( &inputData ),
+                     updateOutput );
+
+   // This cleanup is giving me endless trouble on the NYU Tier3 with
+   // ROOT 5.28c. So, knowing no better solution, I just disabled it
+   // on new ROOT versions for now...
+#if ROOT_VERSION_CODE < ROOT_VERSION( 5, 28, 0 )
+   outputs->SetOwner( kTRUE );
+#endif
+   outputs->Clear();
 
-   ++m_curCycle;
    return;
 }
 
@@ -957,20 +2529,21 @@ void SCycleController::ShutDownProof() {
  * this output file from the objects transmitted to the client through the
  * network, and from the file created by TProofOutputFile.
  *
+ * @param cycleName The name of the cycle that produced the output
  * @param olist The list of objects kept/merged in memory
  * @param filename The name of the output file to create
  * @param config The configuration string to store in the file as metadata
  * @param update Flag deciding if the output file should be updated or
  *               overwritten
  */
-void SCycleController::WriteCycleOutput( TList* olist,
+void SCycleController::WriteCycleOutput( const char* cycleName,
+                                         TList* olist,
                                          const TString& filename,
                                          const TString& config,
                                          Bool_t update ) const {
 
    // Let the user know what's happening:
-   m_logger << INFO << "Writing output of \""
-            << m_analysisCycles.at( m_curCycle )->GetName() << "\" to: "
+   m_logger << INFO << "Writing output of \"" << cycleName << "\" to: "
             << filename << SLogger::endmsg;
 
    //
@@ -1015,22 +2588,28 @@ void SCycleController::WriteCycleOutput( TList* olist,
    }
 
    //
-   // Add the cycle configuration as metadata to the output file:
+   // Add the cycle configuration and statistics as metadata to the output
+   // file:
    //
+   // Make a directory for all SFrame related metadata:
+   TDirectory* sframeDir = outputFile->GetDirectory( "SFrame" );
+   if( ! sframeDir ) {
+      sframeDir = outputFile->mkdir( "SFrame" );
+   }
+   sframeDir->cd();
    if( ! update ) {
-      // Make a directory for all SFrame related metadata. Might want to
-      // add other metadata types as well to the output files later on.
-      TDirectory* sframeDir = outputFile->GetDirectory( "SFrame" );
-      if( ! sframeDir ) {
-         sframeDir = outputFile->mkdir( "SFrame" );
-      }
-      sframeDir->cd();
-
       // Create a TObjString out of the cycle configuration, and write it
       // out:
       TObjString configString( config );
       configString.Write( "CycleConfiguration" );
    }
+   // The statistics are merged with the ones already in the file when
+   // updating it:
+   const SCycleStatistics* stat = dynamic_cast< const SCycleStatistics* >(
+      olist->FindObject( SFrame::RunStatisticsName ) );
+   if( stat ) {
+      stat->Write( "CycleStatistics" );
+   }
 
    //
    // Write and close the output file:
@@ -1049,6 +2628,7 @@ void SCycleController::WriteCycleOutput( TList* olist,
 
       // Merge the file(s) into the output file using SFileMerger:
       SFileMerger merger;
+      merger.SetThreads( m_mergeThreads );
       for( std::vector< TString >::const_iterator mfile = filesToMerge.begin();
            mfile != filesToMerge.end(); ++mfile ) {
          if( ! merger.AddFile( *mfile ) ) {
@@ -1083,3 +2663,617 @@ void SCycleController::WriteCycleOutput( TList* olist,
 
    return;
 }
+
+/**
+ * This function processes one input data block with multiple cycles in a
+ * single event loop. The loop itself is driven by this function instead of
+ * TTreePlayer, as all the cycles need to be notified about new input files,
+ * and all of them need to read the current entry before any of them would
+ * start processing it.
+ *
+ * @param cycles The cycles to execute
+ * @param inputs The input object lists of the cycles
+ * @param id The input data block to process
+ * @param treeName The name of the main event-level input tree
+ * @param evmax The maximum number of events to process
+ * @param share The registry of the input branches shared by the cycles
+ */
+void SCycleController::ProcessFused( const std::vector< ISCycleBase* >& cycles,
+                                     const std::vector< TList* >& inputs,
+                                     const SInputData& id,
+                                     const char* treeName, Long64_t evmax,
+                                     SInputShare& share ) {
+
+   //
+   // Find out which entries need to be processed:
+   //
+   TChain chain( treeName );
+   AddInputFiles( chain, id );
+   ConfigureTreeCache( chain, cycles.front()->GetConfig() );
+   Long64_t firstEntry = 0;
+   const Long64_t nEntries = GetEntryRange( chain, id, evmax, firstEntry );
+
+   //
+   // Let the cycles run their client side initialisation:
+   //
+   std::vector< SCycleWorker* > workers;
+   for( size_t i = 0; i < cycles.size(); ++i ) {
+      cycles[ i ]->SetInputList( inputs[ i ] );
+      cycles[ i ]->Begin( &chain );
+      workers.push_back( new SCycleWorker( cycles[ i ], inputs[ i ] ) );
+   }
+
+   try {
+
+      //
+      // Initialise the worker side of the cycles:
+      //
+      for( size_t i = 0; i < workers.size(); ++i ) {
+         workers[ i ]->Begin( &chain, kFALSE );
+      }
+
+      //
+      // Process the events, opening the next input file in the background
+      // if requested:
+      //
+      SFilePrefetcher prefetcher( cycles.front()->GetConfig().GetCacheSize() );
+      const Bool_t prefetch =
+         cycles.front()->GetConfig().GetPrefetchInputFiles();
+      Int_t treeNumber = -1;
+      for( Long64_t entry = firstEntry; entry < firstEntry + nEntries;
+           ++entry ) {
+
+         const Long64_t localEntry = chain.LoadTree( entry );
+         if( localEntry < 0 ) {
+            REPORT_ERROR( "Couldn't load entry " << entry
+                          << " from the input" );
+            break;
+         }
+
+         // Let the cycles connect to a newly opened input file:
+         if( chain.GetTreeNumber() != treeNumber ) {
+            treeNumber = chain.GetTreeNumber();
+            if( prefetch ) {
+               prefetcher.Update( chain );
+            }
+            share.Clear();
+            for( size_t i = 0; i < cycles.size(); ++i ) {
+               cycles[ i ]->Notify();
+            }
+         }
+
+         // Read the entry for all the cycles first, and only then let them
+         // process it:
+         for( size_t i = 0; i < cycles.size(); ++i ) {
+            cycles[ i ]->PreloadEvent( localEntry );
+         }
+         for( size_t i = 0; i < cycles.size(); ++i ) {
+            cycles[ i ]->Process( localEntry );
+         }
+      }
+
+      //
+      // Finalise the worker side of the cycles:
+      //
+      for( size_t i = 0; i < workers.size(); ++i ) {
+         workers[ i ]->Terminate();
+      }
+
+   } catch( ... ) {
+      for( size_t i = 0; i < workers.size(); ++i ) {
+         delete workers[ i ];
+      }
+      throw;
+   }
+   for( size_t i = 0; i < workers.size(); ++i ) {
+      delete workers[ i ];
+   }
+
+   //
+   // Let the cycles run their client side finalisation:
+   //
+   for( size_t i = 0; i < cycles.size(); ++i ) {
+      cycles[ i ]->Terminate();
+   }
+
+   return;
+}
+
+/**
+ * This function processes one input data block on multiple threads of the
+ * current process. Each thread gets its own instance of the cycle and its
+ * own TChain. The entries are split into cluster-aligned ranges, which are
+ * handed to the threads through a work-stealing queue.
+ * The client side Begin(...) and Terminate() functions are only called on
+ * the original cycle object, which receives the merged outputs of all the
+ * threads.
+ *
+ * If one of the threads fails, the others stop after their current range.
+ * The temporary files of all the threads are removed then, and the problem
+ * of the failed thread is reported.
+ *
+ * @param cycle The cycle to execute
+ * @param input The input objects for the cycle (configuration, etc.)
+ * @param id The input data block to process
+ * @param treeName The name of the main event-level input tree
+ * @param evmax The maximum number of events to process
+ * @returns The merged output objects of all the threads
+ */
+TList* SCycleController::ProcessThreads( ISCycleBase* cycle, TList& input,
+                                         const SInputData& id,
+                                         const char* treeName,
+                                         Long64_t evmax ) {
+
+#if ROOT_VERSION_CODE < ROOT_VERSION( 6, 6, 0 )
+   throw SError( "THREADS mode is only available with ROOT >= 6.06",
+                 SError::SkipCycle );
+   return 0;
+#else
+   // Make sure that ROOT protects its global state:
+   ROOT::EnableThreadSafety();
+
+   //
+   // Find out which entries need to be processed:
+   //
+   TChain chain( treeName );
+   AddInputFiles( chain, id );
+   Long64_t firstEntry = 0;
+   const Long64_t nEntries = GetEntryRange( chain, id, evmax, firstEntry );
+   const std::vector< SEntryRange > ranges =
+      GetClusterRanges( chain, firstEntry, nEntries );
+
+   //
+   // Decide how many threads to use. It doesn't make sense to use more
+   // threads than the number of entry ranges.
+   //
+   Long64_t nThreads = cycle->GetConfig().GetNThreads();
+   if( nThreads <= 0 ) {
+      nThreads = std::thread::hardware_concurrency();
+   }
+   if( nThreads > static_cast< Long64_t >( ranges.size() ) ) {
+      nThreads = ranges.size();
+   }
+   if( nThreads <= 0 ) nThreads = 1;
+   m_logger << INFO << "Processing " << nEntries << " entries in "
+            << ranges.size() << " clusters on " << nThreads << " threads"
+            << SLogger::endmsg;
+
+   // The queue distributing the work between the threads:
+   SWorkQueue queue( ranges, nThreads );
+
+   // A single monitor reports the progress of all the threads. It may have
+   // been given by the caller already.
+   SProgressMonitor* monitor = dynamic_cast< SProgressMonitor* >(
+      input.FindObject( SFrame::ProgressMonitorName ) );
+   const Bool_t ownMonitor = ( ! monitor );
+   if( ownMonitor ) {
+      monitor =
+         new SProgressMonitor( cycle->GetName(), id, nEntries,
+                               cycle->GetConfig().GetProgressInterval(), INFO,
+                               cycle->GetConfig().GetProgressFile() );
+      input.Add( monitor );
+   }
+
+   //
+   // Let the cycle run its client side initialisation:
+   //
+   cycle->SetInputList( &input );
+   cycle->Begin( 0 );
+
+   //
+   // Create the cycle instances for the threads. Each of them gets its own
+   // copy of the input data description, as the cycles modify it during
+   // the event processing. The progress monitor is shared by all of them.
+   //
+   std::vector< TList* > inputs;
+   std::vector< SCycleWorker* > workers;
+   for( Long64_t i = 0; i < nThreads; ++i ) {
+      TList* wInput = new TList();
+      for( Int_t j = 0; j < input.GetSize(); ++j ) {
+         SInputData* wId = dynamic_cast< SInputData* >( input.At( j ) );
+         if( wId ) {
+            wInput->Add( new SInputData( *wId ) );
+         } else {
+            wInput->Add( input.At( j ) );
+         }
+      }
+      ISCycleBase* wCycle =
+         reinterpret_cast< ISCycleBase* >( cycle->IsA()->New() );
+      inputs.push_back( wInput );
+      workers.push_back( new SCycleWorker( wCycle, wInput ) );
+   }
+
+   //
+   // Process the events:
+   //
+   const Long64_t bytesStart = TFile::GetFileBytesRead();
+   std::vector< std::exception_ptr > errors( nThreads );
+   std::vector< std::thread > threads;
+   for( Long64_t i = 0; i < nThreads; ++i ) {
+      const UInt_t index = i;
+      SCycleWorker* worker = workers[ i ];
+      std::exception_ptr& error = errors[ i ];
+      threads.push_back( std::thread( [ &id, &queue, treeName, index, worker,
+                                        &error, cycle ]() {
+               // The chain has to outlive a failed worker's cleanup:
+               TChain wChain( treeName );
+               try {
+                  AddInputFiles( wChain, id );
+                  // The configuration of the thread's own cycle is only
+                  // set up by SCycleWorker::Begin(...):
+                  ConfigureTreeCache( wChain, cycle->GetConfig() );
+                  worker->SetWorkQueue( &queue, index );
+                  worker->Begin( &wChain );
+                  SEntryRange range;
+                  while( queue.Next( index, range ) ) {
+                     worker->ProcessRange( range.first, range.last );
+                  }
+                  worker->Terminate();
+               } catch( ... ) {
+                  error = std::current_exception();
+                  // Make the other threads stop after their current range,
+                  // and close the output file of this one:
+                  queue.Stop();
+                  try {
+                     worker->Abort();
+                  } catch( ... ) {
+                     // The original problem is the one reported
+                  }
+               }
+            } ) );
+   }
+   for( size_t i = 0; i < threads.size(); ++i ) {
+      threads[ i ].join();
+   }
+   if( ownMonitor ) {
+      input.Remove( monitor );
+      delete monitor;
+   }
+
+   //
+   // Merge the outputs of the threads into the output list of the original
+   // cycle, if all of them succeeded. Otherwise none of the outputs is
+   // used, so the temporary files of all the threads are removed.
+   //
+   std::exception_ptr failure;
+   for( size_t i = 0; i < errors.size(); ++i ) {
+      if( errors[ i ] ) {
+         failure = errors[ i ];
+         break;
+      }
+   }
+   for( size_t i = 0; i < workers.size(); ++i ) {
+      if( failure ) {
+         RemoveTemporaryFiles( workers[ i ]->GetOutputList() );
+      } else {
+         MergeOutputs( cycle->GetOutputList(),
+                       workers[ i ]->GetOutputList() );
+      }
+   }
+
+   // ROOT only counts the bytes read from the files for the whole process,
+   // so each thread reported the bytes read by all of them:
+   SCycleStatistics* stat = dynamic_cast< SCycleStatistics* >(
+      cycle->GetOutputList()->FindObject( SFrame::RunStatisticsName ) );
+   if( stat ) {
+      stat->SetBytesRead( TFile::GetFileBytesRead() - bytesStart );
+   }
+
+   //
+   // Clean up:
+   //
+   for( size_t i = 0; i < workers.size(); ++i ) {
+      delete workers[ i ]->GetCycle();
+      delete workers[ i ];
+      for( Int_t j = 0; j < inputs[ i ]->GetSize(); ++j ) {
+         if( dynamic_cast< SInputData* >( inputs[ i ]->At( j ) ) ) {
+            delete inputs[ i ]->At( j );
+         }
+      }
+      delete inputs[ i ];
+   }
+   if( failure ) {
+      std::rethrow_exception( failure );
+   }
+
+   //
+   // Let the cycle run its client side finalisation:
+   //
+   cycle->Terminate();
+
+   return cycle->GetOutputList();
+#endif // ROOT_VERSION
+}
+
+/**
+ * This function processes one input data block on multiple child processes
+ * forked from the current process. Since the children start out as copies of
+ * this process, they don't need to re-load any libraries, or re-read the
+ * configuration. Each of them processes cluster-aligned entry ranges taken
+ * from a work-stealing queue in shared memory, writes its ntuple output into
+ * its own temporary file, and sends its in-memory output objects back through
+ * a pipe. The temporary files are merged by WriteCycleOutput(...) in the end,
+ * just like in LOCAL mode.
+ *
+ * The client side Begin(...) and Terminate() functions are only called on
+ * the cycle object of this process, which receives the merged outputs of
+ * all the children.
+ *
+ * @param cycle The cycle to execute
+ * @param input The input objects for the cycle (configuration, etc.)
+ * @param id The input data block to process
+ * @param treeName The name of the main event-level input tree
+ * @param evmax The maximum number of events to process
+ * @returns The merged output objects of all the processes
+ */
+TList* SCycleController::ProcessForked( ISCycleBase* cycle, TList& input,
+                                        const SInputData& id,
+                                        const char* treeName,
+                                        Long64_t evmax ) {
+
+   //
+   // Find out which entries need to be processed:
+   //
+   TChain chain( treeName );
+   AddInputFiles( chain, id );
+   Long64_t firstEntry = 0;
+   const Long64_t nEntries = GetEntryRange( chain, id, evmax, firstEntry );
+   const std::vector< SEntryRange > ranges =
+      GetClusterRanges( chain, firstEntry, nEntries );
+
+   //
+   // Decide how many processes to use. It doesn't make sense to use more
+   // processes than the number of entry ranges.
+   //
+   Long64_t nProcesses = cycle->GetConfig().GetNProcesses();
+   if( nProcesses <= 0 ) {
+      nProcesses = std::thread::hardware_concurrency();
+   }
+   if( nProcesses > static_cast< Long64_t >( ranges.size() ) ) {
+      nProcesses = ranges.size();
+   }
+   if( nProcesses <= 0 ) nProcesses = 1;
+   m_logger << INFO << "Processing " << nEntries << " entries in "
+            << ranges.size() << " clusters on " << nProcesses << " processes"
+            << SLogger::endmsg;
+
+   // The queue distributing the work between the processes. It's put into
+   // shared memory, so that the children could steal work from each other.
+   SWorkQueue queue( ranges, nProcesses, kTRUE );
+
+   // A single monitor reports the progress of all the processes. Its
+   // counters are in shared memory as well, and the cycles of the children
+   // find it in their input list. It may also have been given by the caller,
+   // in which case it counts the events in shared memory already.
+   SProgressMonitor* monitor = dynamic_cast< SProgressMonitor* >(
+      input.FindObject( SFrame::ProgressMonitorName ) );
+   const Bool_t ownMonitor = ( ! monitor );
+   if( ownMonitor ) {
+      monitor =
+         new SProgressMonitor( cycle->GetName(), id, nEntries,
+                               cycle->GetConfig().GetProgressInterval(), INFO,
+                               cycle->GetConfig().GetProgressFile(), kTRUE );
+      input.Add( monitor );
+   }
+
+   //
+   // Let the cycle run its client side initialisation:
+   //
+   cycle->SetInputList( &input );
+   cycle->Begin( 0 );
+
+   // Make sure that the children don't print anything still buffered in
+   // this process:
+   std::cout.flush();
+   fflush( stdout );
+   fflush( stderr );
+
+   //
+   // Start the child processes:
+   //
+   std::vector< pid_t > pids;
+   std::vector< int > pipes;
+   for( Long64_t i = 0; i < nProcesses; ++i ) {
+
+      int fd[ 2 ];
+      if( pipe( fd ) ) {
+         REPORT_ERROR( "Couldn't create pipe for worker process: "
+                       << strerror( errno ) );
+         break;
+      }
+      const pid_t pid = fork();
+      if( pid < 0 ) {
+         REPORT_ERROR( "Couldn't fork worker process: " << strerror( errno ) );
+         close( fd[ 0 ] );
+         close( fd[ 1 ] );
+         break;
+      }
+
+      if( pid == 0 ) {
+
+         //
+         // This is the child process. Process the events, send the output
+         // objects to the parent, and exit without running any of the
+         // cleanup of the parent process.
+         //
+         close( fd[ 0 ] );
+         for( size_t j = 0; j < pipes.size(); ++j ) {
+            close( pipes[ j ] );
+         }
+         // Don't count the bytes read by the parent once more:
+         monitor->ResetBytesRead();
+         int status = 0;
+         try {
+            TChain wChain( treeName );
+            AddInputFiles( wChain, id );
+            ConfigureTreeCache( wChain, cycle->GetConfig() );
+            SCycleWorker worker( cycle, &input );
+            worker.SetWorkQueue( &queue, i );
+            worker.Begin( &wChain );
+            SEntryRange range;
+            while( queue.Next( i, range ) ) {
+               worker.ProcessRange( range.first, range.last );
+            }
+            worker.Terminate();
+
+            TBufferFile buffer( TBuffer::kWrite );
+            buffer.WriteObject( worker.GetOutputList() );
+            const Long64_t size = buffer.Length();
+            if( ( ! WriteAll( fd[ 1 ], reinterpret_cast< const char* >( &size ),
+                              sizeof( size ) ) ) ||
+                ( ! WriteAll( fd[ 1 ], buffer.Buffer(), size ) ) ) {
+               REPORT_ERROR( "Couldn't send the output objects to the parent "
+                             "process" );
+               status = 1;
+            }
+         } catch( const SError& error ) {
+            REPORT_FATAL( "Exception caught in worker process with message: "
+                          << error.what() );
+            status = 1;
+         } catch( const std::exception& error ) {
+            REPORT_FATAL( "STL exception caught in worker process with "
+                          "message: " << error.what() );
+            status = 1;
+         } catch( ... ) {
+            // Nothing may unwind the child into the parent's code path:
+            REPORT_FATAL( "Unknown exception caught in worker process" );
+            status = 1;
+         }
+         close( fd[ 1 ] );
+         std::cout.flush();
+         fflush( stdout );
+         _exit( status );
+      }
+
+      // This is the parent process:
+      close( fd[ 1 ] );
+      pids.push_back( pid );
+      pipes.push_back( fd[ 0 ] );
+   }
+
+   //
+   // Collect the outputs of the children:
+   //
+   Bool_t failed = ( pids.size() != static_cast< size_t >( nProcesses ) );
+   std::vector< TList* > results;
+   for( size_t i = 0; i < pids.size(); ++i ) {
+
+      // Read the serialised output list from the pipe:
+      TList* result = 0;
+      Long64_t size = 0;
+      if( ReadAll( pipes[ i ], reinterpret_cast< char* >( &size ),
+                   sizeof( size ) ) && ( size > 0 ) ) {
+         char* data = new char[ size ];
+         if( ReadAll( pipes[ i ], data, size ) ) {
+            // The buffer object takes ownership of the data:
+            TBufferFile buffer( TBuffer::kRead, size, data, kTRUE );
+            result =
+               dynamic_cast< TList* >( buffer.ReadObject( TList::Class() ) );
+         } else {
+            delete[] data;
+         }
+      }
+      close( pipes[ i ] );
+
+      // Wait for the child to finish:
+      int status = 0;
+      while( ( waitpid( pids[ i ], &status, 0 ) < 0 ) && ( errno == EINTR ) ) {}
+      if( ( ! result ) || ( ! WIFEXITED( status ) ) ||
+          WEXITSTATUS( status ) ) {
+         REPORT_ERROR( "Worker process " << pids[ i ] << " failed" );
+         failed = kTRUE;
+      }
+      if( result ) {
+         results.push_back( result );
+      }
+   }
+
+   //
+   // Merge the outputs of the children into the output list of the original
+   // cycle, if all of them succeeded. Otherwise none of the outputs is used,
+   // so the temporary files of all the children are removed.
+   //
+   for( size_t i = 0; i < results.size(); ++i ) {
+      if( failed ) {
+         RemoveTemporaryFiles( results[ i ] );
+      } else {
+         MergeOutputs( cycle->GetOutputList(), results[ i ] );
+      }
+      results[ i ]->SetOwner( kTRUE );
+      delete results[ i ];
+   }
+   if( ownMonitor ) {
+      input.Remove( monitor );
+      delete monitor;
+   }
+   if( failed ) {
+      throw SError( "Failed to process the events on the worker processes",
+                    SError::SkipCycle );
+   }
+
+   //
+   // Let the cycle run its client side finalisation:
+   //
+   cycle->Terminate();
+
+   return cycle->GetOutputList();
+}
+
+/**
+ * This function merges the output objects produced by one cycle instance into
+ * the output list of another one, in a way similar to how PROOF merges the
+ * outputs of its workers. Objects not yet present in the target list are
+ * moved there, while the ones already there are merged with the new ones.
+ * The references to temporary output files are all collected in the target
+ * list, so that WriteCycleOutput(...) would merge all of them.
+ *
+ * @param target The list to merge the objects into
+ * @param source The list to take the objects from
+ */
+void SCycleController::MergeOutputs( TList* target, TList* source ) const {
+
+   // TSelectorList refuses to hold multiple objects with the same name, so
+   // it's bypassed when adding objects to the target list:
+   THashList* htarget = dynamic_cast< THashList* >( target );
+
+   std::vector< TObject* > moved;
+   TIter next( source );
+   TObject* obj = 0;
+   while( ( obj = next() ) ) {
+
+      // Check if the object needs to be merged at all:
+      TObject* existing = 0;
+      if( ! dynamic_cast< SOutputFile* >( obj ) ) {
+         existing = target->FindObject( obj->GetName() );
+      }
+      if( ! existing ) {
+         if( htarget ) {
+            htarget->THashList::AddLast( obj );
+         } else {
+            target->AddLast( obj );
+         }
+         moved.push_back( obj );
+         continue;
+      }
+
+      // Merge it using the correct function:
+      TList list;
+      list.Add( obj );
+      if( dynamic_cast< SCycleOutput* >( existing ) ) {
+         dynamic_cast< SCycleOutput* >( existing )->Merge( &list );
+      } else if( dynamic_cast< SCycleStatistics* >( existing ) ) {
+         dynamic_cast< SCycleStatistics* >( existing )->Merge( &list );
+      } else {
+         m_logger << WARNING << "Don't know how to merge object: "
+                  << obj->GetName() << SLogger::endmsg;
+      }
+   }
+
+   // Make the source list forget about the moved objects:
+   for( std::vector< TObject* >::const_iterator itr = moved.begin();
+        itr != moved.end(); ++itr ) {
+      source->Remove( *itr );
+   }
+
+   return;
+}
@@ -10,6 +10,9 @@
  *
  ***************************************************************************/
 
+// STL include(s):
+#include <algorithm>
+
 // ROOT include(s):
 #include <TCollection.h>
 #include <TDirectory.h>
@@ -30,8 +33,35 @@ SCycleStatistics::SCycleStatistics( const char* name, Long64_t procEvents,
                                     Long64_t skipEvents )
    : TNamed( name, "SFrame cycle statistics" ),
      m_processedEvents( procEvents ), m_skippedEvents( skipEvents ),
+     m_bytesRead( 0 ), m_bytesUnzipped( 0 ), m_fileOpens( 0 ),
+     m_peakMemory( 0 ), m_cpuTime( 0.0 ), m_realTime( 0.0 ),
      m_logger( "SCycleStatistics" ) {
 
+   for( Int_t i = 0; i < NStages; ++i ) {
+      m_stageRealTime[ i ] = 0.0;
+      m_stageCpuTime[ i ] = 0.0;
+   }
+}
+
+/**
+ * Resets all the counters and timers of the object. Its name is kept.
+ */
+void SCycleStatistics::Clear( Option_t* ) {
+
+   m_processedEvents = 0;
+   m_skippedEvents = 0;
+   m_bytesRead = 0;
+   m_bytesUnzipped = 0;
+   m_fileOpens = 0;
+   m_peakMemory = 0;
+   m_cpuTime = 0.0;
+   m_realTime = 0.0;
+   for( Int_t i = 0; i < NStages; ++i ) {
+      m_stageRealTime[ i ] = 0.0;
+      m_stageCpuTime[ i ] = 0.0;
+   }
+
+   return;
 }
 
 /**
@@ -68,9 +98,208 @@ void SCycleStatistics::SetSkippedEvents( Long64_t events ) {
    return;
 }
 
+/**
+ * The files opened in the background by the input file prefetcher are
+ * counted as well.
+ *
+ * @returns The number of (compressed) bytes read from the input files
+ */
+Long64_t SCycleStatistics::GetBytesRead() const {
+
+   return m_bytesRead;
+}
+
+/**
+ * @param bytes The number of (compressed) bytes read from the input files
+ */
+void SCycleStatistics::SetBytesRead( Long64_t bytes ) {
+
+   m_bytesRead = bytes;
+   return;
+}
+
+/**
+ * @returns The number of uncompressed bytes read from the input branches
+ */
+Long64_t SCycleStatistics::GetUncompressedBytesRead() const {
+
+   return m_bytesUnzipped;
+}
+
+/**
+ * @param bytes The number of uncompressed bytes read from the input branches
+ */
+void SCycleStatistics::SetUncompressedBytesRead( Long64_t bytes ) {
+
+   m_bytesUnzipped = bytes;
+   return;
+}
+
+/**
+ * @returns The number of input files opened by the workers
+ */
+Long64_t SCycleStatistics::GetFileOpens() const {
+
+   return m_fileOpens;
+}
+
+/**
+ * @param files The number of input files opened by the workers
+ */
+void SCycleStatistics::SetFileOpens( Long64_t files ) {
+
+   m_fileOpens = files;
+   return;
+}
+
+/**
+ * @returns The highest resident memory of any of the workers, in kilobytes
+ */
+Long64_t SCycleStatistics::GetPeakResidentMemory() const {
+
+   return m_peakMemory;
+}
+
+/**
+ * @param memory The peak resident memory of the worker, in kilobytes
+ */
+void SCycleStatistics::SetPeakResidentMemory( Long64_t memory ) {
+
+   m_peakMemory = memory;
+   return;
+}
+
+/**
+ * @returns The CPU time used by all the workers together, in seconds
+ */
+Double_t SCycleStatistics::GetCpuTime() const {
+
+   return m_cpuTime;
+}
+
+/**
+ * @param time The CPU time used by the worker, in seconds
+ */
+void SCycleStatistics::SetCpuTime( Double_t time ) {
+
+   m_cpuTime = time;
+   return;
+}
+
+/**
+ * @returns The wall clock time spent by all the workers together, in seconds
+ */
+Double_t SCycleStatistics::GetRealTime() const {
+
+   return m_realTime;
+}
+
+/**
+ * @param time The wall clock time spent by the worker, in seconds
+ */
+void SCycleStatistics::SetRealTime( Double_t time ) {
+
+   m_realTime = time;
+   return;
+}
+
+/**
+ * Since the wall clock times of the workers are summed up, the rate is the
+ * one of a single worker. Which is the number needed for estimating how many
+ * jobs/cores a given sample needs.
+ *
+ * @returns The average number of processed events per second of a worker
+ */
+Double_t SCycleStatistics::GetEventRate() const {
+
+   if( m_realTime <= 0.0 ) return 0.0;
+   return m_processedEvents / m_realTime;
+}
+
+/**
+ * @param stage The processing stage
+ * @returns The wall clock time spent in the stage, in seconds
+ */
+Double_t SCycleStatistics::GetStageRealTime( Stage stage ) const {
+
+   return m_stageRealTime[ stage ];
+}
+
+/**
+ * @param stage The processing stage
+ * @returns The CPU time spent in the stage, in seconds
+ */
+Double_t SCycleStatistics::GetStageCpuTime( Stage stage ) const {
+
+   return m_stageCpuTime[ stage ];
+}
+
+/**
+ * @param stage The processing stage
+ * @param realTime Wall clock time spent in the stage, in seconds
+ * @param cpuTime CPU time spent in the stage, in seconds
+ */
+void SCycleStatistics::AddStageTime( Stage stage, Double_t realTime,
+                                     Double_t cpuTime ) {
+
+   m_stageRealTime[ stage ] += realTime;
+   m_stageCpuTime[ stage ] += cpuTime;
+   return;
+}
+
+/**
+ * @param stage The processing stage
+ * @returns A short description of the stage, used when printing the
+ *          statistics
+ */
+const char* SCycleStatistics::GetStageName( Stage stage ) {
+
+   switch( stage ) {
+   case ReadStage:
+      return "Reading events";
+   case WeightStage:
+      return "Event weights";
+   case ExecuteStage:
+      return "ExecuteEvent";
+   case WriteStage:
+      return "Filling output";
+   case FileInitStage:
+      return "File initialisation";
+   default:
+      break;
+   }
+
+   return "Unknown";
+}
+
+/**
+ * All the quantities are summed up, except for the peak memory, for which
+ * the larger value is kept.
+ *
+ * @param other The object whose statistics should be added to this one
+ */
+void SCycleStatistics::Add( const SCycleStatistics& other ) {
+
+   m_processedEvents += other.m_processedEvents;
+   m_skippedEvents   += other.m_skippedEvents;
+   m_bytesRead       += other.m_bytesRead;
+   m_bytesUnzipped   += other.m_bytesUnzipped;
+   m_fileOpens       += other.m_fileOpens;
+   m_peakMemory       = std::max( m_peakMemory, other.m_peakMemory );
+   m_cpuTime         += other.m_cpuTime;
+   m_realTime        += other.m_realTime;
+   for( Int_t i = 0; i < NStages; ++i ) {
+      m_stageRealTime[ i ] += other.m_stageRealTime[ i ];
+      m_stageCpuTime[ i ]  += other.m_stageCpuTime[ i ];
+   }
+
+   return;
+}
+
 /**
  * The merging is done in a *very* simple manner, just adding up the member
- * variables.
+ * variables. (Except for the peak memory usage, for which the maximum of the
+ * workers is taken.)
  *
  * @param coll The collection of objects to merge into this one
  * @returns Zero if some problem happened, something else if everything was okay
@@ -105,8 +334,7 @@ Int_t SCycleStatistics::Merge( TCollection* coll ) {
       //
       // Add the statistics from one worker:
       //
-      m_processedEvents += sobj->m_processedEvents;
-      m_skippedEvents   += sobj->m_skippedEvents;
+      Add( *sobj );
 
       REPORT_VERBOSE( sobj->m_processedEvents
                       << " events processed on one worker" );
@@ -120,11 +348,10 @@ Int_t SCycleStatistics::Merge( TCollection* coll ) {
 }
 
 /**
- * This function is not really used actually. It would make it possible to write
- * out the cycle statistics into the output file, but the code doesn't do this
- * at the moment.
+ * The function is used to write the statistics of an input data block into
+ * the "SFrame" metadata directory of its output file.
  *
- * The function is actually smart enough to handle all SFrame setup situations
+ * The function is smart enough to handle all SFrame setup situations
  * correctly, so it can update objects in an existing output file.
  *
  * @param name The name under which the object should be saved
@@ -134,8 +361,9 @@ Int_t SCycleStatistics::Merge( TCollection* coll ) {
 Int_t SCycleStatistics::Write( const char* name, Int_t option,
                                Int_t bufsize ) const {
 
+   const char* objName = ( name ? name : GetName() );
    TObject* original_obj;
-   if( ( original_obj = gDirectory->Get( GetName() ) ) ) {
+   if( ( original_obj = gDirectory->Get( objName ) ) ) {
       m_logger << DEBUG << "Merging object \"" << GetName()
                << "\" with already existing object..." << SLogger::endmsg;
 
@@ -148,17 +376,22 @@ Int_t SCycleStatistics::Write( const char* name, Int_t option,
          m_logger << WARNING
                   << "Merging is not possible, so it will be overwritten..."
                   << SLogger::endmsg;
+         delete original_obj;
       } else {
          TList list;
          list.Add( const_cast< SCycleStatistics* >( this ) );
          sobject->Merge( &list );
-         return 1;
+         const Int_t result = sobject->TObject::Write( objName,
+                                                       TObject::kOverwrite,
+                                                       bufsize );
+         delete sobject;
+         return result;
       }
 
    }
 
    // Call the standard ROOT write function:
-   return TObject::Write( name, option, bufsize );
+   return TObject::Write( objName, option | TObject::kOverwrite, bufsize );
 }
 
 /**
@@ -0,0 +1,282 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// STL include(s):
+#include <mutex>
+#include <algorithm>
+
+// ROOT include(s):
+#include <TTree.h>
+#include <TChain.h>
+#include <TList.h>
+
+// Local include(s):
+#include "../include/SCycleWorker.h"
+#include "../include/ISCycleBase.h"
+#include "../include/SCycleConfig.h"
+#include "../include/SFilePrefetcher.h"
+#include "../include/SWorkQueue.h"
+
+namespace {
+
+   /// Mutex serialising the initialisation and finalisation of the workers
+   /**
+    * The user code books its histograms and declares its output variables
+    * in BeginInputData(...), and writes its in-file merged objects in
+    * SlaveTerminate(). These operations go through ROOT's global directory
+    * structure, which is not meant to be modified from multiple threads
+    * at the same time. The event processing itself is not serialised.
+    */
+   std::mutex s_workerMutex;
+
+} // private namespace
+
+/**
+ * @param cycle The cycle instance that should be executed. It has to be a
+ *              separate instance for each worker running in parallel.
+ * @param input The input object list given to the cycle
+ */
+SCycleWorker::SCycleWorker( ISCycleBase* cycle, TList* input )
+   : m_cycle( cycle ), m_tree( 0 ), m_chain( 0 ), m_prefetcher( 0 ),
+     m_queue( 0 ), m_queueWorker( 0 ), m_logger( "SCycleWorker" ) {
+
+   m_cycle->SetInputList( input );
+}
+
+SCycleWorker::~SCycleWorker() {
+
+   delete m_prefetcher;
+}
+
+/**
+ * When the entry ranges are taken from a work-stealing queue, the worker
+ * doesn't process the files of the input chain in order. The queue is used
+ * then to find out which file should be prefetched.
+ *
+ * @param queue The queue that the ranges given to ProcessRange(...) are
+ *              taken from
+ * @param worker The index of this worker in the queue
+ */
+void SCycleWorker::SetWorkQueue( SWorkQueue* queue, UInt_t worker ) {
+
+   m_queue = queue;
+   m_queueWorker = worker;
+   return;
+}
+
+/**
+ * This function performs the same steps as TTreePlayer::Process(...) does
+ * before starting the event loop. Notice that it calls Notify() explicitly
+ * once, just like TTreePlayer. The cycle is expected to ignore this first
+ * call, and initialise itself when the first entry is loaded from the tree.
+ *
+ * When the cycle asks for it, the files of an input chain are prefetched
+ * in the background while the entries are processed by ProcessRange(...).
+ *
+ * @param tree The (chain) tree that the entries should be read from
+ * @param connectNotify When <code>kFALSE</code>, the tree doesn't notify the
+ *                      cycle about new input files. The caller has to call
+ *                      Notify() on the cycle itself in this case.
+ */
+void SCycleWorker::Begin( TTree* tree, Bool_t connectNotify ) {
+
+   m_tree = tree;
+
+   // Set up the prefetching of the input files:
+   delete m_prefetcher;
+   m_prefetcher = 0;
+   m_chain = 0;
+   if( m_cycle->GetConfig().GetPrefetchInputFiles() ) {
+      m_chain = dynamic_cast< TChain* >( m_tree );
+      if( m_chain ) {
+         m_prefetcher =
+            new SFilePrefetcher( m_cycle->GetConfig().GetCacheSize() );
+      }
+   }
+
+   {
+      std::lock_guard< std::mutex > lock( s_workerMutex );
+      m_cycle->SlaveBegin( m_tree );
+   }
+
+   m_cycle->Init( m_tree );
+   m_cycle->Notify();
+   if( connectNotify ) {
+      m_tree->SetNotify( m_cycle );
+   }
+
+   return;
+}
+
+/**
+ * The entry numbers are interpreted in the "global" entry space of the tree
+ * given to SCycleWorker::Begin. When the tree is a TChain, the cycle is
+ * notified by the chain itself whenever a new input file is reached.
+ *
+ * The range is split into blocks at the cluster and file boundaries. Each
+ * block is given to the cycle in one go if it implements
+ * SCycleBaseExec::ExecuteEventBatch(...), otherwise the entries are
+ * processed one by one.
+ *
+ * @param first The first entry to process
+ * @param last  One past the last entry to process
+ * @returns The number of entries that were processed
+ */
+Long64_t SCycleWorker::ProcessRange( Long64_t first, Long64_t last ) {
+
+   if( ! m_tree ) {
+      throw SError( "SCycleWorker::ProcessRange called before Begin",
+                    SError::SkipCycle );
+   }
+
+   Long64_t processed = 0;
+   Long64_t entry = first;
+   while( entry < last ) {
+
+      // Load the first entry of the block:
+      Long64_t localEntry = m_tree->LoadTree( entry );
+      if( localEntry < 0 ) {
+         REPORT_ERROR( "Couldn't load entry " << entry << " from the input" );
+         break;
+      }
+
+      // Start opening the next input file if a new file was reached. (The
+      // blocks never span multiple files.) When the ranges come from a work
+      // queue, the file of the next range in the queue is opened instead.
+      if( m_prefetcher ) {
+         if( m_queue ) {
+            SEntryRange next;
+            m_prefetcher->Update( *m_chain,
+                                  ( m_queue->Peek( m_queueWorker, next ) ?
+                                    next.tree : -1 ) );
+         } else {
+            m_prefetcher->Update( *m_chain );
+         }
+      }
+
+      // Find the end of the cluster holding the entry:
+      TTree::TClusterIterator clusters =
+         m_tree->GetTree()->GetClusterIterator( localEntry );
+      clusters();
+      const Long64_t blockEnd =
+         std::min( last, entry - localEntry + clusters.GetNextEntry() );
+
+      // Try to process the block in one go:
+      if( m_cycle->ProcessBatch( localEntry, blockEnd - entry ) ) {
+         processed += blockEnd - entry;
+         entry = blockEnd;
+         continue;
+      }
+
+      // Process the entries of the block one by one:
+      for( ; entry < blockEnd; ++entry ) {
+         localEntry = m_tree->LoadTree( entry );
+         if( localEntry < 0 ) {
+            REPORT_ERROR( "Couldn't load entry " << entry
+                          << " from the input" );
+            return processed;
+         }
+         m_cycle->Process( localEntry );
+         ++processed;
+      }
+   }
+
+   return processed;
+}
+
+/**
+ * This function is used when the input of the cycle doesn't come from a
+ * chain, but from a series of independent trees. (Like the chunks of events
+ * handed over between pipelined cycles.) The cycle is connected to the tree,
+ * and processes all of its entries, cluster by cluster.
+ *
+ * @param tree The tree to process
+ * @returns The number of entries that were processed
+ */
+Long64_t SCycleWorker::ProcessTree( TTree* tree ) {
+
+   m_cycle->Init( tree );
+   m_cycle->Notify();
+
+   const Long64_t entries = tree->GetEntries();
+   TTree::TClusterIterator clusters = tree->GetClusterIterator( 0 );
+   Long64_t start = 0;
+   while( ( start = clusters() ) < entries ) {
+      const Long64_t end = std::min( clusters.GetNextEntry(), entries );
+      if( m_cycle->ProcessBatch( start, end - start ) ) {
+         continue;
+      }
+      for( Long64_t entry = start; entry < end; ++entry ) {
+         m_cycle->Process( entry );
+      }
+   }
+
+   return entries;
+}
+
+/**
+ * Lets the cycle finish processing its input, and disconnects it from the
+ * input tree.
+ */
+void SCycleWorker::Terminate() {
+
+   if( m_tree ) {
+      m_tree->SetNotify( 0 );
+   }
+
+   // Close the last prefetched file:
+   delete m_prefetcher;
+   m_prefetcher = 0;
+   m_chain = 0;
+
+   std::lock_guard< std::mutex > lock( s_workerMutex );
+   m_cycle->SlaveTerminate();
+
+   return;
+}
+
+/**
+ * Used instead of Terminate() when the processing failed. The cycle only
+ * closes its output file, and disconnects from the input tree.
+ */
+void SCycleWorker::Abort() {
+
+   if( m_tree ) {
+      m_tree->SetNotify( 0 );
+   }
+
+   // Close the last prefetched file:
+   delete m_prefetcher;
+   m_prefetcher = 0;
+   m_chain = 0;
+
+   std::lock_guard< std::mutex > lock( s_workerMutex );
+   m_cycle->AbortInputData();
+
+   return;
+}
+
+/**
+ * @returns The cycle instance driven by this object
+ */
+ISCycleBase* SCycleWorker::GetCycle() const {
+
+   return m_cycle;
+}
+
+/**
+ * @returns The list of objects produced by the cycle
+ */
+TList* SCycleWorker::GetOutputList() const {
+
+   return m_cycle->GetOutputList();
+}
@@ -72,6 +72,7 @@ void SErrorHandler( int level, Bool_t abort, const char* location,
    // Abort the process if necessary:
    if( abort ) {
       logger << ERROR << "Aborting..." << SLogger::endmsg;
+      SLogWriter::Instance()->Flush();
       if( gSystem ) {
          gSystem->StackTrace();
          gSystem->Abort();
@@ -10,26 +10,217 @@
  *
  ***************************************************************************/
 
+// System include(s):
+#include <string.h>
+
 // STL include(s):
+#include <atomic>
+#include <exception>
+#include <functional>
 #include <set>
 #include <string>
+#include <thread>
+#include <utility>
 
 // ROOT include(s):
+#include <RVersion.h>
 #include <TObject.h>
 #include <TString.h>
 #include <TFile.h>
 #include <TList.h>
 #include <TTree.h>
+#include <TBranch.h>
 #include <TKey.h>
+#include <TClass.h>
 #include <TSystem.h>
 #include <TUUID.h>
+#include <TUrl.h>
+#include <TROOT.h>
 #include <TMethodCall.h>
 
 // Local include(s):
 #include "../include/SFileMerger.h"
 
+namespace {
+
+   /**
+    * Creates a unique name for a temporary file. The directory can be set
+    * using the SFRAME_TEMP_DIR environment variable.
+    *
+    * @returns A file name that's not used by anything else
+    */
+   TString TempFileName() {
+
+      TUUID uuid;
+      return TString::Format( "%s/SFRAMEMERGE-%s.root",
+                              ( gSystem->Getenv( "SFRAME_TEMP_DIR" ) ?
+                                gSystem->Getenv( "SFRAME_TEMP_DIR" ) :
+                                gSystem->TempDirectory() ),
+                              uuid.AsString() );
+   }
+
+   /**
+    * Executes a number of independent tasks, with each thread taking the next
+    * task that no other thread has taken yet.
+    *
+    * @param tasks The number of tasks to execute
+    * @param nThreads The number of threads to use
+    * @param task The function executing one task, receiving its index
+    */
+   void RunParallel( size_t tasks, Int_t nThreads,
+                     const std::function< void( size_t ) >& task ) {
+
+      std::atomic< size_t > nextTask( 0 );
+      auto worker = [ tasks, &nextTask, &task ]() {
+         for( size_t i = nextTask++; i < tasks; i = nextTask++ ) {
+            task( i );
+         }
+      };
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 6, 6, 0 )
+      if( nThreads > 1 ) {
+         // Make sure that ROOT protects its global state:
+         ROOT::EnableThreadSafety();
+         std::vector< std::thread > threads;
+         for( Int_t i = 0; i < nThreads; ++i ) {
+            threads.push_back( std::thread( worker ) );
+         }
+         for( size_t i = 0; i < threads.size(); ++i ) {
+            threads[ i ].join();
+         }
+         return;
+      }
+#endif // ROOT_VERSION...
+      worker();
+
+      return;
+   }
+
+   /**
+    * SFrame sets the same compression for all branches of an output tree, so
+    * the setting of the first branch describes the whole tree.
+    *
+    * @param tree The tree to investigate
+    * @returns The compression setting of the tree's baskets
+    */
+   Int_t TreeCompression( TTree* tree ) {
+
+      TObjArray* branches = tree->GetListOfBranches();
+      if( branches->GetEntriesFast() ) {
+         return static_cast< TBranch* >( branches->At( 0 ) )->
+            GetCompressionSettings();
+      }
+      TFile* file = tree->GetCurrentFile();
+      return ( file ? file->GetCompressionSettings() : -1 );
+   }
+
+   /**
+    * @param tree The tree to investigate
+    * @param compression The expected compression setting
+    * @returns <code>kTRUE</code> if all the baskets of the tree are written
+    *          with the specified compression
+    */
+   Bool_t HasCompression( TTree* tree, Int_t compression ) {
+
+      TObjArray* branches = tree->GetListOfBranches();
+      for( Int_t i = 0; i < branches->GetEntriesFast(); ++i ) {
+         if( static_cast< TBranch* >( branches->At( i ) )->
+             GetCompressionSettings() != compression ) {
+            return kFALSE;
+         }
+      }
+
+      return kTRUE;
+   }
+
+   /**
+    * @param tree The tree to modify
+    * @param compression The compression setting to use for all branches
+    */
+   void SetCompression( TTree* tree, Int_t compression ) {
+
+      if( compression < 0 ) return;
+      TObjArray* branches = tree->GetListOfBranches();
+      for( Int_t i = 0; i < branches->GetEntriesFast(); ++i ) {
+         static_cast< TBranch* >( branches->At( i ) )->
+            SetCompressionSettings( compression );
+      }
+
+      return;
+   }
+
+   /**
+    * This function is executed on the worker threads. It opens its own handles
+    * to all the input files, and merges one tree from them into a temporary
+    * file, re-compressing all of its baskets.
+    *
+    * @param files The (local) input files
+    * @param path The full path of the tree inside the input files
+    * @param compression The compression setting to use for the merged tree
+    * @param outName The name of the temporary file to create
+    * @returns An empty string if successful, the description of the problem
+    *          otherwise
+    */
+   TString RecompressTree( const std::vector< TString >& files,
+                           const TString& path, Int_t compression,
+                           const TString& outName ) {
+
+      TFile* ofile = TFile::Open( outName, "RECREATE" );
+      if( ! ofile ) {
+         return "Couldn't create temporary file: " + outName;
+      }
+      if( compression >= 0 ) {
+         ofile->SetCompressionSettings( compression );
+      }
+
+      // Access the tree in all the input files:
+      TString error;
+      std::vector< TFile* > ifiles;
+      TList trees;
+      for( std::vector< TString >::const_iterator file = files.begin();
+           file != files.end(); ++file ) {
+         TFile* ifile = TFile::Open( *file, "READ" );
+         if( ! ifile ) {
+            error = "Couldn't open file: " + *file;
+            break;
+         }
+         ifiles.push_back( ifile );
+         TTree* tree = dynamic_cast< TTree* >( ifile->Get( path ) );
+         if( tree ) trees.Add( tree );
+      }
+
+      // Copy all the entries into a single tree:
+      if( ( ! error.Length() ) && trees.GetSize() ) {
+         ofile->cd();
+         TTree* otree = static_cast< TTree* >( trees.First() )->CloneTree( 0 );
+         if( otree ) {
+            otree->SetDirectory( ofile );
+            SetCompression( otree, compression );
+            otree->Merge( &trees, "" );
+            otree->Write();
+            delete otree;
+         } else {
+            error = "Couldn't clone tree \"" + path + "\"";
+         }
+      }
+
+      // Clean up:
+      trees.Clear();
+      ofile->Close();
+      delete ofile;
+      for( std::vector< TFile* >::iterator ifile = ifiles.begin();
+           ifile != ifiles.end(); ++ifile ) {
+         ( *ifile )->Close();
+         delete ( *ifile );
+      }
+
+      return error;
+   }
+
+} // private namespace
+
 SFileMerger::SFileMerger()
-   : m_inputFiles(), m_outputFile( 0 ), m_logger( "SFileMerger" ) {
+   : m_inputNames(), m_localNames(), m_inputFiles(), m_outputFile( 0 ),
+     m_nThreads( 1 ), m_logger( "SFileMerger" ) {
 
 }
 
@@ -40,7 +231,8 @@ SFileMerger::~SFileMerger() {
 }
 
 /**
- * This function adds a new file as input for the merging.
+ * This function adds a new file as input for the merging. The file is only
+ * opened when the merging is executed.
  *
  * @param fileName The name of the input file
  * @returns <code>kTRUE</code> if everything went correctly,
@@ -48,36 +240,8 @@ SFileMerger::~SFileMerger() {
  */
 Bool_t SFileMerger::AddFile( const TString& fileName ) {
 
-   //
-   // Copy the file locally. This is important when reading an ntuple file
-   // from a remote PROOF farm that might be half way around the world...
-   //
-   TUUID uuid;
-   const TString localName =
-      TString::Format( "%s/SFRAMEMERGE-%s.root",
-                       ( gSystem->Getenv( "SFRAME_TEMP_DIR" ) ?
-                         gSystem->Getenv( "SFRAME_TEMP_DIR" ) :
-                         gSystem->TempDirectory() ), uuid.AsString() );
-   if( ! TFile::Cp( fileName, localName, kTRUE ) ) {
-      REPORT_ERROR( "Couldn't create local copy of: " << fileName );
-      throw SError( "Couldn't create local copy of: " + fileName,
-                    SError::SkipCycle );
-      return kFALSE;
-   }
-   REPORT_VERBOSE( fileName << " copied locally as " << localName );
-
-   //
-   // Try to open the specified file. Throw an exception if it wasn't possible.
-   //
-   TFile* ifile = TFile::Open( localName, "READ" );
-   if( ! ifile ) {
-      REPORT_ERROR( "Local file could not be opened: " << localName );
-      throw SError( "Local file could not be opened: " + fileName,
-                    SError::SkipCycle );
-      return kFALSE;
-   }
-   m_inputFiles.push_back( ifile );
-   REPORT_VERBOSE( localName << " opened for reading" );
+   m_inputNames.push_back( fileName );
+   REPORT_VERBOSE( fileName << " added to the merging" );
 
    // Return gracefully:
    return kTRUE;
@@ -113,6 +277,21 @@ Bool_t SFileMerger::OutputFile( const TString& fileName,
    return kTRUE;
 }
 
+/**
+ * The threads are used for copying remote input files, and for merging the
+ * trees that have to be re-compressed. Everything else happens on the
+ * calling thread, which is also the default. Note that using multiple
+ * threads turns on ROOT's thread-safety for the rest of the process.
+ *
+ * @param threads The number of threads to use. 0 (or a negative value) means
+ *                one thread per core.
+ */
+void SFileMerger::SetThreads( Int_t threads ) {
+
+   m_nThreads = threads;
+   return;
+}
+
 /**
  * This is the main function of this class. It was heavily inspired by the
  * TFileMerger::MergeRecursive function, which in turn is basically a copy of
@@ -130,26 +309,27 @@ Bool_t SFileMerger::Merge() {
       REPORT_ERROR( "Merge(): Output file not specified yet" );
       return kFALSE;
    }
-   if( ! m_inputFiles.size() ) {
+   if( ! m_inputNames.size() ) {
       m_logger << WARNING
                << "Merge(): No input files specified. Noting to be done..."
                << SLogger::endmsg;
       return kFALSE;
    }
 
-   m_logger << DEBUG << "Running file merging..." << SLogger::endmsg;
+   SLOGGER_DEBUG( "Running file merging..." );
+
+   // Make the input files available:
+   OpenInputFiles();
 
    //
-   // Loop over all input files:
+   // Merge all the input files in one go. The trees that need to be
+   // re-compressed are only collected while walking the directories.
    //
-   for( std::vector< TFile* >::const_iterator ifile = m_inputFiles.begin();
-        ifile != m_inputFiles.end(); ++ifile ) {
-
-      REPORT_VERBOSE( "Now processing file: " << ( *ifile )->GetName() );
-
-      // Call the recursive merging function:
-      MergeDirectory( *ifile, m_outputFile );
-   }
+   std::vector< TDirectory* > inputs( m_inputFiles.begin(),
+                                      m_inputFiles.end() );
+   std::vector< TreeJob > jobs;
+   MergeDirectory( inputs, m_outputFile, "", jobs );
+   RunTreeJobs( jobs );
 
    //
    // Make sure that everything in the output is written out:
@@ -161,19 +341,97 @@ Bool_t SFileMerger::Merge() {
    return kTRUE;
 }
 
+/**
+ * Remote files are copied locally first. This is important when reading an
+ * ntuple file from a remote PROOF farm that might be half way around the
+ * world... Since copying a file mostly means waiting for the network, the
+ * files are copied in parallel.
+ */
+void SFileMerger::OpenInputFiles() {
+
+   //
+   // Decide which files need to be copied:
+   //
+   std::vector< size_t > toCopy;
+   m_localNames.clear();
+   for( size_t i = 0; i < m_inputNames.size(); ++i ) {
+      TUrl url( m_inputNames[ i ], kTRUE );
+      if( ! strcmp( url.GetProtocol(), "file" ) ) {
+         m_localNames.push_back( m_inputNames[ i ] );
+      } else {
+         m_localNames.push_back( TempFileName() );
+         toCopy.push_back( i );
+      }
+   }
+
+   //
+   // Copy the remote files:
+   //
+   if( toCopy.size() ) {
+      const Int_t nThreads = GetThreads( toCopy.size() );
+      m_logger << DEBUG << "Copying " << toCopy.size() << " files locally on "
+               << nThreads << " threads" << SLogger::endmsg;
+      std::vector< Int_t > copied( toCopy.size(), 0 );
+      const std::vector< TString >& inputNames = m_inputNames;
+      const std::vector< TString >& localNames = m_localNames;
+      RunParallel( toCopy.size(), nThreads,
+                   [ &toCopy, &copied, &inputNames, &localNames ]( size_t i ) {
+                      const size_t index = toCopy[ i ];
+                      try {
+                         copied[ i ] = ( TFile::Cp( inputNames[ index ],
+                                                    localNames[ index ],
+                                                    kFALSE ) ? 1 : 0 );
+                      } catch( ... ) {
+                         copied[ i ] = 0;
+                      }
+                   } );
+      for( size_t i = 0; i < toCopy.size(); ++i ) {
+         const TString& fileName = m_inputNames[ toCopy[ i ] ];
+         if( ! copied[ i ] ) {
+            REPORT_ERROR( "Couldn't create local copy of: " << fileName );
+            throw SError( "Couldn't create local copy of: " + fileName,
+                          SError::SkipCycle );
+         }
+         REPORT_VERBOSE( fileName << " copied locally as "
+                         << m_localNames[ toCopy[ i ] ] );
+      }
+   }
+
+   //
+   // Try to open the files. Throw an exception if it wasn't possible.
+   //
+   for( std::vector< TString >::const_iterator name = m_localNames.begin();
+        name != m_localNames.end(); ++name ) {
+      TFile* ifile = TFile::Open( *name, "READ" );
+      if( ! ifile ) {
+         REPORT_ERROR( "Local file could not be opened: " << *name );
+         throw SError( "Local file could not be opened: " + *name,
+                       SError::SkipCycle );
+      }
+      m_inputFiles.push_back( ifile );
+      REPORT_VERBOSE( *name << " opened for reading" );
+   }
+
+   return;
+}
+
 void SFileMerger::CloseFiles() {
 
    for( std::vector< TFile* >::iterator ifile = m_inputFiles.begin();
         ifile != m_inputFiles.end(); ++ifile ) {
       ( *ifile )->Close();
-      // Remove the local copy of the file:
-      TString p( ( *ifile )->GetPath() );
-      p = p( 0, p.Index( ':', 0 ) );
-      REPORT_VERBOSE( "Removing local file: " << p );
-      gSystem->Unlink( p );
       delete ( *ifile );
    }
    m_inputFiles.clear();
+   // Remove the local copies of the remote files:
+   for( size_t i = 0; i < m_localNames.size(); ++i ) {
+      if( m_localNames[ i ] != m_inputNames[ i ] ) {
+         REPORT_VERBOSE( "Removing local file: " << m_localNames[ i ] );
+         gSystem->Unlink( m_localNames[ i ] );
+      }
+   }
+   m_localNames.clear();
+   m_inputNames.clear();
    if( m_outputFile ) delete m_outputFile;
    m_outputFile = 0;
 
@@ -182,193 +440,330 @@ void SFileMerger::CloseFiles() {
 
 /**
  * This recursive function is taking care about merging all the TTree-s from one
- * directory into the TTree-s of the output directory. If it finds a directory
- * on the input, it calls itself for that directory.
+ * directory of all the input files into the TTree-s of the output directory.
+ * If it finds a directory on the input, it calls itself for that directory.
  *
  * The result should be that all TTree-s from all the sub-directories should get
  * merged into the output.
  *
- * @param input The input directory
+ * @param inputs The input directories
  * @param output The output directory
+ * @param path The path of the directories inside the files
+ * @param jobs The trees to be re-compressed on separate threads
  */
-void SFileMerger::MergeDirectory( TDirectory* input,
-                                  TDirectory* output ) {
-
-   // Get a list of all objects in this directory:
-   TList* keyList = input->GetListOfKeys();
+void SFileMerger::MergeDirectory( const std::vector< TDirectory* >& inputs,
+                                  TDirectory* output, const TString& path,
+                                  std::vector< TreeJob >& jobs ) {
 
    //
-   // Loop over all keys in the root directory, and select the ones describing
-   // a TTree or a TDirectory. Since one single object can appear multiple times
-   // in this list (with different "cycles"), keep track of which objectss have
-   // already been merged into the output.
+   // Collect the objects from all the input directories. Since one single
+   // object can appear multiple times in the list of keys (with different
+   // "cycles"), and in multiple files, keep track of which objects have
+   // already been found.
    //
-   std::set< std::string > processedObjects;
-   for( Int_t i = 0; i < keyList->GetSize(); ++i ) {
-
-      // Convert to a TKey:
-      TKey* key = dynamic_cast< TKey* >( keyList->At( i ) );
-      if( ! key ) {
-         REPORT_ERROR( "Couldn't cast to TKey. There is some problem in the "
-                       "code" );
-         throw SError( "Couldn't cast to TKey. There is some problem in the "
-                       "code", SError::StopExecution );
+   std::set< std::string > foundObjects;
+   std::vector< std::pair< TString, TClass* > > objects;
+   for( std::vector< TDirectory* >::const_iterator input = inputs.begin();
+        input != inputs.end(); ++input ) {
+
+      TList* keyList = ( *input )->GetListOfKeys();
+      for( Int_t i = 0; i < keyList->GetSize(); ++i ) {
+
+         // Convert to a TKey:
+         TKey* key = dynamic_cast< TKey* >( keyList->At( i ) );
+         if( ! key ) {
+            REPORT_ERROR( "Couldn't cast to TKey. There is some problem in "
+                          "the code" );
+            throw SError( "Couldn't cast to TKey. There is some problem in "
+                          "the code", SError::StopExecution );
+         }
+         REPORT_VERBOSE( "Found key with name: " << key->GetName()
+                         << ";" << key->GetCycle() );
+         if( ! foundObjects.insert( key->GetName() ).second ) {
+            continue;
+         }
+         objects.push_back( std::make_pair( TString( key->GetName() ),
+                                            TClass::GetClass(
+                                               key->GetClassName() ) ) );
       }
+   }
 
-      //
-      // Check whether we already processed an object with this name:
-      //
-      REPORT_VERBOSE( "Processing key with name: " << key->GetName()
-                      << ";" << key->GetCycle() );
-      if( processedObjects.find( key->GetName() ) != processedObjects.end() ) {
-         m_logger << DEBUG << "Object \"" << key->GetName()
-                  << "\" has already been processed" << SLogger::endmsg;
-         continue;
-      }
+   //
+   // Merge the objects one by one:
+   //
+   for( std::vector< std::pair< TString, TClass* > >::const_iterator obj =
+           objects.begin(); obj != objects.end(); ++obj ) {
 
-      //
-      // Get the object:
-      //
-      TObject* obj = input->Get( key->GetName() );
-      if( ! obj ) {
-         REPORT_ERROR( "Couldn't access object with name '" << key->GetName()
-                       << "'" );
-         throw SError( "Couldn't access object for which we got a key",
-                       SError::StopExecution );
+      const TString& name = obj->first;
+      if( ! obj->second ) {
+         REPORT_ERROR( "Unknown type for object with name '" << name << "'" );
+         continue;
       }
+      REPORT_VERBOSE( "Processing object with name: " << name );
 
       //
       // Decide how to handle this object:
       //
-      if( obj->IsA()->InheritsFrom( "TDirectory" ) ) {
-
-         // Access the input object as a directory:
-         TDirectory* indir = dynamic_cast< TDirectory* >( obj );
-         if( ! indir ) {
-            REPORT_ERROR( "Couldn't cast to object to TDirectory" );
-            continue;
+      if( obj->second->InheritsFrom( "TDirectory" ) ) {
+
+         // Access the directory in all the input files:
+         std::vector< TDirectory* > indirs;
+         for( std::vector< TDirectory* >::const_iterator input =
+                 inputs.begin(); input != inputs.end(); ++input ) {
+            TDirectory* indir =
+               dynamic_cast< TDirectory* >( ( *input )->Get( name ) );
+            if( indir ) indirs.push_back( indir );
          }
 
          // Check if such a directory already exists in the output:
          TDirectory* outdir =
-            dynamic_cast< TDirectory* >( output->Get( key->GetName() ) );
+            dynamic_cast< TDirectory* >( output->Get( name ) );
          // If it doesn't let's create it:
          if( ! outdir ) {
-            if( ! ( outdir = output->mkdir( key->GetName(),
-                                            "dummy title" ) ) ) {
+            if( ! ( outdir = output->mkdir( name, "dummy title" ) ) ) {
                REPORT_ERROR( "Failed creating subdirectory with name: "
-                             << key->GetName() );
+                             << name );
                throw SError( "Failed creating subdirectory",
                              SError::SkipInputData );
             }
          }
 
          // Now call this same function recursively:
-         MergeDirectory( indir, outdir );
+         MergeDirectory( indirs, outdir, path + name + "/", jobs );
 
-      } else if( obj->IsA()->InheritsFrom( "TTree" ) ) {
+      } else if( obj->second->InheritsFrom( "TTree" ) ) {
+
+         // Access the tree in all the input files:
+         TList trees;
+         for( std::vector< TDirectory* >::const_iterator input =
+                 inputs.begin(); input != inputs.end(); ++input ) {
+            TTree* tree = dynamic_cast< TTree* >( ( *input )->Get( name ) );
+            if( tree ) trees.Add( tree );
+         }
+         if( ! trees.GetSize() ) {
+            REPORT_ERROR( "Coulnd't access tree with name: " << name );
+            continue;
+         }
 
          //
-         // See if such a TTree exists in the output already:
+         // The merged tree keeps the compression of the tree already in the
+         // output, or of the first input tree. If all the input trees use the
+         // same compression, their baskets can be copied as they are.
          //
-         TTree* otree = 0;
-         if( ( otree =
-               dynamic_cast< TTree* >( output->Get( key->GetName() ) ) ) ) {
-
-            //
-            // If it does, then use the TTree:Merge function to copy the
-            // contents of the TTree in the input file into the existing TTree
-            // in the output file.
-            //
-            TList itrees;
-            itrees.Add( obj );
-            if( otree->Merge( &itrees ) ) {
-               m_logger << DEBUG << "Merged tree \"" << obj->GetName()
-                        << "\" from file: " << input->GetName()
-                        << SLogger::endmsg;
-               otree->AutoSave();
-            } else {
-               throw SError( TString( "There was a problem with merging "
-                                      "trees \""  ) + obj->GetName() + "\"",
-                             SError::SkipCycle );
+         TTree* otree = dynamic_cast< TTree* >( output->Get( name ) );
+         const Int_t compression =
+            TreeCompression( otree ? otree :
+                             static_cast< TTree* >( trees.First() ) );
+         Bool_t fast = kTRUE;
+         TIter next( &trees );
+         TTree* tree = 0;
+         while( ( tree = static_cast< TTree* >( next() ) ) ) {
+            if( ! HasCompression( tree, compression ) ) {
+               fast = kFALSE;
+               break;
             }
+         }
 
+         //
+         // Re-compressing the baskets is expensive, so if multiple threads
+         // can be used, such trees are merged in parallel at the end:
+         //
+         if( ( ! fast ) && ( GetThreads( 2 ) > 1 ) ) {
+            TreeJob job;
+            job.path = path + name;
+            job.compression = compression;
+            jobs.push_back( job );
+            SLOGGER_DEBUG( "Tree \"" << job.path << "\" will be re-compressed "
+                           "on a separate thread" );
          } else {
+            MergeTrees( trees, output, name, compression, fast );
+         }
 
-            //
-            // If it doesn't exist, then use the TTree::CloneTree function to
-            // create a copy of the TTree in the input file. Then save this
-            // copy into the output file.
-            //
-            output->cd();
-            TTree* itree = 0;
-            if( ! ( itree = dynamic_cast< TTree* >( obj ) ) ) {
-               REPORT_ERROR( "Coulnd't dynamic cast object to TTree" );
-               continue;
-            }
+         // Release the memory used by the input trees:
+         trees.Delete();
 
-            //
-            // TTree::MergeTrees would crash in case the input TTree is empty,
-            // so instead let's use TTree::CloneTree
-            //
-            if( ( otree = itree->CloneTree( -1, "fast" ) ) ) {
-               m_logger << DEBUG << "Cloned tree \"" << itree->GetName()
-                        << "\" into file: " << m_outputFile->GetName()
-                        << SLogger::endmsg;
-               otree->SetDirectory( output );
-               otree->AutoSave();
-            } else {
-               throw SError( TString( "Tree \"" ) + itree->GetName() +
-                             "\" couldn't be cloned into the output",
-                             SError::SkipCycle );
-            }
+      } else {
 
+         // Access the object in all the input files:
+         TList objs;
+         for( std::vector< TDirectory* >::const_iterator input =
+                 inputs.begin(); input != inputs.end(); ++input ) {
+            TObject* inobj = ( *input )->Get( name );
+            if( inobj ) objs.Add( inobj );
          }
 
-         // Remember that this TTree has already been processed:
-         processedObjects.insert( obj->GetName() );
+         //
+         // If the object already exists in the output, merge all the input
+         // objects into it. If it doesn't, merge all of them into the first
+         // input object.
+         //
+         TObject* oobj = output->Get( name );
+         if( ! oobj ) {
+            if( ! ( oobj = objs.First() ) ) continue;
+            objs.RemoveFirst();
+         }
+         if( objs.GetSize() ) {
+            MergeObjects( objs, oobj );
+         }
+         output->cd();
+         oobj->Write( name, TObject::kOverwrite );
+         SLOGGER_DEBUG( "Merged object \"" << name << "\" into file: "
+                        << m_outputFile->GetName() );
+      }
+   }
 
-      } else if( obj->IsA()->InheritsFrom( "TObject" ) ) {
+   return;
+}
 
-         // Check if the object is already in the output:
-         TObject* oobj = output->Get( key->GetName() );
+/**
+ * If the tree doesn't exist in the output yet, the TTree::CloneTree function
+ * is used to create an empty copy of the first input tree. (TTree::MergeTrees
+ * would crash in case the input TTree is empty.) The contents of all the
+ * input trees are then copied into the output tree with TTree::Merge, and the
+ * output tree is written just once at the end.
+ *
+ * @param trees The trees to be merged
+ * @param output The output directory
+ * @param name The name of the tree
+ * @param compression The compression setting of the merged tree
+ * @param fast If <code>kTRUE</code>, the baskets of the input trees are
+ *             copied without being decompressed
+ */
+void SFileMerger::MergeTrees( TList& trees, TDirectory* output,
+                              const char* name, Int_t compression,
+                              Bool_t fast ) {
+
+   output->cd();
+
+   //
+   // See if such a TTree exists in the output already, and create it if it
+   // doesn't:
+   //
+   TTree* otree = dynamic_cast< TTree* >( output->Get( name ) );
+   if( ! otree ) {
+      TTree* itree = static_cast< TTree* >( trees.First() );
+      if( ! ( otree = itree->CloneTree( 0 ) ) ) {
+         throw SError( TString( "Tree \"" ) + name +
+                       "\" couldn't be cloned into the output",
+                       SError::SkipCycle );
+      }
+      otree->SetDirectory( output );
+      if( ! fast ) {
+         SetCompression( otree, compression );
+      }
+   }
+
+   //
+   // Copy the contents of all the input trees:
+   //
+   otree->Merge( &trees, ( fast ? "fast" : "" ) );
+   otree->Write( 0, TObject::kOverwrite );
+   SLOGGER_DEBUG( "Merged " << trees.GetSize() << " tree(s) \"" << name
+                  << "\" into file: " << m_outputFile->GetName()
+                  << ( fast ? " (fast)" : "" ) );
+
+   // The tree is not needed in memory anymore:
+   delete otree;
+
+   return;
+}
+
+/**
+ * Each job is merged into a temporary file by a separate thread, with the
+ * compression of the final output. The temporary files are then merged
+ * into the output file one by one, copying their baskets as they are.
+ *
+ * @param jobs The trees to be re-compressed
+ */
+void SFileMerger::RunTreeJobs( std::vector< TreeJob >& jobs ) {
+
+   if( ! jobs.size() ) return;
 
-         // Decide what to do:
-         if( oobj ) {
-            // If the object already exists, merge the new object into it:
-            MergeObjects( obj, oobj );
-            m_logger << DEBUG << "Merged object \"" << obj->GetName()
-                     << "\" into file: " << m_outputFile->GetName()
-                     << SLogger::endmsg;
+   //
+   // Merge the trees into temporary files:
+   //
+   for( std::vector< TreeJob >::iterator job = jobs.begin();
+        job != jobs.end(); ++job ) {
+      job->tempName = TempFileName();
+   }
+   const Int_t nThreads = GetThreads( jobs.size() );
+   m_logger << DEBUG << "Re-compressing " << jobs.size() << " trees on "
+            << nThreads << " threads" << SLogger::endmsg;
+   const std::vector< TString >& files = m_localNames;
+   RunParallel( jobs.size(), nThreads, [ &jobs, &files ]( size_t i ) {
+         TreeJob& job = jobs[ i ];
+         try {
+            job.error = RecompressTree( files, job.path, job.compression,
+                                        job.tempName );
+         } catch( const std::exception& error ) {
+            job.error = "Exception caught while merging tree \"" + job.path +
+               "\": " + error.what();
+         } catch( ... ) {
+            job.error = "Unknown exception caught while merging tree \"" +
+               job.path + "\"";
+         }
+      } );
+
+   //
+   // Merge the temporary files into the output, in the order in which the
+   // trees were found:
+   //
+   TString error;
+   for( std::vector< TreeJob >::const_iterator job = jobs.begin();
+        job != jobs.end(); ++job ) {
+
+      if( job->error.Length() && ( ! error.Length() ) ) {
+         error = job->error;
+      }
+      if( ! error.Length() ) {
+         const Ssiz_t slash = job->path.Last( '/' );
+         const TString dirName = job->path( 0, slash > 0 ? slash : 0 );
+         const TString treeName = job->path( slash + 1, job->path.Length() );
+         TFile* tfile = TFile::Open( job->tempName, "READ" );
+         TTree* tree = ( tfile ? dynamic_cast< TTree* >(
+                            tfile->Get( treeName ) ) : 0 );
+         TDirectory* outdir = ( dirName.Length() ?
+                                m_outputFile->GetDirectory( dirName ) :
+                                m_outputFile );
+         if( tree && outdir ) {
+            TList trees;
+            trees.Add( tree );
+            try {
+               MergeTrees( trees, outdir, treeName, job->compression, kTRUE );
+            } catch( const SError& ex ) {
+               error = ex.what();
+            }
+            trees.Clear();
          } else {
-            // If the object doesn't exist yet, just write this object to the
-            // output:
-            output->cd();
-            obj->Write();
-            m_logger << DEBUG << "Cloned object \"" << obj->GetName()
-                     << "\" into file: " << m_outputFile->GetName()
-                     << SLogger::endmsg;
+            error = "Couldn't merge re-compressed tree \"" + job->path + "\"";
+         }
+         if( tfile ) {
+            tfile->Close();
+            delete tfile;
          }
       }
 
+      // Remove the temporary file:
+      REPORT_VERBOSE( "Removing temporary file: " << job->tempName );
+      gSystem->Unlink( job->tempName );
+   }
+   if( error.Length() ) {
+      REPORT_ERROR( error );
+      throw SError( error, SError::SkipCycle );
    }
 
    return;
 }
 
 /**
- * This internal function takes care of merging two objects together.
+ * This internal function takes care of merging objects together.
  * Since TObject doesn't have a Merge(...) function, we have to do it
  * with a bit more code.
  *
- * @param in The input object
- * @param out The object into which the input object should be merged
+ * @param in The input objects
+ * @param out The object into which the input objects should be merged
  */
-void SFileMerger::MergeObjects( TObject* in, TObject* out ) {
-
-   // Put the input object into a list:
-   TList list;
-   list.Add( in );
+void SFileMerger::MergeObjects( TList& in, TObject* out ) {
 
    //
    // Make sure that the output object supports merging:
@@ -384,13 +779,36 @@ void SFileMerger::MergeObjects( TObject* in, TObject* out ) {
    //
    // Execute the merging:
    //
-   mergeMethod.SetParam( ( Long_t ) &list );
+   mergeMethod.SetParam( ( Long_t ) &in );
    mergeMethod.Execute( out );
 
    // Let the user know what we did:
-   REPORT_VERBOSE( "Merged objects of type \"" << out->ClassName()
-                   << "\" and name: " << out->GetName() );
+   REPORT_VERBOSE( "Merged " << in.GetSize() << " objects of type \""
+                   << out->ClassName() << "\" and name: " << out->GetName() );
 
    // Return gracefully:
    return;
 }
+
+/**
+ * @param tasks The number of independent tasks to execute
+ * @returns The number of threads to use for the tasks
+ */
+Int_t SFileMerger::GetThreads( size_t tasks ) const {
+
+   Int_t nThreads = m_nThreads;
+   if( nThreads <= 0 ) {
+      nThreads = std::thread::hardware_concurrency();
+   }
+   if( nThreads > static_cast< Int_t >( tasks ) ) {
+      nThreads = tasks;
+   }
+#if ROOT_VERSION_CODE < ROOT_VERSION( 6, 6, 0 )
+   // Without thread-safety support in ROOT everything has to happen on the
+   // calling thread:
+   nThreads = 1;
+#endif // ROOT_VERSION...
+   if( nThreads <= 0 ) nThreads = 1;
+
+   return nThreads;
+}
@@ -0,0 +1,697 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// System include(s):
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// STL include(s):
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+
+// ROOT include(s):
+#include <TSystem.h>
+#include <TTree.h>
+
+// Local include(s):
+#include "../include/SFileMetadataCache.h"
+
+namespace {
+
+   /// Identifier at the beginning of the cache files
+   const char CACHE_MAGIC[ 8 ] = { 'S', 'F', 'M', 'D', 'C', '0', '0', '1' };
+
+   /// Header of the cache files
+   struct Header {
+      char     magic[ 8 ]; ///< Identifier of the file format
+      uint64_t nRecords; ///< Number of records in the file
+      uint64_t indexOffset; ///< Position of the index in the file
+      uint64_t fileSize; ///< Size of the whole file
+   }; // struct Header
+
+   /// One entry of the index of the cache files
+   struct IndexEntry {
+      uint64_t hash; ///< Hash of the file path
+      uint64_t offset; ///< Position of the record in the file
+   }; // struct IndexEntry
+
+   /// Ordering of the index entries
+   bool operator< ( const IndexEntry& a, const IndexEntry& b ) {
+
+      return ( ( a.hash < b.hash ) ||
+               ( ( a.hash == b.hash ) && ( a.offset < b.offset ) ) );
+   }
+
+   /**
+    * Calculates the 64-bit FNV-1a hash of a file path. The hash has to be
+    * the same in all the jobs sharing a cache file, so std::hash can't be
+    * used.
+    *
+    * @param path The file path
+    * @returns The hash of the path
+    */
+   uint64_t HashPath( const char* path ) {
+
+      uint64_t hash = 14695981039346656037ULL;
+      for( const char* c = path; *c; ++c ) {
+         hash ^= static_cast< unsigned char >( *c );
+         hash *= 1099511628211ULL;
+      }
+
+      return hash;
+   }
+
+   /// Append a 64-bit integer to a buffer
+   void PutInt( std::string& buffer, int64_t value ) {
+
+      buffer.append( reinterpret_cast< const char* >( &value ),
+                     sizeof( value ) );
+      return;
+   }
+
+   /// Append a length-prefixed string to a buffer
+   void PutString( std::string& buffer, const TString& value ) {
+
+      const uint32_t length = value.Length();
+      buffer.append( reinterpret_cast< const char* >( &length ),
+                     sizeof( length ) );
+      buffer.append( value.Data(), length );
+      return;
+   }
+
+   /**
+    * Helper class reading the binary records, making sure that nothing is
+    * read beyond the end of the data. So a damaged cache file would never
+    * crash the job.
+    */
+   class Reader {
+
+   public:
+      /// Constructor with the range of the data to read
+      Reader( const char* begin, const char* end )
+         : m_pos( begin ), m_end( end ) {}
+
+      /// Read some raw data
+      bool Get( void* data, size_t size ) {
+         if( static_cast< size_t >( m_end - m_pos ) < size ) return false;
+         memcpy( data, m_pos, size );
+         m_pos += size;
+         return true;
+      }
+      /// Read a 64-bit integer
+      bool GetInt( Long64_t& value ) {
+         int64_t result = 0;
+         if( ! Get( &result, sizeof( result ) ) ) return false;
+         value = result;
+         return true;
+      }
+      /// Read a length-prefixed string
+      bool GetString( TString& value ) {
+         uint32_t length = 0;
+         if( ! Get( &length, sizeof( length ) ) ) return false;
+         if( static_cast< size_t >( m_end - m_pos ) < length ) return false;
+         value = TString( m_pos, length );
+         m_pos += length;
+         return true;
+      }
+      /// Get the current position of the reader
+      const char* Position() const { return m_pos; }
+
+   private:
+      const char* m_pos; ///< The current position
+      const char* m_end; ///< The end of the data
+
+   }; // class Reader
+
+   /// Serialise the description of a file into a buffer
+   void Serialise( const SFileMetadataCache::FileInfo& info,
+                   std::string& buffer ) {
+
+      PutString( buffer, info.path );
+      PutInt( buffer, info.size );
+      PutInt( buffer, info.mtime );
+      PutInt( buffer, info.trees.size() );
+      std::vector< SFileMetadataCache::TreeInfo >::const_iterator t_itr =
+         info.trees.begin();
+      std::vector< SFileMetadataCache::TreeInfo >::const_iterator t_end =
+         info.trees.end();
+      for( ; t_itr != t_end; ++t_itr ) {
+         PutString( buffer, t_itr->name );
+         PutInt( buffer, t_itr->entries );
+         PutInt( buffer, t_itr->clusters.size() );
+         for( size_t i = 0; i < t_itr->clusters.size(); ++i ) {
+            PutInt( buffer, t_itr->clusters[ i ].first );
+            PutInt( buffer, t_itr->clusters[ i ].second );
+         }
+      }
+
+      return;
+   }
+
+   /// Read the description of a file from a buffer
+   bool Deserialise( Reader& reader, SFileMetadataCache::FileInfo& info ) {
+
+      Long64_t nTrees = 0;
+      if( ! ( reader.GetString( info.path ) && reader.GetInt( info.size ) &&
+              reader.GetInt( info.mtime ) && reader.GetInt( nTrees ) ) ) {
+         return false;
+      }
+      info.trees.clear();
+      for( Long64_t i = 0; i < nTrees; ++i ) {
+         SFileMetadataCache::TreeInfo tree;
+         Long64_t nRuns = 0;
+         if( ! ( reader.GetString( tree.name ) &&
+                 reader.GetInt( tree.entries ) &&
+                 reader.GetInt( nRuns ) ) ) {
+            return false;
+         }
+         for( Long64_t j = 0; j < nRuns; ++j ) {
+            std::pair< Long64_t, Long64_t > run;
+            if( ! ( reader.GetInt( run.first ) &&
+                    reader.GetInt( run.second ) ) ) {
+               return false;
+            }
+            tree.clusters.push_back( run );
+         }
+         info.trees.push_back( tree );
+      }
+
+      return true;
+   }
+
+   /**
+    * @param data The contents of a cache file
+    * @param size The size of the cache file
+    * @param header The header of the file (output)
+    * @returns <code>true</code> if the file looks valid
+    */
+   bool ReadHeader( const char* data, size_t size, Header& header ) {
+
+      if( size < sizeof( Header ) ) return false;
+      memcpy( &header, data, sizeof( Header ) );
+      return ( ( ! memcmp( header.magic, CACHE_MAGIC,
+                           sizeof( CACHE_MAGIC ) ) ) &&
+               ( header.fileSize == size ) &&
+               ( header.indexOffset >= sizeof( Header ) ) &&
+               ( header.indexOffset <= size ) &&
+               ( ( size - header.indexOffset ) / sizeof( IndexEntry ) ==
+                 header.nRecords ) );
+   }
+
+   /**
+    * @param data The contents of a cache file
+    * @param header The header of the file
+    * @param i The index of the entry to get
+    * @returns The requested index entry
+    */
+   IndexEntry GetIndexEntry( const char* data, const Header& header,
+                             uint64_t i ) {
+
+      IndexEntry result;
+      memcpy( &result, data + header.indexOffset + i * sizeof( IndexEntry ),
+              sizeof( IndexEntry ) );
+      return result;
+   }
+
+} // private namespace
+
+/**
+ * The STL threading types are kept out of the header, so that they would not
+ * have to be seen by all the code including it.
+ */
+struct SFileMetadataCache::Impl {
+   /// Default constructor
+   Impl() : mutex(), data( 0 ), size( 0 ), header(), rejected( false ),
+            rejectedSize( 0 ), rejectedMtime( 0 ) {}
+   /// Map the cache file into memory, if it's not mapped yet
+   bool Map( const TString& fileName );
+   /// Release the mapped cache file
+   void Unmap();
+
+   std::mutex  mutex; ///< Mutex protecting the mapping
+   const char* data; ///< The mapped cache file
+   size_t      size; ///< Size of the mapped cache file
+   Header      header; ///< Header of the mapped cache file
+   bool        rejected; ///< Flag showing that the file was found invalid
+   off_t       rejectedSize; ///< Size of the file found invalid
+   time_t      rejectedMtime; ///< Modification time of the file found invalid
+}; // struct SFileMetadataCache::Impl
+
+/**
+ * A missing cache file is not an error, it just means that no job filled the
+ * cache yet. So the mapping is tried again on every call until the file
+ * shows up. A file in an invalid format is only looked at again once it's
+ * modified.
+ *
+ * @param fileName The name of the cache file
+ * @returns <code>true</code> if the cache file is mapped
+ */
+bool SFileMetadataCache::Impl::Map( const TString& fileName ) {
+
+   if( data ) {
+      return true;
+   }
+
+   const int fd = open( fileName.Data(), O_RDONLY );
+   if( fd < 0 ) {
+      return false;
+   }
+   struct stat st;
+   if( fstat( fd, &st ) || ( st.st_size <= 0 ) ) {
+      close( fd );
+      return false;
+   }
+   if( rejected && ( st.st_size == rejectedSize ) &&
+       ( st.st_mtime == rejectedMtime ) ) {
+      close( fd );
+      return false;
+   }
+   void* mapping = mmap( 0, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+   close( fd );
+   if( mapping == MAP_FAILED ) {
+      return false;
+   }
+   data = static_cast< const char* >( mapping );
+   size = st.st_size;
+
+   // Check that the file is in the expected format:
+   if( ! ReadHeader( data, size, header ) ) {
+      SLogger logger( "SFileMetadataCache" );
+      logger << WARNING << "Ignoring invalid metadata cache file: "
+             << fileName << SLogger::endmsg;
+      Unmap();
+      rejected = true;
+      rejectedSize = st.st_size;
+      rejectedMtime = st.st_mtime;
+      return false;
+   }
+
+   return true;
+}
+
+void SFileMetadataCache::Impl::Unmap() {
+
+   if( data ) {
+      munmap( const_cast< char* >( data ), size );
+   }
+   data = 0;
+   size = 0;
+   rejected = false;
+
+   return;
+}
+
+// Initialize the static member(s):
+SFileMetadataCache* SFileMetadataCache::m_instance = 0;
+
+/**
+ * This function implements the singleton design pattern for the class.
+ */
+SFileMetadataCache* SFileMetadataCache::Instance() {
+
+   if( ! m_instance ) {
+      m_instance = new SFileMetadataCache();
+   }
+
+   return m_instance;
+}
+
+SFileMetadataCache::SFileMetadataCache()
+   : m_fileName( "" ), m_impl( new Impl() ),
+     m_logger( "SFileMetadataCache" ) {
+
+}
+
+SFileMetadataCache::~SFileMetadataCache() {
+
+   m_impl->Unmap();
+   delete m_impl;
+   m_instance = 0;
+}
+
+/**
+ * @param fileName The name of the cache file. The file is created when new
+ *                 files are first stored in it. An empty name disables the
+ *                 cache.
+ */
+void SFileMetadataCache::SetFileName( const TString& fileName ) {
+
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   m_impl->Unmap();
+   m_fileName = fileName;
+
+   return;
+}
+
+const TString& SFileMetadataCache::GetFileName() const {
+
+   return m_fileName;
+}
+
+Bool_t SFileMetadataCache::IsEnabled() const {
+
+   return ( m_fileName.Length() != 0 );
+}
+
+/**
+ * The function can be called from multiple threads at the same time.
+ *
+ * @param path The full path name of the file
+ * @param size The current size of the file
+ * @param mtime The current modification time of the file
+ * @param info The description of the file (output)
+ * @returns <code>kTRUE</code> if the cache describes the file in its current
+ *          state, <code>kFALSE</code> otherwise
+ */
+Bool_t SFileMetadataCache::Lookup( const TString& path, Long64_t size,
+                                   Long64_t mtime, FileInfo& info ) const {
+
+   if( ! IsEnabled() ) {
+      return kFALSE;
+   }
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   if( ! m_impl->Map( m_fileName ) ) {
+      return kFALSE;
+   }
+   const char* data = m_impl->data;
+   const Header& header = m_impl->header;
+
+   // Find the first index entry with the hash of the path:
+   const uint64_t hash = HashPath( path.Data() );
+   uint64_t first = 0, last = header.nRecords;
+   while( first < last ) {
+      const uint64_t middle = first + ( last - first ) / 2;
+      if( GetIndexEntry( data, header, middle ).hash < hash ) {
+         first = middle + 1;
+      } else {
+         last = middle;
+      }
+   }
+
+   // Check all the records with this hash:
+   for( ; first < header.nRecords; ++first ) {
+      const IndexEntry entry = GetIndexEntry( data, header, first );
+      if( entry.hash != hash ) break;
+      if( ( entry.offset < sizeof( Header ) ) ||
+          ( entry.offset >= header.indexOffset ) ) continue;
+      Reader reader( data + entry.offset, data + header.indexOffset );
+      FileInfo candidate;
+      if( ! Deserialise( reader, candidate ) ) continue;
+      if( ( candidate.path == path ) && ( candidate.size == size ) &&
+          ( candidate.mtime == mtime ) ) {
+         info = candidate;
+         return kTRUE;
+      }
+   }
+
+   return kFALSE;
+}
+
+/**
+ * The new descriptions replace the ones of the same files already in the
+ * cache. If the cache already describes the same version of a file, the trees
+ * known by only the existing description are kept, so jobs reading
+ * different trees from the same files don't keep replacing each other's
+ * records.
+ *
+ * The function should not be called while other threads are looking up
+ * files in the cache.
+ *
+ * @param files The descriptions of the files to add
+ * @returns <code>kTRUE</code> if the cache file was updated successfully
+ */
+Bool_t SFileMetadataCache::Store( const std::vector< FileInfo >& files ) {
+
+   if( ( ! IsEnabled() ) || files.empty() ) {
+      return kTRUE;
+   }
+
+   //
+   // Only one job may update the cache at a time:
+   //
+   const TString lockName = m_fileName + ".lock";
+   const int lockFd = open( lockName.Data(), O_RDWR | O_CREAT, 0666 );
+   if( lockFd < 0 ) {
+      m_logger << WARNING << "Couldn't open lock file: " << lockName
+               << SLogger::endmsg;
+      return kFALSE;
+   }
+   struct flock fl;
+   memset( &fl, 0, sizeof( fl ) );
+   fl.l_type = F_WRLCK;
+   fl.l_whence = SEEK_SET;
+   while( fcntl( lockFd, F_SETLKW, &fl ) == -1 ) {
+      if( errno != EINTR ) {
+         m_logger << WARNING << "Couldn't lock file: " << lockName
+                  << SLogger::endmsg;
+         close( lockFd );
+         return kFALSE;
+      }
+   }
+
+   //
+   // Read the records of the latest version of the cache file. (The mapped
+   // version may have been replaced by another job since.)
+   //
+   std::map< std::string, std::string > records;
+   FILE* input = fopen( m_fileName.Data(), "rb" );
+   if( input ) {
+      std::string content;
+      char buffer[ 65536 ];
+      size_t nRead = 0;
+      while( ( nRead = fread( buffer, 1, sizeof( buffer ), input ) ) > 0 ) {
+         content.append( buffer, nRead );
+      }
+      fclose( input );
+      Header header;
+      if( ReadHeader( content.data(), content.size(), header ) ) {
+         const char* data = content.data();
+         for( uint64_t i = 0; i < header.nRecords; ++i ) {
+            const IndexEntry entry = GetIndexEntry( data, header, i );
+            if( ( entry.offset < sizeof( Header ) ) ||
+                ( entry.offset >= header.indexOffset ) ) continue;
+            Reader reader( data + entry.offset, data + header.indexOffset );
+            FileInfo info;
+            if( ! Deserialise( reader, info ) ) continue;
+            records[ info.path.Data() ] =
+               std::string( data + entry.offset, reader.Position() );
+         }
+      } else if( content.size() ) {
+         m_logger << WARNING << "Replacing invalid metadata cache file: "
+                  << m_fileName << SLogger::endmsg;
+      }
+   }
+
+   //
+   // Merge the new descriptions into the existing ones:
+   //
+   std::vector< FileInfo >::const_iterator f_itr = files.begin();
+   std::vector< FileInfo >::const_iterator f_end = files.end();
+   for( ; f_itr != f_end; ++f_itr ) {
+      FileInfo merged( *f_itr );
+      std::string& record = records[ f_itr->path.Data() ];
+      if( record.size() ) {
+         Reader reader( record.data(), record.data() + record.size() );
+         FileInfo existing;
+         if( Deserialise( reader, existing ) &&
+             ( existing.size == merged.size ) &&
+             ( existing.mtime == merged.mtime ) ) {
+            for( size_t i = 0; i < existing.trees.size(); ++i ) {
+               bool found = false;
+               for( size_t j = 0; j < merged.trees.size(); ++j ) {
+                  if( merged.trees[ j ].name == existing.trees[ i ].name ) {
+                     found = true;
+                     break;
+                  }
+               }
+               if( ! found ) {
+                  merged.trees.push_back( existing.trees[ i ] );
+               }
+            }
+         }
+      }
+      record.clear();
+      Serialise( merged, record );
+   }
+
+   //
+   // Create the new version of the file in memory:
+   //
+   std::string output( sizeof( Header ), '\0' );
+   std::vector< IndexEntry > index;
+   index.reserve( records.size() );
+   std::map< std::string, std::string >::const_iterator r_itr =
+      records.begin();
+   std::map< std::string, std::string >::const_iterator r_end = records.end();
+   for( ; r_itr != r_end; ++r_itr ) {
+      IndexEntry entry;
+      entry.hash = HashPath( r_itr->first.c_str() );
+      entry.offset = output.size();
+      index.push_back( entry );
+      output += r_itr->second;
+   }
+   std::sort( index.begin(), index.end() );
+   output.resize( ( output.size() + 7 ) & ~static_cast< size_t >( 7 ), '\0' );
+   Header header;
+   memcpy( header.magic, CACHE_MAGIC, sizeof( CACHE_MAGIC ) );
+   header.nRecords = index.size();
+   header.indexOffset = output.size();
+   header.fileSize = output.size() + index.size() * sizeof( IndexEntry );
+   output.replace( 0, sizeof( Header ),
+                   reinterpret_cast< const char* >( &header ),
+                   sizeof( Header ) );
+   if( index.size() ) {
+      output.append( reinterpret_cast< const char* >( &index.front() ),
+                     index.size() * sizeof( IndexEntry ) );
+   }
+
+   //
+   // Write it under a temporary name, and move it into place. The jobs that
+   // have the previous version mapped keep on using that.
+   //
+   const TString tmpName =
+      TString::Format( "%s.%s.%d.tmp", m_fileName.Data(), gSystem->HostName(),
+                       static_cast< int >( getpid() ) );
+   Bool_t result = kFALSE;
+   FILE* file = fopen( tmpName.Data(), "wb" );
+   if( file ) {
+      const bool written =
+         ( fwrite( output.data(), 1, output.size(), file ) == output.size() );
+      const bool flushed = ( ( fflush( file ) == 0 ) &&
+                             ( fsync( fileno( file ) ) == 0 ) );
+      const bool closed = ( fclose( file ) == 0 );
+      if( written && flushed && closed &&
+          ( ! rename( tmpName.Data(), m_fileName.Data() ) ) ) {
+         result = kTRUE;
+      } else {
+         unlink( tmpName.Data() );
+      }
+   }
+   if( result ) {
+      m_logger << DEBUG << "Stored " << files.size() << " file(s) in "
+               << m_fileName << " (" << records.size() << " in total)"
+               << SLogger::endmsg;
+   } else {
+      m_logger << WARNING << "Couldn't update metadata cache file: "
+               << m_fileName << SLogger::endmsg;
+   }
+
+   // Release the lock:
+   close( lockFd );
+
+   // Use the new version of the file from now on:
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   m_impl->Unmap();
+
+   return result;
+}
+
+/**
+ * @param path The full path name of the file
+ * @param treeName The name of the tree
+ * @param boundaries The first entry of each cluster of the tree, followed by
+ *                   the number of entries in the tree (output)
+ * @returns <code>kTRUE</code> if the cluster boundaries are known for the
+ *          current version of the file, <code>kFALSE</code> otherwise
+ */
+Bool_t SFileMetadataCache::
+GetClusterBoundaries( const TString& path, const TString& treeName,
+                      std::vector< Long64_t >& boundaries ) const {
+
+   if( ! IsEnabled() ) {
+      return kFALSE;
+   }
+   Long64_t size = 0, mtime = 0;
+   FileInfo info;
+   if( ( ! GetFileStat( path, size, mtime ) ) ||
+       ( ! Lookup( path, size, mtime, info ) ) ) {
+      return kFALSE;
+   }
+
+   for( size_t i = 0; i < info.trees.size(); ++i ) {
+      const TreeInfo& tree = info.trees[ i ];
+      if( ( tree.name != treeName ) || tree.clusters.empty() ) continue;
+      boundaries.clear();
+      boundaries.push_back( 0 );
+      for( size_t j = 0; j < tree.clusters.size(); ++j ) {
+         for( Long64_t k = 0; k < tree.clusters[ j ].second; ++k ) {
+            boundaries.push_back( boundaries.back() +
+                                  tree.clusters[ j ].first );
+         }
+      }
+      return ( boundaries.back() == tree.entries );
+   }
+
+   return kFALSE;
+}
+
+/**
+ * @param path The path name of the file
+ * @param size The size of the file (output)
+ * @param mtime The modification time of the file (output)
+ * @returns <code>kTRUE</code> if the file could be accessed,
+ *          <code>kFALSE</code> otherwise
+ */
+Bool_t SFileMetadataCache::GetFileStat( const TString& path, Long64_t& size,
+                                        Long64_t& mtime ) {
+
+   FileStat_t st;
+   if( gSystem->GetPathInfo( path.Data(), st ) ) {
+      return kFALSE;
+   }
+   size = st.fSize;
+   mtime = st.fMtime;
+
+   return kTRUE;
+}
+
+/**
+ * The cluster sizes are stored as (cluster size, number of clusters) pairs,
+ * as most trees have clusters of the same size, apart from the last one.
+ *
+ * @param tree The tree to describe
+ * @param withClusters Flag showing whether the cluster sizes are needed
+ * @param info The description of the tree (output)
+ */
+void SFileMetadataCache::DescribeTree( TTree* tree, Bool_t withClusters,
+                                       TreeInfo& info ) {
+
+   info.name = tree->GetName();
+   info.entries = tree->GetEntriesFast();
+   info.clusters.clear();
+   if( ! withClusters ) {
+      return;
+   }
+
+   TTree::TClusterIterator clusters = tree->GetClusterIterator( 0 );
+   Long64_t start = 0;
+   while( ( start = clusters() ) < info.entries ) {
+      const Long64_t size =
+         std::min( clusters.GetNextEntry(), info.entries ) - start;
+      if( ( ! info.clusters.empty() ) &&
+          ( info.clusters.back().first == size ) ) {
+         ++info.clusters.back().second;
+      } else {
+         info.clusters.push_back( std::make_pair( size, 1LL ) );
+      }
+   }
+
+   return;
+}
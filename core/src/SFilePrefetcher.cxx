@@ -0,0 +1,283 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// STL include(s):
+#include <atomic>
+#include <list>
+#include <thread>
+
+// ROOT include(s):
+#include <RVersion.h>
+#include <TROOT.h>
+#include <TFile.h>
+#include <TTree.h>
+#include <TTreeCache.h>
+#include <TChain.h>
+#include <TObjArray.h>
+#include <TString.h>
+
+// Local include(s):
+#include "../include/SFilePrefetcher.h"
+#include "../include/SLogger.h"
+
+namespace {
+
+   /// Description of one file opened in the background
+   struct Request {
+      /// Constructor with the file name and its index in the chain
+      Request( const char* f, Int_t t )
+         : thread(), fileName( f ), file( 0 ), tree( t ), done( false ) {}
+      std::thread       thread; ///< The thread opening the file
+      TString           fileName; ///< Name of the file being prefetched
+      TFile*            file; ///< The file opened by the background thread
+      Int_t             tree; ///< Index of the file in the chain, or -1
+      std::atomic< bool > done; ///< Flag set when the thread finished
+   }; // struct Request
+
+   /**
+    * This function is executed on the background thread. It opens the file,
+    * and reads the first cluster of the main tree through a TTreeCache
+    * holding all of its branches. It doesn't do any logging, as the
+    * message loggers are not meant to be used from multiple threads.
+    *
+    * @param request The request to fill the opened file into
+    * @param treeName The name of the main input tree
+    * @param cacheSize The size of the cache used for the first cluster
+    */
+   void OpenFile( Request* request, TString treeName, Long64_t cacheSize ) {
+
+      TFile* file = TFile::Open( request->fileName, "READ" );
+      if( ( ! file ) || file->IsZombie() ) {
+         delete file;
+         request->done = true;
+         return;
+      }
+
+      TTree* tree = dynamic_cast< TTree* >( file->Get( treeName ) );
+      if( tree && ( tree->GetEntries() > 0 ) && ( cacheSize > 0 ) ) {
+         tree->SetCacheSize( cacheSize );
+         tree->AddBranchToCache( "*", kTRUE );
+         tree->StopCacheLearningPhase();
+         tree->LoadTree( 0 );
+         TTreeCache* cache =
+            dynamic_cast< TTreeCache* >( file->GetCacheRead( tree ) );
+         if( cache ) {
+            cache->FillBuffer();
+         }
+      }
+
+      request->file = file;
+      request->done = true;
+      return;
+   }
+
+   /// Join the thread of a request, and close its file
+   void Close( Request* request ) {
+
+      if( request->thread.joinable() ) {
+         request->thread.join();
+      }
+      if( request->file ) {
+         delete request->file;
+      } else {
+         SLogger logger( "SFilePrefetcher" );
+         logger << DEBUG << "Couldn't prefetch file: " << request->fileName
+                << SLogger::endmsg;
+      }
+      delete request;
+
+      return;
+   }
+
+} // private namespace
+
+/**
+ * The STL threading types are kept out of the header, so that the dictionary
+ * generator would never have to see them.
+ */
+struct SFilePrefetcher::Impl {
+   /// Constructor with the cache size
+   Impl( Long64_t c )
+      : cacheSize( c ), requests(), treeNumber( -1 ), prefetched( -1 ) {}
+   Long64_t cacheSize; ///< Size of the cache used to read the first cluster
+   std::list< Request* > requests; ///< The files opened, oldest first
+   Int_t    treeNumber; ///< The chain file last seen by Update(...)
+   Int_t    prefetched; ///< The chain file prefetched by Update(...)
+}; // struct SFilePrefetcher::Impl
+
+/**
+ * @param cacheSize The size of the cache used to read the first cluster of
+ *                  the main tree, in bytes
+ */
+SFilePrefetcher::SFilePrefetcher( Long64_t cacheSize )
+   : m_impl( new Impl( cacheSize ) ) {
+
+}
+
+/**
+ * This is the only place where the object waits for the background threads.
+ * It's only called once the event loop is finished.
+ */
+SFilePrefetcher::~SFilePrefetcher() {
+
+   std::list< Request* >::iterator itr = m_impl->requests.begin();
+   std::list< Request* >::iterator end = m_impl->requests.end();
+   for( ; itr != end; ++itr ) {
+      Close( *itr );
+   }
+   delete m_impl;
+}
+
+/**
+ * The function should be called after each entry loaded from the chain.
+ * It only starts prefetching a new file when the chain moved to a new file
+ * since the last call.
+ *
+ * @param chain The chain being processed
+ */
+void SFilePrefetcher::Update( const TChain& chain ) {
+
+   const Int_t treeNumber = chain.GetTreeNumber();
+   if( treeNumber == m_impl->treeNumber ) {
+      return;
+   }
+   m_impl->treeNumber = treeNumber;
+
+   // The chain opened the previously prefetched file by now:
+   Release( treeNumber );
+
+   const TObjArray* files = chain.GetListOfFiles();
+   if( ( treeNumber >= 0 ) && ( treeNumber + 1 < files->GetEntries() ) ) {
+      // The chain elements are named after the tree, and their titles are
+      // the file names:
+      const TObject* element = files->At( treeNumber + 1 );
+      Start( element->GetTitle(), element->GetName(), treeNumber + 1 );
+   }
+
+   return;
+}
+
+/**
+ * Used when the files of the chain are not processed in order, like when
+ * the workers take their entry ranges from a work-stealing queue. The file
+ * is only prefetched if it's neither the current file of the chain, nor the
+ * file prefetched already. Nothing is done when the next file is not known.
+ *
+ * @param chain The chain being processed
+ * @param nextTree Index of the chain file that is processed next, or a
+ *                 negative value if it's not known
+ */
+void SFilePrefetcher::Update( const TChain& chain, Int_t nextTree ) {
+
+   m_impl->treeNumber = chain.GetTreeNumber();
+   Release( m_impl->treeNumber );
+
+   if( ( nextTree < 0 ) || ( nextTree == chain.GetTreeNumber() ) ||
+       ( nextTree == m_impl->prefetched ) ) {
+      return;
+   }
+
+   const TObjArray* files = chain.GetListOfFiles();
+   if( nextTree >= files->GetEntries() ) {
+      return;
+   }
+   const TObject* element = files->At( nextTree );
+   Start( element->GetTitle(), element->GetName(), nextTree );
+
+   return;
+}
+
+/**
+ * The function returns right away. The file is opened on a background
+ * thread. Previously prefetched files are closed once their background
+ * threads have finished.
+ *
+ * @param fileName The name of the file to prefetch
+ * @param treeName The name of the main input tree in the file
+ */
+void SFilePrefetcher::Prefetch( const char* fileName,
+                                const char* treeName ) {
+
+   Release( -1 );
+   Start( fileName, treeName, -1 );
+
+   return;
+}
+
+/**
+ * A new background thread is only started if there is no unfinished request
+ * for a file that the chain didn't reach yet. This way a slow filesystem
+ * can't make the object start a new thread on every file switch.
+ *
+ * @param fileName The name of the file to prefetch
+ * @param treeName The name of the main input tree in the file
+ * @param tree The index of the file in the chain, or -1 if not known
+ */
+void SFilePrefetcher::Start( const char* fileName, const char* treeName,
+                             Int_t tree ) {
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 6, 6, 0 )
+   if( m_impl->requests.size() ) {
+      const Request* last = m_impl->requests.back();
+      if( ( ! last->done ) && ( last->tree != m_impl->treeNumber ) ) {
+         return;
+      }
+   }
+
+   // Make sure that ROOT protects its global state:
+   ROOT::EnableThreadSafety();
+
+   Request* request = new Request( fileName, tree );
+   request->thread = std::thread( OpenFile, request, TString( treeName ),
+                                  m_impl->cacheSize );
+   m_impl->requests.push_back( request );
+   m_impl->prefetched = tree;
+#else
+   // Without thread-safety support in ROOT nothing can be done:
+   ( void ) fileName;
+   ( void ) treeName;
+   ( void ) tree;
+#endif // ROOT_VERSION...
+
+   return;
+}
+
+/**
+ * The prefetched files are kept open until the chain has opened them itself,
+ * or until they were superseded by a newer request. So the connection to
+ * the file's server, and the file's data in the server's and the
+ * filesystem's caches, stay warm until the chain needs them. The function
+ * never waits for a background thread, it only closes the files of the
+ * threads that have finished already.
+ *
+ * @param currentTree The index of the chain file being processed
+ */
+void SFilePrefetcher::Release( Int_t currentTree ) {
+
+   std::list< Request* >::iterator itr = m_impl->requests.begin();
+   while( itr != m_impl->requests.end() ) {
+      Request* request = *itr;
+      const Bool_t latest = ( request == m_impl->requests.back() );
+      if( request->done &&
+          ( ( ! latest ) || ( request->tree == currentTree ) ) ) {
+         Close( request );
+         itr = m_impl->requests.erase( itr );
+      } else {
+         ++itr;
+      }
+   }
+   if( m_impl->requests.empty() ) {
+      m_impl->prefetched = -1;
+   }
+
+   return;
+}
@@ -13,6 +13,12 @@
 // System include(s):
 #include <string.h>
 
+// STL include(s):
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <utility>
+
 // ROOT include(s):
 #include <TFile.h>
 #include <TTree.h>
@@ -28,6 +34,7 @@
 // Local include(s):
 #include "../include/SInputData.h"
 #include "../include/SError.h"
+#include "../include/SFileMetadataCache.h"
 #include "../include/SProofManager.h"
 #include "../include/STreeTypeDecoder.h"
 
@@ -43,6 +50,278 @@ const Int_t STree::INPUT_TREE  = 0x1;
 const Int_t STree::OUTPUT_TREE = 0x2;
 const Int_t STree::EVENT_TREE  = 0x4;
 
+const Long64_t STree::DEFAULT_AUTOFLUSH = -30000000;
+
+namespace {
+
+   /// The result of validating a single input file
+   struct FileValidation {
+      /// Default constructor
+      FileValidation()
+         : valid( kFALSE ), entries( 0 ), treeEntries(), messages(),
+           metadata(), newMetadata( kFALSE ) {}
+      Bool_t valid; ///< Flag showing whether the file can be used
+      Long64_t entries; ///< The number of events in the file
+      /// The number of entries in each input tree, for the cache
+      std::vector< std::pair< TString, Long64_t > > treeEntries;
+      /// The messages to print about the file
+      std::vector< std::pair< SMsgType, TString > > messages;
+      /// Description of the file for the shared metadata cache
+      SFileMetadataCache::FileInfo metadata;
+      /// Flag showing that the description should be added to the cache
+      Bool_t newMetadata;
+   }; // struct FileValidation
+
+   /**
+    * Takes the information about the input trees from the shared metadata
+    * cache, if it has all of it.
+    *
+    * @param info The cached description of the file
+    * @param trees The trees of the input data
+    * @param result The result of the validation (output)
+    * @returns <code>kTRUE</code> if the cached description could be used
+    */
+   Bool_t UseCachedInfo( const SFileMetadataCache::FileInfo& info,
+                         const std::map< Int_t, std::vector< STree > >& trees,
+                         FileValidation& result ) {
+
+      Bool_t firstPassed = kFALSE;
+      Long64_t entries = 0;
+      std::vector< std::pair< TString, Long64_t > > treeEntries;
+      std::map< Int_t, std::vector< STree > >::const_iterator trees_itr =
+         trees.begin();
+      std::map< Int_t, std::vector< STree > >::const_iterator trees_end =
+         trees.end();
+      for( ; trees_itr != trees_end; ++trees_itr ) {
+         std::vector< STree >::const_iterator st_itr =
+            trees_itr->second.begin();
+         std::vector< STree >::const_iterator st_end =
+            trees_itr->second.end();
+         for( ; st_itr != st_end; ++st_itr ) {
+
+            // Only input trees are described:
+            if( ! ( st_itr->type & STree::INPUT_TREE ) ) continue;
+
+            // Find the description of the tree:
+            const SFileMetadataCache::TreeInfo* tree = 0;
+            for( size_t i = 0; i < info.trees.size(); ++i ) {
+               if( info.trees[ i ].name == st_itr->treeName ) {
+                  tree = &info.trees[ i ];
+                  break;
+               }
+            }
+            if( ! tree ) return kFALSE;
+
+            // Check how many events are there in the input:
+            if( st_itr->type & STree::EVENT_TREE ) {
+               if( firstPassed && ( tree->entries != entries ) ) {
+                  return kFALSE;
+               } else if( ! firstPassed ) {
+                  firstPassed = kTRUE;
+                  entries = tree->entries;
+               }
+            }
+            treeEntries.push_back( std::make_pair( st_itr->treeName,
+                                                   tree->entries ) );
+         }
+      }
+
+      result.valid = kTRUE;
+      result.entries = entries;
+      result.treeEntries.swap( treeEntries );
+      result.messages.push_back(
+         std::make_pair( DEBUG, "Information found in the metadata cache "
+                         "for: " + info.path ) );
+
+      return kTRUE;
+   }
+
+   /**
+    * This function is executed by the threads validating the input files, so
+    * it doesn't print anything itself. The messages are collected in the
+    * result, and are printed in the order of the input files afterwards.
+    *
+    * @param fileName The name of the file to validate
+    * @param trees The trees of the input data
+    * @param cache The shared metadata cache, or a null pointer
+    * @param result The result of the validation (output)
+    */
+   void ValidateFile( const TString& fileName,
+                      const std::map< Int_t, std::vector< STree > >& trees,
+                      const SFileMetadataCache* cache,
+                      FileValidation& result ) {
+
+      //
+      // Look for the current version of the file in the shared metadata
+      // cache:
+      //
+      SFileMetadataCache::FileInfo& metadata = result.metadata;
+      metadata.path = fileName;
+      const Bool_t describe =
+         ( cache && SFileMetadataCache::GetFileStat( fileName, metadata.size,
+                                                     metadata.mtime ) );
+      if( describe ) {
+         SFileMetadataCache::FileInfo cached;
+         if( cache->Lookup( fileName, metadata.size, metadata.mtime,
+                            cached ) &&
+             UseCachedInfo( cached, trees, result ) ) {
+            return;
+         }
+      }
+
+      //
+      // Open the physical file:
+      //
+      TFile* file = TFile::Open( fileName.Data(), "READ" );
+      if( ! file || file->IsZombie() ) {
+         result.messages.push_back(
+            std::make_pair( WARNING, "Couldn't open file: " + fileName ) );
+         result.messages.push_back(
+            std::make_pair( WARNING,
+                            TString( "Removing it from the input file "
+                                     "list" ) ) );
+         delete file;
+         return;
+      }
+
+      //
+      // Investigate the input trees:
+      //
+      Bool_t firstPassed = kFALSE;
+      Long64_t entries = 0;
+      Int_t numberOfBranches = 0;
+      std::map< Int_t, std::vector< STree > >::const_iterator trees_itr =
+         trees.begin();
+      std::map< Int_t, std::vector< STree > >::const_iterator trees_end =
+         trees.end();
+      for( ; trees_itr != trees_end; ++trees_itr ) {
+
+         result.messages.push_back(
+            std::make_pair( DEBUG, "Investigating \"" +
+                            STreeTypeDecoder::Instance()->GetName(
+                               trees_itr->first ) + "\" types" ) );
+
+         std::vector< STree >::const_iterator st_itr =
+            trees_itr->second.begin();
+         std::vector< STree >::const_iterator st_end =
+            trees_itr->second.end();
+         for( ; st_itr != st_end; ++st_itr ) {
+
+            // Only check the existence of input trees:
+            if( ! ( st_itr->type & STree::INPUT_TREE ) ) continue;
+
+            // Try to access the input tree:
+            TTree* tree =
+               dynamic_cast< TTree* >( file->Get( st_itr->treeName ) );
+            if( ! tree ) {
+               result.messages.push_back(
+                  std::make_pair( WARNING, "Couldn't find tree " +
+                                  st_itr->treeName + " in file " +
+                                  fileName ) );
+               result.messages.push_back(
+                  std::make_pair( WARNING,
+                                  TString( "Removing file from the input "
+                                           "file list" ) ) );
+               file->Close();
+               delete file;
+               return;
+            }
+
+            // Remember how many branches there are in total in the input:
+            const Int_t branchesThisTree = tree->GetNbranches();
+            result.messages.push_back(
+               std::make_pair( DEBUG,
+                               TString::Format( "%i branches in tree %s",
+                                                branchesThisTree,
+                                                st_itr->treeName.Data() ) ) );
+            numberOfBranches += branchesThisTree;
+
+            // Check how many events are there in the input:
+            if( st_itr->type & STree::EVENT_TREE ) {
+               if( firstPassed && ( tree->GetEntriesFast() != entries ) ) {
+                  result.messages.push_back(
+                     std::make_pair( WARNING,
+                                     TString::Format( "Conflict in number of "
+                                                      "entries - Tree %s has "
+                                                      "%lld entries, NOT %lld",
+                                                      st_itr->treeName.Data(),
+                                                      tree->GetEntriesFast(),
+                                                      entries ) ) );
+                  result.messages.push_back(
+                     std::make_pair( WARNING, "Removing " + fileName +
+                                     " from the input file list" ) );
+                  file->Close();
+                  delete file;
+                  return;
+               } else if( ! firstPassed ) {
+                  firstPassed = kTRUE;
+                  entries = tree->GetEntriesFast();
+               }
+            }
+
+            // Remember the size of the tree for the cache:
+            result.treeEntries.push_back(
+               std::make_pair( st_itr->treeName, tree->GetEntriesFast() ) );
+
+            // Describe the tree for the shared cache. The cluster
+            // boundaries are only needed for the event-level trees.
+            if( describe ) {
+               SFileMetadataCache::TreeInfo info;
+               SFileMetadataCache::DescribeTree(
+                  tree, ( st_itr->type & STree::EVENT_TREE ), info );
+               info.name = st_itr->treeName;
+               metadata.trees.push_back( info );
+            }
+         }
+      }
+
+      result.messages.push_back(
+         std::make_pair( DEBUG,
+                         TString::Format( "%i branches in total in file %s",
+                                          numberOfBranches,
+                                          file->GetName() ) ) );
+      result.valid = kTRUE;
+      result.entries = entries;
+      result.newMetadata = describe;
+
+      // Close the input file:
+      file->Close();
+      delete file;
+
+      return;
+   }
+
+   /**
+    * Collects the names of the input trees from a tree map of SInputData.
+    *
+    * @param trees All the trees of an input data
+    * @returns The names of the input trees, in a well defined order
+    */
+   std::vector< TString >
+   InputTreeNames( const std::map< Int_t, std::vector< STree > >& trees ) {
+
+      std::vector< TString > result;
+      std::map< Int_t, std::vector< STree > >::const_iterator tree_itr =
+         trees.begin();
+      std::map< Int_t, std::vector< STree > >::const_iterator tree_end =
+         trees.end();
+      for( ; tree_itr != tree_end; ++tree_itr ) {
+         std::vector< STree >::const_iterator st_itr =
+            tree_itr->second.begin();
+         std::vector< STree >::const_iterator st_end =
+            tree_itr->second.end();
+         for( ; st_itr != st_end; ++st_itr ) {
+            if( st_itr->type & STree::INPUT_TREE ) {
+               result.push_back( st_itr->treeName );
+            }
+         }
+      }
+
+      return result;
+   }
+
+} // private namespace
+
 /**
  * It is only necessary for some technical affairs.
  */
@@ -135,8 +414,13 @@ Bool_t SFile::operator!= ( const SFile& rh ) const {
  */
 STree& STree::operator= ( const STree& parent ) {
 
-   this->treeName = parent.treeName;
-   this->type     = parent.type;
+   this->treeName             = parent.treeName;
+   this->type                 = parent.type;
+   this->compression          = parent.compression;
+   this->basketSize           = parent.basketSize;
+   this->autoFlush            = parent.autoFlush;
+   this->optimizeBasketsAfter = parent.optimizeBasketsAfter;
+   this->passThrough          = parent.passThrough;
 
    return *this;
 }
@@ -152,8 +436,13 @@ STree& STree::operator= ( const STree& parent ) {
  */
 Bool_t STree::operator== ( const STree& rh ) const {
 
-   if( ( this->treeName == rh.treeName ) &&
-       ( this->type     == rh.type ) ) {
+   if( ( this->treeName             == rh.treeName ) &&
+       ( this->type                 == rh.type ) &&
+       ( this->compression          == rh.compression ) &&
+       ( this->basketSize           == rh.basketSize ) &&
+       ( this->autoFlush            == rh.autoFlush ) &&
+       ( this->optimizeBasketsAfter == rh.optimizeBasketsAfter ) &&
+       ( this->passThrough          == rh.passThrough ) ) {
       return kTRUE;
    } else {
       return kFALSE;
@@ -174,6 +463,109 @@ Bool_t STree::operator!= ( const STree& rh ) const {
    return ( ! ( *this == rh ) );
 }
 
+/**
+ * The compression can be given either as a number in ROOT's convention
+ * (100 * algorithm + level), or as "ALGORITHM[:LEVEL]", where the algorithm
+ * is one of ZLIB, LZMA, LZ4 and ZSTD. (Not case sensitive.) When no level is
+ * given, a level that is considered a good compromise for the algorithm is
+ * used. "None" turns off the compression, and "Default" leaves it up to
+ * ROOT.
+ *
+ * @param value The compression setting from the configuration
+ * @param settings The compression settings in ROOT's convention, or -1 for
+ *                 the default of ROOT
+ * @returns <code>kTRUE</code> if the setting could be decoded,
+ *          <code>kFALSE</code> if it was not recognised, or if the algorithm
+ *          is not available in the used ROOT version
+ */
+Bool_t STree::ParseCompression( const TString& value, Int_t& settings ) {
+
+   // Numbers are taken as they are:
+   if( value.IsDigit() ) {
+      settings = value.Atoi();
+      return kTRUE;
+   }
+
+   TString name( value );
+   name.ToUpper();
+   if( name == "DEFAULT" ) {
+      settings = -1;
+      return kTRUE;
+   } else if( name == "NONE" ) {
+      settings = 0;
+      return kTRUE;
+   }
+
+   // Separate the level from the name of the algorithm:
+   Int_t level = -1;
+   const Ssiz_t colon = name.Index( ":" );
+   if( colon != kNPOS ) {
+      const TString levelName = name( colon + 1, name.Length() );
+      if( ! levelName.IsDigit() ) return kFALSE;
+      level = levelName.Atoi();
+      if( level > 9 ) return kFALSE;
+      name.Remove( colon );
+   }
+
+   // Decode the algorithm:
+   Int_t algorithm = 0, defaultLevel = 0;
+   if( name == "ZLIB" ) {
+      algorithm = 1;
+      defaultLevel = 1;
+   } else if( name == "LZMA" ) {
+      algorithm = 2;
+      defaultLevel = 7;
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 6, 10, 0 )
+   } else if( name == "LZ4" ) {
+      algorithm = 4;
+      defaultLevel = 4;
+#endif // ROOT_VERSION...
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 6, 20, 0 )
+   } else if( name == "ZSTD" ) {
+      algorithm = 5;
+      defaultLevel = 5;
+#endif // ROOT_VERSION...
+   } else {
+      return kFALSE;
+   }
+   if( level < 0 ) level = defaultLevel;
+
+   // Level 0 means no compression, whatever the algorithm:
+   settings = ( level ? 100 * algorithm + level : 0 );
+   return kTRUE;
+}
+
+/**
+ * @param settings The compression settings in ROOT's convention
+ * @returns The settings in the format understood by
+ *          STree::ParseCompression(...)
+ */
+TString STree::CompressionName( Int_t settings ) {
+
+   if( settings < 0 ) {
+      return "Default";
+   } else if( settings == 0 ) {
+      return "None";
+   }
+
+   const Int_t level = settings % 100;
+   switch( settings / 100 ) {
+   case 0:
+   case 1:
+      return TString::Format( "ZLIB:%i", level );
+   case 2:
+      return TString::Format( "LZMA:%i", level );
+   case 4:
+      return TString::Format( "LZ4:%i", level );
+   case 5:
+      return TString::Format( "ZSTD:%i", level );
+   default:
+      break;
+   }
+
+   return TString::Format( "%i", settings );
+}
+
 /**
  * The constructor initialises all member data to some initial value.
  */
@@ -182,7 +574,7 @@ SInputData::SInputData( const char* name )
      m_version( 0 ), m_totalLumiGiven( 0 ), m_totalLumiSum( 0 ),
      m_eventsTotal( 0 ), m_neventsmax( -1 ), m_neventsskip( 0 ),
      m_cacheable( kFALSE ), m_skipValid( kFALSE ), m_skipLookup( kFALSE ),
-     m_entry( 0 ), m_dset( 0 ), m_logger( "SInputData" ) {
+     m_validThreads( 1 ), m_entry( 0 ), m_dset( 0 ), m_logger( "SInputData" ) {
 
    REPORT_VERBOSE( "In constructor" );
 }
@@ -309,6 +701,49 @@ void SInputData::ValidateInput( const char* pserver ) {
    return;
 }
 
+/**
+ * Cycles executed in a single event loop read exactly the same input files,
+ * so the files only need to be validated once. The other cycles take over
+ * the results of the validation with this function, keeping their own
+ * output trees and other settings.
+ *
+ * The results are only taken over if the two input data have the same input
+ * files and input trees, as otherwise the validation could come to a
+ * different conclusion.
+ *
+ * @param validated The already validated description of the same input
+ * @returns <code>kTRUE</code> if the results were taken over,
+ *          <code>kFALSE</code> if this input has to be validated by itself
+ */
+Bool_t SInputData::TakeValidation( const SInputData& validated ) {
+
+   // Check that the same files were specified. (The validation may have
+   // removed some files from the other object, in which case it's simpler
+   // to just validate this one as well.)
+   if( ( m_dataSets.size() != validated.m_dataSets.size() ) ||
+       ( m_sfileIn.size() != validated.m_sfileIn.size() ) ||
+       ( m_skipValid != validated.m_skipValid ) ) {
+      return kFALSE;
+   }
+   for( size_t i = 0; i < m_sfileIn.size(); ++i ) {
+      if( ( m_sfileIn[ i ].file != validated.m_sfileIn[ i ].file ) ||
+          ( m_sfileIn[ i ].lumi != validated.m_sfileIn[ i ].lumi ) ) {
+         return kFALSE;
+      }
+   }
+   if( InputTreeNames( m_trees ) != InputTreeNames( validated.m_trees ) ) {
+      return kFALSE;
+   }
+
+   // Take over the information collected from the input files:
+   m_sfileIn = validated.m_sfileIn;
+   m_totalLumiSum = validated.m_totalLumiSum;
+   m_eventsTotal = validated.m_eventsTotal;
+   m_dset = validated.m_dset;
+
+   return kTRUE;
+}
+
 /**
  * This function has a slightly different interface than all the other
  * functions. Unforunately I wasn't able to come up with any better ideas on how
@@ -422,6 +857,7 @@ SInputData& SInputData::operator= ( const SInputData& parent ) {
    this->m_neventsskip = parent.m_neventsskip;
    this->m_cacheable = parent.m_cacheable;
    this->m_skipValid = parent.m_skipValid;
+   this->m_validThreads = parent.m_validThreads;
    this->m_entry = parent.m_entry;
 
    this->m_dset = parent.m_dset;
@@ -502,6 +938,7 @@ void SInputData::Print( const Option_t* ) const {
             << std::endl;
    m_logger << " Skip file lookup   : " << ( GetSkipLookup() ? "Yes" : "No" )
             << std::endl;
+   m_logger << " Validation threads : " << GetValidationThreads() << std::endl;
 
    for( std::vector< SGeneratorCut >::const_iterator gc = m_gencuts.begin();
         gc != m_gencuts.end(); ++gc ) {
@@ -532,6 +969,18 @@ void SInputData::Print( const Option_t* ) const {
                   << "' (name) | '"
                   << STreeTypeDecoder::Instance()->GetName( tree_itr->first )
                   << "' (type)" << std::endl;
+         if( ( tree->type & STree::OUTPUT_TREE ) &&
+             ( tree->type & STree::EVENT_TREE ) ) {
+            m_logger << "                      '"
+                     << STree::CompressionName( tree->compression )
+                     << "' (compression) | '" << tree->basketSize
+                     << "' (basket size) | '" << tree->autoFlush
+                     << "' (AutoFlush)" << std::endl;
+            if( tree->passThrough.Length() ) {
+               m_logger << "                      '" << tree->passThrough
+                        << "' (pass-through)" << std::endl;
+            }
+         }
       }
    }
 
@@ -567,8 +1016,10 @@ TString SInputData::GetStringConfig() const {
                               ( m_cacheable ? "True" : "False" ) );
    result += TString::Format( "               SkipValid=\"%s\"\n",
                               ( m_skipValid ? "True" : "False" ) );
-   result += TString::Format( "               SkipLookup=\"%s\">\n\n",
+   result += TString::Format( "               SkipLookup=\"%s\"\n",
                               ( m_skipLookup ? "True" : "False" ) );
+   result += TString::Format( "               ValidationThreads=\"%d\">\n\n",
+                              m_validThreads );
 
    // Add all the input files:
    std::vector< SFile >::const_iterator f_itr = m_sfileIn.begin();
@@ -606,9 +1057,26 @@ TString SInputData::GetStringConfig() const {
       std::vector< STree >::const_iterator tt_itr = t_itr->second.begin();
       std::vector< STree >::const_iterator tt_end = t_itr->second.end();
       for( ; tt_itr != tt_end; ++tt_itr ) {
-         result += TString::Format( "        <%s Name=\"%s\"/>\n",
+         result += TString::Format( "        <%s Name=\"%s\"",
                                     decoder->GetXMLName( t_itr->first ).Data(),
                                     tt_itr->treeName.Data() );
+         if( ( tt_itr->type & STree::OUTPUT_TREE ) &&
+             ( tt_itr->type & STree::EVENT_TREE ) ) {
+            result += TString::Format( " Compression=\"%s\" "
+                                       "BasketSize=\"%i\" "
+                                       "AutoFlush=\"%lld\" "
+                                       "OptimizeBasketsAfter=\"%lld\"",
+                                       STree::CompressionName(
+                                          tt_itr->compression ).Data(),
+                                       tt_itr->basketSize,
+                                       tt_itr->autoFlush,
+                                       tt_itr->optimizeBasketsAfter );
+            if( tt_itr->passThrough.Length() ) {
+               result += TString::Format( " PassThrough=\"%s\"",
+                                          tt_itr->passThrough.Data() );
+            }
+         }
+         result += "/>\n";
       }
    }
 
@@ -658,11 +1126,12 @@ void SInputData::ValidateInputFiles() {
    Int_t  fileInfoInDataset = 0;
 
    //
-   // Loop over all the specified input files:
+   // Collect the input files that have to be opened:
    //
-   std::vector< SFile >::iterator sf_itr = m_sfileIn.begin();
-   std::vector< SFile >::iterator sf_end = m_sfileIn.end();
-   for( ; sf_itr != sf_end; ++sf_itr ) {
+   std::vector< size_t > toOpen;
+   for( size_t i = 0; i < m_sfileIn.size(); ++i ) {
+
+      SFile& sfile = m_sfileIn[ i ];
 
       //
       // If it's a local file, then turn it into a full path name. This makes
@@ -670,154 +1139,169 @@ void SInputData::ValidateInputFiles() {
       // configuration file to define the input of the job. (Which in this case
       // would be the output of a pervious job.)
       //
-      if( ( ! sf_itr->file.Contains( ":/" ) ) &&
-          ( sf_itr->file[ 0 ] != '/' ) ) {
-         sf_itr->file = gSystem->pwd() + ( "/" + sf_itr->file );
+      if( ( ! sfile.file.Contains( ":/" ) ) && ( sfile.file[ 0 ] != '/' ) ) {
+         sfile.file = gSystem->pwd() + ( "/" + sfile.file );
       }
 
       //
       // Try to load the file's information from the cache. This is *much*
       // faster than querying the file itself...
       //
-      if( m_cacheable && LoadInfoOnFile( sf_itr.operator->(), filecoll ) ) {
+      if( m_cacheable && LoadInfoOnFile( &sfile, filecoll ) ) {
          ++fileInfoInDataset;
          continue;
       }
 
-      //
-      // Open the physical file:
-      //
-      TFile* file = TFile::Open( sf_itr->file.Data(), "READ" );
-      if( ! file || file->IsZombie() ) {
-         m_logger << WARNING << "Couldn't open file: " << sf_itr->file.Data()
-                  << SLogger::endmsg;
-         m_logger << WARNING << "Removing it from the input file list"
-                  << SLogger::endmsg;
-         // Erasing the file from the file list is a bit tricky actually:
-         sf_itr = m_sfileIn.erase( sf_itr );
-         sf_end = m_sfileIn.end();
-         m_totalLumiSum -= sf_itr->lumi;
-         // Exit at this point if there are no more files in the dataset:
-         if( ! m_sfileIn.size() ) break;
-         --sf_itr;
-         continue;
-      }
-
-      try {
+      toOpen.push_back( i );
+   }
 
-         // If any of the files had to be opened, then the cache will need to be
-         // updated in the ROOT file:
-         cacheUpdated = kTRUE;
+   //
+   // Decide how many threads to use for opening the files. The files are
+   // opened one by one, unless the user asked for more threads. Opening a
+   // file on network storage mostly means waiting, so zero (or a negative
+   // value) asks for as many threads as there are cores.
+   //
+   Int_t nThreads = m_validThreads;
+   if( nThreads <= 0 ) {
+      nThreads = std::thread::hardware_concurrency();
+   }
+   if( nThreads > static_cast< Int_t >( toOpen.size() ) ) {
+      nThreads = toOpen.size();
+   }
+#if ROOT_VERSION_CODE < ROOT_VERSION( 6, 6, 0 )
+   // Without thread-safety support in ROOT the files have to be opened one
+   // by one:
+   nThreads = 1;
+#endif // ROOT_VERSION...
+   if( nThreads <= 0 ) nThreads = 1;
 
-         //
-         // Create/retrieve the object storing the information about the file:
-         //
-         TFileInfo* fileinfo = 0;
-         if( m_cacheable ) {
-            fileinfo = AccessFileInfo( sf_itr.operator->(), filecoll );
+   //
+   // Validate the files, with each thread taking the next file that no other
+   // thread has taken yet:
+   //
+   std::vector< FileValidation > results( toOpen.size() );
+   std::atomic< size_t > nextFile( 0 );
+   const std::map< Int_t, std::vector< STree > >& trees = m_trees;
+   const std::vector< SFile >& files = m_sfileIn;
+   const SFileMetadataCache* cache =
+      ( SFileMetadataCache::Instance()->IsEnabled() ?
+        SFileMetadataCache::Instance() : 0 );
+   auto validate = [ &toOpen, &results, &nextFile, &trees, &files,
+                     cache ]() {
+      for( size_t i = nextFile++; i < toOpen.size(); i = nextFile++ ) {
+         try {
+            ValidateFile( files[ toOpen[ i ] ].file, trees, cache,
+                          results[ i ] );
+         } catch( const std::exception& error ) {
+            results[ i ].valid = kFALSE;
+            results[ i ].messages.push_back(
+               std::make_pair( WARNING, "Exception caught while validating "
+                               "file " + files[ toOpen[ i ] ].file + ": " +
+                               error.what() ) );
+         } catch( ... ) {
+            results[ i ].valid = kFALSE;
+            results[ i ].messages.push_back(
+               std::make_pair( WARNING, "Unknown exception caught while "
+                               "validating file " +
+                               files[ toOpen[ i ] ].file ) );
          }
+      }
+   };
+   if( nThreads > 1 ) {
+#if ROOT_VERSION_CODE >= ROOT_VERSION( 6, 6, 0 )
+      m_logger << DEBUG << "Validating " << toOpen.size() << " files on "
+               << nThreads << " threads" << SLogger::endmsg;
+      // Make sure that ROOT protects its global state:
+      ROOT::EnableThreadSafety();
+      std::vector< std::thread > threads;
+      for( Int_t i = 0; i < nThreads; ++i ) {
+         threads.push_back( std::thread( validate ) );
+      }
+      for( size_t i = 0; i < threads.size(); ++i ) {
+         threads[ i ].join();
+      }
+#endif // ROOT_VERSION...
+   } else {
+      validate();
+   }
 
-         //
-         // Investigate the input trees:
-         //
-         Bool_t firstPassed = kFALSE;
-         Long64_t entries = 0;
-         Int_t numberOfBranches = 0;
-         // Try to find all the input trees in the file info:
-         std::map< Int_t, std::vector< STree > >::const_iterator trees_itr =
-            m_trees.begin();
-         std::map< Int_t, std::vector< STree > >::const_iterator trees_end =
-            m_trees.end();
-         for( ; trees_itr != trees_end; ++trees_itr ) {
-
-            m_logger << DEBUG << "Investigating \""
-                     << STreeTypeDecoder::Instance()->GetName( trees_itr->first )
-                     << "\" types" << SLogger::endmsg;
-
-            std::vector< STree >::const_iterator st_itr =
-               trees_itr->second.begin();
-            std::vector< STree >::const_iterator st_end =
-               trees_itr->second.end();
-            for( ; st_itr != st_end; ++st_itr ) {
+   //
+   // Collect the results in the order in which the files were specified, so
+   // the outcome doesn't depend on which thread finished first:
+   //
+   std::vector< SFile > validFiles;
+   std::vector< SFileMetadataCache::FileInfo > newMetadata;
+   std::vector< size_t >::const_iterator open_itr = toOpen.begin();
+   for( size_t i = 0; i < m_sfileIn.size(); ++i ) {
 
-               // Only check the existence of input trees:
-               if( ! ( st_itr->type & STree::INPUT_TREE ) ) continue;
+      SFile& sfile = m_sfileIn[ i ];
 
-               // Try to access the input tree:
-               TTree* tree =
-                  dynamic_cast< TTree* >( file->Get( st_itr->treeName ) );
-               if( ! tree ) {
-                  m_logger << WARNING << "Couldn't find tree "
-                           << st_itr->treeName << " in file " << sf_itr->file
-                           << SLogger::endmsg;
-                  m_logger << WARNING
-                           << "Removing file from the input file list"
-                           << SLogger::endmsg;
-                  throw SError( SError::SkipFile );
-               }
+      // Files loaded from the cache need no further checks:
+      if( ( open_itr == toOpen.end() ) || ( *open_itr != i ) ) {
+         validFiles.push_back( sfile );
+         continue;
+      }
+      const FileValidation& result = results[ open_itr - toOpen.begin() ];
+      ++open_itr;
+
+      // Print the messages about the file:
+      std::vector< std::pair< SMsgType, TString > >::const_iterator m_itr =
+         result.messages.begin();
+      std::vector< std::pair< SMsgType, TString > >::const_iterator m_end =
+         result.messages.end();
+      for( ; m_itr != m_end; ++m_itr ) {
+         m_logger << m_itr->first << m_itr->second << SLogger::endmsg;
+      }
 
-               // Remember how many branches there are in total in the input:
-               const Int_t branchesThisTree = tree->GetNbranches();
-               m_logger << DEBUG << branchesThisTree << " branches in tree "
-                        << st_itr->treeName << SLogger::endmsg;
-               numberOfBranches += branchesThisTree;
+      // Drop the file if it can't be used:
+      if( ! result.valid ) {
+         m_totalLumiSum -= sfile.lumi;
+         continue;
+      }
 
-               // Check how many events are there in the input:
-               if( st_itr->type & STree::EVENT_TREE ) {
-                  if( firstPassed && ( tree->GetEntriesFast() != entries ) ) {
-                     m_logger << WARNING
-                              << "Conflict in number of entries - Tree "
-                              << st_itr->treeName << " has "
-                              << tree->GetEntriesFast() << " entries, NOT "
-                              << entries << SLogger::endmsg;
-                     m_logger << WARNING << "Removing " << sf_itr->file
-                              << " from the input file list" << SLogger::endmsg;
-                     throw SError( SError::SkipFile );
-                  } else if( ! firstPassed ) {
-                     firstPassed = kTRUE;
-                     entries = tree->GetEntriesFast();
-                  }
-               }
+      // If any of the files had to be opened, then the cache will need to be
+      // updated in the ROOT file:
+      cacheUpdated = kTRUE;
 
-               //
-               // Save the information about this tree into the cache:
-               //
-               if( m_cacheable ) {
-                  TFileInfoMeta* tree_info =
-                     new TFileInfoMeta( st_itr->treeName, "TTree",
-                                        tree->GetEntriesFast() );
-                  tree_info->SetName( st_itr->treeName );
-                  tree_info->SetTitle( "Meta data info for a TTree" );
-                  if( ! fileinfo->AddMetaData( tree_info ) ) {
-                     REPORT_ERROR( "There was a problem caching meta-data for "
-                                   "TTree: " << st_itr->treeName );
-                  } else {
-                     REPORT_VERBOSE( "Meta-data cached for TTree: "
-                                     << st_itr->treeName );
-                  }
-               }
+      //
+      // Save the information about the trees into the cache:
+      //
+      if( m_cacheable ) {
+         TFileInfo* fileinfo = AccessFileInfo( &sfile, filecoll );
+         std::vector< std::pair< TString, Long64_t > >::const_iterator t_itr =
+            result.treeEntries.begin();
+         std::vector< std::pair< TString, Long64_t > >::const_iterator t_end =
+            result.treeEntries.end();
+         for( ; t_itr != t_end; ++t_itr ) {
+            TFileInfoMeta* tree_info =
+               new TFileInfoMeta( t_itr->first, "TTree", t_itr->second );
+            tree_info->SetName( t_itr->first );
+            tree_info->SetTitle( "Meta data info for a TTree" );
+            if( ! fileinfo->AddMetaData( tree_info ) ) {
+               REPORT_ERROR( "There was a problem caching meta-data for "
+                             "TTree: " << t_itr->first );
+            } else {
+               REPORT_VERBOSE( "Meta-data cached for TTree: "
+                               << t_itr->first );
             }
          }
+      }
 
-         // Update the ID information:
-         sf_itr->events = entries;
-         AddEvents( entries );
-
-         m_logger << DEBUG << numberOfBranches << " branches in total in file "
-                  << file->GetName() << SLogger::endmsg;
-
-      } catch( const SError& ) {
-         m_totalLumiSum -= sf_itr->lumi;
-         sf_itr = m_sfileIn.erase( sf_itr );
-         sf_end = m_sfileIn.end();
-         // Exit at this point if there are no more files in the dataset:
-         if( ! m_sfileIn.size() ) break;
-         --sf_itr;
+      // Remember the description of the file for the shared cache:
+      if( result.newMetadata ) {
+         newMetadata.push_back( result.metadata );
       }
 
-      // Close the input file:
-      file->Close();
-      delete file;
+      // Update the ID information:
+      sfile.events = result.entries;
+      AddEvents( result.entries );
+      validFiles.push_back( sfile );
+   }
+   m_sfileIn.swap( validFiles );
+
+   // Share the descriptions of the newly opened files with other jobs:
+   if( cache && newMetadata.size() ) {
+      SFileMetadataCache::Instance()->Store( newMetadata );
    }
 
    //
@@ -0,0 +1,126 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// System include(s):
+#include <string.h>
+
+// STL include(s):
+#include <algorithm>
+
+// ROOT include(s):
+#include <TBranch.h>
+#include <TLeaf.h>
+
+// Local include(s):
+#include "../include/SInputShare.h"
+#include "../include/SConstants.h"
+#include "../include/SError.h"
+
+SInputShare::SInputShare()
+   : TNamed( SFrame::InputShareName, "Input branches shared between cycles" ),
+     m_variables() {
+
+}
+
+void SInputShare::Clear( Option_t* ) {
+
+   m_variables.clear();
+   return;
+}
+
+/**
+ * @param br The branch that was connected to a variable
+ * @param address The address of the variable connected to the branch
+ * @param type The type of the variable connected to the branch
+ */
+void SInputShare::Register( const TBranch* br, void* address,
+                            const std::type_info& type ) {
+
+   m_variables[ br ] = variable_type( address, &type );
+   return;
+}
+
+/**
+ * Since ROOT can't check the type of the variables that don't read the
+ * branch themselves, this function makes sure that all the cycles use the
+ * same type of variable for the same branch.
+ *
+ * @param br The branch to look for
+ * @param type The type of the variable that the caller would use
+ * @returns The address of the variable that the branch is read into, or a
+ *          null pointer if no cycle connected to the branch so far
+ */
+void* SInputShare::Find( const TBranch* br,
+                         const std::type_info& type ) const {
+
+   std::map< const TBranch*, variable_type >::const_iterator itr =
+      m_variables.find( br );
+   if( itr == m_variables.end() ) {
+      return 0;
+   }
+
+   if( *( itr->second.second ) != type ) {
+      SError error( SError::SkipCycle );
+      error << "Branch \"" << br->GetName() << "\" is read into variables of "
+            << "different types by the fused cycles";
+      throw error;
+   }
+
+   return itr->second.first;
+}
+
+/**
+ * @param target The variable of the current cycle
+ * @param source The variable of the cycle reading the branch
+ * @param size The size of the target variable in bytes
+ * @param leaf For array variables the leaf describing the current length
+ *             of the array, a null pointer otherwise
+ */
+SInputCopy::SInputCopy( void* target, const void* source, size_t size,
+                        TLeaf* leaf )
+   : m_target( target ), m_source( source ), m_size( size ),
+     m_leaf( leaf ), m_copy( 0 ) {
+
+}
+
+/**
+ * @param target The object pointer of the current cycle
+ * @param source The object pointer of the cycle reading the branch
+ * @param copy The function assigning the object of the source to the object
+ *             of the target
+ */
+SInputCopy::SInputCopy( void* target, const void* source,
+                        copy_function copy )
+   : m_target( target ), m_source( source ), m_size( 0 ), m_leaf( 0 ),
+     m_copy( copy ) {
+
+}
+
+void SInputCopy::Copy() const {
+
+   // Objects are copied by their own assignment operator:
+   if( m_copy ) {
+      ( *m_copy )( m_target, m_source );
+      return;
+   }
+
+   // Only copy the elements of variable length arrays that were actually
+   // read for the current event:
+   size_t size = m_size;
+   if( m_leaf ) {
+      size = std::min( size, static_cast< size_t >( m_leaf->GetLen() *
+                                                    m_leaf->GetLenType() ) );
+   }
+
+   memcpy( m_target, m_source, size );
+   return;
+}
@@ -13,14 +13,349 @@
 // System include(s):
 extern "C" {
 #   include <unistd.h>
+#   include <pthread.h>
 }
 
 // STL include(s):
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 // Local include(s):
 #include "../include/SLogWriter.h"
 
+namespace {
+
+   /// Mutex keeping the lines printed from multiple threads in one piece
+   std::mutex s_writeMutex;
+
+} // private namespace
+
+/**
+ * The asynchronous writer uses a bounded multi-producer, single-consumer ring
+ * buffer. Each slot carries a sequence number, which tells the producers and
+ * the consumer whose turn it is to use the slot. So the threads sending
+ * messages never need to lock a mutex while the writer thread is busy. The
+ * strings of the slots are re-used, so once they have grown to the typical
+ * message length, sending a message doesn't allocate any memory either.
+ *
+ * The STL threading types are kept out of the header, so that the dictionary
+ * generator would never have to see them.
+ */
+struct SLogWriter::AsyncImpl {
+   /// One line of message in the ring buffer
+   struct Record {
+      std::atomic< size_t > sequence; ///< Sequence number of the slot
+      SMsgType              type; ///< Type of the message
+      std::string           line; ///< The formatted line
+   }; // struct Record
+
+   /// Constructor starting the writer thread
+   AsyncImpl( const SLogWriter* w, size_t size, bool d );
+   /// Destructor, stopping the writer thread
+   ~AsyncImpl();
+
+   /// Put a line into the buffer
+   bool Push( SMsgType type, const std::string& line, bool mayDrop );
+   /// Wait until all lines pushed so far are written
+   void Flush();
+   /// Write out all the lines, and stop the writer thread
+   void Stop();
+   /// Function executed by the writer thread
+   void Run();
+   /// Write all the lines waiting in the buffer (writer thread only)
+   bool Drain( std::string& batch );
+
+   /// Make sure that the output is in a consistent state when forking
+   static void PrepareFork();
+   /// Release the locks in the parent process after forking
+   static void ParentAfterFork();
+   /// Switch to synchronous writing in the child process
+   static void ChildAfterFork();
+   /// Write all remaining lines when the process exits
+   static void AtExit();
+
+   const SLogWriter*       writer; ///< The writer formatting the lines
+   size_t                  mask; ///< Size of the buffer minus one
+   Record*                 records; ///< The ring buffer
+   std::atomic< size_t >   enqueuePos; ///< Next slot to be claimed by senders
+   size_t                  dequeuePos; ///< Next slot to be written
+   std::atomic< size_t >   writtenPos; ///< All slots before this are written
+   std::atomic< size_t >   dropped; ///< Number of dropped lines
+   size_t                  reportedDropped; ///< Dropped lines reported so far
+   bool                    drop; ///< Drop new lines when the buffer is full
+   std::atomic< bool >     running; ///< Flag showing that lines are accepted
+   std::atomic< bool >     sleeping; ///< Flag showing that the writer sleeps
+   bool                    stop; ///< Flag telling the writer thread to stop
+   std::mutex              mutex; ///< Mutex used for the condition variables
+   std::condition_variable wakeup; ///< Signalled to wake up the writer
+   std::condition_variable written; ///< Signalled after writing a batch
+   std::thread*            thread; ///< The writer thread
+}; // struct SLogWriter::AsyncImpl
+
+/**
+ * @param w The writer formatting the lines
+ * @param size The minimal number of lines in the buffer. It's rounded up to
+ *             a power of two.
+ * @param d Flag showing whether new lines should be dropped when the buffer
+ *          is full
+ */
+SLogWriter::AsyncImpl::AsyncImpl( const SLogWriter* w, size_t size, bool d )
+   : writer( w ), mask( 0 ), records( 0 ), enqueuePos( 0 ), dequeuePos( 0 ),
+     writtenPos( 0 ), dropped( 0 ), reportedDropped( 0 ), drop( d ),
+     running( false ), sleeping( false ), stop( false ), thread( 0 ) {
+
+   size_t capacity = 16;
+   while( capacity < size ) {
+      capacity *= 2;
+   }
+   mask = capacity - 1;
+   records = new Record[ capacity ];
+   for( size_t i = 0; i < capacity; ++i ) {
+      records[ i ].sequence.store( i, std::memory_order_relaxed );
+   }
+
+   thread = new std::thread( &AsyncImpl::Run, this );
+   running.store( true, std::memory_order_release );
+}
+
+SLogWriter::AsyncImpl::~AsyncImpl() {
+
+   Stop();
+   delete[] records;
+}
+
+/**
+ * @param type The type of the message
+ * @param line The formatted line
+ * @param mayDrop Flag showing whether the line may be dropped if the buffer
+ *                is full. If not, the function waits for free space.
+ * @returns <code>true</code> if the line was put into the buffer,
+ *          <code>false</code> if it was dropped
+ */
+bool SLogWriter::AsyncImpl::Push( SMsgType type, const std::string& line,
+                                  bool mayDrop ) {
+
+   // Claim a slot in the buffer:
+   Record* record = 0;
+   size_t pos = enqueuePos.load( std::memory_order_relaxed );
+   for( ; ; ) {
+      record = &records[ pos & mask ];
+      const size_t seq = record->sequence.load( std::memory_order_acquire );
+      const ptrdiff_t diff = static_cast< ptrdiff_t >( seq - pos );
+      if( diff == 0 ) {
+         if( enqueuePos.compare_exchange_weak( pos, pos + 1,
+                                               std::memory_order_relaxed ) ) {
+            break;
+         }
+      } else if( diff < 0 ) {
+         // The buffer is full:
+         if( mayDrop ) {
+            dropped.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+         }
+         wakeup.notify_one();
+         std::this_thread::yield();
+         pos = enqueuePos.load( std::memory_order_relaxed );
+      } else {
+         pos = enqueuePos.load( std::memory_order_relaxed );
+      }
+   }
+
+   // Fill the slot, and hand it over to the writer thread:
+   record->type = type;
+   record->line.assign( line );
+   record->sequence.store( pos + 1, std::memory_order_release );
+
+   // Wake up the writer if it's waiting for new lines. It also wakes up on
+   // its own periodically, so a missed notification only delays the output a
+   // little.
+   if( sleeping.load() ) {
+      wakeup.notify_one();
+   }
+
+   return true;
+}
+
+void SLogWriter::AsyncImpl::Flush() {
+
+   if( ! running.load( std::memory_order_acquire ) ) {
+      return;
+   }
+   const size_t target = enqueuePos.load( std::memory_order_acquire );
+   std::unique_lock< std::mutex > lock( mutex );
+   wakeup.notify_one();
+   written.wait( lock, [ this, target ]() {
+         return ( ( static_cast< ptrdiff_t >(
+                       writtenPos.load( std::memory_order_acquire ) -
+                       target ) >= 0 ) || ( ! thread ) ); } );
+
+   return;
+}
+
+/**
+ * New lines are written synchronously once this function is called.
+ */
+void SLogWriter::AsyncImpl::Stop() {
+
+   running.store( false, std::memory_order_release );
+   {
+      std::lock_guard< std::mutex > lock( mutex );
+      if( ! thread ) {
+         return;
+      }
+      stop = true;
+   }
+   wakeup.notify_all();
+   thread->join();
+
+   std::lock_guard< std::mutex > lock( mutex );
+   delete thread;
+   thread = 0;
+   written.notify_all();
+
+   return;
+}
+
+/**
+ * The thread writes everything that it finds in the buffer in one go, and
+ * then waits for new lines. When told to stop, it writes everything that's
+ * left in the buffer before returning.
+ */
+void SLogWriter::AsyncImpl::Run() {
+
+   std::string batch;
+   for( ; ; ) {
+      if( Drain( batch ) ) {
+         continue;
+      }
+      std::unique_lock< std::mutex > lock( mutex );
+      if( stop ) {
+         break;
+      }
+      sleeping.store( true );
+      const Record& next = records[ dequeuePos & mask ];
+      wakeup.wait_for( lock, std::chrono::milliseconds( 100 ),
+                       [ this, &next ]() {
+                          return ( stop ||
+                                   ( next.sequence.load(
+                                        std::memory_order_acquire ) ==
+                                     dequeuePos + 1 ) ); } );
+      sleeping.store( false );
+   }
+   Drain( batch );
+
+   return;
+}
+
+/**
+ * @param batch Buffer used for collecting the formatted output
+ * @returns <code>true</code> if anything was written
+ */
+bool SLogWriter::AsyncImpl::Drain( std::string& batch ) {
+
+   const bool colour = isatty( STDOUT_FILENO );
+   batch.clear();
+
+   // Collect the lines waiting in the buffer:
+   size_t nLines = 0;
+   for( ; nLines <= mask; ++nLines ) {
+      Record& record = records[ dequeuePos & mask ];
+      if( record.sequence.load( std::memory_order_acquire ) !=
+          dequeuePos + 1 ) {
+         break;
+      }
+      writer->Format( batch, record.type, record.line, colour );
+      record.sequence.store( dequeuePos + mask + 1,
+                             std::memory_order_release );
+      ++dequeuePos;
+   }
+
+   // Tell the user if some lines were lost:
+   const size_t nDropped = dropped.load( std::memory_order_relaxed );
+   if( nDropped != reportedDropped ) {
+      std::ostringstream line;
+      line.setf( std::ios::adjustfield, std::ios::left );
+      line.width( 18 );
+      line << "SLogWriter" << " : " << ( nDropped - reportedDropped )
+           << " message(s) dropped, the log buffer was full";
+      writer->Format( batch, WARNING, line.str(), colour );
+      reportedDropped = nDropped;
+   }
+
+   // Write them with a single flush:
+   if( batch.size() ) {
+      std::lock_guard< std::mutex > lock( s_writeMutex );
+      std::cout.write( batch.data(), batch.size() );
+      std::cout.flush();
+   }
+
+   // Notify the threads waiting for the lines to be written:
+   if( nLines ) {
+      writtenPos.store( dequeuePos, std::memory_order_release );
+      std::lock_guard< std::mutex > lock( mutex );
+      written.notify_all();
+   }
+
+   return ( nLines != 0 );
+}
+
+/**
+ * The buffer is written out before forking, and no output is written while
+ * the process is being forked.
+ */
+void SLogWriter::AsyncImpl::PrepareFork() {
+
+   if( m_instance && m_instance->m_async ) {
+      m_instance->m_async->Flush();
+      s_writeMutex.lock();
+      m_instance->m_async->mutex.lock();
+   } else {
+      s_writeMutex.lock();
+   }
+   return;
+}
+
+void SLogWriter::AsyncImpl::ParentAfterFork() {
+
+   if( m_instance && m_instance->m_async ) {
+      m_instance->m_async->mutex.unlock();
+   }
+   s_writeMutex.unlock();
+   return;
+}
+
+/**
+ * The writer thread doesn't exist in the child process. The thread object
+ * can't be deleted safely, so it's just forgotten about, and the child writes
+ * its messages synchronously. Lines sent by other threads of the parent
+ * after the flush are only written by the parent.
+ */
+void SLogWriter::AsyncImpl::ChildAfterFork() {
+
+   if( m_instance && m_instance->m_async ) {
+      m_instance->m_async->running.store( false );
+      m_instance->m_async->thread = 0;
+      m_instance->m_async->mutex.unlock();
+   }
+   s_writeMutex.unlock();
+   return;
+}
+
+void SLogWriter::AsyncImpl::AtExit() {
+
+   if( m_instance ) {
+      m_instance->SetAsync( 0 );
+   }
+   return;
+}
+
 // Initialize the static member(s):
 SLogWriter* SLogWriter::m_instance = 0;
 
@@ -49,6 +384,9 @@ SLogWriter* SLogWriter::Instance() {
  */
 SLogWriter::~SLogWriter() {
 
+   // Write out all the buffered messages:
+   delete m_async;
+
    // Reset the instance pointer, so the object would be properly re-created
    // when it's needed:
    m_instance = 0;
@@ -59,23 +397,36 @@ SLogWriter::~SLogWriter() {
  * message to the console. The function assumes that the message has no
  * line breaks and that it has been formatted by SLogger.
  *
+ * In asynchronous mode the line is only put into the buffer of the writer
+ * thread, unless it's a FATAL message. Those are always written out together
+ * with all the lines before them, as the process is probably about to stop.
+ *
  * @param type The message type
  * @param line A single line of message to be displayed.
  */
 void SLogWriter::Write( SMsgType type, const std::string& line ) const {
 
    if( type < m_minType ) return;
-   std::map< SMsgType, std::string >::const_iterator stype;
-   if( ( stype = m_typeMap.find( type ) ) == m_typeMap.end() ) return;
+   if( m_typeMap.find( type ) == m_typeMap.end() ) return;
+
+   // Hand the line over to the writer thread if there is one:
+   if( m_async && m_async->running.load( std::memory_order_acquire ) ) {
+      if( m_async->Push( type, line,
+                         ( m_async->drop && ( type < FATAL ) ) ) &&
+          ( type >= FATAL ) ) {
+         m_async->Flush();
+      }
+      return;
+   }
 
    // Print the output in colours only if it's printed to the console. If it's
    // redirected to a logfile, then produce simple black on while output.
-   if( isatty( STDOUT_FILENO ) ) {
-      std::cout << m_colorMap.find( type )->second << " (" << stype->second
-                << ")  " << line << "\033[0m" << std::endl;
-   } else {
-      std::cout << " (" << stype->second << ")  " << line << std::endl;
-   }
+   std::string output;
+   Format( output, type, line, isatty( STDOUT_FILENO ) );
+
+   // Make sure that lines from different threads don't get mixed up:
+   std::lock_guard< std::mutex > lock( s_writeMutex );
+   std::cout << output << std::flush;
 
    return;
 }
@@ -104,12 +455,87 @@ SMsgType SLogWriter::GetMinType() const {
    return m_minType;
 }
 
+/**
+ * The function must not be called while other threads may be sending
+ * messages. Switching back to synchronous mode writes out all the messages
+ * still waiting in the buffer.
+ *
+ * @param bufferSize The number of lines that can wait in the buffer of the
+ *                   writer thread. Zero means synchronous writing.
+ * @param dropWhenFull If <code>true</code>, new lines are dropped while the
+ *                     buffer is full, otherwise the sender waits for free
+ *                     space in it
+ */
+void SLogWriter::SetAsync( unsigned int bufferSize, bool dropWhenFull ) {
+
+   delete m_async;
+   m_async = 0;
+   if( ! bufferSize ) {
+      return;
+   }
+
+   // The framework may fork the process while the writer thread is running,
+   // and the buffer has to be written out when the process exits:
+   static bool handlersInstalled = false;
+   if( ! handlersInstalled ) {
+      pthread_atfork( &AsyncImpl::PrepareFork, &AsyncImpl::ParentAfterFork,
+                      &AsyncImpl::ChildAfterFork );
+      atexit( &AsyncImpl::AtExit );
+      handlersInstalled = true;
+   }
+
+   m_async = new AsyncImpl( this, bufferSize, dropWhenFull );
+
+   return;
+}
+
+bool SLogWriter::IsAsync() const {
+
+   return ( m_async && m_async->running.load( std::memory_order_acquire ) );
+}
+
+/**
+ * It doesn't do anything in synchronous mode, as then every line is flushed
+ * right away.
+ */
+void SLogWriter::Flush() const {
+
+   if( m_async ) {
+      m_async->Flush();
+   }
+   return;
+}
+
+/**
+ * @param output The string to append the formatted line to
+ * @param type The message type
+ * @param line A single line of message to be displayed
+ * @param colour Flag showing whether the line should be coloured
+ */
+void SLogWriter::Format( std::string& output, SMsgType type,
+                         const std::string& line, bool colour ) const {
+
+   if( colour ) {
+      output += m_colorMap.find( type )->second;
+   }
+   output += " (";
+   output += m_typeMap.find( type )->second;
+   output += ")  ";
+   output += line;
+   if( colour ) {
+      output += "\033[0m";
+   }
+   output += '\n';
+
+   return;
+}
+
 /**
  * The constructor takes care of filling the two std::map-s that are
  * used for generating the nice, coloured output.
  */
 SLogWriter::SLogWriter()
-   : m_minType( INFO ) {
+   : m_async( 0 ), m_minType( INFO ) {
 
    m_typeMap[ VERBOSE ] = "VERBOSE";
    m_typeMap[ DEBUG ]   = " DEBUG ";
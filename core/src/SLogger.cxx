@@ -143,22 +143,28 @@ void SLogger::Send( const SMsgType type, const std::string& message ) const {
       source_name += "...";
    }
 
+   //
+   // Create the prefix of the lines, with the source name left-adjusted
+   // in a fixed width column:
+   //
+   source_name.resize( MAXIMUM_SOURCE_NAME_LENGTH, ' ' );
+   source_name += " : ";
+   std::string line;
+
    //
    // Slice the recieved message into lines:
    //
    for( ; ; ) {
 
       current_pos = message.find( '\n', previous_pos );
-      std::string line = message.substr( previous_pos, current_pos -
-                                         previous_pos );
-
-      std::ostringstream message_to_send;
-      // I have to call the modifiers like this, otherwise g++ get's confused
-      // with the operators...
-      message_to_send.setf( std::ios::adjustfield, std::ios::left );
-      message_to_send.width( MAXIMUM_SOURCE_NAME_LENGTH );
-      message_to_send << source_name << " : " << line;
-      m_logWriter->Write( type, message_to_send.str() );
+
+      // Re-use the same string for all the lines, without going through
+      // a new std::ostringstream for each of them:
+      line.assign( source_name );
+      line.append( message, previous_pos,
+                   ( current_pos == message.npos ? message.npos :
+                     current_pos - previous_pos ) );
+      m_logWriter->Write( type, line );
 
       if( current_pos == message.npos ) break;
       previous_pos = current_pos + 1;
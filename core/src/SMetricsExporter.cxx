@@ -0,0 +1,441 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// System include(s):
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+// STL include(s):
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ROOT include(s):
+#include <TFile.h>
+#include <TSystem.h>
+
+// Local include(s):
+#include "../include/SMetricsExporter.h"
+#include "../include/SProgressMonitor.h"
+#include "../include/SLogger.h"
+
+namespace {
+
+   /// Event counters of one input data block
+   struct Counters {
+      /// Default constructor
+      Counters()
+         : processed( 0 ), skipped( 0 ), fileIndex( 0 ), nFiles( 0 ),
+           bytesRead( 0 ) {}
+      Long64_t processed; ///< The number of processed events
+      Long64_t skipped; ///< The number of skipped events
+      Long64_t fileIndex; ///< Index of the input file being processed
+      Long64_t nFiles; ///< The number of input files
+      Long64_t bytesRead; ///< Bytes read from the input files
+   }; // struct Counters
+
+   /**
+    * Escapes a label value according to the Prometheus text format.
+    *
+    * @param value The label value to escape
+    * @returns The escaped value
+    */
+   std::string EscapeLabel( const char* value ) {
+
+      std::string result;
+      for( const char* c = value; *c; ++c ) {
+         if( *c == '\\' ) {
+            result += "\\\\";
+         } else if( *c == '"' ) {
+            result += "\\\"";
+         } else if( *c == '\n' ) {
+            result += "\\n";
+         } else {
+            result += *c;
+         }
+      }
+
+      return result;
+   }
+
+   /**
+    * @param monitor The monitor of a cycle
+    * @returns The labels identifying the input data processed by the cycle
+    */
+   std::string Labels( const SProgressMonitor* monitor ) {
+
+      return ( "cycle=\"" + EscapeLabel( monitor->GetCycleName() ) +
+               "\",inputdata=\"" + EscapeLabel( monitor->GetInputType() ) +
+               "\",version=\"" + EscapeLabel( monitor->GetInputVersion() ) +
+               "\"" );
+   }
+
+   /**
+    * @param counters The counters to add the values of the monitor to
+    * @param monitor The monitor of a cycle
+    */
+   void AddCounters( Counters& counters, const SProgressMonitor* monitor ) {
+
+      counters.processed += monitor->GetProcessedEvents();
+      counters.skipped += monitor->GetSkippedEvents();
+      counters.fileIndex = std::max( counters.fileIndex,
+                                     monitor->GetFileIndex() );
+      counters.nFiles = monitor->GetFileCount();
+      counters.bytesRead += monitor->GetBytesRead();
+      return;
+   }
+
+   /// Add the description of a metric to the output
+   void AddHeader( TString& output, const char* name, const char* type,
+                   const char* help ) {
+
+      output += TString::Format( "# HELP %s %s\n# TYPE %s %s\n", name, help,
+                                 name, type );
+      return;
+   }
+
+   /// Get the current time in seconds since the epoch
+   Double_t EpochTime() {
+
+      return std::chrono::duration< Double_t >(
+         std::chrono::system_clock::now().time_since_epoch() ).count();
+   }
+
+} // private namespace
+
+/**
+ * The STL threading types are kept out of the header, so that the dictionary
+ * generator would never have to see them.
+ */
+struct SMetricsExporter::Impl {
+   /// Default constructor
+   Impl()
+      : fileName(), interval( 0.0 ), mutex(), condition(), stop( false ),
+        thread( 0 ), monitors(), finished(), startTime( EpochTime() ),
+        lastTime( std::chrono::steady_clock::now() ), lastBytesRead( 0 ),
+        logger( "SMetricsExporter" ) {}
+   /// Function executed by the writer thread
+   void Run();
+   /// Write the metrics file (with the mutex held)
+   void Write();
+
+   /// Lock the mutex before the process is forked
+   static void PrepareFork();
+   /// Unlock the mutex in the parent process after forking
+   static void ParentAfterFork();
+   /// Unlock the mutex, and forget about the writer thread in the child
+   static void ChildAfterFork();
+
+   TString                 fileName; ///< The metrics file to write
+   Double_t                interval; ///< Time between two updates in seconds
+   std::mutex              mutex; ///< Mutex protecting all the members
+   std::condition_variable condition; ///< Signalled when stopping the thread
+   bool                    stop; ///< Flag telling the thread to stop
+   std::thread*            thread; ///< The writer thread, if running
+   /// The monitors of the cycles running at the moment
+   std::vector< const SProgressMonitor* > monitors;
+   /// The counters of the monitors that finished already
+   std::map< std::string, Counters > finished;
+   Double_t                startTime; ///< Start of the job, since the epoch
+   /// The time of the last update
+   std::chrono::steady_clock::time_point lastTime;
+   Long64_t                lastBytesRead; ///< Bytes read at the last update
+   SLogger                 logger; ///< Logger used while holding the mutex
+}; // struct SMetricsExporter::Impl
+
+// Initialize the static member(s):
+SMetricsExporter* SMetricsExporter::m_instance = 0;
+
+/**
+ * This function implements the singleton design pattern for the class.
+ */
+SMetricsExporter* SMetricsExporter::Instance() {
+
+   if( ! m_instance ) {
+      m_instance = new SMetricsExporter();
+   }
+
+   return m_instance;
+}
+
+SMetricsExporter::SMetricsExporter()
+   : m_impl( new Impl() ) {
+
+}
+
+/**
+ * The destructor stops the writer thread, after writing the metrics file one
+ * last time.
+ */
+SMetricsExporter::~SMetricsExporter() {
+
+   Stop();
+   delete m_impl;
+   m_instance = 0;
+}
+
+/**
+ * @param fileName The metrics file to write. Nothing is done if it's empty.
+ * @param interval The time between two updates of the file in seconds
+ */
+void SMetricsExporter::Start( const TString& fileName, Double_t interval ) {
+
+   Stop();
+   if( ! fileName.Length() ) {
+      return;
+   }
+
+   // The framework may fork the process while the writer thread is running,
+   // in which case the mutex must not be left locked in the child:
+   static bool atforkInstalled = false;
+   if( ! atforkInstalled ) {
+      pthread_atfork( &Impl::PrepareFork, &Impl::ParentAfterFork,
+                      &Impl::ChildAfterFork );
+      atforkInstalled = true;
+   }
+
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   m_impl->fileName = fileName;
+   m_impl->interval = ( interval > 0.0 ? interval : 15.0 );
+   m_impl->stop = false;
+   m_impl->lastTime = std::chrono::steady_clock::now();
+   m_impl->Write();
+   m_impl->thread = new std::thread( &Impl::Run, m_impl );
+
+   return;
+}
+
+void SMetricsExporter::Stop() {
+
+   {
+      std::lock_guard< std::mutex > lock( m_impl->mutex );
+      if( ! m_impl->thread ) {
+         return;
+      }
+      m_impl->stop = true;
+   }
+   m_impl->condition.notify_all();
+   m_impl->thread->join();
+
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   delete m_impl->thread;
+   m_impl->thread = 0;
+   m_impl->Write();
+
+   return;
+}
+
+/**
+ * @param monitor The monitor of a cycle that just started processing an
+ *                input data block
+ */
+void SMetricsExporter::Register( const SProgressMonitor* monitor ) {
+
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   m_impl->monitors.push_back( monitor );
+
+   return;
+}
+
+/**
+ * @param monitor The monitor of a cycle that finished processing an input
+ *                data block
+ */
+void SMetricsExporter::Unregister( const SProgressMonitor* monitor ) {
+
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   std::vector< const SProgressMonitor* >::iterator itr =
+      std::find( m_impl->monitors.begin(), m_impl->monitors.end(), monitor );
+   if( itr == m_impl->monitors.end() ) {
+      return;
+   }
+   AddCounters( m_impl->finished[ Labels( monitor ) ], monitor );
+   m_impl->monitors.erase( itr );
+
+   return;
+}
+
+void SMetricsExporter::Impl::PrepareFork() {
+
+   if( m_instance ) {
+      m_instance->m_impl->mutex.lock();
+   }
+   return;
+}
+
+void SMetricsExporter::Impl::ParentAfterFork() {
+
+   if( m_instance ) {
+      m_instance->m_impl->mutex.unlock();
+   }
+   return;
+}
+
+/**
+ * The writer thread doesn't exist in the child process, and the child must
+ * not overwrite the metrics file of its parent. The thread object can't be
+ * deleted safely, so it's just forgotten about.
+ */
+void SMetricsExporter::Impl::ChildAfterFork() {
+
+   if( m_instance ) {
+      m_instance->m_impl->thread = 0;
+      m_instance->m_impl->mutex.unlock();
+   }
+   return;
+}
+
+void SMetricsExporter::Impl::Run() {
+
+   std::unique_lock< std::mutex > lock( mutex );
+   const std::chrono::duration< Double_t > period( interval );
+   while( ! stop ) {
+      if( condition.wait_for( lock, period, [ this ]() { return stop; } ) ) {
+         break;
+      }
+      Write();
+   }
+
+   return;
+}
+
+/**
+ * The file is written under a temporary name first, and is then renamed to
+ * its final name. So the collector reading it never sees a half-written
+ * file.
+ */
+void SMetricsExporter::Impl::Write() {
+
+   // Collect the event counters of all the input data blocks:
+   std::map< std::string, Counters > counters( finished );
+   for( std::vector< const SProgressMonitor* >::const_iterator itr =
+           monitors.begin(); itr != monitors.end(); ++itr ) {
+      AddCounters( counters[ Labels( *itr ) ], *itr );
+   }
+
+   // Collect the process level quantities:
+   const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+   const Double_t elapsed =
+      std::chrono::duration< Double_t >( now - lastTime ).count();
+   // The bytes are counted by the monitors, as the input may be read by
+   // forked processes:
+   Long64_t bytesRead = 0;
+   std::map< std::string, Counters >::const_iterator itr;
+   for( itr = counters.begin(); itr != counters.end(); ++itr ) {
+      bytesRead += itr->second.bytesRead;
+   }
+   const Double_t throughput = ( elapsed > 0.0 ?
+                                 ( bytesRead - lastBytesRead ) / elapsed :
+                                 0.0 );
+   lastTime = now;
+   lastBytesRead = bytesRead;
+   ProcInfo_t procinfo;
+   gSystem->GetProcInfo( &procinfo );
+   struct rusage usage;
+   Long64_t peakMemory = 0;
+   if( ! getrusage( RUSAGE_SELF, &usage ) ) {
+#ifdef __APPLE__
+      peakMemory = usage.ru_maxrss;
+#else
+      peakMemory = usage.ru_maxrss * 1024;
+#endif // __APPLE__
+   }
+
+   //
+   // Format the metrics:
+   //
+   TString output;
+   AddHeader( output, "sframe_events_processed_total", "counter",
+              "Number of events processed by the cycles" );
+   for( itr = counters.begin(); itr != counters.end(); ++itr ) {
+      output += TString::Format( "sframe_events_processed_total{%s} %lld\n",
+                                 itr->first.c_str(), itr->second.processed );
+   }
+   AddHeader( output, "sframe_events_skipped_total", "counter",
+              "Number of events skipped by the cycles" );
+   for( itr = counters.begin(); itr != counters.end(); ++itr ) {
+      output += TString::Format( "sframe_events_skipped_total{%s} %lld\n",
+                                 itr->first.c_str(), itr->second.skipped );
+   }
+   AddHeader( output, "sframe_input_file_index", "gauge",
+              "Index of the input file being processed" );
+   for( itr = counters.begin(); itr != counters.end(); ++itr ) {
+      output += TString::Format( "sframe_input_file_index{%s} %lld\n",
+                                 itr->first.c_str(), itr->second.fileIndex );
+   }
+   AddHeader( output, "sframe_input_files", "gauge",
+              "Number of input files of the input data" );
+   for( itr = counters.begin(); itr != counters.end(); ++itr ) {
+      output += TString::Format( "sframe_input_files{%s} %lld\n",
+                                 itr->first.c_str(), itr->second.nFiles );
+   }
+   AddHeader( output, "sframe_read_bytes_total", "counter",
+              "Bytes read from the input files by the cycles" );
+   for( itr = counters.begin(); itr != counters.end(); ++itr ) {
+      output += TString::Format( "sframe_read_bytes_total{%s} %lld\n",
+                                 itr->first.c_str(), itr->second.bytesRead );
+   }
+   AddHeader( output, "sframe_read_throughput_bytes_per_second", "gauge",
+              "Input read throughput since the previous update of the file" );
+   output += TString::Format( "sframe_read_throughput_bytes_per_second %.1f\n",
+                              throughput );
+   AddHeader( output, "sframe_written_bytes_total", "counter",
+              "Bytes written to ROOT files by the process" );
+   output += TString::Format( "sframe_written_bytes_total %lld\n",
+                              TFile::GetFileBytesWritten() );
+   AddHeader( output, "sframe_resident_memory_bytes", "gauge",
+              "Resident memory of the process" );
+   output += TString::Format( "sframe_resident_memory_bytes %lld\n",
+                              static_cast< Long64_t >( procinfo.fMemResident ) *
+                              1024 );
+   AddHeader( output, "sframe_peak_resident_memory_bytes", "gauge",
+              "Peak resident memory of the process" );
+   output += TString::Format( "sframe_peak_resident_memory_bytes %lld\n",
+                              peakMemory );
+   AddHeader( output, "sframe_start_time_seconds", "gauge",
+              "Start time of the job since the epoch" );
+   output += TString::Format( "sframe_start_time_seconds %.3f\n", startTime );
+   AddHeader( output, "sframe_last_update_time_seconds", "gauge",
+              "Time of the last update of this file since the epoch" );
+   output += TString::Format( "sframe_last_update_time_seconds %.3f\n",
+                              EpochTime() );
+
+   //
+   // Write the file, and move it into its final place:
+   //
+   const TString tmpName = TString::Format( "%s.%d.tmp", fileName.Data(),
+                                            static_cast< int >( getpid() ) );
+   FILE* file = fopen( tmpName.Data(), "w" );
+   if( ! file ) {
+      logger << WARNING << "Couldn't write metrics file: " << tmpName
+             << SLogger::endmsg;
+      return;
+   }
+   const bool written = ( fputs( output.Data(), file ) >= 0 );
+   const bool closed = ( fclose( file ) == 0 );
+   if( ( ! written ) || ( ! closed ) ||
+       rename( tmpName.Data(), fileName.Data() ) ) {
+      logger << WARNING << "Couldn't update metrics file: " << fileName
+             << SLogger::endmsg;
+      unlink( tmpName.Data() );
+   }
+
+   return;
+}
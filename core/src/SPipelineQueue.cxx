@@ -0,0 +1,156 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// STL include(s):
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// ROOT include(s):
+#include <TFile.h>
+
+// Local include(s):
+#include "../include/SPipelineQueue.h"
+#include "../include/SConstants.h"
+
+/**
+ * The STL threading types are kept out of the header, so that the dictionary
+ * generator would never have to see them.
+ */
+struct SPipelineQueue::Impl {
+   /// Constructor with the capacity of the queue
+   Impl( UInt_t c )
+      : capacity( c ? c : 1 ), files(), closed( false ), aborted( false ) {}
+   std::mutex              mutex; ///< Mutex protecting the queue
+   std::condition_variable notFull; ///< Signalled when a chunk is taken
+   std::condition_variable notEmpty; ///< Signalled when a chunk is added
+   size_t                  capacity; ///< Maximal number of chunks
+   std::deque< TFile* >    files; ///< The chunks waiting to be processed
+   bool                    closed; ///< No more chunks will be added
+   bool                    aborted; ///< The processing was aborted
+}; // struct SPipelineQueue::Impl
+
+/**
+ * @param capacity The maximal number of chunks waiting in the queue. A value
+ *                 of zero is interpreted as one.
+ * @param chunkSize The number of events in one chunk. A value smaller than
+ *                  one is interpreted as one.
+ * @param writeIntermediate Flag showing whether the upstream cycle should
+ *                          write its output trees into its output file too
+ */
+SPipelineQueue::SPipelineQueue( UInt_t capacity, Long64_t chunkSize,
+                                Bool_t writeIntermediate )
+   : TNamed( SFrame::PipelineQueueName, "Events handed over between cycles" ),
+     m_impl( new Impl( capacity ) ),
+     m_chunkSize( chunkSize > 0 ? chunkSize : 1 ),
+     m_writeIntermediate( writeIntermediate ) {
+
+}
+
+/**
+ * The chunks that were not taken from the queue are deleted.
+ */
+SPipelineQueue::~SPipelineQueue() {
+
+   for( std::deque< TFile* >::iterator itr = m_impl->files.begin();
+        itr != m_impl->files.end(); ++itr ) {
+      delete *itr;
+   }
+   delete m_impl;
+}
+
+Long64_t SPipelineQueue::GetChunkSize() const {
+
+   return m_chunkSize;
+}
+
+/**
+ * By default the output trees of the upstream cycle are only written into
+ * the chunks handed over to the downstream cycle, and never to disk.
+ */
+Bool_t SPipelineQueue::GetWriteIntermediate() const {
+
+   return m_writeIntermediate;
+}
+
+/**
+ * The function blocks while the queue is full. The end-of-block markers
+ * count against the capacity of the queue as well.
+ *
+ * @param file The file to add to the queue, or a null pointer to mark the
+ *             end of an input data block
+ * @returns <code>kTRUE</code> if the file was added to the queue,
+ *          <code>kFALSE</code> if the processing was aborted. In the latter
+ *          case the caller keeps the ownership of the file.
+ */
+Bool_t SPipelineQueue::Push( TFile* file ) {
+
+   std::unique_lock< std::mutex > lock( m_impl->mutex );
+   while( ( ! m_impl->aborted ) &&
+          ( m_impl->files.size() >= m_impl->capacity ) ) {
+      m_impl->notFull.wait( lock );
+   }
+   if( m_impl->aborted ) {
+      return kFALSE;
+   }
+
+   m_impl->files.push_back( file );
+   m_impl->notEmpty.notify_one();
+
+   return kTRUE;
+}
+
+/**
+ * The function blocks while the queue is empty, and the producer didn't
+ * close it yet.
+ *
+ * @param file The file taken from the queue, or a null pointer at the end
+ *             of an input data block (output)
+ * @returns <code>kTRUE</code> if a file was taken from the queue,
+ *          <code>kFALSE</code> if there will be no more files
+ */
+Bool_t SPipelineQueue::Pop( TFile*& file ) {
+
+   std::unique_lock< std::mutex > lock( m_impl->mutex );
+   while( ( ! m_impl->aborted ) && ( ! m_impl->closed ) &&
+          m_impl->files.empty() ) {
+      m_impl->notEmpty.wait( lock );
+   }
+   if( m_impl->aborted || m_impl->files.empty() ) {
+      return kFALSE;
+   }
+
+   file = m_impl->files.front();
+   m_impl->files.pop_front();
+   m_impl->notFull.notify_one();
+
+   return kTRUE;
+}
+
+void SPipelineQueue::Close() {
+
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   m_impl->closed = true;
+   m_impl->notEmpty.notify_all();
+
+   return;
+}
+
+void SPipelineQueue::Abort() {
+
+   std::lock_guard< std::mutex > lock( m_impl->mutex );
+   m_impl->aborted = true;
+   m_impl->notFull.notify_all();
+   m_impl->notEmpty.notify_all();
+
+   return;
+}
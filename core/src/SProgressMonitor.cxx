@@ -0,0 +1,409 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// System include(s):
+extern "C" {
+#   include <sys/mman.h>
+}
+#include <stdio.h>
+#include <unistd.h>
+#include <new>
+
+// STL include(s):
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// ROOT include(s):
+#include <TString.h>
+#include <TFile.h>
+
+// Local include(s):
+#include "../include/SProgressMonitor.h"
+#include "../include/SMetricsExporter.h"
+#include "../include/SInputData.h"
+#include "../include/SConstants.h"
+#include "../include/SError.h"
+#include "../include/SLogger.h"
+
+/**
+ * The counters updated by the event loop. They are kept in a separate
+ * structure, so that they could be put into memory shared with forked
+ * processes.
+ */
+struct SProgressMonitor::Counters {
+   /// Default constructor
+   Counters() : events( 0 ), skipped( 0 ), fileIndex( 0 ), bytesRead( 0 ) {}
+   std::atomic< Long64_t > events; ///< The number of processed events
+   std::atomic< Long64_t > skipped; ///< The number of skipped events
+   std::atomic< Long64_t > fileIndex; ///< Index of the current input file
+   std::atomic< Long64_t > bytesRead; ///< Bytes read from the input files
+}; // struct SProgressMonitor::Counters
+
+/**
+ * The STL threading types are kept out of the header, so that the dictionary
+ * generator would never have to see them.
+ */
+struct SProgressMonitor::Impl {
+   /// Constructor with the configuration of the monitor
+   Impl( const char* n, const SInputData& id, Long64_t t, Double_t i,
+         SMsgType ty, const char* f )
+      : name( n ), inputType( id.GetType() ), inputVersion( id.GetVersion() ),
+        nFiles( id.GetSFileIn().size() ), total( t ), interval( i ),
+        type( ty ), fileName( f ), counters( 0 ), shared( false ),
+        ownCounters( true ),
+        mutex(), condition(), stop( false ), thread(),
+        logger( std::string( n ) ), start(), lastTime(), lastEvents( 0 ),
+        worker( 0 ), lastBytesRead( TFile::GetFileBytesRead() ) {}
+   /// Function executed by the monitoring thread
+   void Run();
+   /// Report the current state of the processing
+   void Report( bool finished );
+
+   TString                 name; ///< Name of the monitored cycle
+   TString                 inputType; ///< Type of the processed input data
+   TString                 inputVersion; ///< Version of the input data
+   Long64_t                nFiles; ///< Number of input files
+   Long64_t                total; ///< Events to process, or a negative value
+   Double_t                interval; ///< Time between reports in seconds
+   SMsgType                type; ///< Message type used for the reports
+   TString                 fileName; ///< File to append the JSON reports to
+   Counters*               counters; ///< The counters of the event loop
+   bool                    shared; ///< The counters are in shared memory
+   bool                    ownCounters; ///< The counters belong to the object
+   std::mutex              mutex; ///< Mutex used for waking up the thread
+   std::condition_variable condition; ///< Signalled when stopping the thread
+   bool                    stop; ///< Flag telling the thread to stop
+   std::thread             thread; ///< The monitoring thread
+   SLogger                 logger; ///< Logger only used by the thread
+   /// The time when the monitoring started
+   std::chrono::steady_clock::time_point start;
+   /// The time of the last report
+   std::chrono::steady_clock::time_point lastTime;
+   Long64_t                lastEvents; ///< Processed events at the last report
+   Int_t                   worker; ///< Identifier of the monitor in the process
+   /// Bytes read by the process at the last UpdateBytesRead() call
+   std::atomic< Long64_t > lastBytesRead;
+}; // struct SProgressMonitor::Impl
+
+namespace {
+
+   /// Counter used for giving an identifier to each monitor
+   std::atomic< Int_t > s_workerCounter( 0 );
+
+   /**
+    * Makes sure that a string can be put between quotes in the JSON output.
+    *
+    * @param text The text to escape
+    * @returns The escaped text
+    */
+   TString EscapeJSON( const TString& text ) {
+
+      TString result;
+      for( Ssiz_t i = 0; i < text.Length(); ++i ) {
+         const char c = text[ i ];
+         if( ( c == '"' ) || ( c == '\\' ) ) {
+            result += '\\';
+            result += c;
+         } else if( static_cast< unsigned char >( c ) < 0x20 ) {
+            result += ' ';
+         } else {
+            result += c;
+         }
+      }
+
+      return result;
+   }
+
+} // private namespace
+
+/**
+ * The thread wakes up after every interval to report the progress, until it
+ * is told to stop. It then writes a last line into the progress file.
+ */
+void SProgressMonitor::Impl::Run() {
+
+   std::unique_lock< std::mutex > lock( mutex );
+   const std::chrono::duration< Double_t > period( interval );
+   while( ! stop ) {
+      if( condition.wait_for( lock, period, [ this ]() { return stop; } ) ) {
+         break;
+      }
+      Report( false );
+   }
+   if( fileName.Length() ) {
+      Report( true );
+   }
+
+   return;
+}
+
+/**
+ * @param finished Flag showing that the processing has finished. The final
+ *                 report is only written to the progress file.
+ */
+void SProgressMonitor::Impl::Report( bool finished ) {
+
+   // Sample the counter:
+   const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+   const Long64_t processed =
+      counters->events.load( std::memory_order_relaxed );
+
+   // Calculate the rates. (Using floating point numbers, so that nothing
+   // would overflow for large samples.)
+   const Double_t sinceLast =
+      std::chrono::duration< Double_t >( now - lastTime ).count();
+   const Double_t sinceStart =
+      std::chrono::duration< Double_t >( now - start ).count();
+   const Double_t rate = ( sinceLast > 0.0 ?
+                           ( processed - lastEvents ) / sinceLast : 0.0 );
+   const Double_t average = ( sinceStart > 0.0 ?
+                              processed / sinceStart : 0.0 );
+   Double_t remaining = -1.0;
+   if( ( total >= 0 ) && ( average > 0.0 ) ) {
+      remaining = ( processed < total ? ( total - processed ) / average : 0.0 );
+   }
+   lastTime = now;
+   lastEvents = processed;
+
+   // Print the message:
+   if( ! finished ) {
+      TString message = TString::Format( "%lld", processed );
+      if( total >= 0 ) {
+         message += TString::Format( " / %lld", total );
+      }
+      message += TString::Format( " events processed - %.1f Hz "
+                                  "(average %.1f Hz)", rate, average );
+      if( remaining >= 0.0 ) {
+         if( remaining > 3600.0 ) {
+            message += TString::Format( ", ~ %.2g hours left",
+                                        remaining / 3600.0 );
+         } else if( remaining > 60.0 ) {
+            message += TString::Format( ", ~ %.2g minutes left",
+                                        remaining / 60.0 );
+         } else {
+            message += TString::Format( ", ~ %.2g seconds left", remaining );
+         }
+      }
+      logger << type << message << SLogger::endmsg;
+   }
+
+   // Append a line to the progress file:
+   if( ! fileName.Length() ) {
+      return;
+   }
+   const Double_t epoch = std::chrono::duration< Double_t >(
+      std::chrono::system_clock::now().time_since_epoch() ).count();
+   const TString line =
+      TString::Format( "{\"time\":%.3f,\"name\":\"%s\",\"pid\":%d,"
+                       "\"worker\":%d,\"processed\":%lld,\"total\":%lld,"
+                       "\"rate\":%.2f,\"average_rate\":%.2f,"
+                       "\"remaining_time\":%.1f,\"finished\":%s}\n",
+                       epoch, EscapeJSON( name ).Data(),
+                       static_cast< int >( getpid() ), worker, processed,
+                       total, rate, average, remaining,
+                       ( finished ? "true" : "false" ) );
+   FILE* file = fopen( fileName.Data(), "a" );
+   if( ! file ) {
+      logger << WARNING << "Couldn't open progress file: " << fileName
+             << SLogger::endmsg;
+      fileName = "";
+      return;
+   }
+   // Unbuffered, so that the line is appended with a single write:
+   setvbuf( file, 0, _IONBF, 0 );
+   fputs( line.Data(), file );
+   fclose( file );
+
+   return;
+}
+
+/**
+ * @param name Name of the monitored cycle, used in the reports
+ * @param id The input data processed by the cycle
+ * @param totalEvents The number of events that will be processed, or a
+ *                    negative value if it's not known
+ * @param interval The time between two reports in seconds
+ * @param type The message type used for printing the reports
+ * @param fileName Name of the file to append the JSON reports to. No file
+ *                 is written if it's empty.
+ * @param shared If <code>kTRUE</code>, the counters are put in memory that is
+ *               shared with the processes forked from this one later on
+ * @param parent If not null, the events are counted in the counters of this
+ *               monitor. (Used in processes forked by the framework, with a
+ *               parent monitor having its counters in shared memory.)
+ */
+SProgressMonitor::SProgressMonitor( const char* name, const SInputData& id,
+                                    Long64_t totalEvents, Double_t interval,
+                                    SMsgType type, const char* fileName,
+                                    Bool_t shared,
+                                    const SProgressMonitor* parent )
+   : TNamed( SFrame::ProgressMonitorName, name ),
+     m_impl( new Impl( name, id, totalEvents, interval, type, fileName ) ) {
+
+   if( parent ) {
+      m_impl->counters = parent->m_impl->counters;
+      m_impl->shared = parent->m_impl->shared;
+      m_impl->ownCounters = false;
+   } else if( shared ) {
+      void* memory = mmap( 0, sizeof( Counters ), PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+      if( memory == MAP_FAILED ) {
+         delete m_impl;
+         throw SError( "Couldn't allocate shared memory for the progress "
+                       "monitor", SError::SkipCycle );
+      }
+      m_impl->counters = new( memory ) Counters();
+      m_impl->shared = true;
+   } else {
+      m_impl->counters = new Counters();
+   }
+   m_impl->worker = s_workerCounter++;
+   m_impl->start = std::chrono::steady_clock::now();
+   m_impl->lastTime = m_impl->start;
+   if( interval > 0.0 ) {
+      m_impl->thread = std::thread( &Impl::Run, m_impl );
+   }
+   SMetricsExporter::Instance()->Register( this );
+}
+
+SProgressMonitor::~SProgressMonitor() {
+
+   SMetricsExporter::Instance()->Unregister( this );
+   if( m_impl->thread.joinable() ) {
+      {
+         std::lock_guard< std::mutex > lock( m_impl->mutex );
+         m_impl->stop = true;
+      }
+      m_impl->condition.notify_all();
+      m_impl->thread.join();
+   }
+   if( ! m_impl->ownCounters ) {
+      // The counters are deleted by the parent monitor
+   } else if( m_impl->shared ) {
+      m_impl->counters->~Counters();
+      munmap( m_impl->counters, sizeof( Counters ) );
+   } else {
+      delete m_impl->counters;
+   }
+   delete m_impl;
+}
+
+/**
+ * This function is called from the event loop, so it is kept as cheap as
+ * possible.
+ *
+ * @param events The number of events processed since the last call
+ */
+void SProgressMonitor::AddEvents( Long64_t events ) {
+
+   m_impl->counters->events.fetch_add( events, std::memory_order_relaxed );
+   return;
+}
+
+/**
+ * @param events The number of events skipped since the last call
+ */
+void SProgressMonitor::AddSkippedEvents( Long64_t events ) {
+
+   m_impl->counters->skipped.fetch_add( events, std::memory_order_relaxed );
+   return;
+}
+
+/**
+ * @param index The index of the input file being processed, starting from 1
+ */
+void SProgressMonitor::SetFileIndex( Long64_t index ) {
+
+   m_impl->counters->fileIndex.store( index, std::memory_order_relaxed );
+   return;
+}
+
+/**
+ * ROOT only counts the bytes read by the whole process, so the function
+ * adds the change of that counter since its last call to the counter of the
+ * monitor. It can be called by all the threads sharing the monitor, as each
+ * change of the process counter is only added once. It's called for every
+ * event, so the shared counters are only touched when some bytes were read
+ * since the last call.
+ */
+void SProgressMonitor::UpdateBytesRead() {
+
+   const Long64_t current = TFile::GetFileBytesRead();
+   if( current == m_impl->lastBytesRead.load( std::memory_order_relaxed ) ) {
+      return;
+   }
+   const Long64_t last = m_impl->lastBytesRead.exchange( current );
+   m_impl->counters->bytesRead.fetch_add( current - last,
+                                          std::memory_order_relaxed );
+   return;
+}
+
+/**
+ * A forked process inherits the bytes read by its parent. It has to call
+ * this function before starting its event loop, so that those bytes would
+ * not be counted once more.
+ */
+void SProgressMonitor::ResetBytesRead() {
+
+   m_impl->lastBytesRead.store( TFile::GetFileBytesRead() );
+   return;
+}
+
+const char* SProgressMonitor::GetCycleName() const {
+
+   return m_impl->name.Data();
+}
+
+const char* SProgressMonitor::GetInputType() const {
+
+   return m_impl->inputType.Data();
+}
+
+const char* SProgressMonitor::GetInputVersion() const {
+
+   return m_impl->inputVersion.Data();
+}
+
+Long64_t SProgressMonitor::GetProcessedEvents() const {
+
+   return m_impl->counters->events.load( std::memory_order_relaxed );
+}
+
+Long64_t SProgressMonitor::GetSkippedEvents() const {
+
+   return m_impl->counters->skipped.load( std::memory_order_relaxed );
+}
+
+Long64_t SProgressMonitor::GetBytesRead() const {
+
+   return m_impl->counters->bytesRead.load( std::memory_order_relaxed );
+}
+
+Long64_t SProgressMonitor::GetFileIndex() const {
+
+   return m_impl->counters->fileIndex.load( std::memory_order_relaxed );
+}
+
+/**
+ * In PROOF mode the input files are shared between the workers, so each
+ * worker only processes a part of them.
+ *
+ * @returns The number of input files of the input data
+ */
+Long64_t SProgressMonitor::GetFileCount() const {
+
+   return m_impl->nFiles;
+}
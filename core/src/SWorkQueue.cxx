@@ -0,0 +1,262 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+
+// System include(s):
+extern "C" {
+#   include <sys/mman.h>
+}
+#include <new>
+
+// STL include(s):
+#include <atomic>
+#include <thread>
+
+// Local include(s):
+#include "../include/SWorkQueue.h"
+#include "../include/SError.h"
+
+/**
+ * The deques only ever shrink. The ranges of a worker occupy the
+ * [head, tail) index range of the common range array. The owner takes ranges
+ * from the head, thieves take them from the tail. Since the object may live
+ * in memory shared between processes, a spin lock made of an atomic flag is
+ * used instead of a mutex.
+ */
+struct SWorkQueue::Deque {
+   /// Constructor with the index boundaries of the deque
+   Deque( Long64_t h, Long64_t t ) : head( h ), tail( t ) {
+      lock.clear();
+   }
+   /// Acquire the lock of the deque
+   void Lock() {
+      while( lock.test_and_set( std::memory_order_acquire ) ) {
+         std::this_thread::yield();
+      }
+   }
+   /// Release the lock of the deque
+   void Unlock() {
+      lock.clear( std::memory_order_release );
+   }
+   /// Number of ranges left in the deque (without locking)
+   Long64_t Size() const {
+      return ( tail.load( std::memory_order_relaxed ) -
+               head.load( std::memory_order_relaxed ) );
+   }
+   std::atomic_flag        lock; ///< Lock protecting the deque
+   std::atomic< Long64_t > head; ///< Index of the first range in the deque
+   std::atomic< Long64_t > tail; ///< One past the index of the last range
+}; // struct SWorkQueue::Deque
+
+/**
+ * The constructor distributes the ranges between the workers in contiguous
+ * blocks, having roughly the same number of entries each.
+ *
+ * @param ranges All the entry ranges to process
+ * @param nWorkers The number of workers using the queue
+ * @param shared If <code>kTRUE</code>, the queue is put in memory that is
+ *               shared with the processes forked from this one later on
+ */
+SWorkQueue::SWorkQueue( const std::vector< SEntryRange >& ranges,
+                        UInt_t nWorkers, Bool_t shared )
+   : m_nWorkers( nWorkers ? nWorkers : 1 ), m_ranges( 0 ), m_deques( 0 ),
+     m_stopped( 0 ), m_memory( 0 ), m_memorySize( 0 ), m_shared( shared ) {
+
+   //
+   // Allocate the memory for the deques, the ranges and the stop flag:
+   //
+   m_memorySize = m_nWorkers * sizeof( Deque ) +
+      ranges.size() * sizeof( SEntryRange ) + sizeof( std::atomic< bool > );
+   if( m_shared ) {
+      void* memory = mmap( 0, m_memorySize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+      if( memory == MAP_FAILED ) {
+         throw SError( "Couldn't allocate shared memory for the work queue",
+                       SError::SkipCycle );
+      }
+      m_memory = static_cast< char* >( memory );
+   } else {
+      m_memory = new char[ m_memorySize ];
+   }
+   m_deques = reinterpret_cast< Deque* >( m_memory );
+   m_ranges = reinterpret_cast< SEntryRange* >( m_memory + m_nWorkers *
+                                                sizeof( Deque ) );
+   m_stopped = new( m_memory + m_nWorkers * sizeof( Deque ) +
+                    ranges.size() * sizeof( SEntryRange ) )
+      std::atomic< bool >( false );
+
+   //
+   // Copy the ranges, and count the entries in them:
+   //
+   Long64_t totalEntries = 0;
+   for( size_t i = 0; i < ranges.size(); ++i ) {
+      new( m_ranges + i ) SEntryRange( ranges[ i ] );
+      totalEntries += ranges[ i ].last - ranges[ i ].first;
+   }
+
+   //
+   // Distribute the ranges between the workers:
+   //
+   Long64_t index = 0, entries = 0;
+   const Long64_t nRanges = ranges.size();
+   for( UInt_t w = 0; w < m_nWorkers; ++w ) {
+      const Long64_t head = index;
+      const Long64_t limit = ( totalEntries * ( w + 1 ) ) / m_nWorkers;
+      while( ( index < nRanges ) &&
+             ( ( w + 1 == m_nWorkers ) || ( entries < limit ) ) ) {
+         entries += m_ranges[ index ].last - m_ranges[ index ].first;
+         ++index;
+      }
+      new( m_deques + w ) Deque( head, index );
+   }
+}
+
+/**
+ * The destructor releases the memory used by the queue. In shared mode it
+ * should only be called once all the processes using it are finished.
+ */
+SWorkQueue::~SWorkQueue() {
+
+   for( UInt_t w = 0; w < m_nWorkers; ++w ) {
+      m_deques[ w ].~Deque();
+   }
+   typedef std::atomic< bool > flag_type;
+   m_stopped->~flag_type();
+   if( m_shared ) {
+      munmap( m_memory, m_memorySize );
+   } else {
+      delete[] m_memory;
+   }
+}
+
+/**
+ * The workers first process all the ranges assigned to them, and then try
+ * to help out the other workers.
+ *
+ * @param worker The index of the worker asking for more work
+ * @param range The range to process (output)
+ * @returns <code>kTRUE</code> if a new range was given to the worker,
+ *          <code>kFALSE</code> if there is no work left
+ */
+Bool_t SWorkQueue::Next( UInt_t worker, SEntryRange& range ) {
+
+   if( worker >= m_nWorkers ) {
+      throw SError( "Invalid worker index given to SWorkQueue::Next",
+                    SError::SkipCycle );
+   }
+
+   if( m_stopped->load( std::memory_order_relaxed ) ) {
+      return kFALSE;
+   }
+
+   return ( Pop( worker, range ) || Steal( worker, range ) );
+}
+
+/**
+ * The range is not taken from the queue. Only the worker's own deque is
+ * looked at, as the range that the worker would steal from the others
+ * can't be known in advance. (The returned range may still be stolen by
+ * another worker, if it's the last one in the deque.)
+ *
+ * @param worker The index of the worker
+ * @param range The range that the worker would process next (output)
+ * @returns <code>kTRUE</code> if the worker's own deque still has a range
+ */
+Bool_t SWorkQueue::Peek( UInt_t worker, SEntryRange& range ) {
+
+   if( ( worker >= m_nWorkers ) ||
+       m_stopped->load( std::memory_order_relaxed ) ) {
+      return kFALSE;
+   }
+
+   Deque& deque = m_deques[ worker ];
+   Bool_t result = kFALSE;
+   deque.Lock();
+   const Long64_t head = deque.head.load( std::memory_order_relaxed );
+   if( head < deque.tail.load( std::memory_order_relaxed ) ) {
+      range = m_ranges[ head ];
+      result = kTRUE;
+   }
+   deque.Unlock();
+
+   return result;
+}
+
+/**
+ * The workers receive no more ranges after this call. The ranges that they
+ * are processing at the moment are not interrupted.
+ */
+void SWorkQueue::Stop() {
+
+   m_stopped->store( true, std::memory_order_relaxed );
+   return;
+}
+
+/**
+ * @param worker The index of the worker asking for more work
+ * @param range The range to process (output)
+ * @returns <code>kTRUE</code> if the worker's own deque still had a range
+ */
+Bool_t SWorkQueue::Pop( UInt_t worker, SEntryRange& range ) {
+
+   Deque& deque = m_deques[ worker ];
+   Bool_t result = kFALSE;
+   deque.Lock();
+   const Long64_t head = deque.head.load( std::memory_order_relaxed );
+   if( head < deque.tail.load( std::memory_order_relaxed ) ) {
+      range = m_ranges[ head ];
+      deque.head.store( head + 1, std::memory_order_relaxed );
+      result = kTRUE;
+   }
+   deque.Unlock();
+
+   return result;
+}
+
+/**
+ * @param worker The index of the worker asking for more work
+ * @param range The range to process (output)
+ * @returns <code>kTRUE</code> if a range could be taken from another worker
+ */
+Bool_t SWorkQueue::Steal( UInt_t worker, SEntryRange& range ) {
+
+   while( true ) {
+
+      // Find the worker with the most work left:
+      UInt_t victim = m_nWorkers;
+      Long64_t maxSize = 0;
+      for( UInt_t w = 0; w < m_nWorkers; ++w ) {
+         if( w == worker ) continue;
+         const Long64_t size = m_deques[ w ].Size();
+         if( size > maxSize ) {
+            maxSize = size;
+            victim = w;
+         }
+      }
+      if( victim == m_nWorkers ) {
+         return kFALSE;
+      }
+
+      // Try to take its last range. If somebody else was faster, try again.
+      Deque& deque = m_deques[ victim ];
+      deque.Lock();
+      const Long64_t tail = deque.tail.load( std::memory_order_relaxed );
+      if( deque.head.load( std::memory_order_relaxed ) < tail ) {
+         range = m_ranges[ tail - 1 ];
+         deque.tail.store( tail - 1, std::memory_order_relaxed );
+         deque.Unlock();
+         return kTRUE;
+      }
+      deque.Unlock();
+   }
+
+   return kFALSE;
+}
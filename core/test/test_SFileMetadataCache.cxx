@@ -0,0 +1,295 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+//
+// Test checking that SFileMetadataCache gives back the stored descriptions
+// of the input files, but only for the same version of the files, that it
+// merges the trees stored for the same file by different jobs, and that it
+// ignores damaged cache files instead of crashing on them.
+//
+
+// System include(s):
+#include <stdio.h>
+
+// STL include(s):
+#include <string>
+#include <vector>
+
+// ROOT include(s):
+#include <TString.h>
+#include <TSystem.h>
+
+// Local include(s):
+#include "../include/SFileMetadataCache.h"
+
+namespace {
+
+   /// Path of the (imaginary) input file described in the tests
+   static const char* const INPUT_PATH = "/data/test_SFileMetadataCache.root";
+   /// Size of the input file
+   static const Long64_t INPUT_SIZE = 123456789;
+   /// Modification time of the input file
+   static const Long64_t INPUT_MTIME = 1500000000;
+
+   /// Creates the description of a tree with a few clusters
+   SFileMetadataCache::TreeInfo MakeTree( const char* name,
+                                          Long64_t clusterSize ) {
+
+      SFileMetadataCache::TreeInfo tree;
+      tree.name = name;
+      tree.clusters.push_back( std::make_pair( clusterSize, 10LL ) );
+      tree.clusters.push_back( std::make_pair( 17LL, 1LL ) );
+      tree.entries = 10 * clusterSize + 17;
+      return tree;
+   }
+
+   /// Creates the description of the input file with the specified tree
+   SFileMetadataCache::FileInfo
+   MakeFile( const SFileMetadataCache::TreeInfo& tree ) {
+
+      SFileMetadataCache::FileInfo file;
+      file.path = INPUT_PATH;
+      file.size = INPUT_SIZE;
+      file.mtime = INPUT_MTIME;
+      file.trees.push_back( tree );
+      return file;
+   }
+
+   /// Stores the description of one file in the cache
+   Bool_t StoreFile( const SFileMetadataCache::FileInfo& file ) {
+
+      return SFileMetadataCache::Instance()->Store(
+         std::vector< SFileMetadataCache::FileInfo >( 1, file ) );
+   }
+
+   /**
+    * @param info The description of the file found in the cache
+    * @param tree The expected description of one of its trees
+    * @returns <code>true</code> if the file description has the tree
+    */
+   bool HasTree( const SFileMetadataCache::FileInfo& info,
+                 const SFileMetadataCache::TreeInfo& tree ) {
+
+      for( size_t i = 0; i < info.trees.size(); ++i ) {
+         if( ( info.trees[ i ].name == tree.name ) &&
+             ( info.trees[ i ].entries == tree.entries ) &&
+             ( info.trees[ i ].clusters == tree.clusters ) ) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   /// Reads the whole contents of a file
+   std::string ReadFile( const TString& fileName ) {
+
+      std::string result;
+      FILE* file = fopen( fileName.Data(), "rb" );
+      if( ! file ) {
+         return result;
+      }
+      char buffer[ 4096 ];
+      size_t nRead = 0;
+      while( ( nRead = fread( buffer, 1, sizeof( buffer ), file ) ) > 0 ) {
+         result.append( buffer, nRead );
+      }
+      fclose( file );
+      return result;
+   }
+
+   /// Replaces the contents of a file
+   void WriteFile( const TString& fileName, const std::string& content ) {
+
+      FILE* file = fopen( fileName.Data(), "wb" );
+      if( ! file ) {
+         return;
+      }
+      fwrite( content.data(), 1, content.size(), file );
+      fclose( file );
+      return;
+   }
+
+   /**
+    * Checks that a stored description can be looked up, but only with the
+    * size and modification time that it was stored with.
+    */
+   int TestRoundTrip() {
+
+      const SFileMetadataCache::TreeInfo tree = MakeTree( "CollectionTree",
+                                                          1000 );
+      int problems = 0;
+      if( ! StoreFile( MakeFile( tree ) ) ) {
+         printf( "ERROR: Couldn't store the file description\n" );
+         ++problems;
+      }
+
+      SFileMetadataCache* cache = SFileMetadataCache::Instance();
+      SFileMetadataCache::FileInfo info;
+      if( ! cache->Lookup( INPUT_PATH, INPUT_SIZE, INPUT_MTIME, info ) ) {
+         printf( "ERROR: Stored file not found in the cache\n" );
+         ++problems;
+      } else if( ( info.path != INPUT_PATH ) || ( info.size != INPUT_SIZE ) ||
+                 ( info.mtime != INPUT_MTIME ) ||
+                 ( info.trees.size() != 1 ) || ( ! HasTree( info, tree ) ) ) {
+         printf( "ERROR: Wrong file description found in the cache\n" );
+         ++problems;
+      }
+      if( cache->Lookup( INPUT_PATH, INPUT_SIZE + 1, INPUT_MTIME, info ) ) {
+         printf( "ERROR: File with a different size found in the cache\n" );
+         ++problems;
+      }
+      if( cache->Lookup( INPUT_PATH, INPUT_SIZE, INPUT_MTIME + 1, info ) ) {
+         printf( "ERROR: File with a different modification time found in "
+                 "the cache\n" );
+         ++problems;
+      }
+      if( cache->Lookup( "/data/other.root", INPUT_SIZE, INPUT_MTIME,
+                         info ) ) {
+         printf( "ERROR: Unknown file found in the cache\n" );
+         ++problems;
+      }
+
+      printf( "%s: Store and lookup\n", ( problems ? "FAILED" : "OK" ) );
+      return problems;
+   }
+
+   /**
+    * Checks that the trees stored by two jobs for the same version of a file
+    * are both kept, and that a new version of the file replaces them.
+    */
+   int TestMerge() {
+
+      const SFileMetadataCache::TreeInfo tree1 = MakeTree( "CollectionTree",
+                                                           1000 );
+      const SFileMetadataCache::TreeInfo tree2 = MakeTree( "MetaData", 50 );
+      int problems = 0;
+      if( ! ( StoreFile( MakeFile( tree1 ) ) &&
+              StoreFile( MakeFile( tree2 ) ) ) ) {
+         printf( "ERROR: Couldn't store the file descriptions\n" );
+         ++problems;
+      }
+
+      SFileMetadataCache* cache = SFileMetadataCache::Instance();
+      SFileMetadataCache::FileInfo info;
+      if( ! cache->Lookup( INPUT_PATH, INPUT_SIZE, INPUT_MTIME, info ) ) {
+         printf( "ERROR: Stored file not found in the cache\n" );
+         ++problems;
+      } else if( ( info.trees.size() != 2 ) || ( ! HasTree( info, tree1 ) ) ||
+                 ( ! HasTree( info, tree2 ) ) ) {
+         printf( "ERROR: The trees of the two descriptions were not "
+                 "merged\n" );
+         ++problems;
+      }
+
+      SFileMetadataCache::FileInfo modified = MakeFile( tree2 );
+      modified.mtime = INPUT_MTIME + 1;
+      if( ! StoreFile( modified ) ) {
+         printf( "ERROR: Couldn't store the modified file description\n" );
+         ++problems;
+      }
+      if( ! cache->Lookup( INPUT_PATH, INPUT_SIZE, INPUT_MTIME + 1, info ) ) {
+         printf( "ERROR: Modified file not found in the cache\n" );
+         ++problems;
+      } else if( ( info.trees.size() != 1 ) || ( ! HasTree( info, tree2 ) ) ) {
+         printf( "ERROR: Trees of the old file version kept in the cache\n" );
+         ++problems;
+      }
+      if( cache->Lookup( INPUT_PATH, INPUT_SIZE, INPUT_MTIME, info ) ) {
+         printf( "ERROR: Old file version found in the cache\n" );
+         ++problems;
+      }
+
+      printf( "%s: Merging of trees\n", ( problems ? "FAILED" : "OK" ) );
+      return problems;
+   }
+
+   /**
+    * Replaces the cache file with a damaged version, and checks that the
+    * cache ignores it, and that the next Store(...) call replaces it with a
+    * valid file.
+    */
+   int TestDamaged( const TString& fileName, const std::string& content,
+                    const char* name ) {
+
+      WriteFile( fileName, content );
+      SFileMetadataCache* cache = SFileMetadataCache::Instance();
+      // Forget about the previously mapped version of the file:
+      cache->SetFileName( fileName );
+
+      int problems = 0;
+      SFileMetadataCache::FileInfo info;
+      if( cache->Lookup( INPUT_PATH, INPUT_SIZE, INPUT_MTIME, info ) ) {
+         printf( "ERROR: %s: File found in a damaged cache\n", name );
+         ++problems;
+      }
+
+      const SFileMetadataCache::TreeInfo tree = MakeTree( "CollectionTree",
+                                                          1000 );
+      if( ! StoreFile( MakeFile( tree ) ) ) {
+         printf( "ERROR: %s: Couldn't replace the damaged cache\n", name );
+         ++problems;
+      }
+      if( ! ( cache->Lookup( INPUT_PATH, INPUT_SIZE, INPUT_MTIME, info ) &&
+              HasTree( info, tree ) ) ) {
+         printf( "ERROR: %s: Stored file not found in the replaced cache\n",
+                 name );
+         ++problems;
+      }
+
+      printf( "%s: %s\n", ( problems ? "FAILED" : "OK" ), name );
+      return problems;
+   }
+
+} // private namespace
+
+int main() {
+
+   const TString fileName = TString( gSystem->TempDirectory() ) +
+      TString::Format( "/test_SFileMetadataCache.%d.cache",
+                       gSystem->GetPid() );
+   gSystem->Unlink( fileName );
+   SFileMetadataCache::Instance()->SetFileName( fileName );
+
+   int result = 0;
+   result += TestRoundTrip();
+   result += TestMerge();
+
+   // A valid cache file, used to create the damaged versions:
+   const std::string valid = ReadFile( fileName );
+   if( valid.size() < 64 ) {
+      printf( "ERROR: Cache file not written\n" );
+      ++result;
+   } else {
+      result += TestDamaged( fileName, valid.substr( 0, valid.size() / 2 ),
+                             "Truncated cache file" );
+      result += TestDamaged( fileName, std::string( valid.size(), '\xff' ),
+                             "Garbled cache file" );
+      // Keep the header intact, but damage the records themselves:
+      std::string records( valid );
+      for( size_t i = 32; i < records.size() - 16; ++i ) {
+         records[ i ] = '\xff';
+      }
+      result += TestDamaged( fileName, records, "Garbled cache records" );
+      // Keep the header and the records, but damage the index:
+      std::string index( valid );
+      for( size_t i = index.size() - 16; i < index.size(); ++i ) {
+         index[ i ] = '\x7f';
+      }
+      result += TestDamaged( fileName, index, "Garbled cache index" );
+   }
+   result += TestDamaged( fileName, "", "Empty cache file" );
+
+   SFileMetadataCache::Instance()->SetFileName( "" );
+   gSystem->Unlink( fileName );
+   gSystem->Unlink( fileName + ".lock" );
+
+   return ( result ? 1 : 0 );
+}
@@ -0,0 +1,143 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+//
+// Test checking that SInputColumn reads the same values as reading a branch
+// entry by entry with TTree::GetEntry(...), while a variable of the "cycle"
+// is connected to the same branch.
+//
+
+// System include(s):
+#include <stdio.h>
+
+// STL include(s):
+#include <algorithm>
+
+// ROOT include(s):
+#include <TFile.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TLeaf.h>
+#include <TString.h>
+#include <TSystem.h>
+
+// Local include(s):
+#include "../include/SInputColumn.h"
+
+namespace {
+
+   /// Number of entries in the test tree
+   static const Long64_t NENTRIES = 5000;
+   /// Number of entries accessed at a time (not aligned with the baskets)
+   static const Long64_t BLOCKSIZE = 77;
+
+   /**
+    * Reads a branch both through a column and through a variable connected
+    * to it, and compares the values.
+    *
+    * @returns The number of differences found
+    */
+   template< typename T >
+   int CheckColumn( TTree* tree, const char* name ) {
+
+      TBranch* branch = tree->GetBranch( name );
+      if( ! branch ) {
+         printf( "ERROR: Branch %s not found\n", name );
+         return 1;
+      }
+      T variable = T();
+      tree->SetBranchAddress( name, &variable );
+      SInputColumn< T > column;
+      column.Connect( branch, tree->GetLeaf( name ) );
+
+      int differences = 0;
+      for( Long64_t first = 0; first < NENTRIES; first += BLOCKSIZE ) {
+         const Long64_t count = std::min( BLOCKSIZE, NENTRIES - first );
+         const T* values = column.Get( first, count );
+         for( Long64_t i = 0; i < count; ++i ) {
+            if( branch->GetEntry( first + i ) <= 0 ) {
+               printf( "ERROR: Couldn't read entry %lld of branch %s\n",
+                       first + i, name );
+               return differences + 1;
+            }
+            if( values[ i ] != variable ) {
+               if( differences < 10 ) {
+                  printf( "ERROR: Branch %s, entry %lld: column value %g, "
+                          "GetEntry value %g\n", name, first + i,
+                          static_cast< double >( values[ i ] ),
+                          static_cast< double >( variable ) );
+               }
+               ++differences;
+            }
+         }
+      }
+
+      tree->ResetBranchAddresses();
+      printf( "%s: Branch %s checked\n", ( differences ? "FAILED" : "OK" ),
+              name );
+      return differences;
+   }
+
+} // private namespace
+
+int main() {
+
+   //
+   // Write a small tree with many baskets:
+   //
+   const TString fileName = TString( gSystem->TempDirectory() ) +
+      "/test_SInputColumn.root";
+   TFile* ofile = TFile::Open( fileName, "RECREATE" );
+   if( ! ofile ) {
+      printf( "ERROR: Couldn't create %s\n", fileName.Data() );
+      return 1;
+   }
+   TTree* otree = new TTree( "TestTree", "SInputColumn test tree" );
+   Float_t f = 0;
+   Int_t n = 0;
+   Double_t d = 0;
+   Long64_t l = 0;
+   otree->Branch( "f", &f, "f/F", 1024 );
+   otree->Branch( "n", &n, "n/I", 1024 );
+   otree->Branch( "d", &d, "d/D", 1024 );
+   otree->Branch( "l", &l, "l/L", 1024 );
+   for( Long64_t i = 0; i < NENTRIES; ++i ) {
+      f = 1.5 * i + 0.25;
+      n = 1000 * i - 7;
+      d = 1e6 + 1e-3 * i;
+      l = 1000000007LL * i;
+      otree->Fill();
+   }
+   ofile->Write();
+   ofile->Close();
+   delete ofile;
+
+   //
+   // Read it back through columns:
+   //
+   TFile* ifile = TFile::Open( fileName, "READ" );
+   TTree* itree = ( ifile ?
+                    dynamic_cast< TTree* >( ifile->Get( "TestTree" ) ) : 0 );
+   int result = 1;
+   if( itree ) {
+      result = 0;
+      result += CheckColumn< Float_t >( itree, "f" );
+      result += CheckColumn< Int_t >( itree, "n" );
+      result += CheckColumn< Double_t >( itree, "d" );
+      result += CheckColumn< Long64_t >( itree, "l" );
+   } else {
+      printf( "ERROR: Couldn't read back %s\n", fileName.Data() );
+   }
+   delete ifile;
+   gSystem->Unlink( fileName );
+
+   return ( result ? 1 : 0 );
+}
@@ -0,0 +1,187 @@
+// $Id$
+/***************************************************************************
+ * @Project: SFrame - ROOT-based analysis framework for ATLAS
+ * @Package: Core
+ *
+ * @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+ * @author David Berge      <David.Berge@cern.ch>          - CERN
+ * @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+ * @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - NYU/Debrecen
+ *
+ ***************************************************************************/
+//
+// Test checking that SWorkQueue hands out every entry range exactly once,
+// both to a single worker stealing from all the others, and to multiple
+// workers running on separate threads. It also checks that Stop() ends the
+// hand-out of the ranges.
+//
+
+// System include(s):
+#include <stdio.h>
+
+// STL include(s):
+#include <thread>
+#include <vector>
+
+// Local include(s):
+#include "../include/SWorkQueue.h"
+
+namespace {
+
+   /// Number of ranges in the test queue
+   static const Int_t NRANGES = 101;
+   /// Number of workers using the test queue
+   static const UInt_t NWORKERS = 4;
+
+   /**
+    * Creates ranges of very different sizes, like the clusters of input
+    * files of different sizes would be. The index of each range is stored
+    * as its tree index, so that the ranges could be identified.
+    */
+   std::vector< SEntryRange > MakeRanges() {
+
+      std::vector< SEntryRange > result;
+      Long64_t first = 0;
+      for( Int_t i = 0; i < NRANGES; ++i ) {
+         const Long64_t size = ( i % 7 == 0 ? 5000 : 1 + ( i * 37 ) % 200 );
+         result.push_back( SEntryRange( first, first + size, i ) );
+         first += size;
+      }
+
+      return result;
+   }
+
+   /**
+    * @param ranges The ranges handed out by the queue
+    * @param name Name of the test, used in the printed messages
+    * @returns The number of problems found
+    */
+   int CheckRanges( const std::vector< SEntryRange >& ranges,
+                    const char* name ) {
+
+      const std::vector< SEntryRange > reference = MakeRanges();
+      std::vector< int > count( NRANGES, 0 );
+      int problems = 0;
+      for( size_t i = 0; i < ranges.size(); ++i ) {
+         const Int_t index = ranges[ i ].tree;
+         if( ( index < 0 ) || ( index >= NRANGES ) ||
+             ( ranges[ i ].first != reference[ index ].first ) ||
+             ( ranges[ i ].last != reference[ index ].last ) ) {
+            printf( "ERROR: %s: Unknown range [%lld, %lld) handed out\n",
+                    name, ranges[ i ].first, ranges[ i ].last );
+            ++problems;
+            continue;
+         }
+         ++count[ index ];
+      }
+      for( Int_t i = 0; i < NRANGES; ++i ) {
+         if( count[ i ] != 1 ) {
+            printf( "ERROR: %s: Range %i handed out %i times\n", name, i,
+                    count[ i ] );
+            ++problems;
+         }
+      }
+
+      printf( "%s: %s\n", ( problems ? "FAILED" : "OK" ), name );
+      return problems;
+   }
+
+   /**
+    * Drains the queue with a single worker, which has to steal the ranges of
+    * all the other workers. It also checks that Peek(...) shows the range
+    * that the worker gets next from its own deque.
+    */
+   int TestSingleWorker() {
+
+      SWorkQueue queue( MakeRanges(), NWORKERS );
+      std::vector< SEntryRange > ranges;
+      SEntryRange range, next;
+      int problems = 0;
+      while( true ) {
+         const Bool_t peeked = queue.Peek( 1, next );
+         if( ! queue.Next( 1, range ) ) {
+            break;
+         }
+         if( peeked && ( next.tree != range.tree ) ) {
+            printf( "ERROR: Peek(...) returned range %i, Next(...) %i\n",
+                    next.tree, range.tree );
+            ++problems;
+         }
+         ranges.push_back( range );
+      }
+      for( UInt_t w = 0; w < NWORKERS; ++w ) {
+         if( queue.Next( w, range ) ) {
+            printf( "ERROR: Worker %u received a range from an empty queue\n",
+                    w );
+            ++problems;
+         }
+      }
+
+      return problems + CheckRanges( ranges, "Single worker" );
+   }
+
+   /**
+    * Drains the queue with all the workers running in parallel on separate
+    * threads.
+    */
+   int TestThreads( UInt_t nWorkers, Bool_t shared, const char* name ) {
+
+      SWorkQueue queue( MakeRanges(), nWorkers, shared );
+      std::vector< std::vector< SEntryRange > > ranges( nWorkers );
+      std::vector< std::thread > threads;
+      for( UInt_t w = 0; w < nWorkers; ++w ) {
+         threads.push_back( std::thread( [ &queue, &ranges, w ]() {
+                  SEntryRange range;
+                  while( queue.Next( w, range ) ) {
+                     ranges[ w ].push_back( range );
+                  }
+               } ) );
+      }
+      for( UInt_t w = 0; w < nWorkers; ++w ) {
+         threads[ w ].join();
+      }
+
+      std::vector< SEntryRange > all;
+      for( UInt_t w = 0; w < nWorkers; ++w ) {
+         all.insert( all.end(), ranges[ w ].begin(), ranges[ w ].end() );
+      }
+      return CheckRanges( all, name );
+   }
+
+   /**
+    * Checks that no more ranges are handed out after Stop() is called.
+    */
+   int TestStop() {
+
+      SWorkQueue queue( MakeRanges(), NWORKERS );
+      SEntryRange range;
+      int problems = 0;
+      if( ! queue.Next( 0, range ) ) {
+         printf( "ERROR: No range received from a full queue\n" );
+         ++problems;
+      }
+      queue.Stop();
+      for( UInt_t w = 0; w < NWORKERS; ++w ) {
+         if( queue.Next( w, range ) || queue.Peek( w, range ) ) {
+            printf( "ERROR: Worker %u received a range after Stop()\n", w );
+            ++problems;
+         }
+      }
+
+      printf( "%s: Stop\n", ( problems ? "FAILED" : "OK" ) );
+      return problems;
+   }
+
+} // private namespace
+
+int main() {
+
+   int result = 0;
+   result += TestSingleWorker();
+   result += TestThreads( NWORKERS, kFALSE, "Threads" );
+   result += TestThreads( NWORKERS, kTRUE, "Threads with shared memory" );
+   result += TestThreads( 2 * NRANGES, kFALSE, "More workers than ranges" );
+   result += TestStop();
+
+   return ( result ? 1 : 0 );
+}
@@ -227,9 +227,13 @@ void FirstCycle::ExecuteEvent( const SInputData&, Double_t weight ) {
    ( *m_test )[ 0 ]++;
 
    // Perform event selection. If you don't want to write out
-   // an event, you have to throw an exception anywhere in the ExecuteEvent
-   // method (or in a method called by ExecuteEvent) like this:
-   if( ! m_El_N ) throw SError( SError::SkipEvent );
+   // an event, you can mark it as rejected and return from ExecuteEvent.
+   // (Throwing an SError with SkipEvent severity anywhere in the
+   // ExecuteEvent method has the same effect, but is slower.)
+   if( ! m_El_N ) {
+      SetEventRejected();
+      return;
+   }
 
    // Count the number of events that passed the selection:
    ++m_passedEvents;
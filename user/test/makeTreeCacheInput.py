@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+# $Id$
+#***************************************************************************
+#* @Project: SFrame - ROOT-based analysis framework for ATLAS
+#* @Package: User
+#*
+#* @author Stefan Ask       <Stefan.Ask@cern.ch>           - Manchester
+#* @author David Berge      <David.Berge@cern.ch>          - CERN
+#* @author Johannes Haller  <Johannes.Haller@cern.ch>      - Hamburg
+#* @author A. Krasznahorkay <Attila.Krasznahorkay@cern.ch> - CERN/Debrecen
+#*
+#***************************************************************************
+#
+# This script writes a small input file for FirstCycle, used by the
+# config/TreeCacheCheck_config.xml reference configuration. The contents of
+# the file are pseudo-random, but always the same.
+#
+
+# Import base module(s):
+import sys
+import math
+import array
+
+##
+# The C(++) style main function
+#
+# @returns <code>0</code> if the file was written, something else otherwise
+def main():
+
+    # Access the command line argument(s):
+    if len( sys.argv ) != 2:
+        print( "Usage: %s <output file>" % sys.argv[ 0 ] )
+        return 255
+
+    import ROOT
+    ofile = ROOT.TFile.Open( sys.argv[ 1 ], "RECREATE" )
+    if ( not ofile ) or ofile.IsZombie():
+        print( "ERROR: Couldn't create %s" % sys.argv[ 1 ] )
+        return 1
+
+    # Write many small baskets, so that the tree cache has work to do:
+    tree = ROOT.TTree( "FullRec0", "Reference input of FirstCycle" )
+    tree.SetAutoFlush( 500 )
+    nElectrons = array.array( "i", [ 0 ] )
+    tree.Branch( "El_N", nElectrons, "El_N/I" )
+    variables = {}
+    for name in [ "El_p_T", "El_eta", "El_phi", "El_E" ]:
+        variables[ name ] = ROOT.std.vector( "double" )()
+        tree.Branch( name, variables[ name ] )
+
+    random = ROOT.TRandom3( 4357 )
+    for entry in range( 5000 ):
+        nElectrons[ 0 ] = random.Poisson( 1.5 )
+        for variable in variables.values():
+            variable.clear()
+        for i in range( nElectrons[ 0 ] ):
+            pt = random.Exp( 20000.0 )
+            eta = random.Uniform( -2.5, 2.5 )
+            variables[ "El_p_T" ].push_back( pt )
+            variables[ "El_eta" ].push_back( eta )
+            variables[ "El_phi" ].push_back( random.Uniform( -math.pi,
+                                                             math.pi ) )
+            variables[ "El_E" ].push_back( pt * math.cosh( eta ) )
+        tree.Fill()
+
+    ofile.Write()
+    ofile.Close()
+
+    # Return gracefully:
+    return 0
+
+# Execute the main function:
+if __name__ == "__main__":
+    sys.exit( main() )